@@ -12,7 +12,10 @@ usage() {
     echo "Usage:"
     echo
     echo "runTest.sh TEST_TYPE TEST_BINARY [TEST_ARGS]"
-    echo "where TEST_TYPE can either be --plain, --simulation or --parallel-simulation=\$NUM_CORES (is '$TEST_TYPE')."
+    echo "where TEST_TYPE can either be --plain, --parallel-program=\$NUM_CORES, --simulation,"
+    echo "--parallel-simulation=\$NUM_CORES, --restart,"
+    echo "--parallel-restart=\$NUM_WRITING_CORES,\$NUM_READING_CORES, --parameters or"
+    echo "--replay-linear-system (is '$TEST_TYPE')."
 };
 
 validateResults() {
@@ -34,6 +37,21 @@ validateResults() {
     exit 1
 }
 
+# prints the names of the result files which were written by a given process of a
+# simulation that was run using a given number of processes
+resultFiles()
+{
+    local NUM_PROCS="$1"
+    local PROC_NUM="$2"
+    local SIM_NAME="$3"
+
+    local PREFIX="$SIM_NAME"
+    if test "$NUM_PROCS" -gt 1; then
+        PREFIX=$(printf "s%04d-p%04d-%s" "$NUM_PROCS" "$PROC_NUM" "$SIM_NAME")
+    fi
+    ls -- "$PREFIX"-[0-9]*.vt[up] 2> /dev/null
+}
+
 # this function clips the help message printed by an ewoms simulation
 # to what is actually printed, throwing away all garbage which is
 # printed before or after the "meat"
@@ -182,6 +200,116 @@ case "$TEST_TYPE" in
         exit 0
         ;;        
 
+    "--parallel-restart="*)
+        # write the restart files using a given number of processes and resume the
+        # simulation from the last of them using a different one. the final result is
+        # compared with the one of a simulation which is not interrupted and uses the
+        # number of processes of the resumed simulation.
+        NUM_PROCS="${TEST_TYPE/--parallel-restart=/}"
+        NUM_WRITING_PROCS="${NUM_PROCS%,*}"
+        NUM_READING_PROCS="${NUM_PROCS#*,}"
+
+        # the uninterrupted simulation must run first because it writes restart files
+        # with the same names
+        echo "executing \"mpirun -np \"$NUM_READING_PROCS\" $TEST_BINARY $TEST_ARGS\""
+        mpirun -np "$NUM_READING_PROCS" "$TEST_BINARY" $TEST_ARGS | tee "test-$RND.log"
+        RET="${PIPESTATUS[0]}"
+        if test "$RET" != "0"; then
+            echo "Executing the binary failed!"
+            rm "test-$RND.log"
+            exit 1
+        fi
+        SIM_NAME=$(grep "Applying the initial solution of the" "test-$RND.log" | sed "s/.*\"\(.*\)\".*/\1/" | head -n1)
+        rm "test-$RND.log"
+
+        for ((PROC_NUM=0; PROC_NUM < NUM_READING_PROCS; ++PROC_NUM)); do
+            REF_RESULT=$(resultFiles "$NUM_READING_PROCS" "$PROC_NUM" "$SIM_NAME" | tail -n 1)
+            if ! test -r "$REF_RESULT"; then
+                echo "The result of process $PROC_NUM of the uninterrupted simulation is not readable"
+                exit 1
+            fi
+            mv "$REF_RESULT" "ref-$RND-p$PROC_NUM.${REF_RESULT##*.}"
+
+            # make sure that only the results of the resumed simulation are considered
+            resultFiles "$NUM_READING_PROCS" "$PROC_NUM" "$SIM_NAME" | xargs -r rm --
+        done
+
+        echo "executing \"mpirun -np \"$NUM_WRITING_PROCS\" $TEST_BINARY $TEST_ARGS\""
+        mpirun -np "$NUM_WRITING_PROCS" "$TEST_BINARY" $TEST_ARGS | tee "test-$RND.log"
+        RET="${PIPESTATUS[0]}"
+        if test "$RET" != "0"; then
+            echo "Executing the binary failed!"
+            rm "test-$RND.log" "ref-$RND-p"*
+            exit 1
+        fi
+        RESTART_TIME=$(grep "Serialize" "test-$RND.log" | tail -n 1 | sed "s/.*time=\([0-9.e+\-]*\).*/\1/")
+        rm "test-$RND.log"
+
+        echo "executing \"mpirun -np \"$NUM_READING_PROCS\" $TEST_BINARY $TEST_ARGS --restart-time=$RESTART_TIME\""
+        if ! mpirun -np "$NUM_READING_PROCS" "$TEST_BINARY" $TEST_ARGS --restart-time="$RESTART_TIME"; then
+            echo "Restarting $TEST_BINARY using $NUM_READING_PROCS processes failed"
+            rm "ref-$RND-p"*
+            exit 1;
+        fi
+
+        echo "######################"
+        echo "# Comparing results"
+        echo "######################"
+        for ((PROC_NUM=0; PROC_NUM < NUM_READING_PROCS; ++PROC_NUM)); do
+            TEST_RESULT=$(resultFiles "$NUM_READING_PROCS" "$PROC_NUM" "$SIM_NAME" | tail -n 1)
+            if ! test -r "$TEST_RESULT"; then
+                echo "The result of process $PROC_NUM of the resumed simulation is not readable"
+                rm "ref-$RND-p"*
+                exit 1
+            fi
+            REF_RESULT="ref-$RND-p$PROC_NUM.${TEST_RESULT##*.}"
+            echo "Comparing \"$TEST_RESULT\" with the result of the uninterrupted simulation"
+            if ! python "${MY_DIR}/fuzzycomparevtu.py" "$REF_RESULT" "$TEST_RESULT"; then
+                echo "The result of process $PROC_NUM of the resumed simulation differs from the one of the uninterrupted simulation"
+                rm "ref-$RND-p"*
+                exit 1
+            fi
+        done
+        rm "ref-$RND-p"*
+        exit 0
+        ;;
+
+    "--replay-linear-system")
+        # write the first linear system of the simulation and its parameters to disk
+        # and replay it using a direct and an iterative solver backend
+        echo "executing \"$TEST_BINARY $TEST_ARGS\""
+        if ! "$TEST_BINARY" $TEST_ARGS \
+             --linear-system-dump-file-name="linsys-$RND" \
+             --linear-system-dump-interval=1000000; then
+            echo "Executing the binary failed!"
+            rm -f "linsys-$RND"-*.ewls "linsys-$RND"-*.param
+            exit 1
+        fi
+
+        REPLAY_BINARY=$(find -type f -executable -name "replaylinearsystem")
+        if ! test -x "$REPLAY_BINARY"; then
+            echo "The replaylinearsystem binary could not be found"
+            rm -f "linsys-$RND"-*.ewls "linsys-$RND"-*.param
+            exit 1
+        fi
+
+        REPLAY_LOG="$("$REPLAY_BINARY" --solvers=bicgstab,block-lu --preconditioners=ilu0 "linsys-$RND-0.ewls")"
+        RET="$?"
+        echo "$REPLAY_LOG"
+        rm -f "linsys-$RND"-*.ewls "linsys-$RND"-*.param
+        if test "$RET" != "0"; then
+            echo "Replaying the linear system failed"
+            exit 1
+        elif ! echo "$REPLAY_LOG" | grep -q "^Using the parameters of the simulation"; then
+            echo "The parameters of the simulation were not used for the replay"
+            exit 1
+        elif echo "$REPLAY_LOG" | grep -q "^bicgstab *ilu0 *no "; then
+            echo "The replayed linear system could not be solved"
+            exit 1
+        fi
+        exit 0
+        ;;
+
     "--parameters")
         HELP_MSG="$($TEST_BINARY --help | clipToHelpMessage)"
         if test "$(echo "$HELP_MSG" | grep -i usage)" == ''; then
@@ -228,6 +356,20 @@ EOF
             exit 1
         fi
 
+        exit 0
+        ;;
+
+    "--parallel-program="*)
+        # run a program in parallel without comparing its results, e.g., because
+        # they depend on the wall-clock time or there are no parallel references
+        NUM_PROCS="${TEST_TYPE/--parallel-program=/}"
+
+        echo "executing \"mpirun -np \"$NUM_PROCS\" $TEST_BINARY $TEST_ARGS\""
+        if ! mpirun -np "$NUM_PROCS" "$TEST_BINARY" $TEST_ARGS; then
+            echo "Executing the binary failed!"
+            exit 1
+        fi
+
         exit 0
         ;;
 esac
@@ -42,7 +42,16 @@
 
 #include <dune/grid/common/mcmgmapper.hh>
 
+#include <ewoms/linear/overlaptypes.hh>
+
+#if HAVE_MPI
+#include <mpi.h>
+#endif
+
+#include <array>
+#include <cassert>
 #include <stdexcept>
+#include <vector>
 
 namespace Ewoms
 {
@@ -170,8 +179,22 @@ namespace Ewoms
             typename GridManager::Grid, typename GridManager::EquilGrid > :: value ;
 
         CollectDataToIORank( const GridManager& gridManager )
-            : toIORankComm_( )
+            : toIORankComm_( Ewoms::Linear::gridCommunicator( gridManager.grid().comm() ) )
         {
+#if HAVE_MPI
+            gatherComm_ = MPI_COMM_NULL;
+            sendRequests_.fill( MPI_REQUEST_NULL );
+            nextSendBuffer_ = 0;
+
+            // the gather of the output fields uses its own communicator so that its
+            // messages can never be confused with the ones of the simulation
+            if( isParallel() )
+            {
+                MPI_Comm_dup( Ewoms::Linear::gridCommunicator( gridManager.grid().comm() ),
+                              &gatherComm_ );
+            }
+#endif
+
             // index maps only have to be build when reordering is needed
             if( ! needsReordering && ! isParallel() )
             {
@@ -270,123 +293,29 @@ namespace Ewoms
             }
         }
 
-        class PackUnPack : public P2PCommunicatorType::DataHandleInterface
-        {
-            const Opm::data::Solution& localCellData_;
-            Opm::data::Solution& globalCellData_;
-
-            const IndexMapType& localIndexMap_;
-            const IndexMapStorageType& indexMaps_;
-
-        public:
-            PackUnPack( const Opm::data::Solution& localCellData,
-                        Opm::data::Solution& globalCellData,
-                        const IndexMapType& localIndexMap,
-                        const IndexMapStorageType& indexMaps,
-                        const size_t globalSize,
-                        const bool isIORank )
-            : localCellData_( localCellData ),
-              globalCellData_( globalCellData ),
-              localIndexMap_( localIndexMap ),
-              indexMaps_( indexMaps )
-            {
-                if( isIORank )
-                {
-                    // add missing data to global cell data
-                    for (const auto& pair : localCellData_) {
-                        const std::string& key = pair.first;
-                        std::size_t container_size = globalSize;
-                        auto OPM_OPTIM_UNUSED ret = globalCellData_.insert(key, pair.second.dim,
-                                                                           std::vector<double>(container_size),
-                                                                           pair.second.target);
-                        assert(ret.second);
-                    }
-
-                    MessageBufferType buffer;
-                    pack( 0, buffer );
-
-                    // the last index map is the local one
-                    doUnpack( indexMaps.back(), buffer );
-                }
-            }
-
-            // pack all data associated with link
-            void pack( const int link, MessageBufferType& buffer )
-            {
-                // we should only get one link
-                if( link != 0 ) {
-                    OPM_THROW(std::logic_error,"link in method pack is not 0 as expected");
-                }
-
-                // write all cell data registered in local state
-                for (const auto& pair : localCellData_) {
-                    const auto& data = pair.second.data;
-
-                    // write all data from local data to buffer
-                    write( buffer, localIndexMap_, data);
-                }
-
-            }
-
-            void doUnpack( const IndexMapType& indexMap, MessageBufferType& buffer )
-            {
-                // we loop over the data  as
-                // its order governs the order the data got received.
-                for (auto& pair : localCellData_) {
-                    const std::string& key = pair.first;
-                    auto& data = globalCellData_.data(key);
-
-                    //write all data from local cell data to buffer
-                    read( buffer, indexMap, data);
-                }
-            }
-
-            // unpack all data associated with link
-            void unpack( const int link, MessageBufferType& buffer )
-            {
-                doUnpack( indexMaps_[ link ], buffer );
-            }
-
-        protected:
-            template <class Vector>
-            void write( MessageBufferType& buffer,
-                        const IndexMapType& localIndexMap,
-                        const Vector& vector,
-                        const unsigned int offset = 0,
-                        const unsigned int stride = 1 ) const
-            {
-                unsigned int size = localIndexMap.size();
-                buffer.write( size );
-                assert( vector.size() >= stride * size );
-                for( unsigned int i=0; i<size; ++i )
-                {
-                    const unsigned int index = localIndexMap[ i ] * stride + offset;
-                    assert( index < vector.size() );
-                    buffer.write( vector[ index ] );
-                }
-            }
+        CollectDataToIORank( const CollectDataToIORank& ) = delete;
+        CollectDataToIORank& operator=( const CollectDataToIORank& ) = delete;
 
-            template <class Vector>
-            void read( MessageBufferType& buffer,
-                       const IndexMapType& indexMap,
-                       Vector& vector,
-                       const unsigned int offset = 0, const unsigned int stride = 1 ) const
+        ~CollectDataToIORank()
+        {
+#if HAVE_MPI
+            if( gatherComm_ != MPI_COMM_NULL )
             {
-                unsigned int size = 0;
-                buffer.read( size );
-                assert( size == indexMap.size() );
-                for( unsigned int i=0; i<size; ++i )
-                {
-                    const unsigned int index = indexMap[ i ] * stride + offset;
-                    assert( index < vector.size() );
-                    buffer.read( vector[ index ] );
-                }
+                // the data of the last outputs must have left the send buffers before
+                // they are released
+                MPI_Waitall( static_cast<int>( sendRequests_.size() ), sendRequests_.data(),
+                             MPI_STATUSES_IGNORE );
+                MPI_Comm_free( &gatherComm_ );
             }
-
-
-        };
+#endif
+        }
 
         // gather solution to rank 0 for EclipseWriter
+        //
+        // The ranks which are not the I/O rank only post a non-blocking send of their
+        // data and return immediately. Two send buffers are used alternately, so a rank
+        // only needs to wait if the data of the output before the previous one still has
+        // not been received.
         void collect( const Opm::data::Solution& localCellData )
         {
             globalCellData_ = {};
@@ -396,27 +325,38 @@ namespace Ewoms
                 return ;
             }
 
-            // this also packs and unpacks the local buffers one ioRank
-            PackUnPack
-                packUnpack( localCellData,
-                            globalCellData_,
-                            localIndexMap_,
-                            indexMaps_,
-                            numCells(),
-                            isIORank() );
-
-            if ( ! isParallel() )
+#if HAVE_MPI
+            if( isParallel() && ! isIORank() )
             {
-                // no need to collect anything.
+                sendToIORank_( localCellData );
                 return;
             }
+#endif
+
+#if HAVE_MPI
+            // post the receives before dealing with the local data
+            if ( isParallel() )
+                postReceives_( localCellData.size() );
+#endif
 
-            //toIORankComm_.exchangeCached( packUnpack );
-            toIORankComm_.exchange( packUnpack );
+            // add the global fields and copy the data of the I/O rank itself. the last
+            // index map is the local one.
+            const IndexMapType& localIndexMap = indexMaps_.back();
+            for (const auto& pair : localCellData) {
+                const auto& localData = pair.second.data;
+                std::vector<double> globalData( numCells() );
+                for( size_t i = 0; i < localIndexMap_.size(); ++i )
+                    globalData[ localIndexMap[ i ] ] = localData[ localIndexMap_[ i ] ];
+
+                auto OPM_OPTIM_UNUSED ret = globalCellData_.insert(pair.first, pair.second.dim,
+                                                                   std::move(globalData),
+                                                                   pair.second.target);
+                assert(ret.second);
+            }
 
-#ifndef NDEBUG
-            // mkae sure every process is on the same page
-            toIORankComm_.barrier();
+#if HAVE_MPI
+            if ( isParallel() )
+                unpackReceived_( localCellData );
 #endif
         }
 
@@ -425,6 +365,11 @@ namespace Ewoms
             return globalCellData_;
         }
 
+        Opm::data::Solution& globalCellData()
+        {
+            return globalCellData_;
+        }
+
         bool isIORank() const
         {
             return toIORankComm_.rank() == ioRank;
@@ -455,6 +400,77 @@ namespace Ewoms
         size_t numCells () const { return globalCartesianIndex_.size(); }
 
     protected:
+#if HAVE_MPI
+        void sendToIORank_( const Opm::data::Solution& localCellData )
+        {
+            // make sure that the buffer which is about to be filled is not in use by the
+            // send operation of the output before the previous one anymore
+            const int bufIdx = nextSendBuffer_;
+            nextSendBuffer_ = 1 - nextSendBuffer_;
+            MPI_Wait( &sendRequests_[ bufIdx ], MPI_STATUS_IGNORE );
+
+            // the values are stored field by field in the order of the local index map
+            std::vector<double>& buffer = sendBuffers_[ bufIdx ];
+            const size_t numLocal = localIndexMap_.size();
+            buffer.resize( localCellData.size() * numLocal );
+            size_t pos = 0;
+            for (const auto& pair : localCellData) {
+                const auto& data = pair.second.data;
+                assert( data.size() >= numLocal );
+                for( size_t i = 0; i < numLocal; ++i )
+                    buffer[ pos++ ] = data[ localIndexMap_[ i ] ];
+            }
+
+            MPI_Isend( buffer.data(), static_cast<int>( buffer.size() ), MPI_DOUBLE,
+                       ioRank, /*tag=*/0, gatherComm_, &sendRequests_[ bufIdx ] );
+        }
+
+        void postReceives_( const size_t numFields )
+        {
+            const auto& sources = toIORankComm_.recvDest();
+            const size_t numLinks = sources.size();
+            recvBuffers_.resize( numLinks );
+            recvRequests_.resize( numLinks );
+            for( size_t link = 0; link < numLinks; ++link )
+            {
+                std::vector<double>& buffer = recvBuffers_[ link ];
+                buffer.resize( numFields * indexMaps_[ link ].size() );
+                MPI_Irecv( buffer.data(), static_cast<int>( buffer.size() ), MPI_DOUBLE,
+                           sources[ link ], /*tag=*/0, gatherComm_, &recvRequests_[ link ] );
+            }
+        }
+
+        void unpackReceived_( const Opm::data::Solution& localCellData )
+        {
+            MPI_Waitall( static_cast<int>( recvRequests_.size() ), recvRequests_.data(),
+                         MPI_STATUSES_IGNORE );
+
+            // unpack the data in the order of the links, so that the values of cells
+            // which are seen by multiple ranks do not depend on the arrival order
+            for( size_t link = 0; link < recvBuffers_.size(); ++link )
+            {
+                const IndexMapType& indexMap = indexMaps_[ link ];
+                const std::vector<double>& buffer = recvBuffers_[ link ];
+                size_t pos = 0;
+                for (const auto& pair : localCellData) {
+                    auto& data = globalCellData_.data( pair.first );
+                    for( size_t i = 0; i < indexMap.size(); ++i )
+                    {
+                        assert( size_t(indexMap[ i ]) < data.size() );
+                        data[ indexMap[ i ] ] = buffer[ pos++ ];
+                    }
+                }
+            }
+        }
+
+        MPI_Comm                        gatherComm_;
+        std::array< std::vector<double>, 2 > sendBuffers_;
+        std::array< MPI_Request, 2 >    sendRequests_;
+        int                             nextSendBuffer_;
+        std::vector< std::vector<double> > recvBuffers_;
+        std::vector< MPI_Request >      recvRequests_;
+#endif
+
         P2PCommunicatorType             toIORankComm_;
         IndexMapType                    globalCartesianIndex_;
         IndexMapType                    localIndexMap_;
@@ -33,6 +33,14 @@
 #include <dune/alugrid/grid.hh>
 #include <dune/alugrid/common/fromtogridfactory.hh>
 #include <dune/grid/CpGrid.hpp>
+#include <dune/grid/common/mcmgmapper.hh>
+
+#include <dune/common/version.hh>
+
+#include <opm/common/Unused.hpp>
+
+#include <set>
+#include <vector>
 
 namespace Ewoms {
 template <class TypeTag>
@@ -136,8 +144,16 @@ public:
     void loadBalance()
     {
         auto gridView = grid().leafGridView();
+        const std::vector<double>& cellWeights = this->cellLoadWeights_();
         auto dataHandle = cartesianIndexMapper_->dataHandle(gridView);
-        grid().loadBalance(*dataHandle);
+        if (cellWeights.empty())
+            grid().loadBalance(*dataHandle);
+        else {
+            // let ALUGrid's partitioner balance the computational cost of the cells
+            // instead of their number
+            LoadWeights_ loadWeights(gridView, cellWeights);
+            grid().repartition(loadWeights, *dataHandle);
+        }
 
         // communicate non-interior cells values
         grid().communicate(*dataHandle,
@@ -159,6 +175,56 @@ public:
     { return *equilCartesianIndexMapper_; }
 
 protected:
+    /*!
+     * \brief Provides the computational cost of the elements to the partitioner of
+     *        ALUGrid.
+     */
+    class LoadWeights_
+    {
+        typedef typename Grid::template Codim<0>::Entity Element;
+        typedef typename Grid::LeafGridView LeafGridView;
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2,6)
+        typedef Dune::MultipleCodimMultipleGeomTypeMapper<LeafGridView> ElementMapper;
+#else
+        typedef Dune::MultipleCodimMultipleGeomTypeMapper<LeafGridView, Dune::MCMGElementLayout> ElementMapper;
+#endif
+
+    public:
+        LoadWeights_(const LeafGridView& gridView, const std::vector<double>& weights)
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2,6)
+            : elementMapper_(gridView, Dune::mcmgElementLayout())
+#else
+            : elementMapper_(gridView)
+#endif
+            , weights_(weights)
+        {}
+
+        bool userDefinedPartitioning() const
+        { return false; }
+
+        bool userDefinedLoadWeights() const
+        { return true; }
+
+        bool repartition() const
+        { return true; }
+
+        double loadWeight(const Element& elem) const
+        { return weights_[elementMapper_.index(elem)]; }
+
+        int destination(const Element& elem OPM_UNUSED) const
+        { return -1; }
+
+        bool importRanks(std::set<int>& ranks OPM_UNUSED) const
+        { return false; }
+
+        bool exportRanks(std::set<int>& ranks OPM_UNUSED) const
+        { return false; }
+
+    private:
+        ElementMapper elementMapper_;
+        const std::vector<double>& weights_;
+    };
+
     void createGrids_()
     {
         const auto& gridProps = this->eclState().get3DProperties();
@@ -172,7 +238,7 @@ protected:
         /////
         // create the EQUIL grid
         /////
-        equilGrid_ = new EquilGrid();
+        equilGrid_ = new EquilGrid(this->simulationCommunicator_());
         equilGrid_->processEclipseFormat(this->eclState().getInputGrid(),
                                          /*isPeriodic=*/false,
                                          /*flipNormals=*/false,
@@ -40,13 +40,16 @@
 #include <opm/parser/eclipse/EclipseState/Schedule/Schedule.hpp>
 #include <opm/parser/eclipse/EclipseState/SummaryConfig/SummaryConfig.hpp>
 
-#if HAVE_MPI
-#include <mpi.h>
-#endif // HAVE_MPI
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
 
+#include <algorithm>
 #include <vector>
+#include <unordered_map>
 #include <unordered_set>
 #include <array>
+#include <fstream>
+#include <iostream>
 
 namespace Ewoms {
 template <class TypeTag>
@@ -60,8 +63,15 @@ NEW_PROP_TAG(Grid);
 NEW_PROP_TAG(EquilGrid);
 NEW_PROP_TAG(Scalar);
 NEW_PROP_TAG(EclDeckFileName);
+NEW_PROP_TAG(EclLoadBalanceWellCellWeight);
+NEW_PROP_TAG(EclLoadBalanceWeightsFile);
 
 SET_STRING_PROP(EclBaseGridManager, EclDeckFileName, "ECLDECK.DATA");
+
+// by default, all cells are considered to be equally expensive when the grid is
+// distributed
+SET_SCALAR_PROP(EclBaseGridManager, EclLoadBalanceWellCellWeight, 1.0);
+SET_STRING_PROP(EclBaseGridManager, EclLoadBalanceWeightsFile, "");
 } // namespace Properties
 
 /*!
@@ -92,6 +102,16 @@ public:
     {
         EWOMS_REGISTER_PARAM(TypeTag, std::string, EclDeckFileName,
                              "The name of the file which contains the ECL deck to be simulated");
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, EclLoadBalanceWellCellWeight,
+                             "The computational cost of cells which are perforated by a well "
+                             "relative to the one of regular cells. This is used to weight "
+                             "the cells when the grid is distributed. (Not supported by "
+                             "Dune::CpGrid.)");
+        EWOMS_REGISTER_PARAM(TypeTag, std::string, EclLoadBalanceWeightsFile,
+                             "The name of a file which specifies the computational cost of "
+                             "cells for distributing the grid. Each line consists of the "
+                             "Cartesian index of a cell and its weight. (Not supported by "
+                             "Dune::CpGrid.)");
     }
 
     /*!
@@ -121,10 +141,8 @@ public:
     EclBaseGridManager(Simulator& simulator)
         : ParentType(simulator)
     {
-        int myRank = 0;
-#if HAVE_MPI
-        MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
-#endif
+        typedef typename Simulator::Communicator Communicator;
+        int myRank = Dune::CollectiveCommunication<Communicator>(simulator.communicator()).rank();
 
         std::string fileName = EWOMS_GET_PARAM(TypeTag, std::string, EclDeckFileName);
 
@@ -304,6 +322,88 @@ public:
     std::unordered_set<std::string> defunctWellNames() const
     { return std::unordered_set<std::string>(); }
 
+    /*!
+     * \brief Returns the estimated computational cost of the cells which are not
+     *        equally expensive, keyed by their logically Cartesian index.
+     *
+     * The weights are determined by the parameters EclLoadBalanceWellCellWeight and
+     * EclLoadBalanceWeightsFile. The latter is typically produced by a short
+     * calibration run. The cost of cells which are not contained is 1.
+     */
+    std::unordered_map<int, double> cartesianLoadWeights() const
+    {
+        Scalar wellCellWeight = EWOMS_GET_PARAM(TypeTag, Scalar, EclLoadBalanceWellCellWeight);
+        const std::string& weightsFileName = EWOMS_GET_PARAM(TypeTag, std::string, EclLoadBalanceWeightsFile);
+
+        // the weights of the cells which are not mentioned explicitly are 1
+        std::unordered_map<int, double> cartesianWeights;
+        if (!weightsFileName.empty()) {
+            std::ifstream weightsFile(weightsFileName);
+            if (!weightsFile.good())
+                OPM_THROW(std::runtime_error,
+                          "Could not open the load balancing weights file '"
+                          << weightsFileName << "'");
+
+            int cartIdx;
+            double weight;
+            while (weightsFile >> cartIdx >> weight) {
+                if (weight <= 0.0)
+                    OPM_THROW(std::runtime_error,
+                              "Load balancing weights must be positive. (cell "
+                              << cartIdx << " in '" << weightsFileName << "')");
+                cartesianWeights[cartIdx] = weight;
+            }
+        }
+
+        if (wellCellWeight != 1.0) {
+            // consider all cells which are perforated by any well at any time
+            const auto& dims = cartesianDimensions();
+            size_t numReportSteps = schedule().getTimeMap().size();
+            for (const Opm::Well* well : schedule().getWells()) {
+                for (size_t reportStepIdx = 0; reportStepIdx < numReportSteps; ++reportStepIdx) {
+                    for (const auto& completion : well->getCompletions(reportStepIdx)) {
+                        int cartIdx =
+                            completion.getI()
+                            + dims[0]*(completion.getJ()
+                                       + dims[1]*completion.getK());
+
+                        auto it = cartesianWeights.find(cartIdx);
+                        double weight = (it == cartesianWeights.end())?1.0:it->second;
+                        cartesianWeights[cartIdx] = std::max<double>(weight, wellCellWeight);
+                    }
+                }
+            }
+        }
+
+        return cartesianWeights;
+    }
+
+protected:
+    /*!
+     * \brief Returns the estimated computational cost of each cell of the grid before it
+     *        is distributed.
+     *
+     * The weights are indexed by the compressed index of the cells of the undistributed
+     * simulation grid. If no weights were specified by the parameters, an empty vector
+     * is returned which means that all cells are equally expensive.
+     */
+    std::vector<double> cellLoadWeights_() const
+    {
+        const auto& cartesianWeights = cartesianLoadWeights();
+        if (cartesianWeights.empty())
+            return std::vector<double>();
+
+        unsigned numCells = asImp_().grid().size(/*codim=*/0);
+        std::vector<double> weights(numCells, 1.0);
+        for (unsigned cellIdx = 0; cellIdx < numCells; ++cellIdx) {
+            auto it = cartesianWeights.find(cartesianIndex(cellIdx));
+            if (it != cartesianWeights.end())
+                weights[cellIdx] = it->second;
+        }
+
+        return weights;
+    }
+
 private:
     Implementation& asImp_()
     { return *static_cast<Implementation*>(this); }
@@ -36,6 +36,11 @@
 
 #include <dune/common/version.hh>
 
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
+#include <stdexcept>
+
 namespace Ewoms {
 template <class TypeTag>
 class EclCpGridManager;
@@ -138,11 +143,18 @@ public:
      */
     void loadBalance()
     {
+        // Dune::CpGrid only accepts edge weights for its partitioner. Cells which are
+        // perforated by wells are always kept on a single process, but the
+        // computational cost of the cells cannot be taken into account. Rather than
+        // silently ignoring the cell weights, we refuse to run if they were requested.
+        if (!this->cartesianLoadWeights().empty())
+            OPM_THROW(std::invalid_argument,
+                      "Dune::CpGrid does not support weighting cells by their "
+                      "computational cost. Do not specify the EclLoadBalanceWellCellWeight "
+                      "or EclLoadBalanceWeightsFile parameters or use Dune::ALUGrid.");
+
 #if HAVE_MPI
-        int mpiRank = 0;
-        int mpiSize = 1;
-        MPI_Comm_rank(MPI_COMM_WORLD, &mpiRank);
-        MPI_Comm_size(MPI_COMM_WORLD, &mpiSize);
+        int mpiSize = grid_->comm().size();
 
         if (mpiSize > 1) {
             // the CpGrid's loadBalance() method likes to have the transmissibilities as
@@ -150,6 +162,7 @@ public:
             // transmissibilities are relatively expensive to compute, we only do it if
             // more than a single process is involved in the simulation.
             cartesianIndexMapper_ = new CartesianIndexMapper(*grid_);
+
             globalTrans_ = new EclTransmissibility<TypeTag>(*this);
             globalTrans_->update();
 
@@ -238,7 +251,7 @@ protected:
         const auto& gridProps = this->eclState().get3DProperties();
         const std::vector<double>& porv = gridProps.getDoubleGridProperty("PORV").getData();
 
-        grid_ = new Dune::CpGrid();
+        grid_ = new Dune::CpGrid(this->simulationCommunicator_());
         grid_->processEclipseFormat(this->eclState().getInputGrid(),
                                     /*isPeriodic=*/false,
                                     /*flipNormals=*/false,
@@ -93,6 +93,7 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <unordered_map>
 
 namespace Ewoms {
 template <class TypeTag>
@@ -425,6 +426,8 @@ public:
 
         updatePffDofData_();
 
+        cartesianLoadWeights_ = simulator.gridManager().cartesianLoadWeights();
+
         if (GET_PROP_VALUE(TypeTag, EnablePolymer)) {
             const auto& gridManager = this->simulator().gridManager();
             const auto& gridView = gridManager.gridView();
@@ -436,6 +439,24 @@ public:
     void prefetch(const Element& elem) const
     { pffDofData_.prefetch(elem); }
 
+    /*!
+     * \copydoc FvBaseProblem::elementLoadWeight
+     *
+     * The weights are the ones which are used to distribute the grid initially, i.e.,
+     * they are specified by the EclLoadBalanceWellCellWeight and
+     * EclLoadBalanceWeightsFile parameters.
+     */
+    Scalar elementLoadWeight(const Element& elem) const
+    {
+        if (cartesianLoadWeights_.empty())
+            return 1.0;
+
+        const auto& gridManager = this->simulator().gridManager();
+        unsigned elemIdx = static_cast<unsigned>(this->elementMapper().index(elem));
+        auto it = cartesianLoadWeights_.find(static_cast<int>(gridManager.cartesianIndex(elemIdx)));
+        return (it == cartesianLoadWeights_.end())?1.0:it->second;
+    }
+
     /*!
      * \brief This method restores the complete state of the well
      *        from disk.
@@ -1803,6 +1824,7 @@ private:
 
     std::vector<Scalar> porosity_;
     std::vector<Scalar> elementCenterDepth_;
+    std::unordered_map<int, double> cartesianLoadWeights_;
     EclTransmissibility<TypeTag> transmissibilities_;
 
     std::shared_ptr<EclMaterialLawManager> materialLawManager_;
@@ -70,6 +70,10 @@ NEW_PROP_TAG(PredeterminedTimeStepsFile);
  * a sequence of "episodes" which are defined as time intervals for
  * which the problem exhibits boundary conditions and source terms
  * that do not depend on time.
+ *
+ * All processes of the communicator which is passed to the constructor take part in
+ * the simulation. This allows to run several independent simulations within a single
+ * MPI job by splitting the world communicator.
  */
 template <class TypeTag>
 class Simulator
@@ -81,16 +85,24 @@ class Simulator
     typedef typename GET_PROP_TYPE(TypeTag, Problem) Problem;
 
 public:
+    typedef Dune::MPIHelper::MPICommunicator Communicator;
+
     // do not allow to copy simulators around
     Simulator(const Simulator& ) = delete;
 
     Simulator(bool verbose = true)
+        : Simulator(Dune::MPIHelper::getCommunicator(), verbose)
+    {}
+
+    Simulator(Communicator communicator, bool verbose = true)
+        : communicator_(communicator)
     {
         Ewoms::TimerGuard setupTimerGuard(setupTimer_);
 
         setupTimer_.start();
 
-        verbose_ = verbose && Dune::MPIHelper::getCollectiveCommunication().rank() == 0;
+        typedef Dune::CollectiveCommunication<Communicator> CollectiveCommunication;
+        verbose_ = verbose && CollectiveCommunication(communicator_).rank() == 0;
 
         timeStepIdx_ = 0;
         startTime_ = 0.0;
@@ -165,6 +177,15 @@ public:
         Problem::registerParameters();
     }
 
+    /*!
+     * \brief Return the MPI communicator of the processes which take part in the
+     *        simulation.
+     *
+     * The grid managers must create the grid on this communicator.
+     */
+    Communicator communicator() const
+    { return communicator_; }
+
     /*!
      * \brief Return a reference to the grid manager of simulation
      */
@@ -821,7 +842,7 @@ public:
             << episodeLength_ << " "
             << startTime_ << " "
             << time_ << " "
-            << timeStepIdx_ << " ";
+            << timeStepIdx_;
         restarter.serializeSectionEnd();
     }
 
@@ -847,6 +868,7 @@ public:
     }
 
 private:
+    Communicator communicator_;
     std::unique_ptr<GridManager> gridManager_;
     std::unique_ptr<Model> model_;
     std::unique_ptr<Problem> problem_;
@@ -113,17 +113,20 @@ static inline void registerAllParameters_()
  *
  * \param argc The number of command line arguments
  * \param argv Array with the command line argument strings
+ * \param registerParams Specifies whether the parameters still need to be registered
+ * \param comm The communicator of the simulation. Messages are only printed by its
+ *             first process.
  */
 template <class TypeTag>
-static inline int setupParameters_(int argc, const char **argv, bool registerParams = true)
+static inline int setupParameters_(int argc,
+                                   const char **argv,
+                                   bool registerParams = true,
+                                   Dune::MPIHelper::MPICommunicator comm = Dune::MPIHelper::getCommunicator())
 {
     typedef typename GET_PROP(TypeTag, ParameterMetaData) ParameterMetaData;
 
-    // first, get the MPI rank of the current process
-    int myRank = 0;
-#if HAVE_MPI
-    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
-#endif
+    // first, get the rank of the current process within the simulation
+    const int myRank = Dune::CollectiveCommunication<Dune::MPIHelper::MPICommunicator>(comm).rank();
 
     ////////////////////////////////////////////////////////////
     // Register all parameters
@@ -196,16 +199,21 @@ static inline void resetTerminal_(int signum)
 /*!
  * \ingroup Common
  *
- * \brief Provides a main function which reads in parameters from the
- *        command line and a parameter file and runs the simulation
+ * \brief Reads in parameters from the command line and a parameter file and runs
+ *        the simulation on the processes of a given communicator.
+ *
+ * MPI must already be initialized. This allows to run several independent
+ * simulations within a single MPI job, e.g., for the members of an ensemble, by
+ * splitting the world communicator.
  *
  * \tparam TypeTag  The type tag of the problem which needs to be solved
  *
  * \param argc The number of command line arguments
  * \param argv The array of the command line arguments
+ * \param comm The communicator of the processes which take part in the simulation
  */
 template <class TypeTag>
-static inline int start(int argc, char **argv)
+static inline int start(int argc, char **argv, Dune::MPIHelper::MPICommunicator comm)
 {
     typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
     typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
@@ -225,17 +233,14 @@ static inline int start(int argc, char **argv)
 
     Opm::resetLocale();
 
-    // initialize MPI, finalize is done automatically on exit
-#if HAVE_DUNE_FEM
-    Dune::Fem::MPIManager::initialize(argc, argv);
-    const int myRank = Dune::Fem::MPIManager::rank();
-#else
-    const int myRank = Dune::MPIHelper::instance(argc, argv).rank();
-#endif
+    const int myRank = Dune::CollectiveCommunication<Dune::MPIHelper::MPICommunicator>(comm).rank();
 
     try
     {
-        int paramStatus = setupParameters_<TypeTag>(argc, const_cast<const char**>(argv));
+        int paramStatus = setupParameters_<TypeTag>(argc,
+                                                    const_cast<const char**>(argv),
+                                                    /*registerParams=*/true,
+                                                    comm);
         if (paramStatus == 1)
             return 1;
         if (paramStatus == 2)
@@ -308,7 +313,7 @@ static inline int start(int argc, char **argv)
         // instantiate and run the concrete problem. make sure to
         // deallocate the problem and before the time manager and the
         // grid
-        Simulator simulator;
+        Simulator simulator(comm);
         simulator.run();
 
         if (myRank == 0) {
@@ -340,6 +345,30 @@ static inline int start(int argc, char **argv)
     }
 }
 
+/*!
+ * \ingroup Common
+ *
+ * \brief Provides a main function which reads in parameters from the
+ *        command line and a parameter file and runs the simulation
+ *
+ * \tparam TypeTag  The type tag of the problem which needs to be solved
+ *
+ * \param argc The number of command line arguments
+ * \param argv The array of the command line arguments
+ */
+template <class TypeTag>
+static inline int start(int argc, char **argv)
+{
+    // initialize MPI, finalize is done automatically on exit
+#if HAVE_DUNE_FEM
+    Dune::Fem::MPIManager::initialize(argc, argv);
+#else
+    Dune::MPIHelper::instance(argc, argv);
+#endif
+
+    return start<TypeTag>(argc, argv, Dune::MPIHelper::getCommunicator());
+}
+
 } // namespace Ewoms
 
 #endif
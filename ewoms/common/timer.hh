@@ -30,10 +30,6 @@
 
 #include <chrono>
 
-#if HAVE_MPI
-#include <mpi.h>
-#endif
-
 namespace Ewoms {
 /*!
  * \ingroup Common
@@ -163,27 +159,18 @@ public:
     }
 
     /*!
-     * \brief Return the CPU time [s] used by all threads of the all processes of program
+     * \brief Return the CPU time [s] used by all threads of the all processes of a
+     *        communicator
      *
-     * The value returned only differs from cpuTimeElapsed() if MPI is used.
+     * The value returned only differs from cpuTimeElapsed() if MPI is used. This is a
+     * collective operation on all processes of the communicator.
+     *
+     * \param comm The collective communication object of the processes, e.g., the one
+     *             of the grid view of the simulation
      */
-    double globalCpuTimeElapsed() const
-    {
-        double val = cpuTimeElapsed();
-        double globalVal = val;
-
-#if HAVE_MPI
-        MPI_Reduce(&val,
-                   &globalVal,
-                   /*count=*/1,
-                   MPI_DOUBLE,
-                   MPI_SUM,
-                   /*rootRank=*/0,
-                   MPI_COMM_WORLD);
-#endif
-
-        return globalVal;
-    }
+    template <class CollectiveCommunication>
+    double globalCpuTimeElapsed(const CollectiveCommunication& comm) const
+    { return comm.sum(cpuTimeElapsed()); }
 
     /*!
      * \brief Adds the time of another timer to the current one
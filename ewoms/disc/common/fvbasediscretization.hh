@@ -50,6 +50,7 @@
 #include <ewoms/parallel/threadmanager.hh>
 #include <ewoms/linear/nullborderlistmanager.hh>
 #include <ewoms/common/simulator.hh>
+#include <ewoms/io/restart.hh>
 #include <ewoms/aux/baseauxiliarymodule.hh>
 #include <ewoms/common/alignedallocator.hh>
 #include <ewoms/common/timer.hh>
@@ -72,14 +73,19 @@
 #include <dune/fem/space/common/adaptmanager.hh>
 #endif
 #include <dune/fem/space/common/restrictprolongtuple.hh>
+#include <dune/fem/space/common/dofmanager.hh>
 #include <dune/fem/function/blockvectorfunction.hh>
 #include <dune/fem/misc/capabilities.hh>
 #endif
 
+#include <algorithm>
 #include <limits>
 #include <list>
+#include <set>
 #include <sstream>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace Ewoms {
@@ -228,6 +234,12 @@ SET_SCALAR_PROP(FvBaseDiscretization, MinTimeStepSize, 0.0);
 //! Disable grid adaptation by default
 SET_BOOL_PROP(FvBaseDiscretization, EnableGridAdaptation, false);
 
+//! Do not redistribute the grid during the simulation by default
+SET_BOOL_PROP(FvBaseDiscretization, EnableDynamicLoadBalancing, false);
+
+//! Redistribute the grid if a process does 20% more work than the average
+SET_SCALAR_PROP(FvBaseDiscretization, DynamicLoadBalancingTolerance, 1.2);
+
 //! Enable the VTK output by default
 SET_BOOL_PROP(FvBaseDiscretization, EnableVtkOutput, true);
 
@@ -250,6 +262,9 @@ SET_BOOL_PROP(FvBaseDiscretization, EnableIntensiveQuantityCache, false);
 // enable the intensive quantity cache above to avoid getting an exception...
 SET_BOOL_PROP(FvBaseDiscretization, EnableThermodynamicHints, false);
 
+// by default, the Newton method starts at the solution of the last time step
+SET_BOOL_PROP(FvBaseDiscretization, EnableSolutionExtrapolation, false);
+
 // if the deflection of the newton method is large, we do not need to solve the linear
 // approximation accurately. Assuming that the value for the current solution is quite
 // close to the final value, a reduction of 3 orders of magnitude in the defect should be
@@ -266,6 +281,11 @@ SET_BOOL_PROP(FvBaseDiscretization, ExtensiveStorageTerm, false);
 // use volumetric residuals is default
 SET_BOOL_PROP(FvBaseDiscretization, UseVolumetricResidual, true);
 
+// do not write the linearized systems of equations to disk by default
+SET_STRING_PROP(FvBaseDiscretization, LinearSystemDumpFileName, "");
+SET_INT_PROP(FvBaseDiscretization, LinearSystemDumpInterval, 1);
+SET_BOOL_PROP(FvBaseDiscretization, LinearSystemDumpMatrixMarket, false);
+
 } // namespace Properties
 
 /*!
@@ -384,10 +404,15 @@ public:
         , space_( asImp_().numGridDof() )
 #endif
         , enableGridAdaptation_( EWOMS_GET_PARAM(TypeTag, bool, EnableGridAdaptation) )
+        , enableDynamicLoadBalancing_( EWOMS_GET_PARAM(TypeTag, bool, EnableDynamicLoadBalancing) )
         , enableIntensiveQuantityCache_(EWOMS_GET_PARAM(TypeTag, bool, EnableIntensiveQuantityCache))
         , enableStorageCache_(EWOMS_GET_PARAM(TypeTag, bool, EnableStorageCache))
         , enableThermodynamicHints_(EWOMS_GET_PARAM(TypeTag, bool, EnableThermodynamicHints))
+        , enableSolutionExtrapolation_(EWOMS_GET_PARAM(TypeTag, bool, EnableSolutionExtrapolation))
     {
+        lastTimeStepSize_ = 0.0;
+        loadBalancingWork_ = 0.0;
+
 #if HAVE_DUNE_FEM
         if (enableGridAdaptation_ && !Dune::Fem::Capabilities::isLocallyAdaptive<Grid>::v)
             OPM_THROW(Opm::NotImplemented,
@@ -396,12 +421,19 @@ public:
         if (enableGridAdaptation_)
             OPM_THROW(Opm::NotImplemented,
                       "Grid adaptation currently requires the presence of the dune-fem module");
+        if (enableDynamicLoadBalancing_)
+            OPM_THROW(Opm::NotImplemented,
+                      "Dynamic load balancing currently requires the presence of the dune-fem module");
 #endif
         bool isEcfv = std::is_same<Discretization, EcfvDiscretization<TypeTag> >::value;
         if (enableGridAdaptation_ && !isEcfv)
             OPM_THROW(Opm::NotImplemented,
                       "Grid adaptation currently only works for the element-centered finite "
                       "volume discretization (is: " << Dune::className<Discretization>() << ")");
+        if (enableDynamicLoadBalancing_ && !isEcfv)
+            OPM_THROW(Opm::NotImplemented,
+                      "Dynamic load balancing currently only works for the element-centered "
+                      "finite volume discretization (is: " << Dune::className<Discretization>() << ")");
 
         enableStorageCache_ = EWOMS_GET_PARAM(TypeTag, bool, EnableStorageCache);
 
@@ -450,10 +482,13 @@ public:
         Ewoms::VtkPrimaryVarsModule<TypeTag>::registerParameters();
 
         EWOMS_REGISTER_PARAM(TypeTag, bool, EnableGridAdaptation, "Enable adaptive grid refinement/coarsening");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, EnableDynamicLoadBalancing, "Redistribute the grid at the end of episodes if the work of the processes is unbalanced");
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, DynamicLoadBalancingTolerance, "The ratio between the maximum and the average work of the processes above which the grid gets redistributed");
         EWOMS_REGISTER_PARAM(TypeTag, bool, EnableVtkOutput, "Global switch for turing on writing VTK files");
         EWOMS_REGISTER_PARAM(TypeTag, bool, EnableThermodynamicHints, "Enable thermodynamic hints");
         EWOMS_REGISTER_PARAM(TypeTag, bool, EnableIntensiveQuantityCache, "Turn on caching of intensive quantities");
         EWOMS_REGISTER_PARAM(TypeTag, bool, EnableStorageCache, "Store previous storage terms and avoid re-calculating them.");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, EnableSolutionExtrapolation, "Extrapolate the initial guess of each time step from the solutions of the last two time steps");
     }
 
     /*!
@@ -1185,6 +1220,8 @@ public:
         updateTimer_.halt();
 
         prePostProcessTimer_.start();
+        if (enableSolutionExtrapolation_)
+            extrapolateSolution_();
         asImp_().updateBegin();
         prePostProcessTimer_.stop();
 
@@ -1207,6 +1244,12 @@ public:
         solveTimer_ += newtonMethod_.solveTimer();
         updateTimer_ += newtonMethod_.updateTimer();
 
+        // the work which is considered for load balancing is the time spent on
+        // linearizing and on solving the linear systems
+        loadBalancingWork_ +=
+            newtonMethod_.linearizeTimer().realTimeElapsed()
+            + newtonMethod_.solveTimer().realTimeElapsed();
+
         prePostProcessTimer_.start();
         if (converged)
             asImp_().updateSuccessful();
@@ -1252,6 +1295,33 @@ public:
     void updateSuccessful()
     { }
 
+    /*!
+     * \brief Extrapolate the primary variables of a degree of freedom to the end of the
+     *        current time step.
+     *
+     * This is used to determine the initial guess of the Newton method if
+     * EnableSolutionExtrapolation is set. The default is to extrapolate all primary
+     * variables linearly. Models which use primary variable switching or need to
+     * keep some quantities in a physically meaningful range should overload this
+     * method.
+     *
+     * \param globalDofIdx The global index of the degree of freedom
+     * \param result The extrapolated primary variables
+     * \param curValue The primary variables at the beginning of the time step
+     * \param prevValue The primary variables at the beginning of the last time step
+     * \param alpha The ratio between the current and the last time step sizes
+     */
+    void extrapolatePrimaryVariables(unsigned globalDofIdx OPM_UNUSED,
+                                     PrimaryVariables& result,
+                                     const PrimaryVariables& curValue,
+                                     const PrimaryVariables& prevValue,
+                                     Scalar alpha) const
+    {
+        result = curValue;
+        for (unsigned pvIdx = 0; pvIdx < numEq; ++pvIdx)
+            result[pvIdx] += alpha*(curValue[pvIdx] - prevValue[pvIdx]);
+    }
+
     /*!
      * \brief Called by the update() method when the grid should be refined.
      */
@@ -1270,32 +1340,112 @@ public:
 
                 // if the grid has potentially changed, we need to re-create the
                 // supporting data structures.
-                elementMapper_.update();
-                vertexMapper_.update();
-                resetLinearizer();
-
-                // this is a bit hacky because it supposes that Problem::finishInit()
-                // works fine multiple times in a row.
-                //
-                // TODO: move this to Problem::gridChanged()
-                finishInit();
-
-                // notify the problem that the grid has changed
-                //
-                // TODO: come up with a mechanism to access the unadapted data structures
-                // outside of the problem (i.e., grid, mappers, solutions)
-                simulator_.problem().gridChanged();
-
-                // notify the modules for visualization output
-                auto outIt = outputModules_.begin();
-                auto outEndIt = outputModules_.end();
-                for (; outIt != outEndIt; ++outIt)
-                    (*outIt)->allocBuffers();
+                gridChanged_();
             }
         }
 #endif
     }
 
+    /*!
+     * \brief Redistribute the grid if the work of the processes has become too
+     *        unbalanced.
+     *
+     * The work of a process is the wall-clock time which it spent on linearizing and on
+     * solving linear systems since the last call of this method. If the maximum work is
+     * larger than the average work times the DynamicLoadBalancingTolerance parameter,
+     * the grid is redistributed via the load balancing data handles of the grid. These
+     * transfer the solution and the data of the problem's restriction and prolongation
+     * operator to the new owners, after which all data structures which depend on the
+     * grid partition are rebuilt.
+     *
+     * The partitioner of the grid is given the estimated cost of each element: The work
+     * measured for a process is distributed among its interior elements proportionally
+     * to the problem's elementLoadWeight() values. The partitioner thus moves elements
+     * away from processes which are slow even if all processes own the same number of
+     * elements. If the grid does not support user defined load weights, its default
+     * partitioner is used which only balances the number of elements. In this case,
+     * the grid is only redistributed if the numbers of elements are unbalanced as well
+     * because the partitioner would produce the current partition again otherwise.
+     *
+     * This method must be called by all processes at the same time. By default, it is
+     * called at the end of each episode.
+     *
+     * \return true if the grid was redistributed.
+     */
+    bool balanceLoad()
+    {
+        if (!enableDynamicLoadBalancing_)
+            return false;
+
+        const auto& comm = gridView_.comm();
+        Scalar localWork = loadBalancingWork_;
+        loadBalancingWork_ = 0.0;
+        if (comm.size() < 2)
+            return false;
+
+        Scalar localNumElements = 0.0;
+        ElementIterator elemIt = gridView_.template begin</*codim=*/0>();
+        const ElementIterator& elemEndIt = gridView_.template end</*codim=*/0>();
+        for (; elemIt != elemEndIt; ++elemIt)
+            if (elemIt->partitionType() == Dune::InteriorEntity)
+                localNumElements += 1.0;
+
+        // compare the work and the number of elements of the processes using one
+        // reduction for the maxima and one for the sums
+        Scalar maxValues[2] = { localWork, localNumElements };
+        Scalar sumValues[2] = { localWork, localNumElements };
+        comm.max(maxValues, 2);
+        comm.sum(sumValues, 2);
+        Scalar maxWork = maxValues[0];
+        Scalar meanWork = sumValues[0]/comm.size();
+
+        Scalar tolerance = EWOMS_GET_PARAM(TypeTag, Scalar, DynamicLoadBalancingTolerance);
+        if (meanWork <= 0.0 || maxWork <= tolerance*meanWork)
+            return false;
+
+        bool changed = false;
+#if HAVE_DUNE_FEM
+        if (GridSupportsLoadWeights_::value) {
+            // distribute the measured work of the process among its elements. processes
+            // which did not measure any work use the average cost of an element.
+            const auto& problem = simulator_.problem();
+            std::vector<Scalar> weights(gridView_.size(/*codim=*/0), 0.0);
+            Scalar localElementWeight = 0.0;
+            for (elemIt = gridView_.template begin</*codim=*/0>(); elemIt != elemEndIt; ++elemIt) {
+                if (elemIt->partitionType() != Dune::InteriorEntity)
+                    continue;
+
+                Scalar w = problem.elementLoadWeight(*elemIt);
+                weights[static_cast<size_t>(elementMapper_.index(*elemIt))] = w;
+                localElementWeight += w;
+            }
+
+            Scalar costPerWeight = sumValues[0]/std::max<Scalar>(sumValues[1], 1.0);
+            if (localWork > 0.0 && localElementWeight > 0.0)
+                costPerWeight = localWork/localElementWeight;
+            for (auto& w : weights)
+                w *= costPerWeight;
+
+            changed = repartitionGrid_(weights);
+        }
+        else if (maxValues[1] > tolerance*sumValues[1]/comm.size())
+            // the default partitioner of the grid balances the number of elements, so
+            // it would not change the partition if the elements are already evenly
+            // distributed
+            changed = adaptationManager().loadBalance();
+
+        if (changed)
+            gridChanged_();
+#endif
+
+        if (changed && comm.rank() == 0)
+            std::cout << "Redistributed the grid because of unbalanced work: "
+                      << "maximum " << maxWork << " s, average " << meanWork << " s\n"
+                      << std::flush;
+
+        return changed;
+    }
+
     /*!
      * \brief Called by the update() method if it was
      *        unsuccessful. This is primary a hook which the actual
@@ -1322,12 +1472,24 @@ public:
         // at this point we can adapt the grid
         asImp_().adaptGrid();
 
+        // keep the solution of the last time step around if the initial guess of the
+        // Newton method is extrapolated
+        if (enableSolutionExtrapolation_) {
+            lastSolution_ = solution(/*timeIdx=*/1);
+            lastTimeStepSize_ = simulator_.timeStepSize();
+        }
+
         // make the current solution the previous one.
         solution(/*timeIdx=*/1) = solution(/*timeIdx=*/0);
 
         // shift the intensive quantities cache by one position in the
         // history
         asImp_().shiftIntensiveQuantityCache(/*numSlots=*/1);
+
+        // episodes correspond to the report steps of the simulation, so they are a
+        // natural point to redistribute the grid
+        if (simulator_.episodeWillBeOver())
+            asImp_().balanceLoad();
     }
 
     /*!
@@ -1379,9 +1541,8 @@ public:
             OPM_THROW(std::runtime_error, "Could not serialize degree of freedom " << dofIdx);
         }
 
-        for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx) {
-            outstream << solution(/*timeIdx=*/0)[dofIdx][eqIdx] << " ";
-        }
+        for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+            Restart::writeValue(outstream, solution(/*timeIdx=*/0)[dofIdx][eqIdx]);
     }
 
     /*!
@@ -1402,7 +1563,7 @@ public:
             if (!instream.good())
                 OPM_THROW(std::runtime_error,
                           "Could not deserialize degree of freedom " << dofIdx);
-            instream >> solution(/*timeIdx=*/0)[dofIdx][eqIdx];
+            Restart::readValue(instream, solution(/*timeIdx=*/0)[dofIdx][eqIdx]);
         }
     }
 
@@ -1667,7 +1828,7 @@ public:
         auxEqModules_.push_back(auxMod);
 
         // resize the solutions
-        if (enableGridAdaptation_
+        if ((enableGridAdaptation_ || enableDynamicLoadBalancing_)
             && !std::is_same<DiscreteFunction, BlockVectorWrapper>::value)
         {
             OPM_THROW(Opm::NotImplemented,
@@ -1747,6 +1908,143 @@ public:
     { return updateTimer_; }
 
 protected:
+#if HAVE_DUNE_FEM
+    typedef Dune::Fem::DofManager<Grid> DofManager;
+
+    /*!
+     * \brief Provides the estimated cost of the elements to the partitioner of the grid.
+     *
+     * The weights are specified for the leaf elements. If the partitioner asks for the
+     * weight of a coarser element, the weights of its leaf descendants are summed up.
+     */
+    class LoadWeights_
+    {
+    public:
+        LoadWeights_(const ElementMapper& elementMapper, const std::vector<Scalar>& weights)
+            : elementMapper_(elementMapper)
+            , weights_(weights)
+        {}
+
+        bool userDefinedPartitioning() const
+        { return false; }
+
+        bool userDefinedLoadWeights() const
+        { return true; }
+
+        bool repartition() const
+        { return true; }
+
+        double loadWeight(const Element& elem) const
+        {
+            if (elem.isLeaf())
+                return weights_[static_cast<size_t>(elementMapper_.index(elem))];
+
+            double result = 0.0;
+            int maxLevel = elem.level() + std::numeric_limits<int>::max()/2;
+            auto childIt = elem.hbegin(maxLevel);
+            const auto& childEndIt = elem.hend(maxLevel);
+            for (; childIt != childEndIt; ++childIt)
+                if (childIt->isLeaf())
+                    result += weights_[static_cast<size_t>(elementMapper_.index(*childIt))];
+            return result;
+        }
+
+        int destination(const Element& elem OPM_UNUSED) const
+        { return -1; }
+
+        bool importRanks(std::set<int>& ranks OPM_UNUSED) const
+        { return false; }
+
+        bool exportRanks(std::set<int>& ranks OPM_UNUSED) const
+        { return false; }
+
+    private:
+        const ElementMapper& elementMapper_;
+        const std::vector<Scalar>& weights_;
+    };
+
+    // the grid accepts user defined load weights if it can be repartitioned using a
+    // load balancing handle and the data handle of dune-fem's DOF manager
+    template <class G, class = void>
+    struct GridSupportsLoadWeightsHelper_ : public std::false_type
+    {};
+
+    template <class G>
+    struct GridSupportsLoadWeightsHelper_<G,
+                                          decltype(static_cast<void>(std::declval<G&>().repartition(std::declval<LoadWeights_&>(),
+                                                                                                    std::declval<DofManager&>())))>
+        : public std::true_type
+    {};
+
+    typedef GridSupportsLoadWeightsHelper_<Grid> GridSupportsLoadWeights_;
+
+    /*!
+     * \brief Repartition the grid using the given weights of the leaf elements.
+     *
+     * The data attached to the DOF manager, i.e., the solution and the data of the
+     * problem's restriction and prolongation operator, is transferred to the new owners.
+     */
+    bool repartitionGrid_(const std::vector<Scalar>& weights)
+    { return repartitionGrid_(weights, GridSupportsLoadWeights_()); }
+
+    bool repartitionGrid_(const std::vector<Scalar>& weights, std::true_type)
+    {
+        // make sure that the restriction and prolongation operators are registered
+        // with the DOF manager
+        adaptationManager();
+
+        auto& grid = simulator_.gridManager().grid();
+        LoadWeights_ loadWeights(elementMapper_, weights);
+        return grid.repartition(loadWeights, DofManager::instance(grid));
+    }
+
+    bool repartitionGrid_(const std::vector<Scalar>& weights OPM_UNUSED, std::false_type)
+    { return adaptationManager().loadBalance(); }
+#endif
+
+    /*!
+     * \brief Re-create all data structures which depend on the grid after it was
+     *        adapted or redistributed.
+     */
+    void gridChanged_()
+    {
+        elementMapper_.update();
+        vertexMapper_.update();
+        resetLinearizer();
+
+        // this is a bit hacky because it supposes that Problem::finishInit()
+        // works fine multiple times in a row.
+        //
+        // TODO: move this to Problem::gridChanged()
+        finishInit();
+
+        // only the most recent solution is transferred to the new grid by the
+        // restriction and prolongation operator, the remaining ones just need to be
+        // resized. This method is called by advanceTimeLevel(), i.e., after a time step
+        // has been accepted: adaptGrid() is called right before the current solution is
+        // made the previous one, and balanceLoad() is called right after that. In both
+        // cases, all solutions of the history are thus equal to the current one
+        // afterwards, so this copy is exact.
+        for (unsigned timeIdx = 1; timeIdx < historySize; ++timeIdx)
+            solution(timeIdx) = solution(/*timeIdx=*/0);
+
+        // the solution which is used for extrapolation does not fit the new grid anymore
+        lastTimeStepSize_ = 0.0;
+        lastSolution_.resize(0);
+
+        // notify the problem that the grid has changed
+        //
+        // TODO: come up with a mechanism to access the unadapted data structures
+        // outside of the problem (i.e., grid, mappers, solutions)
+        simulator_.problem().gridChanged();
+
+        // notify the modules for visualization output
+        auto outIt = outputModules_.begin();
+        auto outEndIt = outputModules_.end();
+        for (; outIt != outEndIt; ++outIt)
+            (*outIt)->allocBuffers();
+    }
+
     void resizeAndResetIntensiveQuantitiesCache_()
     {
         // allocate the storage cache
@@ -1774,6 +2072,32 @@ protected:
                                     unsigned timeIdx OPM_UNUSED)
     { }
 
+    /*!
+     * \brief Set the initial guess of the Newton method by extrapolating the solutions
+     *        at the beginning of the current and of the last time steps.
+     *
+     * This is a no-op if no solution of a previous time step is available, e.g., for
+     * the first time step or if the grid was changed.
+     */
+    void extrapolateSolution_()
+    {
+        const SolutionVector& curSolution = solution(/*timeIdx=*/1);
+        if (lastTimeStepSize_ <= 0.0 || lastSolution_.size() != curSolution.size())
+            return;
+
+        Scalar alpha = simulator_.timeStepSize()/lastTimeStepSize_;
+        SolutionVector& nextSolution = solution(/*timeIdx=*/0);
+        size_t numGridDof = asImp_().numGridDof();
+        for (unsigned dofIdx = 0; dofIdx < numGridDof; ++dofIdx)
+            asImp_().extrapolatePrimaryVariables(dofIdx,
+                                                 nextSolution[dofIdx],
+                                                 curSolution[dofIdx],
+                                                 lastSolution_[dofIdx],
+                                                 alpha);
+
+        invalidateIntensiveQuantitiesCache(/*timeIdx=*/0);
+    }
+
     /*!
      * \brief Register all output modules which make sense for the model.
      *
@@ -1855,9 +2179,20 @@ protected:
     mutable GlobalEqVector storageCache_[historySize];
 
     bool enableGridAdaptation_;
+    bool enableDynamicLoadBalancing_;
     bool enableIntensiveQuantityCache_;
     bool enableStorageCache_;
     bool enableThermodynamicHints_;
+    bool enableSolutionExtrapolation_;
+
+    // the solution at the beginning of the last time step and the size of the last
+    // time step. these are only used if the initial solution is extrapolated
+    SolutionVector lastSolution_;
+    Scalar lastTimeStepSize_;
+
+    // the wall-clock time spent on linearizing and solving since the last time the work
+    // of the processes was compared
+    Scalar loadBalancingWork_;
 };
 } // namespace Ewoms
 
@@ -33,7 +33,9 @@
 #include <ewoms/parallel/gridcommhandles.hh>
 #include <ewoms/parallel/threadmanager.hh>
 #include <ewoms/parallel/threadedentityiterator.hh>
+#include <ewoms/parallel/reductionbatch.hh>
 #include <ewoms/aux/baseauxiliarymodule.hh>
+#include <ewoms/linear/linearsystemio.hh>
 
 #include <opm/common/ErrorMacros.hpp>
 #include <opm/common/Exceptions.hpp>
@@ -43,9 +45,12 @@
 #include <dune/common/fmatrix.hh>
 
 #include <type_traits>
+#include <fstream>
 #include <iostream>
 #include <vector>
 #include <set>
+#include <sstream>
+#include <string>
 
 namespace Ewoms {
 // forward declarations
@@ -112,6 +117,8 @@ public:
         simulatorPtr_ = 0;
 
         matrix_ = 0;
+        numLinearizations_ = 0;
+        linearizationSucceeded_ = 1;
     }
 
     ~FvBaseLinearizer()
@@ -127,7 +134,16 @@ public:
      * \brief Register all run-time parameters for the Jacobian linearizer.
      */
     static void registerParameters()
-    { }
+    {
+        EWOMS_REGISTER_PARAM(TypeTag, std::string, LinearSystemDumpFileName,
+                             "The base name of the files to which the linearized systems "
+                             "of equations are written. If empty, nothing is written");
+        EWOMS_REGISTER_PARAM(TypeTag, int, LinearSystemDumpInterval,
+                             "Write every n-th linearized system of equations");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, LinearSystemDumpMatrixMarket,
+                             "Also write the linearized systems of equations in the "
+                             "Matrix Market format");
+    }
 
     /*!
      * \brief Initialize the linearizer.
@@ -169,46 +185,39 @@ public:
      */
     void linearize()
     {
-        // we defer the initialization of the Jacobian matrix until here because the
-        // auxiliary modules usually assume the problem, model and grid to be fully
-        // initialized...
-        if (!matrix_)
-            initFirstIteration_();
+        tryLinearize_();
+        linearizationSucceeded_ = gridView_().comm().min(linearizationSucceeded_);
+        finishLinearization();
+    }
 
-        int succeeded;
-        try {
-            linearize_();
-            succeeded = 1;
-        }
-        catch (const std::exception& e)
-        {
-            std::cout << "rank " << simulator_().gridView().comm().rank()
-                      << " caught an exception while linearizing:" << e.what()
-                      << "\n"  << std::flush;
-            succeeded = 0;
-        }
-#if ! DUNE_VERSION_NEWER(DUNE_COMMON, 2,5)
-        catch (const Dune::Exception& e)
-        {
-            std::cout << "rank " << simulator_().gridView().comm().rank()
-                      << " caught an exception while linearizing:" << e.what()
-                      << "\n"  << std::flush;
-            succeeded = 0;
-        }
-#endif
-        catch (...)
-        {
-            std::cout << "rank " << simulator_().gridView().comm().rank()
-                      << " caught an exception while linearizing"
-                      << "\n"  << std::flush;
-            succeeded = 0;
-        }
-        succeeded = gridView_().comm().min(succeeded);
+    /*!
+     * \brief Linearize the global non-linear system of equations without waiting for
+     *        the other processes.
+     *
+     * Whether all processes succeeded is determined as part of the given batch of
+     * reductions. After it has been communicated, finishLinearization() must be called
+     * before any other result of the batch is used.
+     */
+    void linearize(ReductionBatch& reductions)
+    {
+        tryLinearize_();
+        reductions.min(linearizationSucceeded_);
+    }
 
-        if (!succeeded) {
+    /*!
+     * \brief Complete a linearization once it is known whether all processes succeeded.
+     *
+     * This throws Opm::NumericalProblem if the linearization failed on any process.
+     */
+    void finishLinearization()
+    {
+        if (!linearizationSucceeded_) {
             OPM_THROW(Opm::NumericalProblem,
                        "A process did not succeed in linearizing the system");
         }
+
+        dumpLinearSystem_();
+        ++numLinearizations_;
     }
 
     /*!
@@ -332,6 +341,40 @@ private:
         matrix_->endindices();
     }
 
+    // writes the linearized system of equations to disk if this was requested by the
+    // user. each process writes its own part of the system.
+    void dumpLinearSystem_() const
+    {
+        const std::string& baseName = EWOMS_GET_PARAM(TypeTag, std::string, LinearSystemDumpFileName);
+        if (baseName.empty())
+            return;
+
+        int interval = EWOMS_GET_PARAM(TypeTag, int, LinearSystemDumpInterval);
+        if (interval <= 0 || numLinearizations_ % static_cast<unsigned>(interval) != 0)
+            return;
+
+        const auto& comm = gridView_().comm();
+        Ewoms::Linear::LinearSystemLayout layout;
+        layout.rank = comm.rank();
+        layout.commSize = comm.size();
+        layout.isOwned.resize(matrix_->N(), 1);
+        for (unsigned dofIdx = 0; dofIdx < model_().numGridDof(); ++dofIdx)
+            layout.isOwned[dofIdx] = model_().isLocalDof(dofIdx)?1:0;
+
+        std::ostringstream oss;
+        oss << baseName << "-" << numLinearizations_;
+        if (comm.size() > 1)
+            oss << "-rank" << comm.rank();
+        Ewoms::Linear::writeLinearSystem(oss.str() + ".ewls", *matrix_, residual_, layout);
+        if (EWOMS_GET_PARAM(TypeTag, bool, LinearSystemDumpMatrixMarket))
+            Ewoms::Linear::writeLinearSystemMatrixMarket(oss.str(), *matrix_, residual_);
+
+        // the run-time parameters allow the linear system to be replayed using the
+        // settings of the linear solver of the simulation
+        std::ofstream paramFile(oss.str() + ".param");
+        Ewoms::Parameters::printValues<TypeTag>(paramFile);
+    }
+
     // reset the global linear system of equations.
     void resetSystem_()
     {
@@ -385,6 +428,42 @@ private:
         }
     }
 
+    // linearize the local part of the system and record whether this worked
+    void tryLinearize_()
+    {
+        // we defer the initialization of the Jacobian matrix until here because the
+        // auxiliary modules usually assume the problem, model and grid to be fully
+        // initialized...
+        if (!matrix_)
+            initFirstIteration_();
+
+        linearizationSucceeded_ = 0;
+        try {
+            linearize_();
+            linearizationSucceeded_ = 1;
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "rank " << simulator_().gridView().comm().rank()
+                      << " caught an exception while linearizing:" << e.what()
+                      << "\n"  << std::flush;
+        }
+#if ! DUNE_VERSION_NEWER(DUNE_COMMON, 2,5)
+        catch (const Dune::Exception& e)
+        {
+            std::cout << "rank " << simulator_().gridView().comm().rank()
+                      << " caught an exception while linearizing:" << e.what()
+                      << "\n"  << std::flush;
+        }
+#endif
+        catch (...)
+        {
+            std::cout << "rank " << simulator_().gridView().comm().rank()
+                      << " caught an exception while linearizing"
+                      << "\n"  << std::flush;
+        }
+    }
+
     // linearize the whole system
     void linearize_()
     {
@@ -537,6 +616,8 @@ private:
 
     // the jacobian matrix
     Matrix *matrix_;
+    unsigned numLinearizations_;
+    int linearizationSucceeded_;
     // the right-hand side
     GlobalEqVector residual_;
 
@@ -345,7 +345,7 @@ public:
         Scalar setupTime = simulator().setupTimer().realTimeElapsed();
         Scalar prePostProcessTime = simulator().prePostProcessTimer().realTimeElapsed();
         Scalar localCpuTime = executionTimer.cpuTimeElapsed();
-        Scalar globalCpuTime = executionTimer.globalCpuTimeElapsed();
+        Scalar globalCpuTime = executionTimer.globalCpuTimeElapsed(this->gridView().comm());
         Scalar writeTime = simulator().writeTimer().realTimeElapsed();
         Scalar linearizeTime = simulator().linearizeTimer().realTimeElapsed();
         Scalar solveTime = simulator().solveTimer().realTimeElapsed();
@@ -413,7 +413,7 @@ public:
                 return;
 
             Scalar dt = simulator().timeStepSize();
-            Scalar nextDt = dt / 2;
+            Scalar nextDt = dt * newtonMethod().timeStepReduction();
             if (nextDt < minTimeStepSize)
                 break; // give up: we can't make the time step smaller anymore!
             simulator().setTimeStepSize(nextDt);
@@ -583,6 +583,17 @@ public:
         return 0;
     }
 
+    /*!
+     * \brief Returns the estimated computational cost of an element relative to the
+     *        other elements.
+     *
+     * This is used to distribute the work which has been measured for a process among
+     * its elements if the grid gets redistributed dynamically. By default, all elements
+     * are considered to be equally expensive.
+     */
+    Scalar elementLoadWeight(const Element& elem OPM_UNUSED) const
+    { return 1.0; }
+
     /*!
      * \brief This method writes the complete state of the problem
      *        to the harddisk.
@@ -181,6 +181,20 @@ NEW_PROP_TAG(Simulator);
  */
 NEW_PROP_TAG(EnableGridAdaptation);
 
+/*!
+ * \brief Switch to enable or disable redistributing the grid during the simulation if
+ *        the work of the processes is unbalanced.
+ *
+ * Like grid adaptation, this requires the presence of the dune-FEM module.
+ */
+NEW_PROP_TAG(EnableDynamicLoadBalancing);
+
+/*!
+ * \brief The ratio between the maximum and the average work of the processes above
+ *        which the grid is redistributed.
+ */
+NEW_PROP_TAG(DynamicLoadBalancingTolerance);
+
 /*!
  * \brief Global switch to enable or disable the writing of VTK output files
  *
@@ -252,6 +266,29 @@ NEW_PROP_TAG(EnableStorageCache);
  */
 NEW_PROP_TAG(EnableThermodynamicHints);
 
+/*!
+ * \brief Specify whether the initial guess of the Newton method should be
+ *        extrapolated from the solutions of the last two time steps.
+ *
+ * If this is disabled, the Newton method starts at the solution of the last time
+ * step.
+ */
+NEW_PROP_TAG(EnableSolutionExtrapolation);
+
+/*!
+ * \brief The base name of the files to which the linearized systems of equations are
+ *        written.
+ *
+ * If this is empty, the linear systems are not written to disk.
+ */
+NEW_PROP_TAG(LinearSystemDumpFileName);
+
+//! Write every n-th linearized system of equations to disk
+NEW_PROP_TAG(LinearSystemDumpInterval);
+
+//! Also write the linearized systems of equations in the Matrix Market format
+NEW_PROP_TAG(LinearSystemDumpMatrixMarket);
+
 // mappers from local to global DOF indices
 
 /*!
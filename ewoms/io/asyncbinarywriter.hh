@@ -0,0 +1,245 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::AsyncBinaryWriter
+ */
+#ifndef EWOMS_ASYNC_BINARY_WRITER_HH
+#define EWOMS_ASYNC_BINARY_WRITER_HH
+
+#include <opm/common/Exceptions.hpp>
+#include <opm/common/ErrorMacros.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Ewoms {
+
+/*!
+ * \brief Writes raw binary data to a file using a background thread.
+ *
+ * The data is first collected in an in-memory buffer. If this buffer exceeds a given
+ * size or if flush() is called, it is handed over to a worker thread which writes it to
+ * disk. At most a given number of buffers is queued for the worker, i.e., the thread
+ * which produces the data only blocks if the worker cannot keep up.
+ *
+ * If writing to disk fails, the worker discards all further data and the error is
+ * reported by throwing an exception from the next call to flush(), close() or the
+ * destructor.
+ */
+class AsyncBinaryWriter
+{
+public:
+    AsyncBinaryWriter(const std::string& fileName,
+                      size_t bufferSize = 64*1024,
+                      size_t maxQueuedBuffers = 4)
+        : fileName_(fileName)
+        , bufferSize_(bufferSize)
+        , maxQueuedBuffers_(std::max<size_t>(maxQueuedBuffers, 1))
+        , finished_(false)
+        , failed_(false)
+    {
+        stream_.open(fileName.c_str(), std::ios::binary | std::ios::trunc);
+        if (!stream_.good())
+            OPM_THROW(std::runtime_error,
+                      "Could not open file '" << fileName << "' for writing");
+
+        buffer_.reserve(bufferSize_);
+        thread_ = std::thread([this]() { this->run_(); });
+    }
+
+    /*!
+     * \brief Write all remaining data and stop the worker thread.
+     *
+     * If the writer is destroyed while an exception is propagated, errors are not
+     * reported.
+     */
+    ~AsyncBinaryWriter() noexcept(false)
+    {
+        if (!thread_.joinable())
+            return;
+
+        if (std::uncaught_exception()) {
+            try {
+                close();
+            }
+            catch (...) {
+            }
+        }
+        else
+            close();
+    }
+
+    AsyncBinaryWriter(const AsyncBinaryWriter&) = delete;
+    AsyncBinaryWriter& operator=(const AsyncBinaryWriter&) = delete;
+
+    /*!
+     * \brief Append a block of raw memory to the output.
+     */
+    void write(const void* data, size_t size)
+    {
+        const char* bytes = static_cast<const char*>(data);
+        buffer_.insert(buffer_.end(), bytes, bytes + size);
+        if (buffer_.size() >= bufferSize_)
+            flush();
+    }
+
+    /*!
+     * \brief Append the binary representation of an object to the output.
+     *
+     * The object must be trivially copyable. No conversion of the byte order is done.
+     */
+    template <class T>
+    void write(const T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "Only trivially copyable objects can be written in binary form");
+        write(&value, sizeof(T));
+    }
+
+    /*!
+     * \brief Hand the data collected so far to the worker thread.
+     *
+     * This blocks while the maximum number of buffers is queued for the worker and
+     * throws if the worker failed to write to the file.
+     */
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        throwIfFailed_();
+        if (buffer_.empty())
+            return;
+        if (finished_)
+            OPM_THROW(std::logic_error,
+                      "Data was written to file '" << fileName_ << "' after it was closed");
+
+        spaceCond_.wait(lock, [this]() { return failed_ || queue_.size() < maxQueuedBuffers_; });
+        throwIfFailed_();
+
+        std::vector<char> tmp;
+        tmp.reserve(bufferSize_);
+        tmp.swap(buffer_);
+        queue_.push_back(std::move(tmp));
+        lock.unlock();
+        dataCond_.notify_one();
+    }
+
+    /*!
+     * \brief Write all remaining data to disk and stop the worker thread.
+     *
+     * After this, no data can be written anymore.
+     */
+    void close()
+    {
+        if (!thread_.joinable())
+            return;
+
+        try {
+            flush();
+        }
+        catch (...) {
+            stopWorker_();
+            throw;
+        }
+
+        stopWorker_();
+        throwIfFailed_();
+    }
+
+private:
+    void stopWorker_()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            finished_ = true;
+        }
+        dataCond_.notify_one();
+        thread_.join();
+    }
+
+    // must be called with the mutex locked or after the worker has been stopped
+    void throwIfFailed_() const
+    {
+        if (failed_)
+            OPM_THROW(std::runtime_error,
+                      "Could not write to file '" << fileName_ << "'");
+    }
+
+    void run_()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            dataCond_.wait(lock, [this]() { return finished_ || !queue_.empty(); });
+
+            while (!queue_.empty()) {
+                std::vector<char> data(std::move(queue_.front()));
+                queue_.pop_front();
+                spaceCond_.notify_one();
+                if (failed_)
+                    continue;
+
+                // do not block the producer while writing to disk
+                lock.unlock();
+                stream_.write(data.data(), static_cast<std::streamsize>(data.size()));
+                bool failed = !stream_.good();
+                lock.lock();
+                failed_ = failed_ || failed;
+            }
+
+            if (finished_)
+                break;
+        }
+
+        if (!failed_) {
+            stream_.flush();
+            failed_ = !stream_.good();
+        }
+        stream_.close();
+    }
+
+    std::string fileName_;
+    size_t bufferSize_;
+    size_t maxQueuedBuffers_;
+    std::vector<char> buffer_;
+
+    std::ofstream stream_;
+    std::deque<std::vector<char> > queue_;
+    std::mutex mutex_;
+    std::condition_variable dataCond_;
+    std::condition_variable spaceCond_;
+    bool finished_;
+    bool failed_;
+    std::thread thread_;
+};
+
+} // namespace Ewoms
+
+#endif
@@ -30,7 +30,11 @@
 #include <ewoms/common/propertysystem.hh>
 #include <ewoms/common/parametersystem.hh>
 
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
 #include <dune/common/version.hh>
+#include <dune/common/parallel/mpihelper.hh>
 
 #if HAVE_DUNE_FEM
 #include <dune/fem/space/common/dofmanager.hh>
@@ -38,6 +42,7 @@
 
 #include <type_traits>
 #include <memory>
+#include <stdexcept>
 
 namespace Ewoms {
 namespace Properties {
@@ -121,9 +126,26 @@ public:
     }
 
 protected:
+    // returns the MPI communicator on which the grid must be created
+    typename Simulator::Communicator simulationCommunicator_() const
+    { return simulator_.communicator(); }
+
     // this method should be called after the grid has been allocated
     void finalizeInit_()
     {
+        // some grids can only be created on the world communicator. make sure that
+        // such a grid does not accidentally span the processes of other simulations.
+        typedef typename Simulator::Communicator Communicator;
+        int simulationSize =
+            Dune::CollectiveCommunication<Communicator>(simulationCommunicator_()).size();
+        int gridSize = asImp_().grid().comm().size();
+        if (gridSize > 1 && gridSize != simulationSize)
+            OPM_THROW(std::runtime_error,
+                      "The grid was created on " << gridSize << " processes, but the "
+                      "simulation uses " << simulationSize << ". The grid manager does "
+                      "not support creating the grid on the communicator of the "
+                      "simulation");
+
         updateGridView_();
     }
 
@@ -27,21 +27,186 @@
 #ifndef EWOMS_RESTART_HH
 #define EWOMS_RESTART_HH
 
+#include <ewoms/linear/overlaptypes.hh>
+
 #include <opm/common/Exceptions.hpp>
 #include <opm/common/ErrorMacros.hpp>
 
+#include <dune/grid/common/gridenums.hh>
+
+#if HAVE_MPI
+#include <mpi.h>
+#endif
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <sstream>
+#include <streambuf>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace Ewoms {
 
 /*!
  * \brief Load or save a state of a problem to/from the harddisk.
+ *
+ * The state of all processes is stored in a single binary file. It starts with a header
+ * and a table which specifies the location of the data of each process. The data of a
+ * process consists of a table of its sections followed by their payloads, and each
+ * section carries a checksum which is verified when it is read. Restart files are loaded
+ * by mapping them into memory, and in parallel runs they are written using collective
+ * MPI-IO so that the MPI library can aggregate the writes of the processes.
+ *
+ * The sections are still written and read via C++ streams. The data of degrees of
+ * freedom should be written in binary form using writeValue() and readValue(), which
+ * is faster than formatted I/O and does not lose any bits.
+ *
+ * The data of the entities is keyed by their IDs in the global ID set of the grid, so a
+ * simulation can be resumed using a different number of processes or a different
+ * partitioning of the grid. On load, the processes read the data written by the
+ * processes of the previous run in a round-robin fashion and send the data of each
+ * entity to the process which is responsible for its ID. There, it is picked up by the
+ * processes which store the entity.
+ *
+ * The remaining sections are read from the data of a single process of the previous
+ * run: If the number of processes did not change, each process reads its own data. Else,
+ * the first process reads the data of the first process of the previous run and all
+ * other processes read the one of the second process. All processes thus must have
+ * written the same data to such sections, except that the first process may append
+ * data which is only read by the first process of the next run. Otherwise, the section
+ * contains state which is specific to the processes of the previous run (e.g., the
+ * wells which intersect their part of the grid) and the restart file is rejected.
  */
 class Restart
 {
+    typedef Ewoms::Linear::Communicator Communicator;
+
+    struct FileHeader_
+    {
+        char magic[8];
+        uint32_t byteOrderMark;
+        uint32_t version;
+        uint64_t numRanks;
+        uint64_t rankTableChecksum;
+    };
+
+    struct RankEntry_
+    {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    struct BlockHeader_
+    {
+        uint64_t numSections;
+        uint64_t tableChecksum;
+    };
+
+    struct SectionEntry_
+    {
+        uint64_t nameSize;
+        uint64_t payloadOffset;
+        uint64_t payloadSize;
+        uint64_t checksum;
+    };
+
+    struct Block_
+    {
+        const char* data;
+        uint64_t size;
+        std::vector<SectionEntry_> entries;
+        std::vector<std::string> names;
+    };
+
+    struct Section_
+    {
+        std::string name;
+        std::string payload;
+    };
+
+    /*!
+     * \brief A stream buffer which appends everything to a string.
+     */
+    class OutputBuffer_ : public std::streambuf
+    {
+    public:
+        std::string& data()
+        { return data_; }
+
+    protected:
+        int_type overflow(int_type c) override
+        {
+            if (!traits_type::eq_int_type(c, traits_type::eof()))
+                data_.push_back(traits_type::to_char_type(c));
+            return traits_type::not_eof(c);
+        }
+
+        std::streamsize xsputn(const char* s, std::streamsize n) override
+        {
+            data_.append(s, static_cast<size_t>(n));
+            return n;
+        }
+
+    private:
+        std::string data_;
+    };
+
+    /*!
+     * \brief A stream buffer which reads from a range of memory without copying it.
+     */
+    class InputBuffer_ : public std::streambuf
+    {
+    public:
+        void reset(const char* begin, const char* end)
+        {
+            setg(const_cast<char*>(begin),
+                 const_cast<char*>(begin),
+                 const_cast<char*>(end));
+        }
+
+        const char* begin() const
+        { return gptr(); }
+
+        const char* end() const
+        { return egptr(); }
+    };
+
+    static const char* fileMagic_()
+    { return "eWomsRST"; }
+
+    static uint32_t formatVersion_()
+    { return 1; }
+
+    static uint32_t byteOrderMark_()
+    { return 0x01020304; }
+
+    /*!
+     * \brief Compute the 64 bit FNV-1a hash of a range of bytes.
+     */
+    static uint64_t checksum_(const char* data, size_t size, uint64_t hash = 0xcbf29ce484222325ULL)
+    {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
     /*!
      * \brief Create a magic cookie for restart files, so that it is
      *        unlikely to load a restart file for an incorrectly.
@@ -52,38 +217,135 @@ class Restart
         static const std::string gridName = "blubb"; // gridView.grid().name();
         static const int dim = GridView::dimension;
 
-        int numVertices = gridView.size(dim);
-        int numElements = gridView.size(0);
-        int numEdges = gridView.size(dim - 1);
-        int numCPUs = gridView.comm().size();
-        int rank = gridView.comm().rank();
+        // the cookie must not depend on how the grid is distributed
+        int numElements = 0;
+        auto elemIt = gridView.template begin</*codim=*/0>();
+        const auto& elemEndIt = gridView.template end</*codim=*/0>();
+        for (; elemIt != elemEndIt; ++elemIt)
+            if (elemIt->partitionType() == Dune::InteriorEntity)
+                ++numElements;
+        numElements = gridView.comm().sum(numElements);
 
         std::ostringstream oss;
         oss << "eWoms restart file: "
             << "gridName='" << gridName << "' "
-            << "numCPUs=" << numCPUs << " "
-            << "myRank=" << rank << " "
-            << "numElements=" << numElements << " "
-            << "numEdges=" << numEdges << " "
-            << "numVertices=" << numVertices;
+            << "dimension=" << dim << " "
+            << "numElements=" << numElements;
         return oss.str();
     }
 
+    /*!
+     * \brief Returns a byte string which represents the global ID of an entity.
+     */
+    template <class Id>
+    static typename std::enable_if<std::is_integral<Id>::value, std::string>::type
+    idKey_(const Id& id)
+    {
+        uint64_t value = static_cast<uint64_t>(id);
+        return std::string(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <class Id>
+    static typename std::enable_if<!std::is_integral<Id>::value, std::string>::type
+    idKey_(const Id& id)
+    {
+        std::ostringstream oss;
+        oss << id;
+        return oss.str();
+    }
+
+    /*!
+     * \brief Returns the rank of the process which collects the data of an entity on load.
+     */
+    static int homeRank_(const std::string& key, int commSize)
+    { return static_cast<int>(checksum_(key.data(), key.size()) % static_cast<uint64_t>(commSize)); }
+
+    /*!
+     * \brief Append a chunk of bytes which is prefixed by its size to a buffer.
+     */
+    static void appendChunk_(std::string& buffer, const char* data, uint64_t size)
+    {
+        buffer.append(reinterpret_cast<const char*>(&size), sizeof(size));
+        buffer.append(data, static_cast<size_t>(size));
+    }
+
+    /*!
+     * \brief Read a chunk of bytes which is prefixed by its size from a buffer.
+     *
+     * If the chunk exceeds the end of the buffer, false is returned.
+     */
+    static bool readChunk_(const char*& pos, const char* end, const char*& data, uint64_t& size)
+    {
+        if (static_cast<size_t>(end - pos) < sizeof(size))
+            return false;
+        std::memcpy(&size, pos, sizeof(size));
+        pos += sizeof(size);
+        data = pos;
+        if (size == missingChunk_())
+            return true;
+        if (static_cast<uint64_t>(end - pos) < size)
+            return false;
+        pos += size;
+        return true;
+    }
+
+    static uint64_t missingChunk_()
+    { return std::numeric_limits<uint64_t>::max(); }
+
     /*!
      * \brief Return the restart file name.
+     *
+     * The time is followed by a non-numeric separator so that it can be
+     * extracted from the file name unambiguously.
      */
-    template <class GridView, class Scalar>
-    static const std::string restartFileName_(const GridView& gridView,
-                                              const std::string& simName,
-                                              Scalar t)
+    template <class Scalar>
+    static const std::string restartFileName_(const std::string& simName, Scalar t)
     {
-        int rank = gridView.comm().rank();
         std::ostringstream oss;
-        oss << simName << "_time=" << t << "_rank=" << rank << ".ers";
+        oss << simName << "_time=" << t << "_all.ers";
         return oss.str();
     }
 
 public:
+    Restart()
+        : outStream_(&outBuffer_)
+        , inStream_(&inBuffer_)
+        , mappedData_(nullptr)
+        , mappedSize_(0)
+        , globalBlockIdx_(0)
+        , curSectionIdx_(0)
+    {}
+
+    Restart(const Restart&) = delete;
+    Restart& operator=(const Restart&) = delete;
+
+    ~Restart()
+    { unmapFile_(); }
+
+    /*!
+     * \brief Write a value to a stream in binary form.
+     *
+     * This is intended to be used for the data of the degrees of freedom.
+     */
+    template <class T>
+    static void writeValue(std::ostream& outstream, const T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "Only trivially copyable objects can be written in binary form");
+        outstream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    /*!
+     * \brief Read a value which was written by writeValue() from a stream.
+     */
+    template <class T>
+    static void readValue(std::istream& instream, T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "Only trivially copyable objects can be read in binary form");
+        instream.read(reinterpret_cast<char*>(&value), sizeof(T));
+    }
+
     /*!
      * \brief Returns the name of the file which is (de-)serialized.
      */
@@ -97,12 +359,11 @@ public:
     void serializeBegin(Simulator& simulator)
     {
         const std::string magicCookie = magicRestartCookie_(simulator.gridView());
-        fileName_ = restartFileName_(simulator.gridView(),
-                                     simulator.problem().name(),
-                                     simulator.time());
+        fileName_ = restartFileName_(simulator.problem().name(), simulator.time());
+        comm_ = Ewoms::Linear::gridCommunicator(simulator.gridView().comm());
 
-        // open output file and write magic cookie
-        outStream_.open(fileName_.c_str());
+        sections_.clear();
+        outStream_.clear();
         outStream_.precision(20);
 
         serializeSectionBegin(magicCookie);
@@ -119,13 +380,20 @@ public:
      * \brief Start a new section in the serialized output.
      */
     void serializeSectionBegin(const std::string& cookie)
-    { outStream_ << cookie << "\n"; }
+    {
+        sections_.emplace_back();
+        sections_.back().name = cookie;
+        outBuffer_.data().clear();
+    }
 
     /*!
      * \brief End of a section in the serialized output.
      */
     void serializeSectionEnd()
-    { outStream_ << "\n"; }
+    {
+        sections_.back().payload = std::move(outBuffer_.data());
+        outBuffer_.data().clear();
+    }
 
     /*!
      * \brief Serialize all leaf entities of a codim in a gridView.
@@ -140,14 +408,28 @@ public:
         std::string cookie = oss.str();
         serializeSectionBegin(cookie);
 
-        // write element data
+        // write the data of all entities which are not copies of entities owned by other
+        // processes. each record consists of the global ID of the entity and its data.
+        const auto& idSet = gridView.grid().globalIdSet();
+        std::string& data = outBuffer_.data();
         typedef typename GridView::template Codim<codim>::Iterator Iterator;
 
         Iterator it = gridView.template begin<codim>();
         const Iterator& endIt = gridView.template end<codim>();
         for (; it != endIt; ++it) {
+            if (it->partitionType() != Dune::InteriorEntity
+                && it->partitionType() != Dune::BorderEntity)
+                continue;
+
+            const std::string& key = idKey_(idSet.id(*it));
+            appendChunk_(data, key.data(), key.size());
+
+            // the size of the entity's data is only known after it has been written
+            size_t sizePos = data.size();
+            data.append(sizeof(uint64_t), '\0');
             serializer.serializeEntity(outStream_, *it);
-            outStream_ << "\n";
+            uint64_t size = data.size() - sizePos - sizeof(uint64_t);
+            std::memcpy(&data[sizePos], &size, sizeof(size));
         }
 
         serializeSectionEnd();
@@ -155,37 +437,171 @@ public:
 
     /*!
      * \brief Finish the restart file.
+     *
+     * This is a collective operation on all processes of the grid.
      */
     void serializeEnd()
-    { outStream_.close(); }
+    {
+        if (!outStream_.good())
+            OPM_THROW(std::runtime_error,
+                      "Could not serialize the state to restart file '" << fileName_ << "'");
+
+        // assemble the table of the sections of this process
+        BlockHeader_ blockHeader;
+        blockHeader.numSections = sections_.size();
+
+        std::string table(sizeof(BlockHeader_) + sections_.size()*sizeof(SectionEntry_), '\0');
+        uint64_t payloadOffset = table.size();
+        for (const auto& section : sections_)
+            payloadOffset += section.name.size();
+
+        for (size_t sectionIdx = 0; sectionIdx < sections_.size(); ++sectionIdx) {
+            const auto& section = sections_[sectionIdx];
+            SectionEntry_ entry;
+            entry.nameSize = section.name.size();
+            entry.payloadOffset = payloadOffset;
+            entry.payloadSize = section.payload.size();
+            entry.checksum = checksum_(section.payload.data(), section.payload.size(),
+                                       checksum_(section.name.data(), section.name.size()));
+            std::memcpy(&table[sizeof(BlockHeader_) + sectionIdx*sizeof(SectionEntry_)],
+                        &entry, sizeof(entry));
+            payloadOffset += entry.payloadSize;
+        }
+        for (const auto& section : sections_)
+            table += section.name;
+
+        blockHeader.tableChecksum = checksum_(table.data() + sizeof(BlockHeader_),
+                                              table.size() - sizeof(BlockHeader_));
+        std::memcpy(&table[0], &blockHeader, sizeof(blockHeader));
+
+        // the data of this process is written directly from the section buffers
+        std::vector<std::pair<const char*, size_t> > buffers;
+        buffers.emplace_back(table.data(), table.size());
+        for (const auto& section : sections_)
+            if (!section.payload.empty())
+                buffers.emplace_back(section.payload.data(), section.payload.size());
+
+        uint64_t blockSize = payloadOffset;
+        int commSize = commSize_();
+        int commRank = commRank_();
+
+        // determine the location of the data of each process within the file
+        std::vector<uint64_t> blockSizes(static_cast<size_t>(commSize), blockSize);
+#if HAVE_MPI
+        if (commSize > 1)
+            MPI_Allgather(&blockSize, 1, MPI_UINT64_T,
+                          blockSizes.data(), 1, MPI_UINT64_T,
+                          comm_);
+#endif
+
+        std::vector<RankEntry_> rankTable(static_cast<size_t>(commSize));
+        uint64_t offset = sizeof(FileHeader_) + rankTable.size()*sizeof(RankEntry_);
+        for (size_t rankIdx = 0; rankIdx < rankTable.size(); ++rankIdx) {
+            rankTable[rankIdx].offset = offset;
+            rankTable[rankIdx].size = blockSizes[rankIdx];
+            offset += blockSizes[rankIdx];
+        }
+        uint64_t fileSize = offset;
+
+        FileHeader_ fileHeader;
+        std::memcpy(fileHeader.magic, fileMagic_(), sizeof(fileHeader.magic));
+        fileHeader.byteOrderMark = byteOrderMark_();
+        fileHeader.version = formatVersion_();
+        fileHeader.numRanks = rankTable.size();
+        fileHeader.rankTableChecksum =
+            checksum_(reinterpret_cast<const char*>(rankTable.data()),
+                      rankTable.size()*sizeof(RankEntry_));
+
+        // the first process also writes the header of the file
+        uint64_t writeOffset = rankTable[static_cast<size_t>(commRank)].offset;
+        if (commRank == 0) {
+            buffers.emplace(buffers.begin(),
+                            reinterpret_cast<const char*>(rankTable.data()),
+                            rankTable.size()*sizeof(RankEntry_));
+            buffers.emplace(buffers.begin(),
+                            reinterpret_cast<const char*>(&fileHeader),
+                            sizeof(fileHeader));
+            writeOffset = 0;
+        }
+
+        if (commSize > 1)
+            writeParallel_(buffers, writeOffset, fileSize);
+        else {
+            std::ofstream outFile(fileName_.c_str(), std::ios::binary | std::ios::trunc);
+            for (const auto& buffer : buffers)
+                outFile.write(buffer.first, static_cast<std::streamsize>(buffer.second));
+            if (!outFile.good())
+                OPM_THROW(std::runtime_error,
+                          "Could not write restart file '" << fileName_ << "'");
+        }
+
+        sections_.clear();
+    }
 
     /*!
      * \brief Start reading a restart file at a certain simulated
      *        time.
+     *
+     * This is a collective operation on all processes of the grid.
      */
     template <class Simulator, class Scalar>
     void deserializeBegin(Simulator& simulator, Scalar t)
     {
-        fileName_ = restartFileName_(simulator.gridView(), simulator.problem().name(), t);
+        fileName_ = restartFileName_(simulator.problem().name(), t);
+        comm_ = Ewoms::Linear::gridCommunicator(simulator.gridView().comm());
+        mapFile_();
 
-        // open input file and read magic cookie
-        inStream_.open(fileName_.c_str());
-        if (!inStream_.good()) {
-            OPM_THROW(std::runtime_error, "Restart file '" << fileName_
-                                          << "' could not be opened properly");
-        }
+        // check the header of the file
+        FileHeader_ fileHeader;
+        if (mappedSize_ < sizeof(fileHeader))
+            OPM_THROW(std::runtime_error,
+                      "Restart file '" << fileName_ << "' is too small");
+        std::memcpy(&fileHeader, mappedData_, sizeof(fileHeader));
+        if (std::memcmp(fileHeader.magic, fileMagic_(), sizeof(fileHeader.magic)) != 0)
+            OPM_THROW(std::runtime_error,
+                      "File '" << fileName_ << "' is not an eWoms restart file");
+        if (fileHeader.byteOrderMark != byteOrderMark_())
+            OPM_THROW(std::runtime_error,
+                      "Restart file '" << fileName_ << "' was written on a machine "
+                      "with a different byte order");
+        if (fileHeader.version != formatVersion_())
+            OPM_THROW(std::runtime_error,
+                      "Restart file '" << fileName_ << "' uses the unsupported format version "
+                      << fileHeader.version);
+        if (fileHeader.numRanks == 0
+            || fileHeader.numRanks > mappedSize_/sizeof(RankEntry_))
+            OPM_THROW(std::runtime_error,
+                      "Restart file '" << fileName_ << "' is corrupted: invalid number "
+                      "of processes");
 
-        // make sure that we don't open an empty file
-        inStream_.seekg(0, std::ios::end);
-        auto pos = inStream_.tellg();
-        if (pos == 0) {
+        // read the table of the data written by the processes of the previous run
+        const char* rankTableData = mappedData_ + sizeof(FileHeader_);
+        size_t rankTableSize = static_cast<size_t>(fileHeader.numRanks)*sizeof(RankEntry_);
+        checkRange_(sizeof(FileHeader_), rankTableSize, mappedSize_);
+        if (checksum_(rankTableData, rankTableSize) != fileHeader.rankTableChecksum)
             OPM_THROW(std::runtime_error,
-                      "Restart file '" << fileName_ << "' is empty");
+                      "Restart file '" << fileName_ << "' is corrupted: checksum mismatch "
+                      "in the table of processes");
+
+        blocks_.resize(static_cast<size_t>(fileHeader.numRanks));
+        for (size_t blockIdx = 0; blockIdx < blocks_.size(); ++blockIdx) {
+            RankEntry_ rankEntry;
+            std::memcpy(&rankEntry, rankTableData + blockIdx*sizeof(RankEntry_), sizeof(rankEntry));
+            checkRange_(rankEntry.offset, rankEntry.size, mappedSize_);
+            parseBlock_(blocks_[blockIdx], mappedData_ + rankEntry.offset, rankEntry.size);
         }
-        inStream_.seekg(0, std::ios::beg);
 
-        const std::string magicCookie = magicRestartCookie_(simulator.gridView());
+        // the sections which are not related to entities are read from the data of a
+        // single process of the previous run
+        if (blocks_.size() == static_cast<size_t>(commSize_()))
+            globalBlockIdx_ = static_cast<size_t>(commRank_());
+        else if (commRank_() == 0 || blocks_.size() == 1)
+            globalBlockIdx_ = 0;
+        else
+            globalBlockIdx_ = 1;
+        curSectionIdx_ = 0;
 
+        const std::string magicCookie = magicRestartCookie_(simulator.gridView());
         deserializeSectionBegin(magicCookie);
         deserializeSectionEnd();
     }
@@ -202,14 +618,12 @@ public:
      */
     void deserializeSectionBegin(const std::string& cookie)
     {
-        if (!inStream_.good())
-            OPM_THROW(std::runtime_error,
-                      "Encountered unexpected EOF in restart file.");
-        std::string buf;
-        std::getline(inStream_, buf);
-        if (buf != cookie)
-            OPM_THROW(std::runtime_error,
-                      "Could not start section '" << cookie << "'");
+        if (blocks_.size() != static_cast<size_t>(commSize_()))
+            checkSectionIsGlobal_(cookie);
+
+        const auto& payload = sectionPayload_(globalBlockIdx_, cookie);
+        inBuffer_.reset(payload.first, payload.second);
+        inStream_.clear();
     }
 
     /*!
@@ -217,20 +631,27 @@ public:
      */
     void deserializeSectionEnd()
     {
-        std::string dummy;
-        std::getline(inStream_, dummy);
-        for (unsigned i = 0; i < dummy.length(); ++i) {
-            if (!std::isspace(dummy[i])) {
-                OPM_THROW(std::logic_error,
-                          "Encountered unread values while deserializing");
-            }
-        }
+        if (inStream_.fail())
+            OPM_THROW(std::runtime_error,
+                      "Could not read section " << curSectionIdx_ << " of restart file '"
+                      << fileName_ << "'");
+
+        // sections may contain data which is only read by the process which wrote
+        // them. this process must consume the section completely.
+        if (globalBlockIdx_ == static_cast<size_t>(commRank_())
+            && inBuffer_.begin() != inBuffer_.end())
+            OPM_THROW(std::logic_error,
+                      "Encountered unread values while deserializing section "
+                      << curSectionIdx_ << " of restart file '" << fileName_ << "'");
+        inBuffer_.reset(nullptr, nullptr);
+        ++curSectionIdx_;
     }
 
     /*!
      * \brief Deserialize all leaf entities of a codim in a grid.
      *
-     * The actual work is done by Deserializer::deserialize(Entity)
+     * The actual work is done by Deserializer::deserialize(Entity). This is a
+     * collective operation on all processes of the grid.
      */
     template <int codim, class Deserializer, class GridView>
     void deserializeEntities(Deserializer& deserializer, const GridView& gridView)
@@ -238,37 +659,473 @@ public:
         std::ostringstream oss;
         oss << "Entities: Codim " << codim;
         std::string cookie = oss.str();
-        deserializeSectionBegin(cookie);
 
-        std::string curLine;
+        int commSize = commSize_();
+        int commRank = commRank_();
+
+        // errors which are only detected by some processes must not be thrown right
+        // away because the remaining ones would wait for them in the next collective
+        // operation. they are thus counted and reported by all processes at the end.
+        int numCorrupted = 0;
+        int numFailed = 0;
+        std::string failureMessage;
 
-        // read entity data
+        // send the records read by the current process to the processes which are
+        // responsible for their IDs
+        std::vector<std::string> sendBuffers(static_cast<size_t>(commSize));
+        for (size_t blockIdx = static_cast<size_t>(commRank);
+             blockIdx < blocks_.size();
+             blockIdx += static_cast<size_t>(commSize))
+        {
+            const auto& payload = sectionPayload_(blockIdx, cookie);
+            const char* pos = payload.first;
+            while (pos != payload.second) {
+                const char* recordBegin = pos;
+                const char* key;
+                const char* data;
+                uint64_t keySize;
+                uint64_t dataSize;
+                if (!readChunk_(pos, payload.second, key, keySize)
+                    || keySize == missingChunk_()
+                    || !readChunk_(pos, payload.second, data, dataSize)
+                    || dataSize == missingChunk_())
+                {
+                    // the remaining records of the block cannot be located anymore
+                    ++numCorrupted;
+                    break;
+                }
+
+                int destRank = homeRank_(std::string(key, keySize), commSize);
+                sendBuffers[static_cast<size_t>(destRank)].append(recordBegin, pos);
+            }
+        }
+
+        std::string records;
+        std::vector<size_t> recordOffsets;
+        exchange_(sendBuffers, records, recordOffsets);
+
+        std::unordered_map<std::string, std::pair<const char*, uint64_t> > recordIndex;
+        const char* pos = records.data();
+        const char* end = records.data() + records.size();
+        while (pos != end) {
+            const char* key;
+            const char* data;
+            uint64_t keySize;
+            uint64_t dataSize;
+            readChunk_(pos, end, key, keySize);
+            readChunk_(pos, end, data, dataSize);
+            recordIndex[std::string(key, keySize)] = std::make_pair(data, dataSize);
+        }
+
+        // ask the responsible processes for the data of the local entities
+        const auto& idSet = gridView.grid().globalIdSet();
         typedef typename GridView::template Codim<codim>::Iterator Iterator;
+        std::vector<int> entityHomeRanks;
+        for (auto& buffer : sendBuffers)
+            buffer.clear();
+
         Iterator it = gridView.template begin<codim>();
         const Iterator& endIt = gridView.template end<codim>();
         for (; it != endIt; ++it) {
-            if (!inStream_.good()) {
-                OPM_THROW(std::runtime_error, "Restart file is corrupted");
+            const std::string& key = idKey_(idSet.id(*it));
+            int destRank = homeRank_(key, commSize);
+            entityHomeRanks.push_back(destRank);
+            appendChunk_(sendBuffers[static_cast<size_t>(destRank)], key.data(), key.size());
+        }
+
+        std::string requests;
+        std::vector<size_t> requestOffsets;
+        exchange_(sendBuffers, requests, requestOffsets);
+
+        // answer the requests of all processes in the order in which they were made
+        for (int peerRank = 0; peerRank < commSize; ++peerRank) {
+            std::string& answers = sendBuffers[static_cast<size_t>(peerRank)];
+            answers.clear();
+
+            pos = requests.data() + requestOffsets[static_cast<size_t>(peerRank)];
+            end = requests.data() + requestOffsets[static_cast<size_t>(peerRank) + 1];
+            while (pos != end) {
+                const char* key;
+                uint64_t keySize;
+                readChunk_(pos, end, key, keySize);
+
+                const auto& recordIt = recordIndex.find(std::string(key, keySize));
+                if (recordIt == recordIndex.end()) {
+                    uint64_t missing = missingChunk_();
+                    answers.append(reinterpret_cast<const char*>(&missing), sizeof(missing));
+                }
+                else
+                    appendChunk_(answers, recordIt->second.first, recordIt->second.second);
             }
+        }
+
+        std::string answers;
+        std::vector<size_t> answerOffsets;
+        exchange_(sendBuffers, answers, answerOffsets);
+
+        // deserialize the local entities
+        std::vector<const char*> answerPos(static_cast<size_t>(commSize));
+        for (size_t peerIdx = 0; peerIdx < answerPos.size(); ++peerIdx)
+            answerPos[peerIdx] = answers.data() + answerOffsets[peerIdx];
 
-            std::getline(inStream_, curLine);
-            std::istringstream curLineStream(curLine);
-            deserializer.deserializeEntity(curLineStream, *it);
+        int numMissing = 0;
+        int numInconsistent = 0;
+        size_t entityIdx = 0;
+        it = gridView.template begin<codim>();
+        for (; it != endIt; ++it, ++entityIdx) {
+            size_t peerIdx = static_cast<size_t>(entityHomeRanks[entityIdx]);
+            const char* data;
+            uint64_t dataSize;
+            readChunk_(answerPos[peerIdx], answers.data() + answerOffsets[peerIdx + 1],
+                       data, dataSize);
+            if (dataSize == missingChunk_()) {
+                ++numMissing;
+                continue;
+            }
+
+            inBuffer_.reset(data, data + dataSize);
+            inStream_.clear();
+            try {
+                deserializer.deserializeEntity(inStream_, *it);
+            }
+            catch (const std::exception& e) {
+                if (numFailed == 0)
+                    failureMessage = e.what();
+                ++numFailed;
+                continue;
+            }
+            if (!inStream_ || inBuffer_.begin() != inBuffer_.end())
+                ++numInconsistent;
         }
+        inBuffer_.reset(nullptr, nullptr);
 
-        deserializeSectionEnd();
+        int numErrors[4] = { numCorrupted, numFailed, numMissing, numInconsistent };
+        gridView.comm().sum(numErrors, 4);
+        if (numErrors[0] > 0)
+            OPM_THROW(std::runtime_error,
+                      "Restart file '" << fileName_ << "' is corrupted: "
+                      << numErrors[0] << " blocks of section '" << cookie
+                      << "' contain invalid records");
+        if (numErrors[1] > 0)
+            OPM_THROW(std::runtime_error,
+                      "The model could not deserialize the data of " << numErrors[1]
+                      << " entities in restart file '" << fileName_ << "'"
+                      << (numFailed > 0 ? " (" + failureMessage + ")" : std::string()));
+        numMissing = numErrors[2];
+        numInconsistent = numErrors[3];
+        if (numMissing > 0)
+            OPM_THROW(std::runtime_error,
+                      "Restart file '" << fileName_ << "' does not contain the data of "
+                      << numMissing << " entities of the grid");
+        if (numInconsistent > 0)
+            OPM_THROW(std::runtime_error,
+                      "The data of " << numInconsistent << " entities in restart file '"
+                      << fileName_ << "' does not match the size expected by the model");
+
+        ++curSectionIdx_;
     }
 
     /*!
      * \brief Stop reading the restart file.
      */
     void deserializeEnd()
-    { inStream_.close(); }
+    {
+        inBuffer_.reset(nullptr, nullptr);
+        blocks_.clear();
+        unmapFile_();
+    }
 
 private:
+    int commSize_() const
+    {
+        int commSize = 1;
+#if HAVE_MPI
+        MPI_Comm_size(comm_, &commSize);
+#endif
+        return commSize;
+    }
+
+    int commRank_() const
+    {
+        int commRank = 0;
+#if HAVE_MPI
+        MPI_Comm_rank(comm_, &commRank);
+#endif
+        return commRank;
+    }
+
+    void checkRange_(uint64_t offset, uint64_t size, uint64_t totalSize) const
+    {
+        if (offset > totalSize || size > totalSize - offset)
+            OPM_THROW(std::runtime_error,
+                      "Restart file '" << fileName_ << "' is corrupted: "
+                      "data is located beyond its end");
+    }
+
+    /*!
+     * \brief Read the table of sections of the data written by a single process.
+     */
+    void parseBlock_(Block_& block, const char* data, uint64_t size)
+    {
+        block.data = data;
+        block.size = size;
+
+        BlockHeader_ blockHeader;
+        checkRange_(0, sizeof(blockHeader), size);
+        std::memcpy(&blockHeader, data, sizeof(blockHeader));
+        if (blockHeader.numSections > size/sizeof(SectionEntry_))
+            OPM_THROW(std::runtime_error,
+                      "Restart file '" << fileName_ << "' is corrupted: invalid number of sections");
+
+        block.entries.resize(static_cast<size_t>(blockHeader.numSections));
+        block.names.resize(block.entries.size());
+        uint64_t tableSize = block.entries.size()*sizeof(SectionEntry_);
+        checkRange_(sizeof(BlockHeader_), tableSize, size);
+        std::memcpy(block.entries.data(), data + sizeof(BlockHeader_), tableSize);
+
+        uint64_t nameOffset = sizeof(BlockHeader_) + tableSize;
+        for (size_t sectionIdx = 0; sectionIdx < block.entries.size(); ++sectionIdx) {
+            const auto& entry = block.entries[sectionIdx];
+            checkRange_(nameOffset, entry.nameSize, size);
+            checkRange_(entry.payloadOffset, entry.payloadSize, size);
+            block.names[sectionIdx].assign(data + nameOffset, entry.nameSize);
+            nameOffset += entry.nameSize;
+        }
+        if (checksum_(data + sizeof(BlockHeader_), nameOffset - sizeof(BlockHeader_))
+            != blockHeader.tableChecksum)
+            OPM_THROW(std::runtime_error,
+                      "Restart file '" << fileName_ << "' is corrupted: checksum mismatch "
+                      "in the table of sections");
+    }
+
+    /*!
+     * \brief Returns the verified payload of the current section in the data written by
+     *        a given process.
+     */
+    std::pair<const char*, const char*> sectionPayload_(size_t blockIdx,
+                                                        const std::string& cookie) const
+    {
+        const Block_& block = blocks_[blockIdx];
+        if (curSectionIdx_ >= block.entries.size())
+            OPM_THROW(std::runtime_error,
+                      "Encountered unexpected end of restart file.");
+        if (block.names[curSectionIdx_] != cookie)
+            OPM_THROW(std::runtime_error,
+                      "Could not start section '" << cookie << "'");
+
+        const auto& entry = block.entries[curSectionIdx_];
+        const char* payload = block.data + entry.payloadOffset;
+        size_t payloadSize = static_cast<size_t>(entry.payloadSize);
+        if (checksum_(payload, payloadSize, checksum_(cookie.data(), cookie.size()))
+            != entry.checksum)
+            OPM_THROW(std::runtime_error,
+                      "Restart file '" << fileName_ << "' is corrupted: checksum mismatch "
+                      "in section '" << cookie << "'");
+
+        return std::make_pair(payload, payload + payloadSize);
+    }
+
+    /*!
+     * \brief Make sure that a section which is not related to entities can be read by a
+     *        different number of processes than the one which wrote it.
+     *
+     * This is the case if all processes of the previous run wrote the same data, except
+     * that the first process may have appended some data of its own. Since the decision
+     * only depends on the contents of the restart file, all processes come to the same
+     * conclusion.
+     */
+    void checkSectionIsGlobal_(const std::string& cookie) const
+    {
+        if (blocks_.size() < 2)
+            return;
+
+        const auto& rootPayload = sectionPayload_(/*blockIdx=*/0, cookie);
+        size_t rootSize = static_cast<size_t>(rootPayload.second - rootPayload.first);
+        const auto& refPayload = sectionPayload_(/*blockIdx=*/1, cookie);
+        size_t refSize = static_cast<size_t>(refPayload.second - refPayload.first);
+        bool isGlobal =
+            refSize <= rootSize
+            && std::memcmp(refPayload.first, rootPayload.first, refSize) == 0;
+        for (size_t blockIdx = 2; isGlobal && blockIdx < blocks_.size(); ++blockIdx) {
+            const auto& payload = sectionPayload_(blockIdx, cookie);
+            size_t size = static_cast<size_t>(payload.second - payload.first);
+            isGlobal =
+                size == refSize
+                && std::memcmp(payload.first, refPayload.first, size) == 0;
+        }
+
+        if (!isGlobal)
+            OPM_THROW(std::runtime_error,
+                      "Section '" << cookie << "' of restart file '" << fileName_
+                      << "' contains data which is specific to the " << blocks_.size()
+                      << " processes which wrote it. The simulation can only be "
+                      "resumed using the same number of processes");
+    }
+
+    /*!
+     * \brief Send a buffer to each process and receive the buffers which are sent by all
+     *        processes to the current one.
+     *
+     * The data received from process i is located in the range [recvOffsets[i],
+     * recvOffsets[i + 1]) of the receive buffer.
+     */
+    void exchange_(const std::vector<std::string>& sendBuffers,
+                   std::string& recvBuffer,
+                   std::vector<size_t>& recvOffsets) const
+    {
+        size_t commSize = sendBuffers.size();
+        recvOffsets.resize(commSize + 1);
+        recvOffsets[0] = 0;
+
+#if HAVE_MPI
+        if (commSize > 1) {
+            std::vector<int> sendCounts(commSize);
+            std::vector<int> sendDispls(commSize);
+            std::vector<int> recvCounts(commSize);
+            std::vector<int> recvDispls(commSize);
+
+            std::string sendBuffer;
+            for (size_t peerIdx = 0; peerIdx < commSize; ++peerIdx) {
+                if (sendBuffer.size() + sendBuffers[peerIdx].size() > INT_MAX)
+                    OPM_THROW(std::runtime_error,
+                              "Too much restart data to be exchanged between processes");
+                sendDispls[peerIdx] = static_cast<int>(sendBuffer.size());
+                sendCounts[peerIdx] = static_cast<int>(sendBuffers[peerIdx].size());
+                sendBuffer += sendBuffers[peerIdx];
+            }
+
+            MPI_Alltoall(sendCounts.data(), 1, MPI_INT,
+                         recvCounts.data(), 1, MPI_INT,
+                         comm_);
+
+            for (size_t peerIdx = 0; peerIdx < commSize; ++peerIdx)
+                recvOffsets[peerIdx + 1] =
+                    recvOffsets[peerIdx] + static_cast<size_t>(recvCounts[peerIdx]);
+            if (recvOffsets[commSize] > INT_MAX)
+                OPM_THROW(std::runtime_error,
+                          "Too much restart data to be exchanged between processes");
+            for (size_t peerIdx = 0; peerIdx < commSize; ++peerIdx)
+                recvDispls[peerIdx] = static_cast<int>(recvOffsets[peerIdx]);
+
+            recvBuffer.resize(recvOffsets[commSize]);
+            MPI_Alltoallv(const_cast<char*>(sendBuffer.data()),
+                          sendCounts.data(), sendDispls.data(), MPI_BYTE,
+                          &recvBuffer[0], recvCounts.data(), recvDispls.data(), MPI_BYTE,
+                          comm_);
+            return;
+        }
+#endif
+
+        recvBuffer = sendBuffers[0];
+        recvOffsets[1] = recvBuffer.size();
+    }
+
+    void mapFile_()
+    {
+        unmapFile_();
+
+        int fd = ::open(fileName_.c_str(), O_RDONLY);
+        if (fd < 0)
+            OPM_THROW(std::runtime_error, "Restart file '" << fileName_
+                                          << "' could not be opened properly: "
+                                          << std::strerror(errno));
+
+        struct stat fileStat;
+        if (::fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+            ::close(fd);
+            OPM_THROW(std::runtime_error,
+                      "Restart file '" << fileName_ << "' is empty");
+        }
+
+        void* data = ::mmap(nullptr, static_cast<size_t>(fileStat.st_size),
+                            PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED)
+            OPM_THROW(std::runtime_error, "Restart file '" << fileName_
+                                          << "' could not be mapped into memory: "
+                                          << std::strerror(errno));
+
+        mappedData_ = static_cast<const char*>(data);
+        mappedSize_ = static_cast<size_t>(fileStat.st_size);
+    }
+
+    void unmapFile_()
+    {
+        if (mappedData_)
+            ::munmap(const_cast<char*>(mappedData_), mappedSize_);
+        mappedData_ = nullptr;
+        mappedSize_ = 0;
+    }
+
+#if HAVE_MPI
+    void writeParallel_(const std::vector<std::pair<const char*, size_t> >& buffers,
+                        uint64_t writeOffset,
+                        uint64_t fileSize)
+    {
+        // describe all buffers of the process by a single datatype. the block lengths
+        // are integers, so large buffers need to be split into several blocks.
+        static const size_t maxBlockSize = 1 << 30;
+        std::vector<int> blockLengths;
+        std::vector<MPI_Aint> blockAddresses;
+        for (const auto& buffer : buffers) {
+            for (size_t pos = 0; pos < buffer.second; pos += maxBlockSize) {
+                MPI_Aint address;
+                MPI_Get_address(const_cast<char*>(buffer.first + pos), &address);
+                blockAddresses.push_back(address);
+                blockLengths.push_back(static_cast<int>(std::min(maxBlockSize, buffer.second - pos)));
+            }
+        }
+
+        MPI_Datatype memType;
+        MPI_Type_create_hindexed(static_cast<int>(blockLengths.size()),
+                                 blockLengths.data(),
+                                 blockAddresses.data(),
+                                 MPI_BYTE,
+                                 &memType);
+        MPI_Type_commit(&memType);
+
+        // the writes are collective, so the MPI library is free to aggregate them
+        MPI_File file;
+        int ret = MPI_File_open(comm_, const_cast<char*>(fileName_.c_str()),
+                                MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                                MPI_INFO_NULL, &file);
+        if (ret == MPI_SUCCESS) {
+            ret = MPI_File_set_size(file, static_cast<MPI_Offset>(fileSize));
+            int ret2 = MPI_File_write_at_all(file, static_cast<MPI_Offset>(writeOffset),
+                                             MPI_BOTTOM, 1, memType, MPI_STATUS_IGNORE);
+            if (ret == MPI_SUCCESS)
+                ret = ret2;
+            ret2 = MPI_File_close(&file);
+            if (ret == MPI_SUCCESS)
+                ret = ret2;
+        }
+        MPI_Type_free(&memType);
+
+        if (ret != MPI_SUCCESS)
+            OPM_THROW(std::runtime_error,
+                      "Could not write restart file '" << fileName_ << "'");
+    }
+#else
+    void writeParallel_(const std::vector<std::pair<const char*, size_t> >&,
+                        uint64_t,
+                        uint64_t)
+    { OPM_THROW(std::logic_error, "Writing restart files in parallel requires MPI"); }
+#endif
+
     std::string fileName_;
-    std::ifstream inStream_;
-    std::ofstream outStream_;
+    Communicator comm_;
+
+    OutputBuffer_ outBuffer_;
+    std::ostream outStream_;
+    std::vector<Section_> sections_;
+
+    InputBuffer_ inBuffer_;
+    std::istream inStream_;
+    const char* mappedData_;
+    size_t mappedSize_;
+    std::vector<Block_> blocks_;
+    size_t globalBlockIdx_;
+    size_t curSectionIdx_;
 };
 } // namespace Ewoms
 
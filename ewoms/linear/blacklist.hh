@@ -37,6 +37,8 @@
 #endif // HAVE_MPI
 
 #include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace Ewoms {
 namespace Linear {
@@ -135,7 +137,7 @@ private:
 
         numIdxBuff.resize(1);
         numIdxBuff[0] = static_cast<unsigned>(peerIndices.size());
-        numIdxBuff.send(peerRank);
+        numIdxBuff.send(peerRank, domesticOverlap.communicator());
 
         idxBuff.resize(2*peerIndices.size());
         for (size_t i = 0; i < peerIndices.size(); ++i) {
@@ -147,7 +149,7 @@ private:
             // native peer index
             idxBuff[2*i + 1] = peerIndices[i].nativeIndexOfPeer;
         }
-        idxBuff.send(peerRank);
+        idxBuff.send(peerRank, domesticOverlap.communicator());
     }
 
     template <class DomesticOverlap>
@@ -155,11 +157,11 @@ private:
                                const DomesticOverlap& domesticOverlap)
     {
         MpiBuffer<unsigned> numGlobalIdxBuf(1);
-        numGlobalIdxBuf.receive(peerRank);
+        numGlobalIdxBuf.receive(peerRank, domesticOverlap.communicator());
         unsigned numIndices = numGlobalIdxBuf[0];
 
         MpiBuffer<Index> globalIdxBuf(2*numIndices);
-        globalIdxBuf.receive(peerRank);
+        globalIdxBuf.receive(peerRank, domesticOverlap.communicator());
         for (unsigned i = 0; i < numIndices; ++i) {
             Index globalIdx = globalIdxBuf[2*i + 0];
             Index nativeIdx = globalIdxBuf[2*i + 1];
@@ -169,8 +171,8 @@ private:
     }
 #endif // HAVE_MPI
 
-    std::set<Index> nativeBlackListedIndices_;
-    std::map<Index, Index> nativeToDomesticMap_;
+    std::unordered_set<Index> nativeBlackListedIndices_;
+    std::unordered_map<Index, Index> nativeToDomesticMap_;
 #if HAVE_MPI
     std::map<ProcessRank, MpiBuffer<unsigned>> numGlobalIdxSendBuff_;
     std::map<ProcessRank, MpiBuffer<Index>> globalIdxSendBuff_;
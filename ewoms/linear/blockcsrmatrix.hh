@@ -0,0 +1,315 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::Linear::BlockCsrMatrix
+ */
+#ifndef EWOMS_BLOCK_CSR_MATRIX_HH
+#define EWOMS_BLOCK_CSR_MATRIX_HH
+
+#include <ewoms/common/alignedallocator.hh>
+
+#include <cassert>
+#include <vector>
+#include <cstddef>
+
+namespace Ewoms {
+namespace Linear {
+
+/*!
+ * \brief A compact block-CSR copy of a BCRS matrix with fixed-size blocks which provides
+ *        vectorizable matrix-vector and triangular solve kernels.
+ *
+ * The blocks are stored contiguously in column-major order and each column of a block
+ * is padded to a multiple of the 128 bit SIMD width. This means that the contribution
+ * of a block to the result is a sum of aligned vector operations of compile-time
+ * length which the compiler can map directly to SIMD instructions. The rows of the
+ * matrix-vector products are distributed over the available OpenMP threads.
+ *
+ * If the matrix stores an ILU factorization in the format produced by
+ * Dune::bilu0_decomposition(), the triangular solves can be done row by row using
+ * iluForwardRow() and iluBackwardRow(). The order in which the rows are processed (and
+ * thus how they are distributed over the threads) is left to the caller.
+ *
+ * setPattern() rebuilds the sparsity pattern unconditionally and must be called
+ * whenever the pattern of the source matrix changes. If only the values change,
+ * calling assign() is sufficient.
+ */
+template <class Scalar, int blockSize>
+class BlockCsrMatrix
+{
+    enum { simdWidth = (16 + sizeof(Scalar) - 1)/sizeof(Scalar) };
+
+public:
+    //! The number of rows of a block including the padding
+    enum { paddedBlockRows = ((blockSize + simdWidth - 1)/simdWidth)*simdWidth };
+
+    //! The number of scalars which are stored per block
+    enum { blockStride = paddedBlockRows*blockSize };
+
+    BlockCsrMatrix()
+    {}
+
+    /*!
+     * \brief Set up the sparsity pattern of the compact storage using the one of a
+     *        Dune::BCRSMatrix.
+     *
+     * All values are set to zero.
+     */
+    template <class BCRSMatrix>
+    void setPattern(const BCRSMatrix& M)
+    {
+        static_assert(BCRSMatrix::block_type::rows == blockSize
+                      && BCRSMatrix::block_type::cols == blockSize,
+                      "The block size of the source matrix does not match");
+
+        rowStart_.resize(M.N() + 1);
+        diagIdx_.resize(M.N());
+        colIdx_.resize(M.nonzeroes());
+
+        size_t blockIdx = 0;
+        const auto& rowEndIt = M.end();
+        for (auto rowIt = M.begin(); rowIt != rowEndIt; ++rowIt) {
+            const size_t rowIdx = rowIt.index();
+            rowStart_[rowIdx] = blockIdx;
+            // rows without a diagonal block get an invalid diagonal index
+            diagIdx_[rowIdx] = M.nonzeroes();
+            const auto& colEndIt = rowIt->end();
+            for (auto colIt = rowIt->begin(); colIt != colEndIt; ++colIt) {
+                if (colIt.index() == rowIdx)
+                    diagIdx_[rowIdx] = blockIdx;
+                colIdx_[blockIdx++] = static_cast<unsigned>(colIt.index());
+            }
+        }
+        rowStart_[M.N()] = blockIdx;
+
+        values_.assign(M.nonzeroes()*blockStride, 0.0);
+    }
+
+    /*!
+     * \brief Copy the values of a Dune::BCRSMatrix to the compact storage.
+     *
+     * The source matrix must exhibit the sparsity pattern which was passed to
+     * setPattern().
+     */
+    template <class BCRSMatrix>
+    void assign(const BCRSMatrix& M)
+    {
+        assert(rowStart_.size() == M.N() + 1 && colIdx_.size() == M.nonzeroes());
+
+        // copy the values. the padding entries stay zero.
+        const auto& rowEndIt = M.end();
+        for (auto rowIt = M.begin(); rowIt != rowEndIt; ++rowIt) {
+            size_t blockIdx = rowStart_[rowIt.index()];
+            const auto& colEndIt = rowIt->end();
+            for (auto colIt = rowIt->begin(); colIt != colEndIt; ++colIt, ++blockIdx) {
+                Scalar* block = values_.data() + blockIdx*blockStride;
+                for (int j = 0; j < blockSize; ++j)
+                    for (int i = 0; i < blockSize; ++i)
+                        block[j*paddedBlockRows + i] = (*colIt)[i][j];
+            }
+        }
+    }
+
+    /*!
+     * \brief Return the number of block rows.
+     */
+    size_t N() const
+    { return rowStart_.empty() ? 0 : rowStart_.size() - 1; }
+
+    /*!
+     * \brief Compute \f$ y = A x \f$.
+     */
+    template <class DomainVector, class RangeVector>
+    void mv(const DomainVector& x, RangeVector& y) const
+    {
+        const long numRows = static_cast<long>(N());
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (long rowIdx = 0; rowIdx < numRows; ++rowIdx) {
+            alignas(16) Scalar acc[paddedBlockRows] = {};
+            rowProduct_(static_cast<size_t>(rowIdx), x, acc);
+
+            auto& yRow = y[static_cast<size_t>(rowIdx)];
+            for (int i = 0; i < blockSize; ++i)
+                yRow[i] = acc[i];
+        }
+    }
+
+    /*!
+     * \brief Compute \f$ y = y + \alpha A x \f$.
+     */
+    template <class DomainVector, class RangeVector>
+    void usmv(Scalar alpha, const DomainVector& x, RangeVector& y) const
+    {
+        const long numRows = static_cast<long>(N());
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (long rowIdx = 0; rowIdx < numRows; ++rowIdx) {
+            alignas(16) Scalar acc[paddedBlockRows] = {};
+            rowProduct_(static_cast<size_t>(rowIdx), x, acc);
+
+            auto& yRow = y[static_cast<size_t>(rowIdx)];
+            for (int i = 0; i < blockSize; ++i)
+                yRow[i] += alpha*acc[i];
+        }
+    }
+
+    /*!
+     * \brief Compute \f$ y = A x \f$ for a subset of the rows.
+     *
+     * The remaining rows of \c y are left alone.
+     */
+    template <class DomainVector, class RangeVector>
+    void mv(const DomainVector& x, RangeVector& y, const std::vector<unsigned>& rows) const
+    {
+        const long numRows = static_cast<long>(rows.size());
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (long i = 0; i < numRows; ++i) {
+            size_t rowIdx = rows[static_cast<size_t>(i)];
+            alignas(16) Scalar acc[paddedBlockRows] = {};
+            rowProduct_(rowIdx, x, acc);
+
+            auto& yRow = y[rowIdx];
+            for (int j = 0; j < blockSize; ++j)
+                yRow[j] = acc[j];
+        }
+    }
+
+    /*!
+     * \brief Compute \f$ y = y + \alpha A x \f$ for a subset of the rows.
+     *
+     * The remaining rows of \c y are left alone.
+     */
+    template <class DomainVector, class RangeVector>
+    void usmv(Scalar alpha, const DomainVector& x, RangeVector& y, const std::vector<unsigned>& rows) const
+    {
+        const long numRows = static_cast<long>(rows.size());
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (long i = 0; i < numRows; ++i) {
+            size_t rowIdx = rows[static_cast<size_t>(i)];
+            alignas(16) Scalar acc[paddedBlockRows] = {};
+            rowProduct_(rowIdx, x, acc);
+
+            auto& yRow = y[rowIdx];
+            for (int j = 0; j < blockSize; ++j)
+                yRow[j] += alpha*acc[j];
+        }
+    }
+
+    /*!
+     * \brief Forward substitution of a single row with the unit lower triangular ILU
+     *        factor, i.e., \f$ v_i = d_i - \sum_{j < i} L_{ij} v_j \f$.
+     *
+     * All rows which row \c rowIdx depends on must already have been processed.
+     */
+    template <class RangeVector, class DomainVector>
+    void iluForwardRow(size_t rowIdx, const RangeVector& d, DomainVector& v) const
+    {
+        assert(diagIdx_[rowIdx] < colIdx_.size());
+
+        alignas(16) Scalar acc[paddedBlockRows] = {};
+        rangeProduct_(rowStart_[rowIdx], diagIdx_[rowIdx], v, acc);
+
+        const auto& dRow = d[rowIdx];
+        auto& vRow = v[rowIdx];
+        for (int i = 0; i < blockSize; ++i)
+            vRow[i] = dRow[i] - acc[i];
+    }
+
+    /*!
+     * \brief Backward substitution of a single row with the upper triangular ILU
+     *        factor, i.e., \f$ v_i = U_{ii}^{-1} (v_i - \sum_{j > i} U_{ij} v_j) \f$.
+     *
+     * The diagonal blocks of the factorization are expected to be inverted already.
+     * All rows which row \c rowIdx depends on must already have been processed.
+     */
+    template <class DomainVector>
+    void iluBackwardRow(size_t rowIdx, DomainVector& v) const
+    {
+        assert(diagIdx_[rowIdx] < colIdx_.size());
+
+        const size_t diagIdx = diagIdx_[rowIdx];
+        alignas(16) Scalar acc[paddedBlockRows] = {};
+        rangeProduct_(diagIdx + 1, rowStart_[rowIdx + 1], v, acc);
+
+        auto& vRow = v[rowIdx];
+        alignas(16) Scalar rhs[paddedBlockRows] = {};
+        for (int i = 0; i < blockSize; ++i)
+            rhs[i] = vRow[i] - acc[i];
+
+        alignas(16) Scalar result[paddedBlockRows] = {};
+        blockProduct_(values_.data() + diagIdx*blockStride, rhs, result);
+        for (int i = 0; i < blockSize; ++i)
+            vRow[i] = result[i];
+    }
+
+private:
+    // accumulate the product of a block row with a vector
+    template <class DomainVector>
+    void rowProduct_(size_t rowIdx, const DomainVector& x, Scalar* acc) const
+    { rangeProduct_(rowStart_[rowIdx], rowStart_[rowIdx + 1], x, acc); }
+
+    // accumulate the product of a contiguous range of blocks with a vector
+    template <class DomainVector>
+    void rangeProduct_(size_t beginIdx, size_t endIdx, const DomainVector& x, Scalar* acc) const
+    {
+        for (size_t blockIdx = beginIdx; blockIdx < endIdx; ++blockIdx)
+            blockProduct_(values_.data() + blockIdx*blockStride, x[colIdx_[blockIdx]], acc);
+    }
+
+    // accumulate the product of a single block with a vector block
+    template <class VectorBlock>
+    static void blockProduct_(const Scalar* block, const VectorBlock& xBlock, Scalar* acc)
+    {
+        for (int j = 0; j < blockSize; ++j) {
+            const Scalar xj = xBlock[j];
+            const Scalar* column = block + j*paddedBlockRows;
+#if defined(_OPENMP) && _OPENMP >= 201307
+#pragma omp simd aligned(column: 16)
+#endif
+            for (int i = 0; i < paddedBlockRows; ++i)
+                acc[i] += column[i]*xj;
+        }
+    }
+
+    std::vector<size_t> rowStart_;
+    std::vector<size_t> diagIdx_;
+    std::vector<unsigned> colIdx_;
+    std::vector<Scalar, Ewoms::aligned_allocator<Scalar, 64> > values_;
+};
+
+} // namespace Linear
+} // namespace Ewoms
+
+#endif
@@ -0,0 +1,173 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::Linear::BlockLUBackend
+ */
+#ifndef EWOMS_BLOCK_LU_BACKEND_HH
+#define EWOMS_BLOCK_LU_BACKEND_HH
+
+#include <ewoms/linear/blocksparselu.hh>
+#include <ewoms/common/parametersystem.hh>
+
+#include <opm/common/Unused.hpp>
+
+#include <dune/common/fmatrix.hh>
+
+#include <iostream>
+#include <cmath>
+
+namespace Ewoms {
+namespace Properties {
+// forward declaration of the required property tags
+NEW_PROP_TAG(Scalar);
+NEW_PROP_TAG(Simulator);
+NEW_PROP_TAG(JacobianMatrix);
+NEW_PROP_TAG(GlobalEqVector);
+NEW_PROP_TAG(LinearSolverVerbosity);
+NEW_PROP_TAG(LinearSolverBackend);
+NEW_TYPE_TAG(BlockLULinearSolver);
+} // namespace Properties
+} // namespace Ewoms
+
+namespace Ewoms {
+namespace Linear {
+/*!
+ * \ingroup Linear
+ *
+ * \brief A sequential linear solver backend which uses a sparse direct block LU
+ *        decomposition.
+ *
+ * In contrast to the SuperLU backend, the fill reducing ordering and the symbolic
+ * factorization are kept as long as the sparsity pattern of the Jacobian matrix does
+ * not change, i.e., within the Newton iterations and across time steps only the
+ * numeric factorization is redone. See BlockSparseLU for the details.
+ */
+template <class TypeTag>
+class BlockLUBackend
+{
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
+    typedef typename GET_PROP_TYPE(TypeTag, JacobianMatrix) Matrix;
+    typedef typename GET_PROP_TYPE(TypeTag, GlobalEqVector) Vector;
+
+    typedef Ewoms::Linear::BlockSparseLU<Matrix, Vector> LUDecomposition;
+
+public:
+    BlockLUBackend(const Simulator& simulator)
+        : simulator_(simulator)
+        , gridSequenceNumber_(-1)
+    {}
+
+    static void registerParameters()
+    {
+        EWOMS_REGISTER_PARAM(TypeTag, int, LinearSolverVerbosity,
+                             "The verbosity level of the linear solver");
+    }
+
+    /*!
+     * \brief Causes the solve() method to discared the structure of the linear system of
+     *        equations the next time it is called.
+     */
+    void eraseMatrix()
+    { lu_ = LUDecomposition(); }
+
+    void prepareMatrix(const Matrix& M)
+    {
+        M_ = &M;
+
+        // redo the symbolic factorization only if the sparsity pattern has changed
+        int curSeqNum = simulator_.gridManager().gridSequenceNumber();
+        if (gridSequenceNumber_ == curSeqNum && lu_.matchesPattern(M))
+            return;
+
+        gridSequenceNumber_ = curSeqNum;
+        lu_.analyze(M);
+
+        if (EWOMS_GET_PARAM(TypeTag, int, LinearSolverVerbosity) > 0)
+            std::cout << "Block LU: symbolic factorization of a matrix with "
+                      << M.N() << " rows and " << M.nonzeroes() << " non-zero blocks "
+                      << "yields " << lu_.factorNonzeroes() << " non-zero blocks\n"
+                      << std::flush;
+    }
+
+    void prepareRhs(const Matrix& M OPM_UNUSED, Vector& b)
+    {
+        b_ = &b;
+    }
+
+    bool solve(Vector& x)
+    {
+        try {
+            lu_.factorize(*M_);
+        }
+        catch (const Dune::FMatrixError& e) {
+            if (EWOMS_GET_PARAM(TypeTag, int, LinearSolverVerbosity) > 0)
+                std::cout << "Block LU: factorization failed: " << e.what() << "\n"
+                          << std::flush;
+            return false;
+        }
+
+        lu_.solve(x, *b_);
+
+        // make sure that the result only contains finite values.
+        Scalar tmp = 0;
+        for (unsigned i = 0; i < x.size(); ++i) {
+            const auto& xi = x[i];
+            for (unsigned j = 0; j < Vector::block_type::dimension; ++j)
+                tmp += xi[j];
+        }
+        return std::isfinite(tmp);
+    }
+
+    /*!
+     * \brief Returns the number of iterations used by the linear solver for the most
+     *        recent call to solve().
+     *
+     * This is a direct solver, so this is always one.
+     */
+    unsigned iterations() const
+    { return 1; }
+
+private:
+    const Simulator& simulator_;
+    int gridSequenceNumber_;
+
+    const Matrix* M_;
+    Vector* b_;
+
+    LUDecomposition lu_;
+};
+
+} // namespace Linear
+} // namespace Ewoms
+
+namespace Ewoms {
+namespace Properties {
+SET_INT_PROP(BlockLULinearSolver, LinearSolverVerbosity, 0);
+SET_TYPE_PROP(BlockLULinearSolver, LinearSolverBackend,
+              Ewoms::Linear::BlockLUBackend<TypeTag>);
+} // namespace Properties
+} // namespace Ewoms
+
+#endif
@@ -0,0 +1,358 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::Linear::BlockSparseLU
+ */
+#ifndef EWOMS_BLOCK_SPARSE_LU_HH
+#define EWOMS_BLOCK_SPARSE_LU_HH
+
+#include "dofreordering.hh"
+
+#include <opm/common/ErrorMacros.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <vector>
+
+namespace Ewoms {
+namespace Linear {
+
+/*!
+ * \ingroup Linear
+ *
+ * \brief A sparse direct solver for block matrices which separates the symbolic and
+ *        the numeric factorization.
+ *
+ * The symbolic phase (analyze()) computes a fill reducing nested dissection ordering
+ * of the rows, the elimination tree and the sparsity pattern of the complete LU
+ * factors. As long as the sparsity pattern of the matrix stays the same, it only needs
+ * to be done once and every subsequent factorize() only performs the numeric
+ * factorization.
+ *
+ * All operations work on the dense blocks of the matrix, i.e., pivoting is done only
+ * within the diagonal blocks (by inverting them). This is sufficient for the
+ * block-diagonally dominant Jacobians of the finite volume discretizations but it is
+ * not a general purpose replacement for a direct solver which does full pivoting. The
+ * symbolic factorization uses the symmetrized sparsity pattern of the matrix, i.e., the
+ * entries of structurally unsymmetric matrices are treated as explicit zeros in the
+ * transposed positions.
+ */
+template <class Matrix, class Vector>
+class BlockSparseLU
+{
+    typedef typename Matrix::block_type MatrixBlock;
+    typedef typename Vector::block_type VectorBlock;
+
+    enum { numEq = MatrixBlock::rows };
+
+public:
+    BlockSparseLU()
+        : numRows_(0)
+    {}
+
+    /*!
+     * \brief Returns true if the symbolic factorization is available.
+     */
+    bool isAnalyzed() const
+    { return !rowStart_.empty(); }
+
+    /*!
+     * \brief Returns true iff the symbolic factorization can be used for a given matrix.
+     *
+     * This compares the complete sparsity pattern of the matrix with the one which was
+     * passed to analyze(), so it is linear in the number of non-zero blocks.
+     */
+    bool matchesPattern(const Matrix& A) const
+    {
+        if (!isAnalyzed() || A.N() != numRows_ || A.nonzeroes() != patternColIdx_.size())
+            return false;
+
+        for (size_t rowIdx = 0; rowIdx < numRows_; ++rowIdx) {
+            const auto& row = A[rowIdx];
+            size_t pos = patternRowStart_[rowIdx];
+            const size_t endPos = patternRowStart_[rowIdx + 1];
+            for (auto colIt = row.begin(); colIt != row.end(); ++colIt, ++pos)
+                if (pos >= endPos || patternColIdx_[pos] != colIt.index())
+                    return false;
+            if (pos != endPos)
+                return false;
+        }
+
+        return true;
+    }
+
+    /*!
+     * \brief Returns the number of non-zero blocks of the LU factors.
+     */
+    size_t factorNonzeroes() const
+    { return colIdx_.size(); }
+
+    /*!
+     * \brief Compute the fill reducing ordering and the symbolic factorization.
+     */
+    void analyze(const Matrix& A)
+    {
+        numRows_ = A.N();
+        const size_t n = numRows_;
+
+        perm_ = nestedDissectionOrdering(A);
+        std::vector<unsigned> invPerm(n);
+        for (size_t newIdx = 0; newIdx < n; ++newIdx)
+            invPerm[static_cast<unsigned>(perm_[newIdx])] = static_cast<unsigned>(newIdx);
+
+        // the permuted sparsity pattern of the strictly lower triangle
+        std::vector<std::vector<unsigned> > lowerPattern(n);
+        for (size_t rowIdx = 0; rowIdx < n; ++rowIdx) {
+            unsigned newRowIdx = invPerm[rowIdx];
+            const auto& row = A[rowIdx];
+            for (auto colIt = row.begin(); colIt != row.end(); ++colIt) {
+                unsigned newColIdx = invPerm[colIt.index()];
+                if (newColIdx < newRowIdx)
+                    lowerPattern[newRowIdx].push_back(newColIdx);
+                else if (newColIdx > newRowIdx)
+                    lowerPattern[newColIdx].push_back(newRowIdx);
+            }
+        }
+
+        // compute the elimination tree (Liu's algorithm with path compression)
+        const unsigned noParent = static_cast<unsigned>(n);
+        std::vector<unsigned> parent(n, noParent);
+        std::vector<unsigned> ancestor(n, noParent);
+        for (unsigned i = 0; i < n; ++i) {
+            for (unsigned j : lowerPattern[i]) {
+                unsigned r = j;
+                while (ancestor[r] != noParent && ancestor[r] != i) {
+                    unsigned next = ancestor[r];
+                    ancestor[r] = i;
+                    r = next;
+                }
+                if (ancestor[r] == noParent) {
+                    ancestor[r] = i;
+                    parent[r] = i;
+                }
+            }
+        }
+
+        // the pattern of the i-th row of L is given by the union of the paths from
+        // the non-zero entries of the lower triangle of the row to the row itself in
+        // the elimination tree. since the pattern is symmetric, the one of U is its
+        // transpose.
+        std::vector<std::vector<unsigned> > factorLower(n);
+        std::vector<std::vector<unsigned> > factorUpper(n);
+        std::vector<unsigned> mark(n, noParent);
+        for (unsigned i = 0; i < n; ++i) {
+            mark[i] = i;
+            for (unsigned j : lowerPattern[i]) {
+                for (unsigned k = j; mark[k] != i; k = parent[k]) {
+                    factorLower[i].push_back(k);
+                    mark[k] = i;
+                }
+            }
+            std::sort(factorLower[i].begin(), factorLower[i].end());
+            for (unsigned k : factorLower[i])
+                factorUpper[k].push_back(i);
+        }
+        std::vector<std::vector<unsigned> >().swap(lowerPattern);
+
+        // assemble the compressed row storage of the factors
+        rowStart_.resize(n + 1);
+        diagPos_.resize(n);
+        rowStart_[0] = 0;
+        for (unsigned i = 0; i < n; ++i)
+            rowStart_[i + 1] = rowStart_[i] + factorLower[i].size() + 1 + factorUpper[i].size();
+
+        colIdx_.resize(rowStart_[n]);
+        for (unsigned i = 0; i < n; ++i) {
+            size_t pos = rowStart_[i];
+            for (unsigned j : factorLower[i])
+                colIdx_[pos++] = j;
+            diagPos_[i] = pos;
+            colIdx_[pos++] = i;
+            for (unsigned j : factorUpper[i])
+                colIdx_[pos++] = j;
+            std::vector<unsigned>().swap(factorLower[i]);
+            std::vector<unsigned>().swap(factorUpper[i]);
+        }
+
+        // map the entries of the original matrix to the ones of the factors and keep
+        // the sparsity pattern of the matrix for matchesPattern()
+        entryPos_.clear();
+        entryPos_.reserve(A.nonzeroes());
+        patternRowStart_.resize(n + 1);
+        patternColIdx_.clear();
+        patternColIdx_.reserve(A.nonzeroes());
+        for (size_t rowIdx = 0; rowIdx < n; ++rowIdx) {
+            patternRowStart_[rowIdx] = patternColIdx_.size();
+            unsigned newRowIdx = invPerm[rowIdx];
+            const auto& row = A[rowIdx];
+            for (auto colIt = row.begin(); colIt != row.end(); ++colIt) {
+                unsigned newColIdx = invPerm[colIt.index()];
+                entryPos_.push_back(findEntry_(newRowIdx, newColIdx));
+                patternColIdx_.push_back(static_cast<unsigned>(colIt.index()));
+            }
+        }
+        patternRowStart_[n] = patternColIdx_.size();
+
+        values_.resize(colIdx_.size());
+        diagInv_.resize(n);
+        colPos_.assign(n, noEntry_());
+        tmp_.resize(n);
+    }
+
+    /*!
+     * \brief Compute the numeric LU factorization of a matrix.
+     *
+     * The matrix must exhibit the same sparsity pattern as the one passed to
+     * analyze(), see matchesPattern(). If a diagonal block of U is singular, an
+     * exception is thrown.
+     */
+    void factorize(const Matrix& A)
+    {
+        // checking the complete pattern is left to the caller, but a matrix of the
+        // wrong size would lead to out-of-bounds accesses
+        if (!isAnalyzed() || A.N() != numRows_ || A.nonzeroes() != entryPos_.size())
+            OPM_THROW(std::logic_error,
+                      "The matrix does not exhibit the sparsity pattern of the symbolic "
+                      "factorization");
+        assert(matchesPattern(A));
+
+        // scatter the entries of the matrix into the storage of the factors
+        std::fill(values_.begin(), values_.end(), MatrixBlock(0.0));
+        size_t entryIdx = 0;
+        for (size_t rowIdx = 0; rowIdx < numRows_; ++rowIdx) {
+            const auto& row = A[rowIdx];
+            for (auto colIt = row.begin(); colIt != row.end(); ++colIt, ++entryIdx)
+                values_[entryPos_[entryIdx]] = *colIt;
+        }
+
+        // up-looking block LU factorization. since the sparsity pattern contains all
+        // fill-in, this is exact.
+        for (size_t i = 0; i < numRows_; ++i) {
+            for (size_t p = rowStart_[i]; p < rowStart_[i + 1]; ++p)
+                colPos_[colIdx_[p]] = p;
+
+            for (size_t p = rowStart_[i]; p < diagPos_[i]; ++p) {
+                unsigned k = colIdx_[p];
+
+                // L_ik = A_ik * U_kk^-1
+                MatrixBlock& lik = values_[p];
+                lik.rightmultiply(diagInv_[k]);
+
+                // A_ij -= L_ik * U_kj for all j > k
+                for (size_t q = diagPos_[k] + 1; q < rowStart_[k + 1]; ++q) {
+                    size_t ijPos = colPos_[colIdx_[q]];
+                    if (ijPos == noEntry_())
+                        OPM_THROW(std::logic_error,
+                                  "The symbolic factorization does not contain the fill-in "
+                                  "of row " << i);
+                    subtractProduct_(values_[ijPos], lik, values_[q]);
+                }
+            }
+
+            diagInv_[i] = values_[diagPos_[i]];
+            diagInv_[i].invert();
+
+            for (size_t p = rowStart_[i]; p < rowStart_[i + 1]; ++p)
+                colPos_[colIdx_[p]] = noEntry_();
+        }
+    }
+
+    /*!
+     * \brief Solve the linear system of equations using the most recent factorization.
+     */
+    void solve(Vector& x, const Vector& b)
+    {
+        const size_t n = numRows_;
+        x.resize(n);
+
+        // forward substitution with the unit lower triangular factor
+        for (size_t i = 0; i < n; ++i) {
+            VectorBlock& yi = tmp_[i];
+            yi = b[static_cast<unsigned>(perm_[i])];
+            for (size_t p = rowStart_[i]; p < diagPos_[i]; ++p)
+                values_[p].mmv(tmp_[colIdx_[p]], yi);
+        }
+
+        // backward substitution with the upper triangular factor
+        for (size_t i = n; i-- > 0; ) {
+            VectorBlock rhs = tmp_[i];
+            for (size_t p = diagPos_[i] + 1; p < rowStart_[i + 1]; ++p)
+                values_[p].mmv(tmp_[colIdx_[p]], rhs);
+            diagInv_[i].mv(rhs, tmp_[i]);
+        }
+
+        for (size_t i = 0; i < n; ++i)
+            x[static_cast<unsigned>(perm_[i])] = tmp_[i];
+    }
+
+private:
+    static size_t noEntry_()
+    { return static_cast<size_t>(-1); }
+
+    size_t findEntry_(unsigned rowIdx, unsigned colIdx) const
+    {
+        auto beginIt = colIdx_.begin() + static_cast<std::ptrdiff_t>(rowStart_[rowIdx]);
+        auto endIt = colIdx_.begin() + static_cast<std::ptrdiff_t>(rowStart_[rowIdx + 1]);
+        auto it = std::lower_bound(beginIt, endIt, colIdx);
+        if (it == endIt || *it != colIdx)
+            OPM_THROW(std::logic_error,
+                      "Entry (" << rowIdx << ", " << colIdx << ") is not contained in the "
+                      "symbolic factorization");
+        return static_cast<size_t>(it - colIdx_.begin());
+    }
+
+    // dest -= a*b
+    static void subtractProduct_(MatrixBlock& dest, const MatrixBlock& a, const MatrixBlock& b)
+    {
+        for (int i = 0; i < numEq; ++i)
+            for (int k = 0; k < numEq; ++k) {
+                const auto aik = a[i][k];
+                for (int j = 0; j < numEq; ++j)
+                    dest[i][j] -= aik*b[k][j];
+            }
+    }
+
+    size_t numRows_;
+    std::vector<Index> perm_;
+
+    std::vector<size_t> rowStart_;
+    std::vector<size_t> diagPos_;
+    std::vector<unsigned> colIdx_;
+    std::vector<size_t> entryPos_;
+
+    std::vector<size_t> patternRowStart_;
+    std::vector<unsigned> patternColIdx_;
+
+    std::vector<MatrixBlock> values_;
+    std::vector<MatrixBlock> diagInv_;
+
+    std::vector<size_t> colPos_;
+    std::vector<VectorBlock> tmp_;
+};
+
+} // namespace Linear
+} // namespace Ewoms
+
+#endif
@@ -157,6 +157,15 @@ public:
     Scalar accuracy() const override
     { return residualError_/initialResidualError_; }
 
+    /*!
+     * \copydoc ConvergenceCriterion::requiredAccuracy()
+     */
+    Scalar requiredAccuracy() const override
+    {
+        return std::max<Scalar>(residualReductionTolerance_,
+                                absResidualTolerance_/initialResidualError_);
+    }
+
     /*!
      * \copydoc ConvergenceCriterion::printInitial()
      */
@@ -124,6 +124,16 @@ public:
      */
     virtual Scalar accuracy() const = 0;
 
+    /*!
+     * \brief Returns the accuracy below which the convergence criterion is met.
+     *
+     * Linear solvers which can cheaply estimate the norm of the residual (e.g., GMRES)
+     * use this to avoid evaluating the criterion for solutions which are unlikely to
+     * be converged. A value of zero means that the required accuracy is unknown.
+     */
+    virtual Scalar requiredAccuracy() const
+    { return 0.0; }
+
     /*!
      * \brief Prints the initial information about the convergence behaviour.
      *
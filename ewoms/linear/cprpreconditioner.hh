@@ -0,0 +1,156 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::Linear::CprPreconditioner
+ */
+#ifndef EWOMS_CPR_PRECONDITIONER_HH
+#define EWOMS_CPR_PRECONDITIONER_HH
+
+#include <dune/istl/preconditioner.hh>
+#include <dune/common/version.hh>
+
+#include <memory>
+
+namespace Ewoms {
+namespace Linear {
+
+/*!
+ * \brief A two-stage constrained pressure residual (CPR) preconditioner for block
+ *        matrices on overlapping domains.
+ *
+ * The first stage reduces the residual to a scalar pressure system using a
+ * PressureReduction object, approximately solves it using a preconditioner for the
+ * pressure matrix (typically a single AMG V-cycle) and prolongates the result to the
+ * pressure entries of the full correction. The second stage applies a smoother (e.g.,
+ * ILU0) to the residual which remains after the pressure correction. The corrections
+ * of both stages are added up.
+ *
+ * The pressure reduction needs to be up to date before the preconditioner is applied,
+ * i.e., its update() method must have been called for the matrix which is passed to
+ * the constructor. All vectors which are passed to the preconditioner are assumed to
+ * be consistent on the overlap.
+ */
+template <class OverlappingMatrix,
+          class OverlappingVector,
+          class PressureReduction,
+          class PressurePreconditioner,
+          class Smoother>
+class CprPreconditioner
+    : public Dune::Preconditioner<OverlappingVector, OverlappingVector>
+{
+    typedef typename PressureReduction::PressureVector PressureVector;
+
+public:
+    typedef OverlappingVector domain_type;
+    typedef OverlappingVector range_type;
+    typedef typename OverlappingVector::field_type field_type;
+
+#if DUNE_VERSION_NEWER(DUNE_ISTL, 2,6)
+    //! the kind of computations supported by the operator. Either overlapping or non-overlapping
+    Dune::SolverCategory::Category category() const override
+    { return Dune::SolverCategory::overlapping; }
+#else
+    // redefine the category
+    enum { category = Dune::SolverCategory::overlapping };
+#endif
+
+    CprPreconditioner(const OverlappingMatrix& A,
+                      const PressureReduction& pressureReduction,
+                      PressurePreconditioner& pressurePrecond,
+                      Smoother& smoother)
+        : A_(A)
+        , pressureReduction_(pressureReduction)
+        , pressurePrecond_(pressurePrecond)
+        , smoother_(smoother)
+    { }
+
+    void pre(domain_type& x, range_type& y) override
+    {
+        // allocate the temporary vectors only once per linear solve
+        residual_.reset(new OverlappingVector(y));
+        update_.reset(new OverlappingVector(x));
+
+        pressureResidual_.resize(A_.N());
+        pressureUpdate_.resize(A_.N());
+        pressureResidual_ = 0.0;
+        pressureUpdate_ = 0.0;
+        pressurePrecond_.pre(pressureUpdate_, pressureResidual_);
+
+        smoother_.pre(x, y);
+        x.sync();
+        y.sync();
+    }
+
+    void apply(domain_type& x, const range_type& d) override
+    {
+        // first stage: approximately solve the pressure system and prolongate the
+        // resulting correction
+        pressureReduction_.restrict(d, pressureResidual_);
+        pressureUpdate_ = 0.0;
+        pressurePrecond_.apply(pressureUpdate_, pressureResidual_);
+
+        x = 0.0;
+        pressureReduction_.prolongate(pressureUpdate_, x);
+        x.sync();
+
+        // second stage: smooth the residual which is left after the pressure
+        // correction, i.e., r = d - A x
+        auto& r = *residual_;
+        r = d;
+        A_.mmv(x, r);
+        r.sync();
+
+        auto& dx = *update_;
+        dx = 0.0;
+        smoother_.apply(dx, r);
+
+        x += dx;
+        x.sync();
+    }
+
+    void post(domain_type& x) override
+    {
+        pressurePrecond_.post(pressureUpdate_);
+        smoother_.post(x);
+
+        residual_.reset();
+        update_.reset();
+    }
+
+private:
+    const OverlappingMatrix& A_;
+    const PressureReduction& pressureReduction_;
+    PressurePreconditioner& pressurePrecond_;
+    Smoother& smoother_;
+
+    std::unique_ptr<OverlappingVector> residual_;
+    std::unique_ptr<OverlappingVector> update_;
+    PressureVector pressureResidual_;
+    PressureVector pressureUpdate_;
+};
+
+} // namespace Linear
+} // namespace Ewoms
+
+#endif
@@ -0,0 +1,407 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \brief Provides algorithms which compute bandwidth reducing orderings of the
+ *        degrees of freedom of a linear system.
+ */
+#ifndef EWOMS_DOF_REORDERING_HH
+#define EWOMS_DOF_REORDERING_HH
+
+#include "overlaptypes.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace Ewoms {
+namespace Linear {
+
+/*!
+ * \brief Computes the reverse Cuthill-McKee (RCM) ordering of the rows of a sparse
+ *        matrix.
+ *
+ * The sparsity pattern of the matrix is interpreted as an undirected graph, i.e., it
+ * is assumed to be structurally symmetric which is the case for all Jacobian matrices
+ * produced by the finite volume discretizations. Each connected component is started
+ * at a pseudo-peripheral row which is determined using the heuristic of George and
+ * Liu.
+ *
+ * \return A vector which contains the index of the original row for each position
+ *         of the new ordering.
+ */
+template <class BCRSMatrix>
+std::vector<Index> reverseCuthillMcKeeOrdering(const BCRSMatrix& A)
+{
+    const size_t n = A.N();
+
+    std::vector<unsigned> degree(n);
+    for (size_t rowIdx = 0; rowIdx < n; ++rowIdx)
+        degree[rowIdx] = static_cast<unsigned>(A[rowIdx].size());
+
+    // the breadth-first search used by the pseudo-peripheral node search. this returns
+    // the index of the last level's row with the lowest degree and the number of
+    // levels
+    std::vector<int> levelOf(n, -1);
+    std::vector<unsigned> queue;
+    queue.reserve(n);
+    auto bfs = [&](unsigned root, unsigned& numLevels) -> unsigned {
+        queue.clear();
+        queue.push_back(root);
+        levelOf[root] = 0;
+        for (size_t i = 0; i < queue.size(); ++i) {
+            unsigned rowIdx = queue[i];
+            const auto& row = A[rowIdx];
+            for (auto colIt = row.begin(); colIt != row.end(); ++colIt) {
+                unsigned colIdx = static_cast<unsigned>(colIt.index());
+                if (levelOf[colIdx] < 0) {
+                    levelOf[colIdx] = levelOf[rowIdx] + 1;
+                    queue.push_back(colIdx);
+                }
+            }
+        }
+
+        int lastLevel = levelOf[queue.back()];
+        numLevels = static_cast<unsigned>(lastLevel + 1);
+        unsigned bestIdx = queue.back();
+        for (unsigned rowIdx : queue) {
+            if (levelOf[rowIdx] == lastLevel && degree[rowIdx] < degree[bestIdx])
+                bestIdx = rowIdx;
+            levelOf[rowIdx] = -1;
+        }
+        return bestIdx;
+    };
+
+    std::vector<Index> ordering;
+    ordering.reserve(n);
+    std::vector<bool> visited(n, false);
+    std::vector<unsigned> neighbors;
+    for (size_t seedIdx = 0; seedIdx < n; ++seedIdx) {
+        if (visited[seedIdx])
+            continue;
+
+        // find a pseudo-peripheral row of the connected component of the seed
+        unsigned root = static_cast<unsigned>(seedIdx);
+        unsigned numLevels = 0;
+        unsigned candidate = bfs(root, numLevels);
+        for (int i = 0; i < 8; ++i) {
+            unsigned candidateNumLevels = 0;
+            unsigned nextCandidate = bfs(candidate, candidateNumLevels);
+            if (candidateNumLevels <= numLevels)
+                break;
+            root = candidate;
+            numLevels = candidateNumLevels;
+            candidate = nextCandidate;
+        }
+
+        // Cuthill-McKee: breadth-first search which visits the neighbors of a row in
+        // the order of increasing degree
+        size_t componentBegin = ordering.size();
+        ordering.push_back(static_cast<Index>(root));
+        visited[root] = true;
+        for (size_t i = componentBegin; i < ordering.size(); ++i) {
+            const auto& row = A[static_cast<unsigned>(ordering[i])];
+            neighbors.clear();
+            for (auto colIt = row.begin(); colIt != row.end(); ++colIt) {
+                unsigned colIdx = static_cast<unsigned>(colIt.index());
+                if (!visited[colIdx]) {
+                    visited[colIdx] = true;
+                    neighbors.push_back(colIdx);
+                }
+            }
+
+            std::stable_sort(neighbors.begin(), neighbors.end(),
+                             [&degree](unsigned a, unsigned b)
+                             { return degree[a] < degree[b]; });
+            for (unsigned colIdx : neighbors)
+                ordering.push_back(static_cast<Index>(colIdx));
+        }
+    }
+
+    // reversing the Cuthill-McKee ordering does not change the bandwidth, but it
+    // usually reduces the fill-in of the factorization considerably
+    std::reverse(ordering.begin(), ordering.end());
+    return ordering;
+}
+
+// recursively orders a connected or disconnected subset of the rows of a matrix using
+// nested dissection. the members of the subset are marked with 'label' in 'marker'.
+template <class BCRSMatrix>
+void nestedDissection_(const BCRSMatrix& A,
+                       std::vector<unsigned>& nodes,
+                       std::vector<unsigned>& marker,
+                       std::vector<int>& levelOf,
+                       unsigned& nextLabel,
+                       unsigned leafSize,
+                       std::vector<Index>& ordering)
+{
+    if (nodes.size() <= leafSize) {
+        for (unsigned rowIdx : nodes)
+            ordering.push_back(static_cast<Index>(rowIdx));
+        return;
+    }
+
+    unsigned label = nextLabel++;
+    for (unsigned rowIdx : nodes)
+        marker[rowIdx] = label;
+
+    // breadth-first search restricted to the current subset. the level of all
+    // visited rows is stored in 'levelOf', the visited rows in 'queue'
+    std::vector<unsigned> queue;
+    queue.reserve(nodes.size());
+    auto bfs = [&](unsigned root) {
+        queue.clear();
+        queue.push_back(root);
+        levelOf[root] = 0;
+        for (size_t i = 0; i < queue.size(); ++i) {
+            unsigned rowIdx = queue[i];
+            const auto& row = A[rowIdx];
+            for (auto colIt = row.begin(); colIt != row.end(); ++colIt) {
+                unsigned colIdx = static_cast<unsigned>(colIt.index());
+                if (marker[colIdx] == label && levelOf[colIdx] < 0) {
+                    levelOf[colIdx] = levelOf[rowIdx] + 1;
+                    queue.push_back(colIdx);
+                }
+            }
+        }
+    };
+    auto resetLevels = [&]() {
+        for (unsigned rowIdx : queue)
+            levelOf[rowIdx] = -1;
+    };
+
+    bfs(nodes[0]);
+    if (queue.size() < nodes.size()) {
+        // the subset is not connected: dissect each of its components separately
+        std::vector<std::vector<unsigned> > components;
+        components.emplace_back(queue);
+        for (unsigned rowIdx : nodes) {
+            if (levelOf[rowIdx] >= 0)
+                continue;
+            bfs(rowIdx);
+            components.emplace_back(queue);
+        }
+        for (unsigned rowIdx : nodes)
+            levelOf[rowIdx] = -1;
+
+        for (auto& component : components)
+            nestedDissection_(A, component, marker, levelOf, nextLabel, leafSize, ordering);
+        return;
+    }
+
+    // find a pseudo-peripheral row of the subset
+    unsigned root = nodes[0];
+    int numLevels = levelOf[queue.back()] + 1;
+    for (int i = 0; i < 8; ++i) {
+        unsigned candidate = queue.back();
+        resetLevels();
+        bfs(candidate);
+        int candidateNumLevels = levelOf[queue.back()] + 1;
+        if (candidateNumLevels <= numLevels) {
+            resetLevels();
+            bfs(root);
+            break;
+        }
+        root = candidate;
+        numLevels = candidateNumLevels;
+    }
+
+    if (numLevels < 3) {
+        // the subset is too densely connected to be split
+        resetLevels();
+        for (unsigned rowIdx : nodes)
+            ordering.push_back(static_cast<Index>(rowIdx));
+        return;
+    }
+
+    // use the middle level of the level structure as the separator
+    int separatorLevel = numLevels/2;
+    std::vector<unsigned> firstPart, secondPart, separator;
+    for (unsigned rowIdx : queue) {
+        if (levelOf[rowIdx] < separatorLevel)
+            firstPart.push_back(rowIdx);
+        else if (levelOf[rowIdx] > separatorLevel)
+            secondPart.push_back(rowIdx);
+        else
+            separator.push_back(rowIdx);
+    }
+    resetLevels();
+    std::vector<unsigned>().swap(queue);
+
+    nestedDissection_(A, firstPart, marker, levelOf, nextLabel, leafSize, ordering);
+    nestedDissection_(A, secondPart, marker, levelOf, nextLabel, leafSize, ordering);
+    for (unsigned rowIdx : separator)
+        ordering.push_back(static_cast<Index>(rowIdx));
+}
+
+/*!
+ * \brief Computes a fill reducing ordering of the rows of a sparse matrix using nested
+ *        dissection.
+ *
+ * The graph of the sparsity pattern is recursively split into two parts by the middle
+ * level of the level structure rooted at a pseudo-peripheral row, and the rows of the
+ * separator are numbered after the ones of both parts. Like for
+ * reverseCuthillMcKeeOrdering(), the matrix is assumed to be structurally symmetric.
+ *
+ * \param A The matrix for which the ordering ought to be computed
+ * \param leafSize The maximum number of rows which are not dissected further
+ *
+ * \return A vector which contains the index of the original row for each position
+ *         of the new ordering.
+ */
+template <class BCRSMatrix>
+std::vector<Index> nestedDissectionOrdering(const BCRSMatrix& A, unsigned leafSize = 32)
+{
+    const size_t n = A.N();
+
+    std::vector<unsigned> nodes(n);
+    for (size_t rowIdx = 0; rowIdx < n; ++rowIdx)
+        nodes[rowIdx] = static_cast<unsigned>(rowIdx);
+
+    std::vector<unsigned> marker(n, 0);
+    std::vector<int> levelOf(n, -1);
+    unsigned nextLabel = 1;
+
+    std::vector<Index> ordering;
+    ordering.reserve(n);
+    nestedDissection_(A, nodes, marker, levelOf, nextLabel, leafSize, ordering);
+    assert(ordering.size() == n);
+    return ordering;
+}
+
+/*!
+ * \brief Computes an ordering of a set of points which follows the Morton (Z-order)
+ *        space filling curve.
+ *
+ * The positions are quantized within their bounding box, the bits of the coordinates
+ * are then interleaved and the points are sorted by the resulting key.
+ *
+ * \return A vector which contains the index of the original point for each
+ *         position of the new ordering.
+ */
+template <class GlobalPosition>
+std::vector<Index> mortonOrdering(const std::vector<GlobalPosition>& positions)
+{
+    typedef typename GlobalPosition::value_type Scalar;
+    static const int dim = GlobalPosition::dimension;
+    static const int bitsPerDim = 63/dim;
+    const uint64_t maxCoord = (uint64_t(1) << bitsPerDim) - 1;
+
+    const size_t n = positions.size();
+    std::vector<Index> ordering(n);
+    if (n == 0)
+        return ordering;
+
+    GlobalPosition minPos(positions[0]);
+    GlobalPosition maxPos(positions[0]);
+    for (const auto& pos : positions) {
+        for (int k = 0; k < dim; ++k) {
+            minPos[k] = std::min(minPos[k], pos[k]);
+            maxPos[k] = std::max(maxPos[k], pos[k]);
+        }
+    }
+
+    std::vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t coord[dim];
+        for (int k = 0; k < dim; ++k) {
+            Scalar extent = maxPos[k] - minPos[k];
+            Scalar relPos = (extent > 0.0) ? (positions[i][k] - minPos[k])/extent : 0.0;
+            coord[k] = std::min(maxCoord, static_cast<uint64_t>(relPos*static_cast<Scalar>(maxCoord)));
+        }
+
+        uint64_t key = 0;
+        for (int bitIdx = bitsPerDim - 1; bitIdx >= 0; --bitIdx)
+            for (int k = 0; k < dim; ++k)
+                key = (key << 1) | ((coord[k] >> bitIdx) & 1);
+        keys[i] = key;
+        ordering[i] = static_cast<Index>(i);
+    }
+
+    std::stable_sort(ordering.begin(), ordering.end(),
+                     [&keys](Index a, Index b)
+                     { return keys[static_cast<unsigned>(a)] < keys[static_cast<unsigned>(b)]; });
+    return ordering;
+}
+
+/*!
+ * \brief Returns the bandwidth of a sparse matrix.
+ *
+ * i.e., the maximum distance between the index of a row and the column index of any
+ * of its non-zero entries.
+ */
+template <class BCRSMatrix>
+size_t matrixBandwidth(const BCRSMatrix& A)
+{
+    size_t bandwidth = 0;
+    for (size_t rowIdx = 0; rowIdx < A.N(); ++rowIdx) {
+        const auto& row = A[rowIdx];
+        for (auto colIt = row.begin(); colIt != row.end(); ++colIt) {
+            size_t colIdx = colIt.index();
+            bandwidth = std::max(bandwidth, (colIdx > rowIdx)?(colIdx - rowIdx):(rowIdx - colIdx));
+        }
+    }
+    return bandwidth;
+}
+
+/*!
+ * \brief Creates a copy of a sparse matrix whose rows and columns are symmetrically
+ *        permuted.
+ *
+ * \param A The matrix which ought to be permuted
+ * \param ordering The index of the original row for each row of the result, i.e., the
+ *                 format returned by the ordering algorithms of this file
+ * \param B The permuted matrix
+ */
+template <class BCRSMatrix>
+void permuteMatrix(const BCRSMatrix& A, const std::vector<Index>& ordering, BCRSMatrix& B)
+{
+    const size_t n = A.N();
+    assert(ordering.size() == n);
+
+    std::vector<size_t> newIdx(n);
+    for (size_t rowIdx = 0; rowIdx < n; ++rowIdx)
+        newIdx[static_cast<size_t>(ordering[rowIdx])] = rowIdx;
+
+    B.setSize(n, n, A.nonzeroes());
+    B.setBuildMode(BCRSMatrix::row_wise);
+    for (auto rowIt = B.createbegin(); rowIt != B.createend(); ++rowIt) {
+        const auto& row = A[static_cast<size_t>(ordering[rowIt.index()])];
+        for (auto colIt = row.begin(); colIt != row.end(); ++colIt)
+            rowIt.insert(newIdx[colIt.index()]);
+    }
+
+    for (size_t rowIdx = 0; rowIdx < n; ++rowIdx) {
+        const auto& row = A[static_cast<size_t>(ordering[rowIdx])];
+        auto& newRow = B[rowIdx];
+        for (auto colIt = row.begin(); colIt != row.end(); ++colIt)
+            newRow[newIdx[colIt.index()]] = *colIt;
+    }
+}
+
+} // namespace Linear
+} // namespace Ewoms
+
+#endif
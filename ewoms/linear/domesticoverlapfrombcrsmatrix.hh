@@ -34,6 +34,7 @@
 #include <ewoms/parallel/mpibuffer.hh>
 
 #include <algorithm>
+#include <cassert>
 #include <limits>
 #include <set>
 #include <map>
@@ -61,13 +62,22 @@ public:
     /*!
      * \brief Constructs the foreign overlap given a BCRS matrix and
      *        an initial list of border indices.
+     *
+     * If a non-empty ordering of the native indices is specified, the domestic
+     * indices of the local rows are numbered accordingly. The entry at position i of
+     * this vector is the native index which becomes the i-th local index.
+     *
+     * All communication uses the specified communicator, i.e., the ranks of the
+     * peer processes refer to this communicator.
      */
     template <class BCRSMatrix>
     DomesticOverlapFromBCRSMatrix(const BCRSMatrix& A,
                                   const BorderList& borderList,
                                   const BlackList& blackList,
-                                  unsigned overlapSize)
-        : foreignOverlap_(A, borderList, blackList, overlapSize)
+                                  unsigned overlapSize,
+                                  const std::vector<Index>& nativeOrdering = std::vector<Index>(),
+                                  Communicator comm = Dune::MPIHelper::getCommunicator())
+        : foreignOverlap_(A, borderList, blackList, overlapSize, comm)
         , blackList_(blackList)
         , globalIndices_(foreignOverlap_)
     {
@@ -76,12 +86,13 @@ public:
 
 #if HAVE_MPI
         int tmp;
-        MPI_Comm_rank(MPI_COMM_WORLD, &tmp);
+        MPI_Comm_rank(comm, &tmp);
         myRank_ = static_cast<ProcessRank>(tmp);
-        MPI_Comm_size(MPI_COMM_WORLD, &tmp);
+        MPI_Comm_size(comm, &tmp);
         worldSize_ = static_cast<unsigned>(tmp);
 #endif // HAVE_MPI
 
+        setupOrdering_(nativeOrdering);
         buildDomesticOverlap_();
         updateMasterRanks_();
         blackList_.updateNativeToDomesticMap(*this);
@@ -108,13 +119,13 @@ public:
             auto& buffer = *(new MpiBuffer<unsigned>(1));
             sizeBufferMap[*peerIt] = &buffer;
             buffer[0] = foreignOverlap_.foreignOverlapWithPeer(*peerIt).size();
-            buffer.send(*peerIt);
+            buffer.send(*peerIt, communicator());
         }
 
         peerIt = peerSet_.begin();
         for (; peerIt != peerEndIt; ++peerIt) {
             MpiBuffer<unsigned> rcvBuffer(1);
-            rcvBuffer.receive(*peerIt);
+            rcvBuffer.receive(*peerIt, communicator());
 
             assert(rcvBuffer[0] == domesticOverlapWithPeer_.find(*peerIt)->second.size());
         }
@@ -133,11 +144,17 @@ public:
     { return myRank_; }
 
     /*!
-     * \brief Returns the number of processes in the global MPI communicator.
+     * \brief Returns the number of processes in the communicator of the overlap.
      */
     unsigned worldSize() const
     { return worldSize_; }
 
+    /*!
+     * \brief Returns the communicator used by the overlap.
+     */
+    Communicator communicator() const
+    { return foreignOverlap_.communicator(); }
+
     /*!
      * \brief Return the set of process ranks which share an overlap
      *        with the current process.
@@ -384,29 +401,70 @@ protected:
         domesticOverlapByIndex_.resize(numLocal());
         borderDistance_.resize(numLocal(), 0);
 
-        PeerSet::const_iterator peerIt;
-        PeerSet::const_iterator peerEndIt = peerSet_.end();
-
-        // send the overlap indices to all peer processes
-        peerIt = peerSet_.begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
-            sendIndicesToPeer_(peerRank);
+#if HAVE_MPI
+        std::vector<ProcessRank> peers(peerSet_.begin(), peerSet_.end());
+        size_t numPeers = peers.size();
+
+        // assemble the foreign overlap of each peer using global
+        // indices
+        std::vector<std::vector<IndexDistanceNpeers> > sendBufs(numPeers);
+        std::vector<unsigned> sendSizes(numPeers);
+        for (size_t i = 0; i < numPeers; ++i) {
+            const auto& foreignOverlap = foreignOverlap_.foreignOverlapWithPeer(peers[i]);
+            auto& sendBuf = sendBufs[i];
+            sendBuf.resize(foreignOverlap.size());
+            for (size_t j = 0; j < foreignOverlap.size(); ++j) {
+                Index localIdx = foreignOverlap[j].index;
+
+                IndexDistanceNpeers& tmp = sendBuf[j];
+                tmp.index = globalIndices_.domesticToGlobal(localIdx);
+                tmp.borderDistance = foreignOverlap[j].borderDistance;
+                tmp.numPeers =
+                    static_cast<unsigned>(foreignOverlap_.foreignOverlapByLocalIndex(localIdx).size());
+            }
+            sendSizes[i] = static_cast<unsigned>(sendBuf.size());
         }
 
-        // receive our overlap from the processes to all peer processes
-        peerIt = peerSet_.begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
-            receiveIndicesFromPeer_(peerRank);
+        // exchange the number of indices with all peers. all
+        // messages are posted at once so that no process needs to
+        // wait for its peers in a particular order.
+        std::vector<unsigned> recvSizes(numPeers, 0);
+        std::vector<MPI_Request> requests(2*numPeers, MPI_REQUEST_NULL);
+        for (size_t i = 0; i < numPeers; ++i)
+            MPI_Irecv(&recvSizes[i], 1, MPI_UNSIGNED, static_cast<int>(peers[i]),
+                      /*tag=*/0, communicator(), &requests[i]);
+        for (size_t i = 0; i < numPeers; ++i)
+            MPI_Isend(&sendSizes[i], 1, MPI_UNSIGNED, static_cast<int>(peers[i]),
+                      /*tag=*/0, communicator(), &requests[numPeers + i]);
+        MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+
+        // exchange the indices themselves
+        std::vector<std::vector<IndexDistanceNpeers> > recvBufs(numPeers);
+        std::fill(requests.begin(), requests.end(), MPI_REQUEST_NULL);
+        for (size_t i = 0; i < numPeers; ++i) {
+            recvBufs[i].resize(recvSizes[i]);
+            if (recvSizes[i] > 0)
+                MPI_Irecv(recvBufs[i].data(),
+                          static_cast<int>(recvSizes[i]*sizeof(IndexDistanceNpeers)),
+                          MPI_BYTE, static_cast<int>(peers[i]),
+                          /*tag=*/0, communicator(), &requests[i]);
         }
-
-        // wait until all send operations complete
-        peerIt = peerSet_.begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
-            waitSendIndices_(peerRank);
+        for (size_t i = 0; i < numPeers; ++i) {
+            if (sendSizes[i] > 0)
+                MPI_Isend(sendBufs[i].data(),
+                          static_cast<int>(sendSizes[i]*sizeof(IndexDistanceNpeers)),
+                          MPI_BYTE, static_cast<int>(peers[i]),
+                          /*tag=*/0, communicator(), &requests[numPeers + i]);
         }
+        MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+
+        // extend the domestic overlap. the peers are processed in
+        // ascending order of their ranks so that the numbering of
+        // the new domestic indices does not depend on the order in
+        // which the messages arrived.
+        for (size_t i = 0; i < numPeers; ++i)
+            addIndicesFromPeer_(peers[i], recvBufs[i]);
+#endif // HAVE_MPI
     }
 
     void updateMasterRanks_()
@@ -444,84 +502,31 @@ protected:
         }
     }
 
-    void sendIndicesToPeer_(ProcessRank peerRank)
-    {
-#if HAVE_MPI
-        const auto& foreignOverlap = foreignOverlap_.foreignOverlapWithPeer(peerRank);
-
-        // first, send a message containing the number of additional
-        // indices stemming from the overlap (i.e. without the border
-        // indices)
-        size_t numIndices = foreignOverlap.size();
-        numIndicesSendBuffer_[peerRank] = new MpiBuffer<size_t>(1);
-        (*numIndicesSendBuffer_[peerRank])[0] = numIndices;
-        numIndicesSendBuffer_[peerRank]->send(peerRank);
-
-        // create MPI buffers
-        indicesSendBuffer_[peerRank] = new MpiBuffer<IndexDistanceNpeers>(numIndices);
-
-        // then send the additional indices themselfs
-        auto overlapIt = foreignOverlap.begin();
-        const auto& overlapEndIt = foreignOverlap.end();
-        for (unsigned i = 0; overlapIt != overlapEndIt; ++overlapIt, ++i) {
-            Index localIdx = overlapIt->index;
-            BorderDistance borderDistance = overlapIt->borderDistance;
-            size_t numPeers = foreignOverlap_.foreignOverlapByLocalIndex(localIdx).size();
-
-            IndexDistanceNpeers tmp;
-            tmp.index = globalIndices_.domesticToGlobal(localIdx);
-            tmp.borderDistance = borderDistance;
-            tmp.numPeers = static_cast<unsigned>(numPeers);
-
-            (*indicesSendBuffer_[peerRank])[i] = tmp;
-        }
-
-        indicesSendBuffer_[peerRank]->send(peerRank);
-#endif // HAVE_MPI
-    }
-
-    void waitSendIndices_(ProcessRank peerRank)
+    void addIndicesFromPeer_(ProcessRank peerRank,
+                             const std::vector<IndexDistanceNpeers>& recvBuff)
     {
-        numIndicesSendBuffer_[peerRank]->wait();
-        delete numIndicesSendBuffer_[peerRank];
-
-        indicesSendBuffer_[peerRank]->wait();
-        delete indicesSendBuffer_[peerRank];
-    }
+        auto& overlapWithPeer = domesticOverlapWithPeer_[static_cast<unsigned>(peerRank)];
+        overlapWithPeer.reserve(recvBuff.size());
 
-    void receiveIndicesFromPeer_(ProcessRank peerRank)
-    {
-#if HAVE_MPI
-        // receive the number of additional indices
-        int numIndices = -1;
-        MpiBuffer<size_t> numIndicesRecvBuff(1);
-        numIndicesRecvBuff.receive(peerRank);
-        numIndices = static_cast<int>(numIndicesRecvBuff[0]);
-
-        // receive the additional indices themselfs
-        MpiBuffer<IndexDistanceNpeers> recvBuff(static_cast<size_t>(numIndices));
-        recvBuff.receive(peerRank);
-        for (unsigned i = 0; i < static_cast<unsigned>(numIndices); ++i) {
-            Index globalIdx = recvBuff[i].index;
-            BorderDistance borderDistance = recvBuff[i].borderDistance;
+        for (const auto& recvEntry : recvBuff) {
+            Index globalIdx = recvEntry.index;
+            BorderDistance borderDistance = recvEntry.borderDistance;
 
             // if the index is not already known, add it to the
             // domestic indices
-            if (!globalIndices_.hasGlobalIndex(globalIdx)) {
-                Index newDomesticIdx = static_cast<Index>(globalIndices_.numDomestic());
-                globalIndices_.addIndex(newDomesticIdx, globalIdx);
+            Index domesticIdx = globalIndices_.globalToDomestic(globalIdx);
+            if (domesticIdx < 0) {
+                domesticIdx = static_cast<Index>(globalIndices_.numDomestic());
+                globalIndices_.addIndex(domesticIdx, globalIdx);
 
                 size_t newSize = globalIndices_.numDomestic();
                 borderDistance_.resize(newSize, std::numeric_limits<int>::max());
                 domesticOverlapByIndex_.resize(newSize);
             }
 
-            // convert the global index into a domestic one
-            Index domesticIdx = globalIndices_.globalToDomestic(globalIdx);
-
             // extend the domestic overlap
             domesticOverlapByIndex_[static_cast<unsigned>(domesticIdx)][static_cast<unsigned>(peerRank)] = borderDistance;
-            domesticOverlapWithPeer_[static_cast<unsigned>(peerRank)].push_back(domesticIdx);
+            overlapWithPeer.push_back(domesticIdx);
 
             //assert(borderDistance >= 0);
             assert(globalIdx >= 0);
@@ -531,7 +536,6 @@ protected:
 
             borderDistance_[static_cast<unsigned>(domesticIdx)] = std::min(borderDistance, borderDistance_[static_cast<unsigned>(domesticIdx)]);
         }
-#endif // HAVE_MPI
     }
 
     // this method is intended to set up the code mapping code for
@@ -546,19 +550,50 @@ protected:
     void setupDebugMapping_()
     {}
 
+    // converts an ordering of the native indices to a permutation of the local
+    // indices. the indices of the domestic overlap are not affected.
+    void setupOrdering_(const std::vector<Index>& nativeOrdering)
+    {
+        if (nativeOrdering.empty())
+            return;
+
+        assert(nativeOrdering.size() == numNative());
+        size_t nLocal = numLocal();
+        externalToInternal_.reserve(nLocal);
+        internalToExternal_.resize(nLocal, -1);
+        for (Index nativeIdx : nativeOrdering) {
+            Index localIdx = foreignOverlap_.nativeToLocal(nativeIdx);
+            if (localIdx < 0)
+                continue; // black-listed index
+
+            internalToExternal_[static_cast<unsigned>(localIdx)] =
+                static_cast<Index>(externalToInternal_.size());
+            externalToInternal_.push_back(localIdx);
+        }
+        assert(externalToInternal_.size() == nLocal);
+    }
+
     // this method is intended to map domestic indices to the ones
     // used by a sequential grid.
     //
-    // by default, this method does nothing
+    // by default, this method only applies the ordering of the local indices
     Index mapInternalToExternal_(Index internalIdx) const
-    { return internalIdx; }
+    {
+        if (internalIdx < 0 || static_cast<size_t>(internalIdx) >= internalToExternal_.size())
+            return internalIdx;
+        return internalToExternal_[static_cast<unsigned>(internalIdx)];
+    }
 
     // this method is intended to map the indices used by a sequential
     // to grid domestic indices ones.
     //
-    // by default, this method does nothing
+    // by default, this method only applies the ordering of the local indices
     Index mapExternalToInternal_(Index externalIdx) const
-    { return externalIdx; }
+    {
+        if (externalIdx < 0 || static_cast<size_t>(externalIdx) >= externalToInternal_.size())
+            return externalIdx;
+        return externalToInternal_[static_cast<unsigned>(externalIdx)];
+    }
 
     ProcessRank myRank_;
     unsigned worldSize_;
@@ -566,13 +601,14 @@ protected:
 
     BlackList blackList_;
 
+    std::vector<Index> internalToExternal_;
+    std::vector<Index> externalToInternal_;
+
     DomesticOverlapByRank domesticOverlapWithPeer_;
     OverlapByIndex domesticOverlapByIndex_;
     std::vector<BorderDistance> borderDistance_;
     std::vector<ProcessRank> masterRank_;
 
-    std::map<ProcessRank, MpiBuffer<size_t> *> numIndicesSendBuffer_;
-    std::map<ProcessRank, MpiBuffer<IndexDistanceNpeers> *> indicesSendBuffer_;
     GlobalIndices globalIndices_;
     PeerSet peerSet_;
 };
@@ -0,0 +1,240 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::Linear::FgmresSolver
+ */
+#ifndef EWOMS_FGMRES_SOLVER_HH
+#define EWOMS_FGMRES_SOLVER_HH
+
+#include "gmresbase.hh"
+
+#include <ewoms/common/timer.hh>
+#include <ewoms/common/timerguard.hh>
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+namespace Ewoms {
+namespace Linear {
+/*!
+ * \brief Implements a restarted flexible GMRES linear solver.
+ *
+ * The method uses right preconditioning and stores the preconditioned basis vectors,
+ * so the preconditioner is allowed to change from iteration to iteration (e.g., if it
+ * is an inner iterative solver). To reduce the number of global synchronization
+ * points, the new basis vector is orthogonalized using classical Gram-Schmidt where
+ * all scalar products, including the one which is required for its norm, are computed
+ * by a single global reduction. If this indicates a severe loss of orthogonality, a
+ * second Gram-Schmidt pass is done.
+ *
+ * The latency of the reduction is hidden behind the preconditioner and the linear
+ * operator: While the scalar products are summed up, the next preconditioned
+ * direction is computed from the image \f$w_i = A z_i\f$ of the current one which has
+ * not yet been orthogonalized. Once the coefficients are known, this direction and
+ * its image are combined with the previous ones like the basis vector, i.e.,
+ * \f$z_{i+1} = (K^{-1} w_i - \sum_k h_{k,i} z_k)/h_{i+1,i}\f$, which corresponds to
+ * \f$K^{-1} v_{i+1}\f$ for a linear preconditioner. (If the preconditioner changes
+ * between iterations, the method still converges, but usually needs more iterations
+ * than without pipelining.) Since the images of the directions are not recomputed,
+ * this requires to store them and rounding errors accumulate within a cycle, but the
+ * residual is recomputed at every restart.
+ *
+ * Since the residual vector is not available during a GMRES cycle, the convergence
+ * criterion is evaluated for the true residual at the end of each cycle and if the
+ * estimated residual norm indicates that the accuracy required by the criterion has
+ * been reached. For this, the accuracy is assumed to be proportional to the
+ * residual norm.
+ *
+ * The scalar product must provide the startDots() and finishDots() methods of
+ * OverlappingScalarProduct.
+ */
+template <class LinearOperator, class Vector, class Preconditioner, class ScalarProduct>
+class FgmresSolver
+    : public GmresBase<LinearOperator, Vector, Preconditioner, ScalarProduct>
+{
+    typedef GmresBase<LinearOperator, Vector, Preconditioner, ScalarProduct> ParentType;
+    typedef typename ParentType::ConvergenceCriterion ConvergenceCriterion;
+    typedef typename ParentType::Scalar Scalar;
+
+    using ParentType::A_;
+    using ParentType::b_;
+    using ParentType::preconditioner_;
+    using ParentType::convergenceCriterion_;
+    using ParentType::report_;
+    using ParentType::maxIterations_;
+    using ParentType::restart_;
+    using ParentType::verbosity_;
+
+public:
+    FgmresSolver(Preconditioner& preconditioner,
+                 ConvergenceCriterion& convergenceCriterion,
+                 ScalarProduct& scalarProduct)
+        : ParentType(preconditioner, convergenceCriterion, scalarProduct)
+    {}
+
+    /*!
+     * \brief Run the FGMRES solver and store the result into the "x" vector.
+     */
+    bool apply(Vector& x)
+    {
+        report_.reset();
+        Ewoms::TimerGuard reportTimerGuard(report_.timer());
+        report_.timer().start();
+
+        // set the initial solution to the zero vector, i.e., r_0 = b
+        x = 0.0;
+        Vector r = *b_;
+        preconditioner_.pre(x, r);
+
+        convergenceCriterion_.setInitial(x, r);
+        if (convergenceCriterion_.converged()) {
+            report_.setConverged(true);
+            return report_.converged();
+        }
+
+        if (verbosity_ > 0) {
+            std::cout << "-------- FgmresSolver --------" << std::endl;
+            convergenceCriterion_.printInitial();
+        }
+
+        // the orthonormal basis of the Krylov space, the preconditioned directions and
+        // their images under the linear operator
+        std::vector<Vector> V(restart_ + 1, x);
+        std::vector<Vector> Z(restart_, x);
+        std::vector<Vector> W(restart_, x);
+        Vector w(x);
+        Vector xTrial(x);
+        Vector dx(x);
+
+        // the Hessenberg matrix (stored column-wise), the Givens rotations and the
+        // right hand side of the least squares problem
+        std::vector<std::vector<Scalar> > H(restart_, std::vector<Scalar>(restart_ + 1, 0.0));
+        std::vector<Scalar> cs(restart_, 0.0);
+        std::vector<Scalar> sn(restart_, 0.0);
+        std::vector<Scalar> g(restart_ + 1, 0.0);
+        std::vector<Scalar> y;
+        std::vector<Scalar> coeffs;
+        std::vector<const Vector*> basis;
+
+        while (report_.iterations() < maxIterations_) {
+            Scalar beta = this->startCycle_(r, V, Z, W);
+            if (beta <= 0.0) {
+                // the residual is exactly zero. this should have been detected by the
+                // convergence criterion...
+                preconditioner_.post(x);
+                report_.setConverged(true);
+                return report_.converged();
+            }
+
+            std::fill(g.begin(), g.end(), 0.0);
+            g[0] = beta;
+            basis.clear();
+
+            // the estimated residual norm and the accuracy of the convergence criterion
+            // of the most recent evaluation for the true residual
+            Scalar refResidual = beta;
+            Scalar refAccuracy = convergenceCriterion_.accuracy();
+
+            for (unsigned i = 0; i < restart_ && report_.iterations() < maxIterations_; ++i) {
+                report_.increment();
+                bool extendable = i + 1 < restart_ && report_.iterations() < maxIterations_;
+
+                // orthogonalize W_i against all basis vectors. while the scalar products
+                // are reduced, K^-1 W_i and its image are computed.
+                basis.push_back(&V[i]);
+                bool happyBreakdown;
+                Scalar hNext = this->arnoldiStep_(basis, V, Z, W, i, extendable, beta,
+                                                  coeffs, happyBreakdown);
+                auto& h = H[i];
+                std::copy(coeffs.begin(), coeffs.end(), h.begin());
+                h[i + 1] = hNext;
+
+                Scalar estimatedResidual =
+                    this->applyGivensRotations_(h, i, cs, sn, g, "FGMRES");
+
+                // check the true residual if the estimated one indicates convergence,
+                // if the Krylov space cannot be extended anymore or at the end of the
+                // cycle
+                bool endOfCycle = happyBreakdown || !extendable;
+                Scalar predictedAccuracy = refAccuracy*estimatedResidual/refResidual;
+                if (!endOfCycle && predictedAccuracy > convergenceCriterion_.requiredAccuracy())
+                    continue;
+
+                this->computeUpdate_(Z, H, g, i + 1, y, dx);
+                xTrial = x;
+                xTrial += dx;
+                w = *b_;
+                A_->applyscaleadd(/*alpha=*/-1.0, xTrial, w);
+
+                convergenceCriterion_.update(/*curSol=*/xTrial, /*delta=*/dx, w);
+                if (verbosity_ > 1)
+                    convergenceCriterion_.print(report_.iterations());
+
+                refResidual = std::max(estimatedResidual, std::numeric_limits<Scalar>::min());
+                refAccuracy = convergenceCriterion_.accuracy();
+
+                if (convergenceCriterion_.converged()) {
+                    if (verbosity_ > 0) {
+                        convergenceCriterion_.print(report_.iterations());
+                        std::cout << "-------- /FgmresSolver --------" << std::endl;
+                    }
+
+                    x = xTrial;
+                    preconditioner_.post(x);
+                    report_.setConverged(true);
+                    return report_.converged();
+                }
+                else if (convergenceCriterion_.failed()) {
+                    if (verbosity_ > 0) {
+                        convergenceCriterion_.print(report_.iterations());
+                        std::cout << "-------- /FgmresSolver --------" << std::endl;
+                    }
+
+                    report_.setConverged(false);
+                    return report_.converged();
+                }
+
+                if (endOfCycle) {
+                    // restart using the current approximation and its residual
+                    x = xTrial;
+                    r = w;
+                    break;
+                }
+            }
+        }
+
+        if (verbosity_ > 0)
+            std::cout << "-------- /FgmresSolver --------" << std::endl;
+
+        report_.setConverged(false);
+        return report_.converged();
+    }
+};
+
+} // namespace Linear
+} // namespace Ewoms
+
+#endif
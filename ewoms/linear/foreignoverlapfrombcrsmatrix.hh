@@ -40,8 +40,11 @@
 #include <dune/istl/operators.hh>
 
 #include <algorithm>
+#include <cstdint>
 #include <iostream>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #if HAVE_MPI
@@ -67,13 +70,16 @@ public:
     /*!
      * \brief Constructs the foreign overlap given a BCRS matrix and
      *        an initial list of border indices.
+     *
+     * All communication happens using the specified communicator.
      */
     template <class BCRSMatrix>
     ForeignOverlapFromBCRSMatrix(const BCRSMatrix& A,
                                  const BorderList& borderList,
                                  const BlackList& blackList,
-                                 unsigned overlapSize)
-        : borderList_(borderList), blackList_(blackList)
+                                 unsigned overlapSize,
+                                 Communicator comm = Dune::MPIHelper::getCommunicator())
+        : borderList_(borderList), blackList_(blackList), comm_(comm)
     {
         overlapSize_ = overlapSize;
 
@@ -81,7 +87,7 @@ public:
 #if HAVE_MPI
         {
             int tmp;
-            MPI_Comm_rank(MPI_COMM_WORLD, &tmp);
+            MPI_Comm_rank(comm_, &tmp);
             myRank_ = static_cast<ProcessRank>(tmp);
         }
 #endif
@@ -92,6 +98,7 @@ public:
 
         // calculate the set of local indices on the border (beware:
         // _not_ the native ones)
+        localBorderIndices_.resize(numLocal_, 0);
         auto it = borderList.begin();
         const auto& endIt = borderList.end();
         for (; it != endIt; ++it) {
@@ -99,7 +106,7 @@ public:
             if (localIdx < 0)
                 continue;
 
-            localBorderIndices_.insert(localIdx);
+            localBorderIndices_[static_cast<unsigned>(localIdx)] = 1;
         }
 
         // compute the set of processes which are neighbors of the
@@ -149,7 +156,11 @@ public:
      * \brief Returns true iff a local index is a border index.
      */
     bool isBorder(Index localIdx) const
-    { return localBorderIndices_.count(localIdx) > 0; }
+    {
+        return localIdx >= 0
+               && static_cast<size_t>(localIdx) < localBorderIndices_.size()
+               && localBorderIndices_[static_cast<unsigned>(localIdx)];
+    }
 
     /*!
      * \brief Returns true iff a local index is a border index shared with a
@@ -311,6 +322,12 @@ public:
     const BlackList& blackList() const
     { return blackList_; }
 
+    /*!
+     * \brief Returns the communicator used by the overlap.
+     */
+    Communicator communicator() const
+    { return comm_; }
+
     /*!
      * \brief Return the number of peer ranks for which a given local
      *        index is visible.
@@ -377,6 +394,7 @@ protected:
         // find the seed list for the next overlap level using the
         // seed set for the current level
         SeedList nextSeedList;
+        std::unordered_set<std::uint64_t> nextSeedKeys;
         seedIt = seedList.begin();
         for (; seedIt != seedEndIt; ++seedIt) {
             Index nativeRowIdx = seedIt->index;
@@ -403,16 +421,7 @@ protected:
                     continue;
 
                 // check whether the new index is already in the overlap
-                bool hasIndex = false;
-                typename SeedList::iterator sIt = nextSeedList.begin();
-                typename SeedList::iterator sEndIt = nextSeedList.end();
-                for (; sIt != sEndIt; ++sIt) {
-                    if (sIt->index == nativeColIdx && sIt->peerRank == peerRank) {
-                        hasIndex = true;
-                        break;
-                    }
-                }
-                if (hasIndex)
+                if (!nextSeedKeys.insert(seedKey_(nativeColIdx, peerRank)).second)
                     continue; // we already have this index
 
                 // add the current processes to the seed list for the
@@ -453,16 +462,27 @@ protected:
         numLocal_ = localToNativeIndices_.size();
     }
 
+    // returns a key which identifies an (index, peer rank) pair
+    static std::uint64_t seedKey_(Index idx, ProcessRank peerRank)
+    {
+        return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(idx)) << 32)
+               | static_cast<std::uint64_t>(peerRank);
+    }
+
     Index localToPeerIdx_(Index localIdx, ProcessRank peerRank) const
     {
-        auto it = borderList_.begin();
-        const auto& endIt = borderList_.end();
-        for (; it != endIt; ++it) {
-            if (it->localIdx == localIdx && it->peerRank == peerRank)
-                return it->peerIdx;
+        // build the lookup table for the border list on first use
+        if (borderPeerIndices_.empty()) {
+            auto it = borderList_.begin();
+            const auto& endIt = borderList_.end();
+            for (; it != endIt; ++it)
+                borderPeerIndices_.emplace(seedKey_(it->localIdx, it->peerRank), it->peerIdx);
         }
 
-        return -1;
+        const auto& it = borderPeerIndices_.find(seedKey_(localIdx, peerRank));
+        if (it == borderPeerIndices_.end())
+            return -1;
+        return it->second;
     }
 
     template <class BCRSMatrix>
@@ -540,10 +560,15 @@ protected:
         peerIt = neighborPeerSet().begin();
         for (; peerIt != peerEndIt; ++peerIt) {
             ProcessRank neighborPeer = *peerIt;
-            numIndicesSendBufs[neighborPeer].send(neighborPeer);
-            indicesSendBufs[neighborPeer].send(neighborPeer);
+            numIndicesSendBufs[neighborPeer].send(neighborPeer, comm_);
+            indicesSendBufs[neighborPeer].send(neighborPeer, comm_);
         }
 
+        // the (index, peer rank) pairs which are already in the seed list
+        std::unordered_set<std::uint64_t> seedKeys;
+        for (const auto& seed : seedList)
+            seedKeys.insert(seedKey_(seed.index, seed.peerRank));
+
         // receive all data from the neighbors
         std::map<ProcessRank, MpiBuffer<unsigned> > numIndicesRcvBufs;
         std::map<ProcessRank, MpiBuffer<BorderIndex> > indicesRcvBufs;
@@ -554,10 +579,10 @@ protected:
             auto& indicesRcvBuf = indicesRcvBufs[neighborPeer];
 
             numIndicesRcvBuf.resize(1);
-            numIndicesRcvBuf.receive(neighborPeer);
+            numIndicesRcvBuf.receive(neighborPeer, comm_);
             unsigned numIndices = numIndicesRcvBufs[neighborPeer][0];
             indicesRcvBuf.resize(numIndices);
-            indicesRcvBuf.receive(neighborPeer);
+            indicesRcvBuf.receive(neighborPeer, comm_);
 
             // filter out all indices which are already in the peer
             // processes' overlap and add them to the seed list. also
@@ -578,16 +603,7 @@ protected:
                     continue;
 
                 // make sure the index is not already in the seed list
-                bool inSeedList = false;
-                auto seedIt = seedList.begin();
-                const auto& seedEndIt = seedList.end();
-                for (; seedIt != seedEndIt; ++seedIt) {
-                    if (seedIt->index == localIdx && seedIt->peerRank == peerRank) {
-                        inSeedList = true;
-                        break;
-                    }
-                }
-                if (inSeedList)
+                if (!seedKeys.insert(seedKey_(localIdx, peerRank)).second)
                     continue;
 
                 IndexRankDist seedEntry;
@@ -681,9 +697,13 @@ protected:
     // index
     std::vector<ProcessRank> masterRank_;
 
-    // set of all local indices which are on the border of some remote
+    // flags all local indices which are on the border of some remote
     // process
-    std::set<Index> localBorderIndices_;
+    std::vector<char> localBorderIndices_;
+
+    // maps (native index, peer rank) pairs of the border list to the
+    // index on the peer
+    mutable std::unordered_map<std::uint64_t, Index> borderPeerIndices_;
 
     // stores the set of process ranks which are in the overlap for a
     // given row index "owned" by the current rank. The second value
@@ -704,6 +724,9 @@ protected:
 
     // the MPI rank of the local process
     ProcessRank myRank_;
+
+    // the communicator used for all communication
+    Communicator comm_;
 };
 
 } // namespace Linear
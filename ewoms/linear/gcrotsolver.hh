@@ -0,0 +1,434 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::Linear::GcrotSolver
+ */
+#ifndef EWOMS_GCROT_SOLVER_HH
+#define EWOMS_GCROT_SOLVER_HH
+
+#include "gmresbase.hh"
+
+#include <ewoms/common/timer.hh>
+#include <ewoms/common/timerguard.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <iostream>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace Ewoms {
+namespace Linear {
+/*!
+ * \brief Stores the search directions which are recycled by GcrotSolver.
+ *
+ * The object must outlive the solver, i.e., it is usually owned by the linear solver
+ * backend and passed to every newly created solver. Since only the directions
+ * themselves are kept and their images under the linear operator are recomputed at
+ * the beginning of each solve, the recycled directions stay valid if the matrix
+ * changes, e.g., between the iterations of the Newton method. They must be thrown away
+ * if the layout of the vectors changes, though.
+ */
+template <class Vector>
+class GcrotRecycleSpace
+{
+public:
+    GcrotRecycleSpace()
+    { maxSize_ = 0; }
+
+    /*!
+     * \brief Set the maximum number of recycled directions.
+     *
+     * If the space currently holds more directions, the oldest ones are discarded.
+     */
+    void setMaxSize(unsigned value)
+    {
+        maxSize_ = value;
+        truncate(maxSize_);
+    }
+
+    /*!
+     * \brief Return the maximum number of recycled directions.
+     */
+    unsigned maxSize() const
+    { return maxSize_; }
+
+    /*!
+     * \brief Return the number of directions which are currently stored.
+     */
+    unsigned size() const
+    { return static_cast<unsigned>(directions_.size()); }
+
+    /*!
+     * \brief Throw away all recycled directions.
+     */
+    void clear()
+    { directions_.clear(); }
+
+    /*!
+     * \brief Discard the oldest directions until at most \c n are left.
+     */
+    void truncate(unsigned n)
+    {
+        while (directions_.size() > n)
+            directions_.pop_front();
+    }
+
+    /*!
+     * \brief Add a direction and discard the oldest one if the space is full.
+     */
+    void push(const Vector& u)
+    {
+        if (maxSize_ == 0)
+            return;
+        truncate(maxSize_ - 1);
+        directions_.push_back(u);
+    }
+
+    /*!
+     * \brief Return the recycled directions, the oldest one first.
+     */
+    std::deque<Vector>& directions()
+    { return directions_; }
+
+    /*!
+     * \copydoc directions()
+     */
+    const std::deque<Vector>& directions() const
+    { return directions_; }
+
+private:
+    std::deque<Vector> directions_;
+    unsigned maxSize_;
+};
+
+/*!
+ * \brief Implements a flexible GCROT(m,k) linear solver which recycles search
+ *        directions between solves.
+ *
+ * The outer GCR iteration keeps a set of at most k directions \f$U\f$ and their images
+ * \f$C = A U\f$, where the columns of \f$C\f$ are orthonormal. Each inner cycle is a
+ * flexible GMRES(m) cycle for the operator \f$(I - C C^T) A\f$, i.e., the Krylov space
+ * is kept orthogonal to \f$C\f$, and the correction of the cycle is added to \f$U\f$
+ * afterwards. If the space holds more than k directions, the oldest one is discarded.
+ *
+ * The directions are stored in a GcrotRecycleSpace object which survives the solver.
+ * At the beginning of a solve, \f$C\f$ is recomputed for the current matrix and the
+ * initial residual is projected out of its range. Since consecutive linear systems
+ * of the Newton method are closely related, this removes the slowly converging
+ * error components which the preconditioner cannot deal with (e.g., the
+ * low-frequency modes which are left over by the smoother of an AMG) before the first
+ * Krylov iteration. After a solve has converged, the correction of its last cycle is
+ * added to the recycled directions as well, i.e., the correction subspace is recycled
+ * instead of the solution itself.
+ *
+ * The Arnoldi process is the pipelined one of FgmresSolver (see GmresBase), i.e., the
+ * orthogonalization uses classical Gram-Schmidt with a single global reduction per
+ * iteration in most cases, the next preconditioned direction and its image are
+ * computed while the reduction is in flight, and the true residual is only evaluated
+ * at the end of a cycle or if the estimated residual indicates convergence. When the
+ * next direction is combined with the previous ones, only the coefficients with
+ * respect to the Krylov basis are considered, i.e., the direction is not projected
+ * onto the range of \f$C\f$. (This is done by the update of the solution.) The scalar
+ * product must provide the startDots() and finishDots() methods of
+ * OverlappingScalarProduct.
+ */
+template <class LinearOperator, class Vector, class Preconditioner, class ScalarProduct>
+class GcrotSolver
+    : public GmresBase<LinearOperator, Vector, Preconditioner, ScalarProduct>
+{
+    typedef GmresBase<LinearOperator, Vector, Preconditioner, ScalarProduct> ParentType;
+    typedef typename ParentType::ConvergenceCriterion ConvergenceCriterion;
+    typedef typename ParentType::Scalar Scalar;
+
+    using ParentType::A_;
+    using ParentType::b_;
+    using ParentType::preconditioner_;
+    using ParentType::convergenceCriterion_;
+    using ParentType::scalarProduct_;
+    using ParentType::report_;
+    using ParentType::maxIterations_;
+    using ParentType::restart_;
+    using ParentType::verbosity_;
+
+public:
+    typedef Ewoms::Linear::GcrotRecycleSpace<Vector> RecycleSpace;
+
+    GcrotSolver(Preconditioner& preconditioner,
+                ConvergenceCriterion& convergenceCriterion,
+                ScalarProduct& scalarProduct)
+        : ParentType(preconditioner, convergenceCriterion, scalarProduct)
+    { recycleSpace_ = nullptr; }
+
+    /*!
+     * \brief Set the object which stores the recycled directions.
+     *
+     * If no recycle space is set, the solver behaves like FgmresSolver.
+     */
+    void setRecycleSpace(RecycleSpace* space)
+    { recycleSpace_ = space; }
+
+    /*!
+     * \brief Run the GCROT solver and store the result into the "x" vector.
+     */
+    bool apply(Vector& x)
+    {
+        report_.reset();
+        Ewoms::TimerGuard reportTimerGuard(report_.timer());
+        report_.timer().start();
+
+        RecycleSpace localSpace;
+        RecycleSpace& space = recycleSpace_ ? *recycleSpace_ : localSpace;
+        auto& U = space.directions();
+
+        // set the initial solution to the zero vector, i.e., r_0 = b
+        x = 0.0;
+        Vector r = *b_;
+        preconditioner_.pre(x, r);
+
+        convergenceCriterion_.setInitial(x, r);
+        if (convergenceCriterion_.converged()) {
+            report_.setConverged(true);
+            return report_.converged();
+        }
+
+        if (verbosity_ > 0) {
+            std::cout << "-------- GcrotSolver --------" << std::endl;
+            convergenceCriterion_.printInitial();
+        }
+
+        // compute C = A U for the current matrix, make C orthonormal and remove the
+        // part of the residual which is in its range
+        std::deque<Vector> C;
+        prepareRecycledDirections_(U, C, x);
+        if (!C.empty()) {
+            std::vector<std::pair<const Vector*, const Vector*> > dotPairs;
+            for (const auto& c : C)
+                dotPairs.emplace_back(&c, &r);
+            scalarProduct_.startDots(dotPairs);
+            const std::vector<Scalar> gamma = scalarProduct_.finishDots();
+            for (unsigned k = 0; k < C.size(); ++k) {
+                x.axpy(gamma[k], U[k]);
+                r.axpy(-gamma[k], C[k]);
+            }
+
+            Vector dx(x);
+            convergenceCriterion_.update(/*curSol=*/x, /*delta=*/dx, r);
+            if (verbosity_ > 1) {
+                std::cout << "Projection onto " << C.size() << " recycled directions:\n";
+                convergenceCriterion_.print(report_.iterations());
+            }
+
+            if (convergenceCriterion_.converged())
+                return finish_(x, /*converged=*/true);
+        }
+
+        // the orthonormal basis of the Krylov space, the preconditioned directions and
+        // their images under the linear operator
+        std::vector<Vector> V(restart_ + 1, x);
+        std::vector<Vector> Z(restart_, x);
+        std::vector<Vector> W(restart_, x);
+        Vector w(x);
+        Vector xTrial(x);
+        Vector dx(x);
+
+        // the Hessenberg matrix, the projections of the new basis vectors onto C (both
+        // stored column-wise), the Givens rotations and the right hand side of the
+        // least squares problem
+        std::vector<std::vector<Scalar> > H(restart_, std::vector<Scalar>(restart_ + 1, 0.0));
+        std::vector<std::vector<Scalar> > B(restart_);
+        std::vector<Scalar> cs(restart_, 0.0);
+        std::vector<Scalar> sn(restart_, 0.0);
+        std::vector<Scalar> g(restart_ + 1, 0.0);
+        std::vector<Scalar> y;
+        std::vector<Scalar> coeffs;
+        std::vector<const Vector*> basis;
+
+        while (report_.iterations() < maxIterations_) {
+            Scalar beta = this->startCycle_(r, V, Z, W);
+            if (beta <= 0.0) {
+                // the residual is exactly zero. this should have been detected by the
+                // convergence criterion...
+                return finish_(x, /*converged=*/true);
+            }
+
+            std::fill(g.begin(), g.end(), 0.0);
+            g[0] = beta;
+
+            // the estimated residual norm and the accuracy of the convergence criterion
+            // of the most recent evaluation for the true residual
+            Scalar refResidual = beta;
+            Scalar refAccuracy = convergenceCriterion_.accuracy();
+
+            for (unsigned i = 0; i < restart_ && report_.iterations() < maxIterations_; ++i) {
+                report_.increment();
+                bool extendable = i + 1 < restart_ && report_.iterations() < maxIterations_;
+
+                // orthogonalize W_i against C and all basis vectors of the Krylov space.
+                // while the scalar products are reduced, K^-1 W_i and its image are
+                // computed.
+                basis.clear();
+                for (const auto& c : C)
+                    basis.push_back(&c);
+                for (unsigned k = 0; k <= i; ++k)
+                    basis.push_back(&V[k]);
+
+                bool happyBreakdown;
+                Scalar hNext = this->arnoldiStep_(basis, V, Z, W, i, extendable, beta,
+                                                  coeffs, happyBreakdown);
+                B[i].assign(coeffs.begin(), coeffs.begin() + C.size());
+                auto& h = H[i];
+                std::copy(coeffs.begin() + C.size(), coeffs.end(), h.begin());
+                h[i + 1] = hNext;
+
+                Scalar estimatedResidual =
+                    this->applyGivensRotations_(h, i, cs, sn, g, "GCROT");
+
+                // check the true residual if the estimated one indicates convergence,
+                // if the Krylov space cannot be extended anymore or at the end of the
+                // cycle
+                bool endOfCycle = happyBreakdown || !extendable;
+                Scalar predictedAccuracy = refAccuracy*estimatedResidual/refResidual;
+                if (!endOfCycle && predictedAccuracy > convergenceCriterion_.requiredAccuracy())
+                    continue;
+
+                // dx = Z y - U B y. (Since A U = C, this means that A dx = V H y, i.e.,
+                // the update does not change the residual's component in the range of
+                // C.)
+                this->computeUpdate_(Z, H, g, i + 1, y, dx);
+                for (unsigned k = 0; k <= i; ++k)
+                    for (unsigned j = 0; j < B[k].size(); ++j)
+                        dx.axpy(-y[k]*B[k][j], U[j]);
+                xTrial = x;
+                xTrial += dx;
+                w = *b_;
+                A_->applyscaleadd(/*alpha=*/-1.0, xTrial, w);
+
+                convergenceCriterion_.update(/*curSol=*/xTrial, /*delta=*/dx, w);
+                if (verbosity_ > 1)
+                    convergenceCriterion_.print(report_.iterations());
+
+                refResidual = std::max(estimatedResidual, std::numeric_limits<Scalar>::min());
+                refAccuracy = convergenceCriterion_.accuracy();
+
+                if (convergenceCriterion_.converged()) {
+                    // the correction of the last cycle is recycled like the ones of
+                    // the previous cycles
+                    x = xTrial;
+                    space.push(dx);
+                    return finish_(x, /*converged=*/true);
+                }
+                else if (convergenceCriterion_.failed())
+                    return finish_(x, /*converged=*/false);
+
+                if (endOfCycle) {
+                    // A dx is the difference of the old and the new residual. if it
+                    // is not negligible, add the correction to the recycled directions.
+                    // (this keeps the new residual orthogonal to C.)
+                    Vector& c = r;
+                    c.axpy(-1.0, w);
+                    scalarProduct_.startDots({{&c, &c}});
+                    Scalar cNorm = std::sqrt(scalarProduct_.finishDots()[0]);
+                    if (cNorm > 0.0 && space.maxSize() > 0) {
+                        if (U.size() >= space.maxSize()) {
+                            U.pop_front();
+                            C.pop_front();
+                        }
+                        dx *= 1.0/cNorm;
+                        c *= 1.0/cNorm;
+                        U.push_back(dx);
+                        C.push_back(c);
+                    }
+
+                    // restart using the current approximation and its residual
+                    x = xTrial;
+                    r = w;
+                    break;
+                }
+            }
+        }
+
+        return finish_(x, /*converged=*/false);
+    }
+
+private:
+    // recompute C = A U for the current linear operator and orthonormalize it. The
+    // directions in U are transformed accordingly and the ones which have become
+    // (almost) linearly dependent are discarded.
+    void prepareRecycledDirections_(std::deque<Vector>& U,
+                                    std::deque<Vector>& C,
+                                    const Vector& templateVector)
+    {
+        std::vector<const Vector*> basis;
+        std::vector<Scalar> coeffs;
+        for (unsigned k = 0; k < U.size();) {
+            C.emplace_back(templateVector);
+            Vector& c = C.back();
+            A_->apply(U[k], c);
+
+            scalarProduct_.startDots({{&c, &c}});
+            Scalar origNorm = std::sqrt(scalarProduct_.finishDots()[0]);
+
+            basis.clear();
+            for (unsigned j = 0; j < k; ++j)
+                basis.push_back(&C[j]);
+            Scalar cNorm = this->orthogonalize_(basis, c, coeffs, []() {});
+
+            if (!(cNorm > 1e-10*origNorm)) {
+                C.pop_back();
+                U.erase(U.begin() + k);
+                continue;
+            }
+
+            for (unsigned j = 0; j < k; ++j)
+                U[k].axpy(-coeffs[j], U[j]);
+            U[k] *= 1.0/cNorm;
+            c *= 1.0/cNorm;
+            ++k;
+        }
+    }
+
+    // conclude the solve
+    bool finish_(Vector& x, bool converged)
+    {
+        preconditioner_.post(x);
+
+        if (verbosity_ > 0) {
+            convergenceCriterion_.print(report_.iterations());
+            std::cout << "-------- /GcrotSolver --------" << std::endl;
+        }
+
+        report_.setConverged(converged);
+        return report_.converged();
+    }
+
+    RecycleSpace* recycleSpace_;
+};
+
+} // namespace Linear
+} // namespace Ewoms
+
+#endif
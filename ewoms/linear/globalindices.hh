@@ -33,8 +33,8 @@
 #include <dune/istl/operators.hh>
 
 #include <algorithm>
-#include <set>
-#include <map>
+#include <unordered_map>
+#include <vector>
 #include <iostream>
 #include <tuple>
 
@@ -50,14 +50,20 @@ namespace Linear {
  * \brief This class maps domestic row indices to and from "global"
  *        indices which is used to construct an algebraic overlap
  *        for the parallel linear solvers.
+ *
+ * The domestic to global mapping is stored as a flat array while the
+ * reverse direction uses a hash table. The offsets of the indices of
+ * the individual processes are determined by a single exclusive
+ * prefix sum and the global indices of the border are exchanged
+ * using one message per peer process.
  */
 template <class ForeignOverlap>
 class GlobalIndices
 {
     GlobalIndices(const GlobalIndices& ) = delete;
 
-    typedef std::map<Index, Index> GlobalToDomesticMap;
-    typedef std::map<Index, Index> DomesticToGlobalMap;
+    typedef std::unordered_map<Index, Index> GlobalToDomesticMap;
+    typedef std::vector<Index> DomesticToGlobalMap;
 
 public:
     GlobalIndices(const ForeignOverlap& foreignOverlap)
@@ -69,9 +75,9 @@ public:
 #if HAVE_MPI
         {
             int tmp;
-            MPI_Comm_rank(MPI_COMM_WORLD, &tmp);
+            MPI_Comm_rank(foreignOverlap_.communicator(), &tmp);
             myRank_ = static_cast<ProcessRank>(tmp);
-            MPI_Comm_size(MPI_COMM_WORLD, &tmp);
+            MPI_Comm_size(foreignOverlap_.communicator(), &tmp);
             mpiSize_ = static_cast<size_t>(tmp);
         }
 #endif
@@ -87,9 +93,11 @@ public:
      */
     Index domesticToGlobal(Index domesticIdx) const
     {
-        assert(domesticToGlobal_.find(domesticIdx) != domesticToGlobal_.end());
+        assert(0 <= domesticIdx
+               && static_cast<size_t>(domesticIdx) < domesticToGlobal_.size()
+               && domesticToGlobal_[static_cast<size_t>(domesticIdx)] >= 0);
 
-        return domesticToGlobal_.find(domesticIdx)->second;
+        return domesticToGlobal_[static_cast<size_t>(domesticIdx)];
     }
 
     /*!
@@ -126,11 +134,21 @@ public:
      */
     void addIndex(Index domesticIdx, Index globalIdx)
     {
-        domesticToGlobal_[domesticIdx] = globalIdx;
+        assert(domesticIdx >= 0 && globalIdx >= 0);
+
+        size_t i = static_cast<size_t>(domesticIdx);
+        if (i >= domesticToGlobal_.size())
+            domesticToGlobal_.resize(std::max(i + 1, 2*domesticToGlobal_.size()), -1);
+
+        if (domesticToGlobal_[i] < 0)
+            ++numDomestic_;
+        else
+            globalToDomestic_.erase(domesticToGlobal_[i]);
+
+        domesticToGlobal_[i] = globalIdx;
         globalToDomestic_[globalIdx] = domesticIdx;
-        numDomestic_ = domesticToGlobal_.size();
 
-        assert(domesticToGlobal_.size() == globalToDomestic_.size());
+        assert(numDomestic_ == globalToDomestic_.size());
     }
 
     /*!
@@ -147,7 +165,7 @@ public:
                  MPI_BYTE,                     // data type
                  static_cast<int>(peerRank),   // peer process
                  0,                            // tag
-                 MPI_COMM_WORLD);              // communicator
+                 foreignOverlap_.communicator()); // communicator
 #endif
     }
 
@@ -164,7 +182,7 @@ public:
                  MPI_BYTE,                     // data type
                  static_cast<int>(peerRank),   // peer process
                  0,                            // tag
-                 MPI_COMM_WORLD,               // communicator
+                 foreignOverlap_.communicator(), // communicator
                  MPI_STATUS_IGNORE);           // status
 
         Index domesticIdx = foreignOverlap_.nativeToLocal(recvBuf.peerIdx);
@@ -190,9 +208,9 @@ public:
         std::cout << "(domestic index, global index, domestic->global->domestic)"
                   << " list for rank " << myRank_ << "\n";
 
-        for (size_t domIdx = 0; domIdx < domesticToGlobal_.size(); ++domIdx)
-            std::cout << "(" << domIdx << ", " << domesticToGlobal(domIdx)
-                      << ", " << globalToDomestic(domesticToGlobal(domIdx)) << ") ";
+        for (size_t domIdx = 0; domIdx < numDomestic_; ++domIdx)
+            std::cout << "(" << domIdx << ", " << domesticToGlobal(static_cast<Index>(domIdx))
+                      << ", " << globalToDomestic(domesticToGlobal(static_cast<Index>(domIdx))) << ") ";
         std::cout << "\n" << std::flush;
     }
 
@@ -201,125 +219,130 @@ protected:
     // global index list
     void buildGlobalIndices_()
     {
-#if HAVE_MPI
         numDomestic_ = 0;
-#else
+#if !HAVE_MPI
         numDomestic_ = foreignOverlap_.numLocal();
 #endif
 
 #if HAVE_MPI
-        if (myRank_ == 0) {
-            // the first rank starts at index zero
+        size_t numLocal = foreignOverlap_.numLocal();
+        domesticToGlobal_.reserve(numLocal);
+        globalToDomestic_.reserve(numLocal);
+
+        // count the indices for which the current process is the
+        // master and get the offset of the current process using a
+        // prefix sum over all ranks.
+        int numMaster = 0;
+        for (unsigned i = 0; i < numLocal; ++i)
+            if (foreignOverlap_.iAmMasterOf(static_cast<Index>(i)))
+                ++numMaster;
+
+        domesticOffset_ = 0;
+        MPI_Exscan(&numMaster, &domesticOffset_, 1, MPI_INT, MPI_SUM,
+                   foreignOverlap_.communicator());
+        if (myRank_ == 0)
+            // the result of MPI_Exscan is undefined on the first rank
             domesticOffset_ = 0;
-        }
-        else {
-            // all other ranks retrieve their offset from the next
-            // lower rank
-            MPI_Recv(&domesticOffset_, // buffer
-                     1,                // count
-                     MPI_INT,          // data type
-                     static_cast<int>(myRank_ - 1), // peer rank
-                     0,                // tag
-                     MPI_COMM_WORLD,   // communicator
-                     MPI_STATUS_IGNORE);
-        }
 
         // create maps for all indices for which the current process
         // is the master
-        int numMaster = 0;
-        for (unsigned i = 0; i < foreignOverlap_.numLocal(); ++i) {
+        Index globalIdx = domesticOffset_;
+        for (unsigned i = 0; i < numLocal; ++i) {
             if (!foreignOverlap_.iAmMasterOf(static_cast<Index>(i)))
                 continue;
 
-            addIndex(static_cast<Index>(i),
-                     static_cast<Index>(domesticOffset_ + numMaster));
-            ++numMaster;
-        }
-
-        if (myRank_ < mpiSize_ - 1) {
-            // send the domestic offset plus the number of master
-            // indices to the process which is one rank higher
-            int tmp = domesticOffset_ + numMaster;
-            MPI_Send(&tmp,            // buff
-                     1,               // count
-                     MPI_INT,         // data type
-                     static_cast<int>(myRank_ + 1), // peer rank
-                     0,               // tag
-                     MPI_COMM_WORLD); // communicator
-        }
-
-        typename PeerSet::const_iterator peerIt;
-        typename PeerSet::const_iterator peerEndIt = peerSet_().end();
-        // receive the border indices from the lower ranks
-        peerIt = peerSet_().begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            if (*peerIt < myRank_)
-                receiveBorderFrom_(*peerIt);
-        }
-
-        // send the border indices to the higher ranks
-        peerIt = peerSet_().begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            if (*peerIt > myRank_)
-                sendBorderTo_(*peerIt);
-        }
-
-        // receive the border indices from the higher ranks
-        peerIt = peerSet_().begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            if (*peerIt > myRank_)
-                receiveBorderFrom_(*peerIt);
+            addIndex(static_cast<Index>(i), globalIdx++);
         }
 
-        // send the border indices to the lower ranks
-        peerIt = peerSet_().begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            if (*peerIt < myRank_)
-                sendBorderTo_(*peerIt);
-        }
+        exchangeBorderIndices_();
 #endif // HAVE_MPI
     }
 
-    void sendBorderTo_(ProcessRank peerRank)
+    // send the global indices of all border indices for which we are
+    // master to the peers and receive the ones which are mastered
+    // by the peers. each pair of processes exchanges exactly one
+    // message.
+    void exchangeBorderIndices_()
     {
 #if HAVE_MPI
-        // send (local index on myRank, global index) pairs to the
-        // peers
+        const PeerSet& peerSet = peerSet_();
+        size_t numPeers = peerSet.size();
+
+        std::vector<ProcessRank> peers(peerSet.begin(), peerSet.end());
+        std::vector<std::vector<PeerIndexGlobalIndex> > sendBufs(numPeers);
+        std::vector<std::vector<PeerIndexGlobalIndex> > recvBufs(numPeers);
+
+        // a single pass over the border list is sufficient to figure
+        // out what needs to be send to and received from each peer.
+        // peers which are not in the peer set are ignored.
+        auto peerPos = [&peers](ProcessRank peerRank) -> int {
+            auto it = std::lower_bound(peers.begin(), peers.end(), peerRank);
+            if (it == peers.end() || *it != peerRank)
+                return -1;
+            return static_cast<int>(it - peers.begin());
+        };
+
+        std::vector<size_t> numRecv(numPeers, 0);
         BorderList::const_iterator borderIt = borderList_().begin();
         BorderList::const_iterator borderEndIt = borderList_().end();
         for (; borderIt != borderEndIt; ++borderIt) {
-            ProcessRank borderPeer = borderIt->peerRank;
-            BorderDistance borderDistance = borderIt->borderDistance;
-            if (borderPeer != peerRank || borderDistance != 0)
+            if (borderIt->borderDistance != 0)
+                continue;
+
+            int pos = peerPos(borderIt->peerRank);
+            if (pos < 0)
                 continue;
 
             Index localIdx = foreignOverlap_.nativeToLocal(borderIt->localIdx);
-            Index peerIdx = borderIt->peerIdx;
-            assert(localIdx >= 0);
-            if (foreignOverlap_.iAmMasterOf(localIdx)) {
-                sendBorderIndex(borderPeer, localIdx, peerIdx);
+            if (localIdx >= 0 && foreignOverlap_.iAmMasterOf(localIdx)) {
+                PeerIndexGlobalIndex tmp;
+                tmp.peerIdx = borderIt->peerIdx;
+                tmp.globalIdx = domesticToGlobal(localIdx);
+                sendBufs[static_cast<size_t>(pos)].push_back(tmp);
             }
+            else if (localIdx >= 0 && foreignOverlap_.masterRank(localIdx) == borderIt->peerRank)
+                ++numRecv[static_cast<size_t>(pos)];
         }
-#endif // HAVE_MPI
-    }
 
-    void receiveBorderFrom_(ProcessRank peerRank)
-    {
-#if HAVE_MPI
-        // retrieve the global indices for which we are not master
-        // from the processes with lower rank
-        BorderList::const_iterator borderIt = borderList_().begin();
-        BorderList::const_iterator borderEndIt = borderList_().end();
-        for (; borderIt != borderEndIt; ++borderIt) {
-            ProcessRank borderPeer = borderIt->peerRank;
-            BorderDistance borderDistance = borderIt->borderDistance;
-            if (borderPeer != peerRank || borderDistance != 0)
+        std::vector<MPI_Request> requests;
+        requests.reserve(2*numPeers);
+        for (size_t i = 0; i < numPeers; ++i) {
+            if (numRecv[i] == 0)
+                continue;
+
+            recvBufs[i].resize(numRecv[i]);
+            requests.push_back(MPI_REQUEST_NULL);
+            MPI_Irecv(recvBufs[i].data(),
+                      static_cast<int>(numRecv[i]*sizeof(PeerIndexGlobalIndex)),
+                      MPI_BYTE,
+                      static_cast<int>(peers[i]),
+                      /*tag=*/0,
+                      foreignOverlap_.communicator(),
+                      &requests.back());
+        }
+        for (size_t i = 0; i < numPeers; ++i) {
+            if (sendBufs[i].empty())
                 continue;
 
-            Index nativeIdx = borderIt->localIdx;
-            Index localIdx = foreignOverlap_.nativeToLocal(nativeIdx);
-            if (localIdx >= 0 && foreignOverlap_.masterRank(localIdx) == borderPeer)
-                receiveBorderIndex(borderPeer);
+            requests.push_back(MPI_REQUEST_NULL);
+            MPI_Isend(sendBufs[i].data(),
+                      static_cast<int>(sendBufs[i].size()*sizeof(PeerIndexGlobalIndex)),
+                      MPI_BYTE,
+                      static_cast<int>(peers[i]),
+                      /*tag=*/0,
+                      foreignOverlap_.communicator(),
+                      &requests.back());
+        }
+        MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+
+        // add the received indices. this is done in the order of the
+        // peer ranks to keep the result deterministic
+        for (size_t i = 0; i < numPeers; ++i) {
+            for (const auto& recvEntry : recvBufs[i]) {
+                Index domesticIdx = foreignOverlap_.nativeToLocal(recvEntry.peerIdx);
+                if (domesticIdx >= 0)
+                    addIndex(domesticIdx, recvEntry.globalIdx);
+            }
         }
 #endif // HAVE_MPI
     }
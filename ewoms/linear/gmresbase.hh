@@ -0,0 +1,323 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::Linear::GmresBase
+ */
+#ifndef EWOMS_GMRES_BASE_HH
+#define EWOMS_GMRES_BASE_HH
+
+#include "convergencecriterion.hh"
+#include "linearsolverreport.hh"
+
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Ewoms {
+namespace Linear {
+/*!
+ * \brief The functionality which is shared by the restarted Krylov solvers that are
+ *        based on the flexible GMRES method, i.e., FgmresSolver and GcrotSolver.
+ *
+ * Besides the run-time settings, this comprises the pipelined Arnoldi process, the
+ * Givens rotations of the Hessenberg matrix and the solution of the resulting least
+ * squares problem. The Arnoldi process keeps the preconditioned directions \f$Z\f$,
+ * their images \f$W = A Z\f$ and the orthonormal basis \f$V\f$ of the Krylov space.
+ * The orthogonalization uses classical Gram-Schmidt where all scalar products of a
+ * pass are computed by a single global reduction, and the next preconditioned
+ * direction and its image are computed while this reduction is in flight, see
+ * FgmresSolver.
+ *
+ * The scalar product must provide the startDots() and finishDots() methods of
+ * OverlappingScalarProduct.
+ */
+template <class LinearOperator, class Vector, class Preconditioner, class ScalarProduct>
+class GmresBase
+{
+protected:
+    typedef Ewoms::Linear::ConvergenceCriterion<Vector> ConvergenceCriterion;
+    typedef typename LinearOperator::field_type Scalar;
+
+public:
+    GmresBase(Preconditioner& preconditioner,
+              ConvergenceCriterion& convergenceCriterion,
+              ScalarProduct& scalarProduct)
+        : preconditioner_(preconditioner)
+        , convergenceCriterion_(convergenceCriterion)
+        , scalarProduct_(scalarProduct)
+    {
+        A_ = nullptr;
+        b_ = nullptr;
+
+        maxIterations_ = 1000;
+        restart_ = 30;
+        verbosity_ = 0;
+    }
+
+    /*!
+     * \brief Set the maximum number of iterations before we give up without achieving
+     *        convergence.
+     */
+    void setMaxIterations(unsigned value)
+    { maxIterations_ = value; }
+
+    /*!
+     * \brief Return the maximum number of iterations before we give up without achieving
+     *        convergence.
+     */
+    unsigned maxIterations() const
+    { return maxIterations_; }
+
+    /*!
+     * \brief Set the number of iterations after which the method is restarted.
+     */
+    void setRestart(unsigned value)
+    { restart_ = std::max(1u, value); }
+
+    /*!
+     * \brief Return the number of iterations after which the method is restarted.
+     */
+    unsigned restart() const
+    { return restart_; }
+
+    /*!
+     * \brief Set the verbosity level of the linear solver
+     *
+     * The levels are the same as for BiCGStabSolver.
+     */
+    void setVerbosity(unsigned value)
+    { verbosity_ = value; }
+
+    /*!
+     * \brief Return the verbosity level of the linear solver.
+     */
+    unsigned verbosity() const
+    { return verbosity_; }
+
+    /*!
+     * \brief Set the matrix "A" of the linear system.
+     */
+    void setLinearOperator(const LinearOperator* A)
+    { A_ = A; }
+
+    /*!
+     * \brief Set the right hand side "b" of the linear system.
+     */
+    void setRhs(const Vector* b)
+    { b_ = b; }
+
+    const Ewoms::Linear::SolverReport& report() const
+    { return report_; }
+
+protected:
+    // start a new cycle: V_0 = r/|r|, Z_0 = K^-1 r/|r|, W_0 = A Z_0 and return |r|. the
+    // norm of the residual is reduced while the preconditioner and the linear operator
+    // are applied.
+    Scalar startCycle_(const Vector& r,
+                       std::vector<Vector>& V,
+                       std::vector<Vector>& Z,
+                       std::vector<Vector>& W)
+    {
+        scalarProduct_.startDots({{&r, &r}});
+        preconditioner_.apply(Z[0], r);
+        A_->apply(Z[0], W[0]);
+        Scalar beta = std::sqrt(scalarProduct_.finishDots()[0]);
+        if (beta <= 0.0)
+            return beta;
+
+        V[0] = r;
+        V[0] *= 1.0/beta;
+        Z[0] *= 1.0/beta;
+        W[0] *= 1.0/beta;
+        return beta;
+    }
+
+    // compute V_(i+1) by orthogonalizing W_i against the given basis vectors, the last
+    // i + 1 of which must be V_0 ... V_i, and return the norm of the orthogonalized
+    // vector. the coefficients are stored in coeffs. if the Krylov space is to be
+    // extended further, Z_(i+1) = (K^-1 W_i - sum_k h_k Z_k)/h_(i+1) and
+    // W_(i+1) = A Z_(i+1) are computed as well, where h_k are the coefficients with
+    // respect to V_k.
+    Scalar arnoldiStep_(const std::vector<const Vector*>& basis,
+                        std::vector<Vector>& V,
+                        std::vector<Vector>& Z,
+                        std::vector<Vector>& W,
+                        unsigned i,
+                        bool extendable,
+                        Scalar beta,
+                        std::vector<Scalar>& coeffs,
+                        bool& happyBreakdown)
+    {
+        V[i + 1] = W[i];
+        Scalar hNext =
+            orthogonalize_(basis, V[i + 1], coeffs,
+                           [&]() {
+                               if (extendable) {
+                                   preconditioner_.apply(Z[i + 1], W[i]);
+                                   A_->apply(Z[i + 1], W[i + 1]);
+                               }
+                           });
+
+        happyBreakdown = hNext <= std::numeric_limits<Scalar>::min()*1e10*beta;
+        if (happyBreakdown)
+            return hNext;
+
+        V[i + 1] *= 1.0/hNext;
+        if (extendable) {
+            unsigned offset = static_cast<unsigned>(basis.size()) - (i + 1);
+            for (unsigned k = 0; k <= i; ++k) {
+                Z[i + 1].axpy(-coeffs[offset + k], Z[k]);
+                W[i + 1].axpy(-coeffs[offset + k], W[k]);
+            }
+            Z[i + 1] *= 1.0/hNext;
+            W[i + 1] *= 1.0/hNext;
+        }
+
+        return hNext;
+    }
+
+    // orthogonalize w against the given basis vectors using classical Gram-Schmidt and
+    // return the norm of the result. All scalar products of a pass are computed using
+    // a single global reduction and the work of the first pass is done while it is in
+    // flight.
+    template <class Work>
+    Scalar orthogonalize_(const std::vector<const Vector*>& basis,
+                          Vector& w,
+                          std::vector<Scalar>& coeffs,
+                          const Work& work)
+    {
+        unsigned n = static_cast<unsigned>(basis.size());
+        coeffs.assign(n, 0.0);
+
+        Scalar hNextSquared = 0.0;
+        for (unsigned passIdx = 0; passIdx < 2; ++passIdx) {
+            std::vector<std::pair<const Vector*, const Vector*> > dotPairs;
+            for (unsigned k = 0; k < n; ++k)
+                dotPairs.emplace_back(basis[k], &w);
+            dotPairs.emplace_back(&w, &w);
+
+            scalarProduct_.startDots(dotPairs);
+            if (passIdx == 0)
+                work();
+            const auto& dots = scalarProduct_.finishDots();
+
+            Scalar wNormSquared = dots[n];
+            hNextSquared = wNormSquared;
+            for (unsigned k = 0; k < n; ++k) {
+                coeffs[k] += dots[k];
+                w.axpy(-dots[k], *basis[k]);
+                hNextSquared -= dots[k]*dots[k];
+            }
+
+            // the norm of the orthogonalized vector is computed using Pythagoras'
+            // theorem. if it is much smaller than the norm of the original vector,
+            // cancellation has occurred and the vector is orthogonalized again.
+            if (hNextSquared > 0.25*wNormSquared)
+                break;
+
+            if (passIdx == 1) {
+                // compute the norm explicitly
+                scalarProduct_.startDots({{&w, &w}});
+                hNextSquared = scalarProduct_.finishDots()[0];
+            }
+        }
+
+        return std::sqrt(std::max<Scalar>(hNextSquared, 0.0));
+    }
+
+    // apply the previous Givens rotations to the i-th column of the Hessenberg matrix,
+    // eliminate its subdiagonal entry and update the right hand side of the least
+    // squares problem. the estimated norm of the residual is returned.
+    Scalar applyGivensRotations_(std::vector<Scalar>& h,
+                                 unsigned i,
+                                 std::vector<Scalar>& cs,
+                                 std::vector<Scalar>& sn,
+                                 std::vector<Scalar>& g,
+                                 const std::string& solverName) const
+    {
+        for (unsigned k = 0; k < i; ++k) {
+            Scalar tmp = cs[k]*h[k] + sn[k]*h[k + 1];
+            h[k + 1] = -sn[k]*h[k] + cs[k]*h[k + 1];
+            h[k] = tmp;
+        }
+        Scalar denom = std::sqrt(h[i]*h[i] + h[i + 1]*h[i + 1]);
+        if (denom <= 0.0)
+            OPM_THROW(Opm::NumericalProblem,
+                      "Breakdown of the " << solverName << " solver (singular Hessenberg matrix)");
+        cs[i] = h[i]/denom;
+        sn[i] = h[i + 1]/denom;
+        h[i] = denom;
+        h[i + 1] = 0.0;
+
+        g[i + 1] = -sn[i]*g[i];
+        g[i] = cs[i]*g[i];
+
+        return std::abs(g[i + 1]);
+    }
+
+    // solve the upper triangular least squares system for the first m columns of the
+    // Hessenberg matrix, which is stored column-wise, and compute dx = Z y
+    void computeUpdate_(const std::vector<Vector>& Z,
+                        const std::vector<std::vector<Scalar> >& H,
+                        const std::vector<Scalar>& g,
+                        unsigned m,
+                        std::vector<Scalar>& y,
+                        Vector& dx) const
+    {
+        y.assign(g.begin(), g.begin() + m);
+        for (unsigned k = m; k > 0; --k) {
+            unsigned row = k - 1;
+            for (unsigned j = k; j < m; ++j)
+                y[row] -= H[j][row]*y[j];
+            y[row] /= H[row][row];
+        }
+
+        dx = 0.0;
+        for (unsigned k = 0; k < m; ++k)
+            dx.axpy(y[k], Z[k]);
+    }
+
+    const LinearOperator* A_;
+    const Vector* b_;
+
+    Preconditioner& preconditioner_;
+    ConvergenceCriterion& convergenceCriterion_;
+    ScalarProduct& scalarProduct_;
+    Ewoms::Linear::SolverReport report_;
+
+    unsigned maxIterations_;
+    unsigned restart_;
+    unsigned verbosity_;
+};
+
+} // namespace Linear
+} // namespace Ewoms
+
+#endif
@@ -39,6 +39,8 @@
  * - \c SOR: A successive overrelaxation (SOR) preconditioner
  * - \c ILUn: An ILU(n) preconditioner
  * - \c ILU0: A specialized (and optimized) ILU(0) preconditioner
+ * - \c ThreadedILU0: An ILU(0) preconditioner which uses multiple threads for the
+ *                   factorization and for the triangular solves
  */
 #ifndef EWOMS_ISTL_PRECONDITIONER_WRAPPERS_HH
 #define EWOMS_ISTL_PRECONDITIONER_WRAPPERS_HH
@@ -46,8 +48,15 @@
 #include <ewoms/common/propertysystem.hh>
 #include <ewoms/common/parametersystem.hh>
 
+#include <ewoms/linear/threadedilu0.hh>
+#include <ewoms/linear/mixedprecisionpreconditioner.hh>
+
 #include <dune/istl/preconditioners.hh>
 
+#include <memory>
+#include <type_traits>
+#include <utility>
+
 namespace Ewoms {
 namespace Properties {
 NEW_PROP_TAG(Scalar);
@@ -56,9 +65,36 @@ NEW_PROP_TAG(OverlappingMatrix);
 NEW_PROP_TAG(OverlappingVector);
 NEW_PROP_TAG(PreconditionerOrder);
 NEW_PROP_TAG(PreconditionerRelaxation);
+NEW_PROP_TAG(PreconditionerScalar);
 } // namespace Properties
 
 namespace Linear {
+// creates the sequential preconditioner. if it uses a lower precision than the linear
+// solver, the low-precision copy of the matrix is kept by the wrapper, so that only
+// its values need to be converted as long as the sparsity pattern does not change
+#define EWOMS_WRAP_ISTL_PRECONDITIONER_CREATE_(MATRIX_TYPE, ISTL_PREC_TYPE)     \
+        template <class ...Args>                                                \
+        SequentialPreconditioner* create_(std::false_type,                      \
+                                          MATRIX_TYPE& matrix,                  \
+                                          Args&&... args)                       \
+        { return new SequentialPreconditioner(matrix, std::forward<Args>(args)...); } \
+                                                                                \
+        template <class ...Args>                                                \
+        SequentialPreconditioner* create_(std::true_type,                       \
+                                          MATRIX_TYPE& matrix,                  \
+                                          Args&&... args)                       \
+        {                                                                       \
+            typedef ISTL_PREC_TYPE<LowPrecisionMatrix,                          \
+                                   LowPrecisionVector,                          \
+                                   LowPrecisionVector> LowPrecisionPreconditioner; \
+                                                                                \
+            copyMatrixPrecision(lowPrecMatrix_, matrix);                        \
+            std::unique_ptr<LowPrecisionPreconditioner>                         \
+                lowPrecPreCond(new LowPrecisionPreconditioner(lowPrecMatrix_,   \
+                                                              std::forward<Args>(args)...)); \
+            return new SequentialPreconditioner(std::move(lowPrecPreCond));     \
+        }
+
 #define EWOMS_WRAP_ISTL_PRECONDITIONER(PREC_NAME, ISTL_PREC_TYPE)               \
     template <class TypeTag>                                                    \
     class PreconditionerWrapper##PREC_NAME                                      \
@@ -66,10 +102,21 @@ namespace Linear {
         typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;                 \
         typedef typename GET_PROP_TYPE(TypeTag, JacobianMatrix) JacobianMatrix; \
         typedef typename GET_PROP_TYPE(TypeTag, OverlappingVector) OverlappingVector; \
+        typedef typename GET_PROP_TYPE(TypeTag, PreconditionerScalar) PreconditionerScalar; \
+        typedef MixedPrecisionTraits<JacobianMatrix, OverlappingVector,         \
+                                     PreconditionerScalar> PrecisionTraits;     \
+        typedef typename PrecisionTraits::LowPrecisionMatrix LowPrecisionMatrix; \
+        typedef typename PrecisionTraits::LowPrecisionVector LowPrecisionVector; \
                                                                                 \
     public:                                                                     \
-        typedef ISTL_PREC_TYPE<JacobianMatrix, OverlappingVector,               \
-                               OverlappingVector> SequentialPreconditioner;     \
+        typedef typename std::conditional<                                      \
+            PrecisionTraits::isMixed,                                           \
+            MixedPrecisionPreconditioner<ISTL_PREC_TYPE<LowPrecisionMatrix,     \
+                                                        LowPrecisionVector,     \
+                                                        LowPrecisionVector>,    \
+                                         OverlappingVector>,                    \
+            ISTL_PREC_TYPE<JacobianMatrix, OverlappingVector, OverlappingVector> \
+            >::type SequentialPreconditioner;                                   \
         PreconditionerWrapper##PREC_NAME()                                      \
         {}                                                                      \
                                                                                 \
@@ -86,8 +133,8 @@ namespace Linear {
         {                                                                       \
             int order = EWOMS_GET_PARAM(TypeTag, int, PreconditionerOrder);     \
             Scalar relaxationFactor = EWOMS_GET_PARAM(TypeTag, Scalar, PreconditionerRelaxation);   \
-            seqPreCond_ = new SequentialPreconditioner(matrix, order,           \
-                                                       relaxationFactor);       \
+            seqPreCond_ = create_(std::integral_constant<bool, PrecisionTraits::isMixed>(), \
+                                  matrix, order, relaxationFactor);             \
         }                                                                       \
                                                                                 \
         SequentialPreconditioner& get()                                         \
@@ -97,7 +144,10 @@ namespace Linear {
         { delete seqPreCond_; }                                                 \
                                                                                 \
     private:                                                                    \
+        EWOMS_WRAP_ISTL_PRECONDITIONER_CREATE_(JacobianMatrix, ISTL_PREC_TYPE)  \
+                                                                                \
         SequentialPreconditioner *seqPreCond_;                                  \
+        LowPrecisionMatrix lowPrecMatrix_;                                      \
     };
 
 // the same as the EWOMS_WRAP_ISTL_PRECONDITIONER macro, but without
@@ -109,10 +159,21 @@ namespace Linear {
         typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;                 \
         typedef typename GET_PROP_TYPE(TypeTag, OverlappingMatrix) OverlappingMatrix; \
         typedef typename GET_PROP_TYPE(TypeTag, OverlappingVector) OverlappingVector; \
+        typedef typename GET_PROP_TYPE(TypeTag, PreconditionerScalar) PreconditionerScalar; \
+        typedef MixedPrecisionTraits<OverlappingMatrix, OverlappingVector,      \
+                                     PreconditionerScalar> PrecisionTraits;     \
+        typedef typename PrecisionTraits::LowPrecisionMatrix LowPrecisionMatrix; \
+        typedef typename PrecisionTraits::LowPrecisionVector LowPrecisionVector; \
                                                                                 \
     public:                                                                     \
-        typedef ISTL_PREC_TYPE<OverlappingMatrix, OverlappingVector,            \
-                               OverlappingVector> SequentialPreconditioner;     \
+        typedef typename std::conditional<                                      \
+            PrecisionTraits::isMixed,                                           \
+            MixedPrecisionPreconditioner<ISTL_PREC_TYPE<LowPrecisionMatrix,     \
+                                                        LowPrecisionVector,     \
+                                                        LowPrecisionVector>,    \
+                                         OverlappingVector>,                    \
+            ISTL_PREC_TYPE<OverlappingMatrix, OverlappingVector, OverlappingVector> \
+            >::type SequentialPreconditioner;                                   \
         PreconditionerWrapper##PREC_NAME()                                      \
         {}                                                                      \
                                                                                 \
@@ -127,8 +188,8 @@ namespace Linear {
         {                                                                       \
             Scalar relaxationFactor =                                           \
                 EWOMS_GET_PARAM(TypeTag, Scalar, PreconditionerRelaxation);     \
-            seqPreCond_ = new SequentialPreconditioner(matrix,                  \
-                                                       relaxationFactor);       \
+            seqPreCond_ = create_(std::integral_constant<bool, PrecisionTraits::isMixed>(), \
+                                  matrix, relaxationFactor);                    \
         }                                                                       \
                                                                                 \
         SequentialPreconditioner& get()                                         \
@@ -138,7 +199,10 @@ namespace Linear {
         { delete seqPreCond_; }                                                 \
                                                                                 \
     private:                                                                    \
+        EWOMS_WRAP_ISTL_PRECONDITIONER_CREATE_(OverlappingMatrix, ISTL_PREC_TYPE) \
+                                                                                \
         SequentialPreconditioner *seqPreCond_;                                  \
+        LowPrecisionMatrix lowPrecMatrix_;                                      \
     };
 
 EWOMS_WRAP_ISTL_PRECONDITIONER(Jacobi, Dune::SeqJac)
@@ -147,9 +211,11 @@ EWOMS_WRAP_ISTL_PRECONDITIONER(GaussSeidel, Dune::SeqGS)
 EWOMS_WRAP_ISTL_PRECONDITIONER(SOR, Dune::SeqSOR)
 EWOMS_WRAP_ISTL_PRECONDITIONER(SSOR, Dune::SeqSSOR)
 EWOMS_WRAP_ISTL_SIMPLE_PRECONDITIONER(ILU0, Dune::SeqILU0)
+EWOMS_WRAP_ISTL_SIMPLE_PRECONDITIONER(ThreadedILU0, Ewoms::Linear::ThreadedILU0)
 EWOMS_WRAP_ISTL_PRECONDITIONER(ILUn, Dune::SeqILUn)
 
 #undef EWOMS_WRAP_ISTL_PRECONDITIONER
+#undef EWOMS_WRAP_ISTL_PRECONDITIONER_CREATE_
 }} // namespace Linear, Ewoms
 
 #endif
@@ -0,0 +1,275 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \brief Provides functions to write linear systems of equations to disk and to read
+ *        them back.
+ */
+#ifndef EWOMS_LINEAR_SYSTEM_IO_HH
+#define EWOMS_LINEAR_SYSTEM_IO_HH
+
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
+#include <dune/istl/matrixmarket.hh>
+
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace Ewoms {
+namespace Linear {
+
+/*!
+ * \brief Describes how the rows of a linear system are distributed over the processes.
+ */
+struct LinearSystemLayout
+{
+    LinearSystemLayout()
+        : rank(0), commSize(1)
+    {}
+
+    //! The rank of the process which wrote the linear system
+    int rank;
+
+    //! The number of processes of the simulation
+    int commSize;
+
+    //! Specifies for each row if the process is its owner (1) or not (0)
+    std::vector<unsigned char> isOwned;
+};
+
+/*!
+ * \brief Write a linear system of equations in the binary block format.
+ *
+ * The file contains a header (magic string, format version, block size, layout
+ * information and sizes), followed by the compressed row storage of the matrix and
+ * the right hand side. All floating point values are stored with double precision,
+ * all values use the byte order of the machine which wrote the file.
+ */
+template <class Matrix, class Vector>
+void writeLinearSystem(const std::string& fileName,
+                       const Matrix& A,
+                       const Vector& b,
+                       const LinearSystemLayout& layout)
+{
+    typedef typename Matrix::block_type MatrixBlock;
+    static const uint32_t blockSize = MatrixBlock::rows;
+
+    std::ofstream os(fileName, std::ios::binary);
+    if (!os)
+        OPM_THROW(std::runtime_error, "Could not open file '" << fileName << "' for writing");
+
+    auto write = [&os](const void* data, size_t size)
+    { os.write(static_cast<const char*>(data), static_cast<std::streamsize>(size)); };
+
+    const uint32_t version = 1;
+    const int32_t rank = layout.rank;
+    const int32_t commSize = layout.commSize;
+    const uint64_t numRows = A.N();
+    const uint64_t numNonzeros = A.nonzeroes();
+    write("EWLS", 4);
+    write(&version, sizeof(version));
+    write(&blockSize, sizeof(blockSize));
+    write(&rank, sizeof(rank));
+    write(&commSize, sizeof(commSize));
+    write(&numRows, sizeof(numRows));
+    write(&numNonzeros, sizeof(numNonzeros));
+
+    std::vector<uint64_t> rowStart(numRows + 1, 0);
+    std::vector<uint32_t> colIndices;
+    std::vector<double> values;
+    colIndices.reserve(numNonzeros);
+    values.reserve(numNonzeros*blockSize*blockSize);
+    for (size_t rowIdx = 0; rowIdx < numRows; ++rowIdx) {
+        const auto& row = A[rowIdx];
+        for (auto colIt = row.begin(); colIt != row.end(); ++colIt) {
+            colIndices.push_back(static_cast<uint32_t>(colIt.index()));
+            for (unsigned i = 0; i < blockSize; ++i)
+                for (unsigned j = 0; j < blockSize; ++j)
+                    values.push_back(static_cast<double>((*colIt)[i][j]));
+        }
+        rowStart[rowIdx + 1] = colIndices.size();
+    }
+    write(rowStart.data(), rowStart.size()*sizeof(uint64_t));
+    write(colIndices.data(), colIndices.size()*sizeof(uint32_t));
+    write(values.data(), values.size()*sizeof(double));
+
+    std::vector<double> rhs;
+    rhs.reserve(numRows*blockSize);
+    for (size_t rowIdx = 0; rowIdx < numRows; ++rowIdx)
+        for (unsigned i = 0; i < blockSize; ++i)
+            rhs.push_back(static_cast<double>(b[rowIdx][i]));
+    write(rhs.data(), rhs.size()*sizeof(double));
+
+    std::vector<unsigned char> isOwned(layout.isOwned);
+    isOwned.resize(numRows, 1);
+    write(isOwned.data(), isOwned.size());
+
+    if (!os)
+        OPM_THROW(std::runtime_error, "Could not write the linear system to '" << fileName << "'");
+}
+
+/*!
+ * \brief Returns the block size of a linear system stored in the binary block format.
+ */
+inline unsigned readLinearSystemBlockSize(const std::string& fileName)
+{
+    std::ifstream is(fileName, std::ios::binary);
+    char magic[4];
+    uint32_t version, blockSize;
+    is.read(magic, 4);
+    is.read(reinterpret_cast<char*>(&version), sizeof(version));
+    is.read(reinterpret_cast<char*>(&blockSize), sizeof(blockSize));
+    if (!is || std::string(magic, 4) != "EWLS" || version != 1)
+        OPM_THROW(std::runtime_error, "File '" << fileName << "' is not a linear system file");
+    return blockSize;
+}
+
+/*!
+ * \brief Read a linear system of equations written by writeLinearSystem().
+ */
+template <class Matrix, class Vector>
+void readLinearSystem(const std::string& fileName,
+                      Matrix& A,
+                      Vector& b,
+                      LinearSystemLayout& layout)
+{
+    typedef typename Matrix::block_type MatrixBlock;
+    static const uint32_t expectedBlockSize = MatrixBlock::rows;
+
+    if (readLinearSystemBlockSize(fileName) != expectedBlockSize)
+        OPM_THROW(std::runtime_error,
+                  "The block size of the linear system in '" << fileName << "' is not "
+                  << expectedBlockSize);
+
+    std::ifstream is(fileName, std::ios::binary | std::ios::ate);
+    const uint64_t fileSize = static_cast<uint64_t>(is.tellg());
+    is.seekg(0);
+    auto read = [&is](void* data, size_t size)
+    { is.read(static_cast<char*>(data), static_cast<std::streamsize>(size)); };
+
+    char magic[4];
+    uint32_t version, blockSize;
+    int32_t rank, commSize;
+    uint64_t numRows, numNonzeros;
+    read(magic, 4);
+    read(&version, sizeof(version));
+    read(&blockSize, sizeof(blockSize));
+    read(&rank, sizeof(rank));
+    read(&commSize, sizeof(commSize));
+    read(&numRows, sizeof(numRows));
+    read(&numNonzeros, sizeof(numNonzeros));
+    if (!is)
+        OPM_THROW(std::runtime_error, "File '" << fileName << "' is truncated");
+
+    // make sure that the sizes specified by the header match the length of the file
+    // before anything is allocated. each row and each non-zero block requires at
+    // least one byte, so the products below cannot overflow if this holds.
+    const uint64_t headerSize =
+        4 + sizeof(version) + sizeof(blockSize) + sizeof(rank) + sizeof(commSize)
+        + sizeof(numRows) + sizeof(numNonzeros);
+    if (numRows > fileSize || numNonzeros > fileSize
+        || fileSize != headerSize
+                       + (numRows + 1)*sizeof(uint64_t)
+                       + numNonzeros*sizeof(uint32_t)
+                       + numNonzeros*blockSize*blockSize*sizeof(double)
+                       + numRows*blockSize*sizeof(double)
+                       + numRows)
+        OPM_THROW(std::runtime_error,
+                  "The sizes specified by the header of '" << fileName << "' do not "
+                  "match the length of the file");
+
+    layout.rank = rank;
+    layout.commSize = commSize;
+
+    std::vector<uint64_t> rowStart(numRows + 1);
+    std::vector<uint32_t> colIndices(numNonzeros);
+    std::vector<double> values(numNonzeros*blockSize*blockSize);
+    read(rowStart.data(), rowStart.size()*sizeof(uint64_t));
+    read(colIndices.data(), colIndices.size()*sizeof(uint32_t));
+    read(values.data(), values.size()*sizeof(double));
+
+    if (rowStart[0] != 0 || rowStart[numRows] != numNonzeros)
+        OPM_THROW(std::runtime_error, "File '" << fileName << "' is corrupted");
+    for (size_t rowIdx = 0; rowIdx < numRows; ++rowIdx)
+        if (rowStart[rowIdx] > rowStart[rowIdx + 1])
+            OPM_THROW(std::runtime_error, "File '" << fileName << "' is corrupted");
+    for (uint32_t colIdx : colIndices)
+        if (colIdx >= numRows)
+            OPM_THROW(std::runtime_error, "File '" << fileName << "' is corrupted");
+
+    // the matrix must not have been allocated before
+    A.setBuildMode(Matrix::row_wise);
+    A.setSize(numRows, numRows, numNonzeros);
+    for (auto rowIt = A.createbegin(); rowIt != A.createend(); ++rowIt) {
+        size_t rowIdx = rowIt.index();
+        for (uint64_t k = rowStart[rowIdx]; k < rowStart[rowIdx + 1]; ++k)
+            rowIt.insert(colIndices[k]);
+    }
+
+    const double* value = values.data();
+    for (size_t rowIdx = 0; rowIdx < numRows; ++rowIdx) {
+        auto colIt = A[rowIdx].begin();
+        for (uint64_t k = rowStart[rowIdx]; k < rowStart[rowIdx + 1]; ++k, ++colIt)
+            for (unsigned i = 0; i < blockSize; ++i)
+                for (unsigned j = 0; j < blockSize; ++j)
+                    (*colIt)[i][j] = *value++;
+    }
+
+    std::vector<double> rhs(numRows*blockSize);
+    read(rhs.data(), rhs.size()*sizeof(double));
+    b.resize(numRows);
+    for (size_t rowIdx = 0; rowIdx < numRows; ++rowIdx)
+        for (unsigned i = 0; i < blockSize; ++i)
+            b[rowIdx][i] = rhs[rowIdx*blockSize + i];
+
+    layout.isOwned.resize(numRows);
+    read(layout.isOwned.data(), numRows);
+
+    if (!is)
+        OPM_THROW(std::runtime_error, "File '" << fileName << "' is truncated");
+}
+
+/*!
+ * \brief Write a linear system of equations in the Matrix Market format.
+ *
+ * The matrix is written to '$BASENAME_matrix.mm', the right hand side to
+ * '$BASENAME_rhs.mm'.
+ */
+template <class Matrix, class Vector>
+void writeLinearSystemMatrixMarket(const std::string& baseName,
+                                   const Matrix& A,
+                                   const Vector& b)
+{
+    Dune::storeMatrixMarket(A, baseName + "_matrix.mm");
+    Dune::storeMatrixMarket(b, baseName + "_rhs.mm");
+}
+
+} // namespace Linear
+} // namespace Ewoms
+
+#endif
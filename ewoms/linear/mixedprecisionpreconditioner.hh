@@ -0,0 +1,227 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::Linear::MixedPrecisionPreconditioner
+ */
+#ifndef EWOMS_MIXED_PRECISION_PRECONDITIONER_HH
+#define EWOMS_MIXED_PRECISION_PRECONDITIONER_HH
+
+#include <dune/istl/preconditioner.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/common/version.hh>
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace Ewoms {
+namespace Linear {
+
+namespace detail {
+// copy the values of a BCRS matrix to a matrix with the same sparsity pattern but
+// different entries. if the patterns differ, false is returned.
+template <class DestMatrix, class SrcMatrix>
+bool copyMatrixValues(DestMatrix& dest, const SrcMatrix& src)
+{
+    if (dest.N() != src.N() || dest.nonzeroes() != src.nonzeroes())
+        return false;
+
+    auto destRowIt = dest.begin();
+    const auto& srcRowEndIt = src.end();
+    for (auto srcRowIt = src.begin(); srcRowIt != srcRowEndIt; ++srcRowIt, ++destRowIt) {
+        if (destRowIt->size() != srcRowIt->size())
+            return false;
+
+        auto destColIt = destRowIt->begin();
+        const auto& srcColEndIt = srcRowIt->end();
+        for (auto srcColIt = srcRowIt->begin(); srcColIt != srcColEndIt; ++srcColIt, ++destColIt) {
+            if (destColIt.index() != srcColIt.index())
+                return false;
+
+            const auto& srcBlock = *srcColIt;
+            auto& destBlock = *destColIt;
+            for (unsigned i = 0; i < srcBlock.rows; ++i)
+                for (unsigned j = 0; j < srcBlock.cols; ++j)
+                    destBlock[i][j] = srcBlock[i][j];
+        }
+    }
+
+    return true;
+}
+} // namespace detail
+
+/*!
+ * \brief Copy the values of a BCRS matrix to a matrix which uses a different
+ *        floating point type for its entries.
+ *
+ * The sparsity pattern of the destination matrix is only recreated if it does not
+ * match the one of the source matrix. Since the column indices are compared while
+ * the values are copied, this is almost free if the destination matrix is reused.
+ */
+template <class DestMatrix, class SrcMatrix>
+void copyMatrixPrecision(DestMatrix& dest, const SrcMatrix& src)
+{
+    if (detail::copyMatrixValues(dest, src))
+        return;
+
+    dest = DestMatrix(src.N(), src.M(), src.nonzeroes(), DestMatrix::row_wise);
+
+    auto srcRowIt = src.begin();
+    for (auto destRowIt = dest.createbegin();
+         destRowIt != dest.createend();
+         ++destRowIt, ++srcRowIt)
+    {
+        const auto& colEndIt = srcRowIt->end();
+        for (auto colIt = srcRowIt->begin(); colIt != colEndIt; ++colIt)
+            destRowIt.insert(colIt.index());
+    }
+
+    detail::copyMatrixValues(dest, src);
+}
+
+/*!
+ * \brief Specifies the types which are used by a preconditioner that stores its data
+ *        using a different floating point type than the linear solver.
+ */
+template <class Matrix, class Vector, class PreconditionerScalar>
+struct MixedPrecisionTraits
+{
+    typedef typename Matrix::block_type MatrixBlock;
+    typedef typename Vector::block_type VectorBlock;
+
+    typedef Dune::FieldMatrix<PreconditionerScalar,
+                              MatrixBlock::rows,
+                              MatrixBlock::cols> LowPrecisionMatrixBlock;
+    typedef Dune::FieldVector<PreconditionerScalar,
+                              VectorBlock::dimension> LowPrecisionVectorBlock;
+
+    typedef Dune::BCRSMatrix<LowPrecisionMatrixBlock> LowPrecisionMatrix;
+    typedef Dune::BlockVector<LowPrecisionVectorBlock> LowPrecisionVector;
+
+    //! Specifies whether the precision of the preconditioner differs from the one of
+    //! the linear solver
+    static constexpr bool isMixed =
+        !std::is_same<PreconditionerScalar, typename Vector::field_type>::value;
+};
+
+/*!
+ * \brief Uses a preconditioner which works on a lower precision floating point type
+ *        for a linear solver which operates on higher precision vectors.
+ *
+ * The defect is converted to the precision of the preconditioner and the resulting
+ * correction is converted back. Since the application of the preconditioner is
+ * usually limited by memory bandwidth, storing its data (e.g., the ILU factors or the
+ * AMG hierarchy) in single precision roughly halves its cost while the Krylov solver
+ * and the linear operator still compute the residual in full precision.
+ *
+ * The low-precision preconditioner can either be owned by the adapter or it can be
+ * managed externally. In both cases, the low-precision copy of the matrix which it
+ * operates on is managed by the caller, so that it can be kept across linear solves
+ * (cf. copyMatrixPrecision()).
+ */
+template <class LowPrecisionPreconditioner, class Vector>
+class MixedPrecisionPreconditioner
+    : public Dune::Preconditioner<Vector, Vector>
+{
+    typedef typename LowPrecisionPreconditioner::domain_type LowPrecisionVector;
+
+public:
+    typedef Vector domain_type;
+    typedef Vector range_type;
+    typedef typename Vector::field_type field_type;
+
+#if DUNE_VERSION_NEWER(DUNE_ISTL, 2,6)
+    //! the kind of computations supported by the operator. Either overlapping or non-overlapping
+    Dune::SolverCategory::Category category() const override
+    { return lowPrecPreCond_->category(); }
+#else
+    // redefine the category
+    enum { category = LowPrecisionPreconditioner::category };
+#endif
+
+    /*!
+     * \brief Take the ownership of a low-precision preconditioner.
+     */
+    explicit MixedPrecisionPreconditioner(std::unique_ptr<LowPrecisionPreconditioner> lowPrecPreCond)
+        : ownedPreCond_(std::move(lowPrecPreCond))
+        , lowPrecPreCond_(ownedPreCond_.get())
+    {}
+
+    /*!
+     * \brief Use an externally managed low-precision preconditioner.
+     */
+    MixedPrecisionPreconditioner(LowPrecisionPreconditioner& lowPrecPreCond)
+        : lowPrecPreCond_(&lowPrecPreCond)
+    {}
+
+    void pre(domain_type& x, range_type& b) override
+    {
+        convert_(x, lowPrecX_);
+        convert_(b, lowPrecB_);
+        lowPrecPreCond_->pre(lowPrecX_, lowPrecB_);
+    }
+
+    void apply(domain_type& v, const range_type& d) override
+    {
+        convert_(d, lowPrecB_);
+        lowPrecX_.resize(lowPrecB_.size());
+        lowPrecX_ = 0.0;
+
+        lowPrecPreCond_->apply(lowPrecX_, lowPrecB_);
+
+        convert_(lowPrecX_, v);
+    }
+
+    void post(domain_type& x) override
+    {
+        convert_(x, lowPrecX_);
+        lowPrecPreCond_->post(lowPrecX_);
+    }
+
+private:
+    template <class DestVector, class SrcVector>
+    static void convert_(const SrcVector& src, DestVector& dest)
+    {
+        if (dest.size() != src.size())
+            dest.resize(src.size());
+
+        for (unsigned i = 0; i < src.size(); ++i)
+            for (unsigned j = 0; j < src[i].size(); ++j)
+                dest[i][j] = src[i][j];
+    }
+
+    std::unique_ptr<LowPrecisionPreconditioner> ownedPreCond_;
+    LowPrecisionPreconditioner* lowPrecPreCond_;
+
+    LowPrecisionVector lowPrecX_;
+    LowPrecisionVector lowPrecB_;
+};
+
+} // namespace Linear
+} // namespace Ewoms
+
+#endif
@@ -0,0 +1,348 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::Linear::OverlapExchange
+ */
+#ifndef EWOMS_OVERLAP_EXCHANGE_HH
+#define EWOMS_OVERLAP_EXCHANGE_HH
+
+#include "overlaptypes.hh"
+
+#if HAVE_MPI
+#include <mpi.h>
+#endif
+
+#include <cassert>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace Ewoms {
+namespace Linear {
+
+/*!
+ * \brief Exchanges the values of the overlap of block vectors between processes.
+ *
+ * All data structures which are required for the communication are set up once per
+ * overlap: The values are packed into and unpacked from contiguous buffers using
+ * precomputed index lists, and persistent MPI requests for all peer processes are
+ * created on a private duplicate of the communicator. Each exchange thus only needs
+ * to start the persistent requests. When the values are obtained from the master
+ * process of the respective degrees of freedom, the incoming messages are processed
+ * in the order of their arrival. When values are added up, all messages are received
+ * first and are then processed in a fixed order to keep the results reproducible.
+ *
+ * Only a single exchange can be in progress at any time, but starting and finishing
+ * it are separate steps, so computations which do not depend on the overlap can be
+ * done while the messages are in flight.
+ */
+template <class FieldVector, class Overlap>
+class OverlapExchange
+{
+public:
+    /*!
+     * \brief Specifies how the received values are combined with the local ones.
+     */
+    enum Mode {
+        //! use the value of the master process of each degree of freedom
+        FromMaster,
+        //! add up the values of all processes
+        Add,
+        //! add up the values of the border, use the master's value for the remaining ones
+        AddBorder
+    };
+
+    OverlapExchange(const Overlap& overlap)
+    {
+        inProgress_ = false;
+#if HAVE_MPI
+        comm_ = MPI_COMM_NULL;
+        setup_(overlap);
+#endif // HAVE_MPI
+    }
+
+    OverlapExchange(const OverlapExchange&) = delete;
+    OverlapExchange& operator=(const OverlapExchange&) = delete;
+
+    ~OverlapExchange()
+    {
+#if HAVE_MPI
+        int finalized;
+        MPI_Finalized(&finalized);
+        if (finalized)
+            return;
+
+        for (auto& request : sendRequests_)
+            MPI_Request_free(&request);
+        for (auto& request : recvRequests_)
+            MPI_Request_free(&request);
+        if (comm_ != MPI_COMM_NULL)
+            MPI_Comm_free(&comm_);
+#endif // HAVE_MPI
+    }
+
+    /*!
+     * \brief Return the number of peer processes.
+     */
+    size_t numPeers() const
+    { return peerRanks_.size(); }
+
+    /*!
+     * \brief Return true if an exchange has been started but not yet finished.
+     */
+    bool inProgress() const
+    { return inProgress_; }
+
+    /*!
+     * \brief Copy the values which are required by the peers into the send buffers
+     *        and start all send and receive operations.
+     */
+    template <class BlockVector>
+    void start(const BlockVector& v)
+    {
+        assert(!inProgress_);
+        inProgress_ = true;
+
+#if HAVE_MPI
+        if (peerRanks_.empty())
+            return;
+
+        for (size_t i = 0; i < sendIndices_.size(); ++i)
+            sendValues_[i] = v[static_cast<unsigned>(sendIndices_[i])];
+
+        MPI_Startall(static_cast<int>(recvRequests_.size()), recvRequests_.data());
+        MPI_Startall(static_cast<int>(sendRequests_.size()), sendRequests_.data());
+#endif // HAVE_MPI
+    }
+
+    /*!
+     * \brief Wait for the values of the peers, merge them into a vector and wait
+     *        until the send operations are completed.
+     */
+    template <class BlockVector>
+    void finish(BlockVector& v, Mode mode)
+    {
+        assert(inProgress_);
+        inProgress_ = false;
+
+#if HAVE_MPI
+        if (peerRanks_.empty())
+            return;
+
+        int numPeers = static_cast<int>(peerRanks_.size());
+        if (mode == FromMaster) {
+            // every value is assigned by at most a single peer, so the messages can be
+            // processed in any order
+            for (int i = 0; i < numPeers; ++i) {
+                int peerIdx;
+                MPI_Waitany(numPeers, recvRequests_.data(), &peerIdx, MPI_STATUS_IGNORE);
+                unpack_(v, peerIdx, masterOffsets_, masterPos_, /*add=*/false);
+            }
+        }
+        else {
+            MPI_Waitall(numPeers, recvRequests_.data(), MPI_STATUSES_IGNORE);
+            for (int peerIdx = 0; peerIdx < numPeers; ++peerIdx) {
+                if (mode == Add)
+                    unpackAll_(v, peerIdx);
+                else {
+                    unpack_(v, peerIdx, nonBorderOffsets_, nonBorderPos_, /*add=*/false);
+                    unpack_(v, peerIdx, borderOffsets_, borderPos_, /*add=*/true);
+                }
+            }
+        }
+
+        MPI_Waitall(numPeers, sendRequests_.data(), MPI_STATUSES_IGNORE);
+#endif // HAVE_MPI
+    }
+
+    /*!
+     * \brief Exchange the values of a vector in a single step.
+     */
+    template <class BlockVector>
+    void exchange(BlockVector& v, Mode mode)
+    {
+        start(v);
+        finish(v, mode);
+    }
+
+private:
+#if HAVE_MPI
+    void setup_(const Overlap& overlap)
+    {
+        // the communication of the overlap uses its own communicator, so it cannot
+        // interfere with any other messages
+        MPI_Comm_dup(overlap.communicator(), &comm_);
+
+        for (const auto& peerRank : overlap.peerSet())
+            peerRanks_.push_back(peerRank);
+        int numPeers = static_cast<int>(peerRanks_.size());
+
+        // exchange the number of values which are sent to each peer
+        std::vector<int> numSend(peerRanks_.size());
+        std::vector<int> numRecv(peerRanks_.size());
+        std::vector<MPI_Request> requests(2*peerRanks_.size());
+        for (int peerIdx = 0; peerIdx < numPeers; ++peerIdx) {
+            int peerRank = static_cast<int>(peerRanks_[peerIdx]);
+            numSend[peerIdx] = static_cast<int>(overlap.foreignOverlapSize(peerRanks_[peerIdx]));
+            MPI_Irecv(&numRecv[peerIdx], 1, MPI_INT, peerRank, /*tag=*/0, comm_,
+                      &requests[peerIdx]);
+            MPI_Isend(&numSend[peerIdx], 1, MPI_INT, peerRank, /*tag=*/0, comm_,
+                      &requests[numPeers + peerIdx]);
+        }
+        MPI_Waitall(2*numPeers, requests.data(), MPI_STATUSES_IGNORE);
+
+        sendOffsets_.resize(peerRanks_.size() + 1, 0);
+        recvOffsets_.resize(peerRanks_.size() + 1, 0);
+        for (int peerIdx = 0; peerIdx < numPeers; ++peerIdx) {
+            sendOffsets_[peerIdx + 1] = sendOffsets_[peerIdx] + static_cast<size_t>(numSend[peerIdx]);
+            recvOffsets_[peerIdx + 1] = recvOffsets_[peerIdx] + static_cast<size_t>(numRecv[peerIdx]);
+        }
+
+        // the domestic indices of the values which are sent to the peers and the
+        // corresponding global indices
+        sendIndices_.resize(sendOffsets_.back());
+        std::vector<Index> sendGlobalIndices(sendOffsets_.back());
+        for (int peerIdx = 0; peerIdx < numPeers; ++peerIdx) {
+            size_t n = sendOffsets_[peerIdx + 1] - sendOffsets_[peerIdx];
+            for (unsigned i = 0; i < n; ++i) {
+                size_t pos = sendOffsets_[peerIdx] + i;
+                sendIndices_[pos] = overlap.foreignOverlapOffsetToDomesticIdx(peerRanks_[peerIdx], i);
+                sendGlobalIndices[pos] = overlap.domesticToGlobal(sendIndices_[pos]);
+            }
+        }
+
+        // tell the peers which values they will receive
+        std::vector<Index> recvGlobalIndices(recvOffsets_.back());
+        for (int peerIdx = 0; peerIdx < numPeers; ++peerIdx) {
+            int peerRank = static_cast<int>(peerRanks_[peerIdx]);
+            MPI_Irecv(recvGlobalIndices.data() + recvOffsets_[peerIdx],
+                      numBytes_<Index>(recvOffsets_, peerIdx), MPI_BYTE,
+                      peerRank, /*tag=*/0, comm_, &requests[peerIdx]);
+            MPI_Isend(sendGlobalIndices.data() + sendOffsets_[peerIdx],
+                      numBytes_<Index>(sendOffsets_, peerIdx), MPI_BYTE,
+                      peerRank, /*tag=*/0, comm_, &requests[numPeers + peerIdx]);
+        }
+        MPI_Waitall(2*numPeers, requests.data(), MPI_STATUSES_IGNORE);
+
+        // create the lists of the received values which are assigned or added to the
+        // vector. they are stored as pairs of (buffer position, domestic index)
+        recvIndices_.resize(recvOffsets_.back());
+        masterOffsets_.push_back(0);
+        borderOffsets_.push_back(0);
+        nonBorderOffsets_.push_back(0);
+        for (int peerIdx = 0; peerIdx < numPeers; ++peerIdx) {
+            ProcessRank peerRank = peerRanks_[peerIdx];
+            for (size_t pos = recvOffsets_[peerIdx]; pos < recvOffsets_[peerIdx + 1]; ++pos) {
+                Index domesticIdx = overlap.globalToDomestic(recvGlobalIndices[pos]);
+                recvIndices_[pos] = domesticIdx;
+
+                if (overlap.masterRank(domesticIdx) == peerRank)
+                    masterPos_.emplace_back(pos, domesticIdx);
+
+                if (overlap.isBorderWith(domesticIdx, peerRank))
+                    borderPos_.emplace_back(pos, domesticIdx);
+                else
+                    nonBorderPos_.emplace_back(pos, domesticIdx);
+            }
+            masterOffsets_.push_back(masterPos_.size());
+            borderOffsets_.push_back(borderPos_.size());
+            nonBorderOffsets_.push_back(nonBorderPos_.size());
+        }
+
+        // create the persistent requests for the values
+        sendValues_.resize(sendOffsets_.back());
+        recvValues_.resize(recvOffsets_.back());
+        sendRequests_.resize(peerRanks_.size());
+        recvRequests_.resize(peerRanks_.size());
+        for (int peerIdx = 0; peerIdx < numPeers; ++peerIdx) {
+            int peerRank = static_cast<int>(peerRanks_[peerIdx]);
+            MPI_Send_init(sendValues_.data() + sendOffsets_[peerIdx],
+                          numBytes_<FieldVector>(sendOffsets_, peerIdx), MPI_BYTE,
+                          peerRank, /*tag=*/1, comm_, &sendRequests_[peerIdx]);
+            MPI_Recv_init(recvValues_.data() + recvOffsets_[peerIdx],
+                          numBytes_<FieldVector>(recvOffsets_, peerIdx), MPI_BYTE,
+                          peerRank, /*tag=*/1, comm_, &recvRequests_[peerIdx]);
+        }
+    }
+
+    template <class T>
+    static int numBytes_(const std::vector<size_t>& offsets, int peerIdx)
+    { return static_cast<int>((offsets[peerIdx + 1] - offsets[peerIdx])*sizeof(T)); }
+
+    template <class BlockVector>
+    void unpack_(BlockVector& v,
+                 int peerIdx,
+                 const std::vector<size_t>& offsets,
+                 const std::vector<std::pair<size_t, Index> >& entries,
+                 bool add) const
+    {
+        if (add) {
+            for (size_t i = offsets[peerIdx]; i < offsets[peerIdx + 1]; ++i)
+                v[static_cast<unsigned>(entries[i].second)] += recvValues_[entries[i].first];
+        }
+        else {
+            for (size_t i = offsets[peerIdx]; i < offsets[peerIdx + 1]; ++i)
+                v[static_cast<unsigned>(entries[i].second)] = recvValues_[entries[i].first];
+        }
+    }
+
+    template <class BlockVector>
+    void unpackAll_(BlockVector& v, int peerIdx) const
+    {
+        for (size_t pos = recvOffsets_[peerIdx]; pos < recvOffsets_[peerIdx + 1]; ++pos)
+            v[static_cast<unsigned>(recvIndices_[pos])] += recvValues_[pos];
+    }
+
+    MPI_Comm comm_;
+    std::vector<MPI_Request> sendRequests_;
+    std::vector<MPI_Request> recvRequests_;
+#endif // HAVE_MPI
+
+    std::vector<ProcessRank> peerRanks_;
+
+    // the values which are sent to peer i are stored at positions
+    // [sendOffsets_[i], sendOffsets_[i + 1]) of the send buffer. (the same applies
+    // to the receive buffer.)
+    std::vector<size_t> sendOffsets_;
+    std::vector<size_t> recvOffsets_;
+    std::vector<Index> sendIndices_;
+    std::vector<Index> recvIndices_;
+    std::vector<FieldVector> sendValues_;
+    std::vector<FieldVector> recvValues_;
+
+    // the received values which are merged into the vector by the respective modes
+    std::vector<size_t> masterOffsets_;
+    std::vector<std::pair<size_t, Index> > masterPos_;
+    std::vector<size_t> borderOffsets_;
+    std::vector<std::pair<size_t, Index> > borderPos_;
+    std::vector<size_t> nonBorderOffsets_;
+    std::vector<std::pair<size_t, Index> > nonBorderPos_;
+
+    bool inProgress_;
+};
+
+} // namespace Linear
+} // namespace Ewoms
+
+#endif
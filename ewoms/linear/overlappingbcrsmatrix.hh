@@ -30,7 +30,6 @@
 #include <ewoms/linear/domesticoverlapfrombcrsmatrix.hh>
 #include <ewoms/linear/globalindices.hh>
 #include <ewoms/linear/blacklist.hh>
-#include <ewoms/parallel/mpibuffer.hh>
 
 #include <opm/common/Valgrind.hpp>
 
@@ -38,8 +37,7 @@
 #include <dune/istl/io.hh>
 
 #include <algorithm>
-#include <set>
-#include <map>
+#include <cassert>
 #include <iostream>
 #include <vector>
 #include <memory>
@@ -59,7 +57,7 @@ public:
     typedef Ewoms::Linear::DomesticOverlapFromBCRSMatrix Overlap;
 
 private:
-    typedef std::vector<std::set<Index> > Entries;
+    typedef std::vector<std::vector<Index> > Entries;
 
 public:
     typedef typename ParentType::ColIterator ColIterator;
@@ -70,18 +68,22 @@ public:
     // no real copying done at the moment
     OverlappingBCRSMatrix(const OverlappingBCRSMatrix& other)
         : ParentType(other)
+        , nativeLayout_(false)
     {}
 
     template <class NativeBCRSMatrix>
     OverlappingBCRSMatrix(const NativeBCRSMatrix& nativeMatrix,
                           const BorderList& borderList,
                           const BlackList& blackList,
-                          unsigned overlapSize)
+                          unsigned overlapSize,
+                          const std::vector<Index>& nativeOrdering = std::vector<Index>(),
+                          Communicator comm = Dune::MPIHelper::getCommunicator())
     {
-        overlap_ = std::make_shared<Overlap>(nativeMatrix, borderList, blackList, overlapSize);
+        overlap_ = std::make_shared<Overlap>(nativeMatrix, borderList, blackList,
+                                             overlapSize, nativeOrdering, comm);
         myRank_ = 0;
 #if HAVE_MPI
-        MPI_Comm_rank(MPI_COMM_WORLD, &myRank_);
+        MPI_Comm_rank(comm, &myRank_);
 #endif // HAVE_MPI
 
         // build the overlapping matrix from the non-overlapping
@@ -89,31 +91,6 @@ public:
         build_(nativeMatrix);
     }
 
-    ~OverlappingBCRSMatrix()
-    {
-        if (overlap_.use_count() == 0)
-            return;
-
-        // delete all MPI buffers
-        const PeerSet& peerSet = overlap_->peerSet();
-        typename PeerSet::const_iterator peerIt = peerSet.begin();
-        typename PeerSet::const_iterator peerEndIt = peerSet.end();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
-
-            delete rowSizesRecvBuff_[peerRank];
-            delete rowIndicesRecvBuff_[peerRank];
-            delete entryColIndicesRecvBuff_[peerRank];
-            delete entryValuesRecvBuff_[peerRank];
-
-            delete numRowsSendBuff_[peerRank];
-            delete rowSizesSendBuff_[peerRank];
-            delete rowIndicesSendBuff_[peerRank];
-            delete entryColIndicesSendBuff_[peerRank];
-            delete entryValuesSendBuff_[peerRank];
-        }
-    }
-
     ParentType& asParent()
     { return *this; }
 
@@ -211,9 +188,49 @@ public:
                                 "row");
     }
 
+    /*!
+     * \brief Copy the entries of a non-overlapping matrix to the overlapping one.
+     */
     template <class NativeBCRSMatrix>
     void assignFromNative(const NativeBCRSMatrix& nativeMatrix)
     {
+        assignFromNative(nativeMatrix,
+                         [](unsigned, unsigned) -> field_type
+                         { return 1.0; });
+    }
+
+    /*!
+     * \brief Copy the entries of a non-overlapping matrix to the overlapping one and
+     *        scale its rows at the same time.
+     *
+     * The weight of the eqIdx-th row of the block of a native row index is
+     * given by rowWeight(nativeRowIdx, eqIdx). If the overlapping matrix exhibits the
+     * same layout as the native one, i.e., if there is no overlap and the indices are
+     * not reordered, the entries are copied in a single linear sweep without any
+     * index lookups.
+     */
+    template <class NativeBCRSMatrix, class RowWeightFn>
+    void assignFromNative(const NativeBCRSMatrix& nativeMatrix, const RowWeightFn& rowWeight)
+    {
+        if (nativeLayout_) {
+            assert(nativeMatrix.N() == this->N()
+                   && nativeMatrix.nonzeroes() == this->nonzeroes());
+
+            int numRows = static_cast<int>(nativeMatrix.N());
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+            for (int rowIdx = 0; rowIdx < numRows; ++rowIdx) {
+                auto destIt = (*this)[static_cast<unsigned>(rowIdx)].begin();
+                auto srcIt = nativeMatrix[static_cast<unsigned>(rowIdx)].begin();
+                const auto& srcEndIt = nativeMatrix[static_cast<unsigned>(rowIdx)].end();
+                for (; srcIt != srcEndIt; ++srcIt, ++destIt)
+                    copyBlock_(*destIt, *srcIt, static_cast<unsigned>(rowIdx), rowWeight);
+            }
+
+            return;
+        }
+
         // first, set everything to 0,
         BCRSMatrix::operator=(0.0);
 
@@ -241,16 +258,8 @@ public:
                     // algebraic one...
                     continue;
 
-                // we need to copy the block matrices manually since it seems that (at
-                // least some versions of) Dune have an endless recursion bug when
-                // assigning dense matrices of different field type
-                const auto& src = *nativeColIt;
                 auto& dest = (*this)[static_cast<unsigned>(domesticRowIdx)][static_cast<unsigned>(domesticColIdx)];
-                for (unsigned i = 0; i < src.rows; ++i) {
-                    for (unsigned j = 0; j < src.cols; ++j) {
-                        dest[i][j] = static_cast<field_type>(src[i][j]);
-                    }
-                }
+                copyBlock_(dest, *nativeColIt, nativeRowIdx, rowWeight);
             }
         }
     }
@@ -258,30 +267,21 @@ public:
     // communicates and adds up the contents of overlapping rows
     void syncAdd()
     {
-        // first, send all entries to the peers
-        const PeerSet& peerSet = overlap_->peerSet();
-        typename PeerSet::const_iterator peerIt = peerSet.begin();
-        typename PeerSet::const_iterator peerEndIt = peerSet.end();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
-
-            sendEntries_(peerRank);
-        }
-
-        // then, receive entries from the peers
-        peerIt = peerSet.begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
-
-            receiveAddEntries_(peerRank);
-        }
+        exchangeEntries_();
+
+        // add the received values. this is done in the order of the
+        // peer ranks so that the result does not depend on the order
+        // in which the messages arrive.
+        for (size_t peerIdx = 0; peerIdx < peers_.size(); ++peerIdx) {
+            const auto& recvBlocks = recvBlocks_[peerIdx];
+            const auto& recvValues = recvValues_[peerIdx];
+            for (size_t i = 0; i < recvBlocks.size(); ++i) {
+                if (!recvBlocks[i])
+                    // the matrix for the current process does not know about this DOF
+                    continue;
 
-        // finally, make sure that everything which we send was
-        // received by the peers
-        peerIt = peerSet.begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
-            entryValuesSendBuff_[peerRank]->wait();
+                *recvBlocks[i] += recvValues[i];
+            }
         }
     }
 
@@ -289,30 +289,18 @@ public:
     // the master
     void syncCopy()
     {
-        // first, send all entries to the peers
-        const PeerSet& peerSet = overlap_->peerSet();
-        typename PeerSet::const_iterator peerIt = peerSet.begin();
-        typename PeerSet::const_iterator peerEndIt = peerSet.end();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
-
-            sendEntries_(peerRank);
-        }
-
-        // then, receive entries from the peers
-        peerIt = peerSet.begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
+        exchangeEntries_();
 
-            receiveCopyEntries_(peerRank);
-        }
+        for (size_t peerIdx = 0; peerIdx < peers_.size(); ++peerIdx) {
+            const auto& recvBlocks = recvBlocks_[peerIdx];
+            const auto& recvValues = recvValues_[peerIdx];
+            for (size_t i = 0; i < recvBlocks.size(); ++i) {
+                if (!recvBlocks[i])
+                    // the matrix for the current process does not know about this DOF
+                    continue;
 
-        // finally, make sure that everything which we send was
-        // received by the peers
-        peerIt = peerSet.begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
-            entryValuesSendBuff_[peerRank]->wait();
+                *recvBlocks[i] = recvValues[i];
+            }
         }
     }
 
@@ -328,6 +316,53 @@ private:
 
         // communicate the entries
         buildIndices_(nativeMatrix);
+
+        nativeLayout_ = hasNativeLayout_(nativeMatrix);
+    }
+
+    // returns true if the overlapping matrix uses exactly the same rows and the same
+    // sparsity pattern as the native one
+    template <class NativeBCRSMatrix>
+    bool hasNativeLayout_(const NativeBCRSMatrix& nativeMatrix) const
+    {
+        if (overlap_->numDomestic() != nativeMatrix.N()
+            || this->nonzeroes() != nativeMatrix.nonzeroes())
+            return false;
+
+        for (unsigned rowIdx = 0; rowIdx < nativeMatrix.N(); ++rowIdx) {
+            if (overlap_->nativeToDomestic(static_cast<Index>(rowIdx)) != static_cast<Index>(rowIdx))
+                return false;
+
+            const auto& nativeRow = nativeMatrix[rowIdx];
+            const auto& row = (*this)[rowIdx];
+            if (nativeRow.size() != row.size())
+                return false;
+
+            auto colIt = row.begin();
+            auto nativeColIt = nativeRow.begin();
+            const auto& nativeColEndIt = nativeRow.end();
+            for (; nativeColIt != nativeColEndIt; ++nativeColIt, ++colIt)
+                if (nativeColIt.index() != colIt.index())
+                    return false;
+        }
+
+        return true;
+    }
+
+    // we need to copy the block matrices manually since it seems that (at least some
+    // versions of) Dune have an endless recursion bug when assigning dense matrices of
+    // different field type
+    template <class NativeBlock, class RowWeightFn>
+    static void copyBlock_(block_type& dest,
+                           const NativeBlock& src,
+                           unsigned nativeRowIdx,
+                           const RowWeightFn& rowWeight)
+    {
+        for (unsigned i = 0; i < src.rows; ++i) {
+            field_type weight = static_cast<field_type>(rowWeight(nativeRowIdx, i));
+            for (unsigned j = 0; j < src.cols; ++j)
+                dest[i][j] = weight*static_cast<field_type>(src[i][j]);
+        }
     }
 
     template <class NativeBCRSMatrix>
@@ -342,342 +377,305 @@ private:
             if (domesticRowIdx < 0)
                 continue;
 
+            auto& rowEntries = entries_[static_cast<unsigned>(domesticRowIdx)];
+            rowEntries.reserve(nativeMatrix[nativeRowIdx].size());
             auto nativeColIt = nativeMatrix[nativeRowIdx].begin();
             const auto& nativeColEndIt = nativeMatrix[nativeRowIdx].end();
             for (; nativeColIt != nativeColEndIt; ++nativeColIt) {
-                int domesticColIdx = overlap_->nativeToDomestic(static_cast<Index>(nativeColIt.index()));
-
-                // make sure to include all off-diagonal entries, even those which belong
-                // to DOFs which are managed by a peer process. For this, we have to
-                // re-map the column index of the black-listed index to a native one.
-                if (domesticColIdx < 0) {
-                    domesticColIdx = overlap_->blackList().nativeToDomestic(static_cast<Index>(nativeColIt.index()));
-                }
-
+                int domesticColIdx = nativeColToDomestic_(static_cast<Index>(nativeColIt.index()));
                 if (domesticColIdx < 0)
                     continue;
 
-                entries_[static_cast<unsigned>(domesticRowIdx)].insert(domesticColIdx);
+                rowEntries.push_back(domesticColIdx);
             }
         }
 
         /////////
         // add the indices for all additional entries
         /////////
-
-        // first, send all our indices to all peers
-        const PeerSet& peerSet = overlap_->peerSet();
-        typename PeerSet::const_iterator peerIt = peerSet.begin();
-        typename PeerSet::const_iterator peerEndIt = peerSet.end();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
-            sendIndices_(nativeMatrix, peerRank);
-        }
-
-        // then recieve all indices from the peers
-        peerIt = peerSet.begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
-            receiveIndices_(peerRank);
-        }
-
-        // wait until all send operations are completed
-        peerIt = peerSet.begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
-
-            numRowsSendBuff_[peerRank]->wait();
-            rowSizesSendBuff_[peerRank]->wait();
-            rowIndicesSendBuff_[peerRank]->wait();
-            entryColIndicesSendBuff_[peerRank]->wait();
-
-            // convert the global indices in the send buffers to domestic
-            // ones
-            globalToDomesticBuff_(*rowIndicesSendBuff_[peerRank]);
-            globalToDomesticBuff_(*entryColIndicesSendBuff_[peerRank]);
-        }
+        exchangeIndices_(nativeMatrix);
 
         /////////
         // actually initialize the BCRS matrix structure
         /////////
 
-        // set the row sizes
+        // remove the duplicate column indices and set the row sizes
         size_t numDomestic = overlap_->numDomestic();
         for (unsigned rowIdx = 0; rowIdx < numDomestic; ++rowIdx) {
-            unsigned numCols = 0;
-            const auto& colIndices = entries_[rowIdx];
-            auto colIdxIt = colIndices.begin();
-            const auto& colIdxEndIt = colIndices.end();
-            for (; colIdxIt != colIdxEndIt; ++colIdxIt) {
-                if (*colIdxIt < 0)
-                    // the matrix for the local process does not know about this DOF
-                    continue;
-
-                ++numCols;
-            }
+            auto& colIndices = entries_[rowIdx];
+            std::sort(colIndices.begin(), colIndices.end());
+            colIndices.erase(std::unique(colIndices.begin(), colIndices.end()),
+                             colIndices.end());
 
-            this->setrowsize(rowIdx, numCols);
+            this->setrowsize(rowIdx, colIndices.size());
         }
         this->endrowsizes();
 
         // set the indices
         for (unsigned rowIdx = 0; rowIdx < numDomestic; ++rowIdx) {
-            const auto& colIndices = entries_[rowIdx];
-
-            auto colIdxIt = colIndices.begin();
-            const auto& colIdxEndIt = colIndices.end();
-            for (; colIdxIt != colIdxEndIt; ++colIdxIt) {
-                if (*colIdxIt < 0)
-                    // the matrix for the local process does not know about this DOF
-                    continue;
-
-                this->addindex(rowIdx, static_cast<unsigned>(*colIdxIt));
-            }
+            for (Index colIdx : entries_[rowIdx])
+                this->addindex(rowIdx, static_cast<unsigned>(colIdx));
         }
         this->endindices();
 
         // free the memory occupied by the array of the matrix entries
         entries_.clear();
+        entries_.shrink_to_fit();
+
+        // now that the sparsity pattern is fixed, resolve the matrix
+        // blocks which are communicated with the peers
+        setupEntryBlocks_();
     }
 
-    // send the overlap indices to a peer
-    template <class NativeBCRSMatrix>
-    void sendIndices_(const NativeBCRSMatrix& nativeMatrix, ProcessRank peerRank)
+    // returns the domestic index of a native column index. in contrast
+    // to rows, this considers black-listed indices which have a
+    // counterpart in the domestic overlap.
+    Index nativeColToDomestic_(Index nativeColIdx) const
     {
-#if HAVE_MPI
-        // send size of foreign overlap to peer
-        size_t numOverlapRows = overlap_->foreignOverlapSize(peerRank);
-        numRowsSendBuff_[peerRank] = new MpiBuffer<unsigned>(1);
-        (*numRowsSendBuff_[peerRank])[0] = static_cast<unsigned>(numOverlapRows);
-        numRowsSendBuff_[peerRank]->send(peerRank);
-
-        // allocate the buffers which hold the global indices of each row and the number
-        // of entries which need to be communicated by the respective row
-        rowIndicesSendBuff_[peerRank] = new MpiBuffer<Index>(numOverlapRows);
-        rowSizesSendBuff_[peerRank] = new MpiBuffer<unsigned>(numOverlapRows);
-
-        // compute the sets of the indices of the entries which need to be send to the peer
-        typedef std::set<int> ColumnIndexSet;
-        typedef std::map<int, ColumnIndexSet> EntryTuples;
-
-        EntryTuples entryIndices;
-        unsigned numEntries = 0; // <- total number of matrix entries to be send to the peer
-        for (unsigned overlapOffset = 0; overlapOffset < numOverlapRows; ++overlapOffset) {
-            Index domesticRowIdx = overlap_->foreignOverlapOffsetToDomesticIdx(peerRank, overlapOffset);
-            Index nativeRowIdx = overlap_->domesticToNative(domesticRowIdx);
-            Index globalRowIdx = overlap_->domesticToGlobal(domesticRowIdx);
-
-            ColumnIndexSet& colIndices = entryIndices[globalRowIdx];
-
-            auto nativeColIt = nativeMatrix[static_cast<unsigned>(nativeRowIdx)].begin();
-            const auto& nativeColEndIt = nativeMatrix[static_cast<unsigned>(nativeRowIdx)].end();
-            for (; nativeColIt != nativeColEndIt; ++nativeColIt) {
-                unsigned nativeColIdx = static_cast<unsigned>(nativeColIt.index());
-                Index domesticColIdx = overlap_->nativeToDomestic(static_cast<Index>(nativeColIdx));
-
-                if (domesticColIdx < 0)
-                    // the native column index may be blacklisted, use the corresponding
-                    // index in the domestic overlap.
-                    domesticColIdx = overlap_->blackList().nativeToDomestic(static_cast<Index>(nativeColIdx));
+        Index domesticColIdx = overlap_->nativeToDomestic(nativeColIdx);
 
-                if (domesticColIdx < 0)
-                    // the column may still not be known locally, i.e. the corresponding
-                    // DOF of the row is at the process's front. we don't need this
-                    // entry.
-                    continue;
+        // make sure to include all off-diagonal entries, even those which belong
+        // to DOFs which are managed by a peer process. For this, we have to
+        // re-map the column index of the black-listed index to a native one.
+        if (domesticColIdx < 0)
+            domesticColIdx = overlap_->blackList().nativeToDomestic(nativeColIdx);
 
-                Index globalColIdx = overlap_->domesticToGlobal(domesticColIdx);
-                colIndices.insert(globalColIdx);
-                ++numEntries;
-            }
-        };
+        return domesticColIdx;
+    }
 
-        // fill the send buffers
-        entryColIndicesSendBuff_[peerRank] = new MpiBuffer<Index>(numEntries);
-        Index overlapEntryIdx = 0;
-        for (unsigned overlapOffset = 0; overlapOffset < numOverlapRows; ++overlapOffset) {
-            Index domesticRowIdx = overlap_->foreignOverlapOffsetToDomesticIdx(peerRank, overlapOffset);
-            Index globalRowIdx = overlap_->domesticToGlobal(domesticRowIdx);
+    // send the global indices of the matrix entries in the foreign
+    // overlap to the peers and receive the ones of the domestic
+    // overlap. besides the message containing the sizes, each peer
+    // receives a single message which contains the row indices, the
+    // row sizes and the column indices.
+    template <class NativeBCRSMatrix>
+    void exchangeIndices_(const NativeBCRSMatrix& nativeMatrix)
+    {
+        const PeerSet& peerSet = overlap_->peerSet();
+        peers_.assign(peerSet.begin(), peerSet.end());
+        size_t numPeers = peers_.size();
 
-            (*rowIndicesSendBuff_[peerRank])[overlapOffset] = globalRowIdx;
+        sendRows_.resize(numPeers);
+        sendCols_.resize(numPeers);
+        recvRows_.resize(numPeers);
+        recvCols_.resize(numPeers);
 
-            const ColumnIndexSet& colIndexSet = entryIndices[globalRowIdx];
-            auto* rssb = rowSizesSendBuff_[peerRank];
-            (*rssb)[overlapOffset] = static_cast<unsigned>(colIndexSet.size());
-            for (auto it = colIndexSet.begin(); it != colIndexSet.end(); ++it) {
-                int globalColIdx = *it;
+#if HAVE_MPI
+        // assemble the send buffers. their layout is (row indices,
+        // row sizes, column indices) and all indices are global
+        std::vector<std::vector<Index> > sendBufs(numPeers);
+        std::vector<unsigned> sendSizes(2*numPeers);
+        std::vector<Index> colIndices;
+        for (size_t peerIdx = 0; peerIdx < numPeers; ++peerIdx) {
+            ProcessRank peerRank = peers_[peerIdx];
+            unsigned numOverlapRows = static_cast<unsigned>(overlap_->foreignOverlapSize(peerRank));
+
+            auto& sendBuf = sendBufs[peerIdx];
+            sendBuf.resize(2*numOverlapRows);
+            for (unsigned overlapOffset = 0; overlapOffset < numOverlapRows; ++overlapOffset) {
+                Index domesticRowIdx = overlap_->foreignOverlapOffsetToDomesticIdx(peerRank, overlapOffset);
+                Index nativeRowIdx = overlap_->domesticToNative(domesticRowIdx);
+
+                colIndices.clear();
+                auto nativeColIt = nativeMatrix[static_cast<unsigned>(nativeRowIdx)].begin();
+                const auto& nativeColEndIt = nativeMatrix[static_cast<unsigned>(nativeRowIdx)].end();
+                for (; nativeColIt != nativeColEndIt; ++nativeColIt) {
+                    Index domesticColIdx = nativeColToDomestic_(static_cast<Index>(nativeColIt.index()));
+                    if (domesticColIdx < 0)
+                        // the column may still not be known locally, i.e. the corresponding
+                        // DOF of the row is at the process's front. we don't need this
+                        // entry.
+                        continue;
+
+                    colIndices.push_back(overlap_->domesticToGlobal(domesticColIdx));
+                }
+                std::sort(colIndices.begin(), colIndices.end());
+                colIndices.erase(std::unique(colIndices.begin(), colIndices.end()),
+                                 colIndices.end());
 
-                (*entryColIndicesSendBuff_[peerRank])[static_cast<unsigned>(overlapEntryIdx)] = globalColIdx;
-                ++ overlapEntryIdx;
+                sendBuf[overlapOffset] = overlap_->domesticToGlobal(domesticRowIdx);
+                sendBuf[numOverlapRows + overlapOffset] = static_cast<Index>(colIndices.size());
+                sendBuf.insert(sendBuf.end(), colIndices.begin(), colIndices.end());
             }
-        }
-
-        // actually communicate with the peer
-        rowSizesSendBuff_[peerRank]->send(peerRank);
-        rowIndicesSendBuff_[peerRank]->send(peerRank);
-        entryColIndicesSendBuff_[peerRank]->send(peerRank);
 
-        // create the send buffers for the values of the matrix
-        // entries
-        entryValuesSendBuff_[peerRank] = new MpiBuffer<block_type>(numEntries);
-#endif // HAVE_MPI
-    }
+            sendSizes[2*peerIdx + 0] = numOverlapRows;
+            sendSizes[2*peerIdx + 1] = static_cast<unsigned>(sendBuf.size());
+        }
 
-    // receive the overlap indices to a peer
-    void receiveIndices_(ProcessRank peerRank)
-    {
-#if HAVE_MPI
-        // receive size of foreign overlap to peer
-        unsigned numOverlapRows;
-        auto& numRowsRecvBuff = numRowsRecvBuff_[peerRank];
-        numRowsRecvBuff.resize(1);
-        numRowsRecvBuff.receive(peerRank);
-        numOverlapRows = numRowsRecvBuff[0];
-
-        // create receive buffer for the row sizes and receive them
-        // from the peer
-        rowSizesRecvBuff_[peerRank] = new MpiBuffer<unsigned>(numOverlapRows);
-        rowIndicesRecvBuff_[peerRank] = new MpiBuffer<Index>(numOverlapRows);
-        rowSizesRecvBuff_[peerRank]->receive(peerRank);
-        rowIndicesRecvBuff_[peerRank]->receive(peerRank);
-
-        // calculate the total number of indices which are send by the
-        // peer
-        unsigned totalIndices = 0;
-        for (unsigned i = 0; i < numOverlapRows; ++i)
-            totalIndices += (*rowSizesRecvBuff_[peerRank])[i];
-
-        // create the buffer to store the column indices of the matrix entries
-        entryColIndicesRecvBuff_[peerRank] = new MpiBuffer<Index>(totalIndices);
-        entryValuesRecvBuff_[peerRank] = new MpiBuffer<block_type>(totalIndices);
-
-        // communicate with the peer
-        entryColIndicesRecvBuff_[peerRank]->receive(peerRank);
-
-        // convert the global indices in the receive buffers to
-        // domestic ones
-        globalToDomesticBuff_(*rowIndicesRecvBuff_[peerRank]);
-        globalToDomesticBuff_(*entryColIndicesRecvBuff_[peerRank]);
-
-        // add the entries to the global entry map
-        unsigned k = 0;
-        for (unsigned i = 0; i < numOverlapRows; ++i) {
-            Index domRowIdx = (*rowIndicesRecvBuff_[peerRank])[i];
-            for (unsigned j = 0; j < (*rowSizesRecvBuff_[peerRank])[i]; ++j) {
-                Index domColIdx = (*entryColIndicesRecvBuff_[peerRank])[k];
-                entries_[static_cast<unsigned>(domRowIdx)].insert(domColIdx);
-                ++k;
-            }
+        // exchange the sizes of the messages
+        std::vector<unsigned> recvSizes(2*numPeers, 0);
+        std::vector<MPI_Request> requests(2*numPeers, MPI_REQUEST_NULL);
+        for (size_t peerIdx = 0; peerIdx < numPeers; ++peerIdx)
+            MPI_Irecv(&recvSizes[2*peerIdx], 2, MPI_UNSIGNED, static_cast<int>(peers_[peerIdx]),
+                      /*tag=*/0, overlap_->communicator(), &requests[peerIdx]);
+        for (size_t peerIdx = 0; peerIdx < numPeers; ++peerIdx)
+            MPI_Isend(&sendSizes[2*peerIdx], 2, MPI_UNSIGNED, static_cast<int>(peers_[peerIdx]),
+                      /*tag=*/0, overlap_->communicator(), &requests[numPeers + peerIdx]);
+        MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+
+        // exchange the indices
+        std::vector<std::vector<Index> > recvBufs(numPeers);
+        std::fill(requests.begin(), requests.end(), MPI_REQUEST_NULL);
+        for (size_t peerIdx = 0; peerIdx < numPeers; ++peerIdx) {
+            recvBufs[peerIdx].resize(recvSizes[2*peerIdx + 1]);
+            if (!recvBufs[peerIdx].empty())
+                MPI_Irecv(recvBufs[peerIdx].data(), static_cast<int>(recvBufs[peerIdx].size()),
+                          MPI_INT, static_cast<int>(peers_[peerIdx]),
+                          /*tag=*/0, overlap_->communicator(), &requests[peerIdx]);
+        }
+        for (size_t peerIdx = 0; peerIdx < numPeers; ++peerIdx) {
+            if (!sendBufs[peerIdx].empty())
+                MPI_Isend(sendBufs[peerIdx].data(), static_cast<int>(sendBufs[peerIdx].size()),
+                          MPI_INT, static_cast<int>(peers_[peerIdx]),
+                          /*tag=*/0, overlap_->communicator(), &requests[numPeers + peerIdx]);
+        }
+        MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+
+        // convert the global indices to domestic ones and remember the
+        // (row, column) pairs of all communicated entries. the
+        // received entries are also added to the sparsity pattern.
+        for (size_t peerIdx = 0; peerIdx < numPeers; ++peerIdx) {
+            unpackIndices_(sendBufs[peerIdx], sendSizes[2*peerIdx],
+                           sendRows_[peerIdx], sendCols_[peerIdx],
+                           /*addEntries=*/false);
+            unpackIndices_(recvBufs[peerIdx], recvSizes[2*peerIdx],
+                           recvRows_[peerIdx], recvCols_[peerIdx],
+                           /*addEntries=*/true);
         }
 #endif // HAVE_MPI
     }
 
-    void sendEntries_(ProcessRank peerRank)
+    // convert a buffer of global indices to lists of domestic row and
+    // column indices
+    void unpackIndices_(const std::vector<Index>& buf,
+                        unsigned numRows,
+                        std::vector<Index>& rows,
+                        std::vector<Index>& cols,
+                        bool addEntries)
     {
-#if HAVE_MPI
-        auto &mpiSendBuff = *entryValuesSendBuff_[peerRank];
+        assert(buf.size() >= 2*numRows);
 
-        auto &mpiRowIndicesSendBuff = *rowIndicesSendBuff_[peerRank];
-        auto &mpiRowSizesSendBuff = *rowSizesSendBuff_[peerRank];
-        auto &mpiColIndicesSendBuff = *entryColIndicesSendBuff_[peerRank];
+        size_t numEntries = buf.size() - 2*numRows;
+        rows.resize(numEntries);
+        cols.resize(numEntries);
 
-        // fill the send buffer
-        unsigned k = 0;
-        for (unsigned i = 0; i < mpiRowIndicesSendBuff.size(); ++i) {
-            Index domRowIdx = mpiRowIndicesSendBuff[i];
+        size_t k = 0;
+        for (unsigned i = 0; i < numRows; ++i) {
+            Index domRowIdx = overlap_->globalToDomestic(buf[i]);
+            assert(domRowIdx >= 0);
 
-            for (Index j = 0; j < static_cast<Index>(mpiRowSizesSendBuff[i]); ++j)
-            {
-                // move to the next column which is in the overlap
-                Index domColIdx = mpiColIndicesSendBuff[k];
+            unsigned rowSize = static_cast<unsigned>(buf[numRows + i]);
+            for (unsigned j = 0; j < rowSize; ++j, ++k) {
+                Index domColIdx = overlap_->globalToDomestic(buf[2*numRows + k]);
+                rows[k] = domRowIdx;
+                cols[k] = domColIdx;
 
-                // add the values of this column to the send buffer
-                mpiSendBuff[k] = (*this)[static_cast<unsigned>(domRowIdx)][static_cast<unsigned>(domColIdx)];
-                ++k;
+                if (addEntries && domColIdx >= 0)
+                    entries_[static_cast<unsigned>(domRowIdx)].push_back(domColIdx);
             }
         }
-
-        mpiSendBuff.send(peerRank);
-#endif // HAVE_MPI
+        assert(k == numEntries);
     }
 
-    void receiveAddEntries_(ProcessRank peerRank)
+    // resolve the matrix blocks of the communicated entries. this
+    // avoids looking up the entries every time the matrix is
+    // synchronized.
+    void setupEntryBlocks_()
     {
-#if HAVE_MPI
-        auto &mpiRecvBuff = *entryValuesRecvBuff_[peerRank];
-
-        auto &mpiRowIndicesRecvBuff = *rowIndicesRecvBuff_[peerRank];
-        auto &mpiRowSizesRecvBuff = *rowSizesRecvBuff_[peerRank];
-        auto &mpiColIndicesRecvBuff = *entryColIndicesRecvBuff_[peerRank];
-
-        mpiRecvBuff.receive(peerRank);
-
-        // retrieve the values from the receive buffer
-        unsigned k = 0;
-        for (unsigned i = 0; i < mpiRowIndicesRecvBuff.size(); ++i) {
-            Index domRowIdx = mpiRowIndicesRecvBuff[i];
-            for (unsigned j = 0; j < mpiRowSizesRecvBuff[i]; ++j, ++k) {
-                Index domColIdx = mpiColIndicesRecvBuff[k];
+        size_t numPeers = peers_.size();
+        sendBlocks_.resize(numPeers);
+        sendValues_.resize(numPeers);
+        recvBlocks_.resize(numPeers);
+        recvValues_.resize(numPeers);
+
+        for (size_t peerIdx = 0; peerIdx < numPeers; ++peerIdx) {
+            size_t numSend = sendRows_[peerIdx].size();
+            sendBlocks_[peerIdx].resize(numSend);
+            sendValues_[peerIdx].resize(numSend);
+            for (size_t i = 0; i < numSend; ++i) {
+                unsigned rowIdx = static_cast<unsigned>(sendRows_[peerIdx][i]);
+                unsigned colIdx = static_cast<unsigned>(sendCols_[peerIdx][i]);
+                sendBlocks_[peerIdx][i] = &(*this)[rowIdx][colIdx];
+            }
 
-                if (domColIdx < 0)
-                    // the matrix for the current process does not know about this DOF
+            size_t numRecv = recvRows_[peerIdx].size();
+            recvBlocks_[peerIdx].resize(numRecv);
+            recvValues_[peerIdx].resize(numRecv);
+            for (size_t i = 0; i < numRecv; ++i) {
+                Index colIdx = recvCols_[peerIdx][i];
+                if (colIdx < 0) {
+                    // the matrix for the local process does not know about this DOF
+                    recvBlocks_[peerIdx][i] = nullptr;
                     continue;
+                }
 
-                (*this)[static_cast<unsigned>(domRowIdx)][static_cast<unsigned>(domColIdx)] += mpiRecvBuff[k];
+                unsigned rowIdx = static_cast<unsigned>(recvRows_[peerIdx][i]);
+                recvBlocks_[peerIdx][i] = &(*this)[rowIdx][static_cast<unsigned>(colIdx)];
             }
+
+            // the index lists are not required anymore
+            std::vector<Index>().swap(sendRows_[peerIdx]);
+            std::vector<Index>().swap(sendCols_[peerIdx]);
+            std::vector<Index>().swap(recvRows_[peerIdx]);
+            std::vector<Index>().swap(recvCols_[peerIdx]);
         }
-#endif // HAVE_MPI
     }
 
-    void receiveCopyEntries_(int peerRank)
+    // send the values of the entries in the foreign overlap to the
+    // peers and receive the ones of the domestic overlap
+    void exchangeEntries_()
     {
 #if HAVE_MPI
-        MpiBuffer<block_type> &mpiRecvBuff = *entryValuesRecvBuff_[peerRank];
-
-        MpiBuffer<Index> &mpiRowIndicesRecvBuff = *rowIndicesRecvBuff_[peerRank];
-        MpiBuffer<unsigned> &mpiRowSizesRecvBuff = *rowSizesRecvBuff_[peerRank];
-        MpiBuffer<Index> &mpiColIndicesRecvBuff = *entryColIndicesRecvBuff_[peerRank];
-
-        mpiRecvBuff.receive(peerRank);
-
-        // retrieve the values from the receive buffer
-        unsigned k = 0;
-        for (unsigned i = 0; i < mpiRowIndicesRecvBuff.size(); ++i) {
-            Index domRowIdx = mpiRowIndicesRecvBuff[i];
-            for (unsigned j = 0; j < mpiRowSizesRecvBuff[i]; ++j, ++k) {
-                Index domColIdx = mpiColIndicesRecvBuff[k];
-
-                if (domColIdx < 0)
-                    // the matrix for the current process does not know about this DOF
-                    continue;
+        size_t numPeers = peers_.size();
+        for (size_t peerIdx = 0; peerIdx < numPeers; ++peerIdx) {
+            const auto& sendBlocks = sendBlocks_[peerIdx];
+            auto& sendValues = sendValues_[peerIdx];
+            for (size_t i = 0; i < sendBlocks.size(); ++i)
+                sendValues[i] = *sendBlocks[i];
+        }
 
-                (*this)[static_cast<unsigned>(domRowIdx)][static_cast<unsigned>(domColIdx)] = mpiRecvBuff[k];
-            }
+        std::vector<MPI_Request> requests(2*numPeers, MPI_REQUEST_NULL);
+        for (size_t peerIdx = 0; peerIdx < numPeers; ++peerIdx) {
+            auto& recvValues = recvValues_[peerIdx];
+            if (!recvValues.empty())
+                MPI_Irecv(recvValues.data(),
+                          static_cast<int>(recvValues.size()*sizeof(block_type)),
+                          MPI_BYTE, static_cast<int>(peers_[peerIdx]),
+                          /*tag=*/0, overlap_->communicator(), &requests[peerIdx]);
+        }
+        for (size_t peerIdx = 0; peerIdx < numPeers; ++peerIdx) {
+            auto& sendValues = sendValues_[peerIdx];
+            if (!sendValues.empty())
+                MPI_Isend(sendValues.data(),
+                          static_cast<int>(sendValues.size()*sizeof(block_type)),
+                          MPI_BYTE, static_cast<int>(peers_[peerIdx]),
+                          /*tag=*/0, overlap_->communicator(), &requests[numPeers + peerIdx]);
         }
+        MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
 #endif // HAVE_MPI
     }
 
-    void globalToDomesticBuff_(MpiBuffer<Index>& idxBuff)
-    {
-        for (unsigned i = 0; i < idxBuff.size(); ++i)
-            idxBuff[i] = overlap_->globalToDomestic(idxBuff[i]);
-    }
-
     int myRank_;
+    bool nativeLayout_;
     Entries entries_;
     std::shared_ptr<Overlap> overlap_;
 
-    std::map<ProcessRank, MpiBuffer<unsigned> *> numRowsSendBuff_;
-    std::map<ProcessRank, MpiBuffer<unsigned> *> rowSizesSendBuff_;
-    std::map<ProcessRank, MpiBuffer<Index> *> rowIndicesSendBuff_;
-    std::map<ProcessRank, MpiBuffer<Index> *> entryColIndicesSendBuff_;
-    std::map<ProcessRank, MpiBuffer<block_type> *> entryValuesSendBuff_;
-
-    std::map<ProcessRank, MpiBuffer<unsigned> > numRowsRecvBuff_;
-    std::map<ProcessRank, MpiBuffer<unsigned> *> rowSizesRecvBuff_;
-    std::map<ProcessRank, MpiBuffer<Index> *> rowIndicesRecvBuff_;
-    std::map<ProcessRank, MpiBuffer<Index> *> entryColIndicesRecvBuff_;
-    std::map<ProcessRank, MpiBuffer<block_type> *> entryValuesRecvBuff_;
+    // the ranks of the peer processes
+    std::vector<ProcessRank> peers_;
+
+    // the domestic (row, column) indices of the communicated entries
+    // for each peer. these are only used while the matrix is built.
+    std::vector<std::vector<Index> > sendRows_;
+    std::vector<std::vector<Index> > sendCols_;
+    std::vector<std::vector<Index> > recvRows_;
+    std::vector<std::vector<Index> > recvCols_;
+
+    // the matrix blocks which are send to and received from each peer
+    // and the corresponding message buffers
+    std::vector<std::vector<const block_type*> > sendBlocks_;
+    std::vector<std::vector<block_type> > sendValues_;
+    std::vector<std::vector<block_type*> > recvBlocks_;
+    std::vector<std::vector<block_type> > recvValues_;
 };
 
 } // namespace Linear
@@ -28,15 +28,14 @@
 #define EWOMS_OVERLAPPING_BLOCK_VECTOR_HH
 
 #include "overlaptypes.hh"
+#include "overlapexchange.hh"
 
-#include <ewoms/parallel/mpibuffer.hh>
 #include <opm/common/Valgrind.hpp>
 
 #include <dune/istl/bvector.hh>
 #include <dune/common/fvector.hh>
 
 #include <memory>
-#include <map>
 #include <iostream>
 
 namespace Ewoms {
@@ -44,12 +43,17 @@ namespace Linear {
 
 /*!
  * \brief An overlap aware block vector.
+ *
+ * The data structures which are required to exchange the overlap with the peer
+ * processes (see OverlapExchange) are created when a vector is constructed from a
+ * domestic overlap object and are shared by all vectors which are copied from it.
  */
 template <class FieldVector, class Overlap>
 class OverlappingBlockVector : public Dune::BlockVector<FieldVector>
 {
     typedef Dune::BlockVector<FieldVector> ParentType;
     typedef Dune::BlockVector<FieldVector> BlockVector;
+    typedef Ewoms::Linear::OverlapExchange<FieldVector, Overlap> Exchange;
 
 public:
     /*!
@@ -57,19 +61,17 @@ public:
      *        block vector coherent to it.
      */
     OverlappingBlockVector(const Overlap& overlap)
-        : ParentType(overlap.numDomestic()), overlap_(&overlap)
-    { createBuffers_(); }
+        : ParentType(overlap.numDomestic())
+        , exchange_(std::make_shared<Exchange>(overlap))
+        , overlap_(&overlap)
+    { }
 
     /*!
      * \brief Copy constructor.
      */
     OverlappingBlockVector(const OverlappingBlockVector& obv)
         : ParentType(obv)
-        , numIndicesSendBuff_(obv.numIndicesSendBuff_)
-        , indicesSendBuff_(obv.indicesSendBuff_)
-        , indicesRecvBuff_(obv.indicesRecvBuff_)
-        , valuesSendBuff_(obv.valuesSendBuff_)
-        , valuesRecvBuff_(obv.valuesRecvBuff_)
+        , exchange_(obv.exchange_)
         , overlap_(obv.overlap_)
     {}
 
@@ -92,11 +94,7 @@ public:
     OverlappingBlockVector& operator=(const OverlappingBlockVector& obv)
     {
         ParentType::operator=(obv);
-        numIndicesSendBuff_ = obv.numIndicesSendBuff_;
-        indicesSendBuff_ = obv.indicesSendBuff_;
-        indicesRecvBuff_ = obv.indicesRecvBuff_;
-        valuesSendBuff_ = obv.valuesSendBuff_;
-        valuesRecvBuff_ = obv.valuesRecvBuff_;
+        exchange_ = obv.exchange_;
         overlap_ = obv.overlap_;
         return *this;
     }
@@ -172,82 +170,39 @@ public:
      *        master process.
      */
     void sync()
-    {
-        typename PeerSet::const_iterator peerIt;
-        typename PeerSet::const_iterator peerEndIt = overlap_->peerSet().end();
-
-        // send all entries to all peers
-        peerIt = overlap_->peerSet().begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
-            sendEntries_(peerRank);
-        }
-
-        // recieve all entries to the peers
-        peerIt = overlap_->peerSet().begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
-            receiveFromMaster_(peerRank);
-        }
-
-        // wait until we have send everything
-        waitSendFinished_();
-    }
+    { exchange_->exchange(*this, Exchange::FromMaster); }
 
     /*!
      * \brief Syncronize all values of the block vector by adding up
      *        the values of all peer ranks.
      */
     void syncAdd()
-    {
-        typename PeerSet::const_iterator peerIt;
-        typename PeerSet::const_iterator peerEndIt = overlap_->peerSet().end();
-
-        // send all entries to all peers
-        peerIt = overlap_->peerSet().begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
-            sendEntries_(peerRank);
-        }
-
-        // recieve all entries to the peers
-        peerIt = overlap_->peerSet().begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
-            receiveAdd_(peerRank);
-        }
-
-        // wait until we have send everything
-        waitSendFinished_();
-    }
+    { exchange_->exchange(*this, Exchange::Add); }
 
     /*!
      * \brief Syncronize all values of the block vector from the
      *        master rank, but add up the entries on the border.
      */
     void syncAddBorder()
-    {
-        typename PeerSet::const_iterator peerIt;
-        typename PeerSet::const_iterator peerEndIt = overlap_->peerSet().end();
-
-        // send all entries to all peers
-        peerIt = overlap_->peerSet().begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
-            sendEntries_(peerRank);
-        }
+    { exchange_->exchange(*this, Exchange::AddBorder); }
 
-        // recieve all entries to the peers
-        peerIt = overlap_->peerSet().begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
-            receiveAddBorder_(peerRank);
-        }
-
-        // wait until we have send everything
-        waitSendFinished_();
+    /*!
+     * \brief Start to syncronize the values of the block vector from their master
+     *        process.
+     *
+     * The values which are sent to the peer processes are copied when this method is
+     * called. Until finishSync() is called, no other syncronization of any copy of
+     * this vector may be started and the rows which are received from the peers must
+     * not be accessed.
+     */
+    void startSync()
+    { exchange_->start(*this); }
 
-    }
+    /*!
+     * \brief Complete a syncronization which has been started using startSync().
+     */
+    void finishSync()
+    { exchange_->finish(*this, Exchange::FromMaster); }
 
     void print() const
     {
@@ -258,164 +213,8 @@ public:
     }
 
 private:
-    void createBuffers_()
-    {
-#if HAVE_MPI
-        // create array for the front indices
-        typename PeerSet::const_iterator peerIt;
-        typename PeerSet::const_iterator peerEndIt = overlap_->peerSet().end();
-
-        // send all indices to the peers
-        peerIt = overlap_->peerSet().begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
-
-            size_t numEntries = overlap_->foreignOverlapSize(peerRank);
-            numIndicesSendBuff_[peerRank] = std::make_shared<MpiBuffer<unsigned> >(1);
-            indicesSendBuff_[peerRank] = std::make_shared<MpiBuffer<Index> >(numEntries);
-            valuesSendBuff_[peerRank] = std::make_shared<MpiBuffer<FieldVector> >(numEntries);
-
-            // fill the indices buffer with global indices
-            MpiBuffer<Index>& indicesSendBuff = *indicesSendBuff_[peerRank];
-            for (unsigned i = 0; i < numEntries; ++i) {
-                Index domRowIdx = overlap_->foreignOverlapOffsetToDomesticIdx(peerRank, i);
-                indicesSendBuff[i] = overlap_->domesticToGlobal(domRowIdx);
-            }
-
-            // first, send the number of indices
-            (*numIndicesSendBuff_[peerRank])[0] = static_cast<unsigned>(numEntries);
-            numIndicesSendBuff_[peerRank]->send(peerRank);
-
-            // then, send the indices themselfs
-            indicesSendBuff.send(peerRank);
-        }
-
-        // receive the indices from the peers
-        peerIt = overlap_->peerSet().begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
-
-            // receive size of overlap to peer
-            MpiBuffer<unsigned> numRowsRecvBuff(1);
-            numRowsRecvBuff.receive(peerRank);
-            unsigned numRows = numRowsRecvBuff[0];
-
-            // then, create the MPI buffers
-            indicesRecvBuff_[peerRank] = std::shared_ptr<MpiBuffer<Index> >(
-                new MpiBuffer<Index>(numRows));
-            valuesRecvBuff_[peerRank] = std::shared_ptr<MpiBuffer<FieldVector> >(
-                new MpiBuffer<FieldVector>(numRows));
-            MpiBuffer<Index>& indicesRecvBuff = *indicesRecvBuff_[peerRank];
-
-            // next, receive the actual indices
-            indicesRecvBuff.receive(peerRank);
-
-            // finally, translate the global indices to domestic ones
-            for (unsigned i = 0; i != numRows; ++i) {
-                Index globalRowIdx = indicesRecvBuff[i];
-                Index domRowIdx = overlap_->globalToDomestic(globalRowIdx);
-
-                indicesRecvBuff[i] = domRowIdx;
-            }
-        }
-
-        // wait for all send operations to complete
-        peerIt = overlap_->peerSet().begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
-            numIndicesSendBuff_[peerRank]->wait();
-            indicesSendBuff_[peerRank]->wait();
-
-            // convert the global indices of the send buffer to
-            // domestic ones
-            MpiBuffer<Index>& indicesSendBuff = *indicesSendBuff_[peerRank];
-            for (unsigned i = 0; i < indicesSendBuff.size(); ++i) {
-                indicesSendBuff[i] = overlap_->globalToDomestic(indicesSendBuff[i]);
-            }
-        }
-#endif // HAVE_MPI
-    }
-
-    void sendEntries_(ProcessRank peerRank)
-    {
-        // copy the values into the send buffer
-        const MpiBuffer<Index>& indices = *indicesSendBuff_[peerRank];
-        MpiBuffer<FieldVector>& values = *valuesSendBuff_[peerRank];
-        for (unsigned i = 0; i < indices.size(); ++i)
-            values[i] = (*this)[static_cast<unsigned>(indices[i])];
-
-        values.send(peerRank);
-    }
-
-    void waitSendFinished_()
-    {
-        typename PeerSet::const_iterator peerIt;
-        typename PeerSet::const_iterator peerEndIt = overlap_->peerSet().end();
-
-        // send all entries to all peers
-        peerIt = overlap_->peerSet().begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
-            valuesSendBuff_[peerRank]->wait();
-        }
-    }
-
-    void receiveFromMaster_(ProcessRank peerRank)
-    {
-        const MpiBuffer<Index>& indices = *indicesRecvBuff_[peerRank];
-        MpiBuffer<FieldVector>& values = *valuesRecvBuff_[peerRank];
-
-        // receive the values from the peer
-        values.receive(peerRank);
-
-        // copy them into the block vector
-        for (unsigned j = 0; j < indices.size(); ++j) {
-            Index domRowIdx = indices[j];
-            if (overlap_->masterRank(domRowIdx) == peerRank) {
-                (*this)[static_cast<unsigned>(domRowIdx)] = values[j];
-            }
-        }
-    }
-
-    void receiveAddBorder_(ProcessRank peerRank)
-    {
-        const MpiBuffer<Index>& indices = *indicesRecvBuff_[peerRank];
-        MpiBuffer<FieldVector>& values = *valuesRecvBuff_[peerRank];
-
-        // receive the values from the peer
-        values.receive(peerRank);
-
-        // add up the values of rows on the shared boundary
-        for (unsigned j = 0; j < indices.size(); ++j) {
-            Index domRowIdx = indices[j];
-            if (overlap_->isBorderWith(domRowIdx, peerRank))
-                (*this)[static_cast<unsigned>(domRowIdx)] += values[j];
-            else
-                (*this)[static_cast<unsigned>(domRowIdx)] = values[j];
-        }
-    }
-
-    void receiveAdd_(ProcessRank peerRank)
-    {
-        const MpiBuffer<Index>& indices = *indicesRecvBuff_[peerRank];
-        MpiBuffer<FieldVector>& values = *valuesRecvBuff_[peerRank];
-
-        // receive the values from the peer
-        values.receive(peerRank);
-
-        // add up the values of rows on the shared boundary
-        for (unsigned j = 0; j < indices.size(); ++j) {
-            Index domRowIdx = indices[j];
-            (*this)[static_cast<unsigned>(domRowIdx)] += values[j];
-        }
-    }
-
-    std::map<ProcessRank, std::shared_ptr<MpiBuffer<unsigned> > > numIndicesSendBuff_;
-    std::map<ProcessRank, std::shared_ptr<MpiBuffer<Index> > > indicesSendBuff_;
-    std::map<ProcessRank, std::shared_ptr<MpiBuffer<Index> > > indicesRecvBuff_;
-    std::map<ProcessRank, std::shared_ptr<MpiBuffer<FieldVector> > > valuesSendBuff_;
-    std::map<ProcessRank, std::shared_ptr<MpiBuffer<FieldVector> > > valuesRecvBuff_;
-
+    // the communication data structures are shared by all copies of a vector
+    std::shared_ptr<Exchange> exchange_;
     const Overlap *overlap_;
 };
 
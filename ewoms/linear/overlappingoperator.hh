@@ -27,20 +27,38 @@
 #ifndef EWOMS_OVERLAPPING_OPERATOR_HH
 #define EWOMS_OVERLAPPING_OPERATOR_HH
 
+#include "blockcsrmatrix.hh"
+
 #include <dune/istl/operators.hh>
 #include <dune/common/version.hh>
 
+#include <vector>
+
 namespace Ewoms {
 namespace Linear {
 
 /*!
  * \brief An overlap aware linear operator usable by ISTL.
+ *
+ * The matrix-vector products are not computed using the BCRS matrix itself but using
+ * a compact copy of it (cf. BlockCsrMatrix) which allows the compiler to vectorize
+ * the block operations and distributes the rows over all threads of the process.
+ *
+ * To hide the latency of the communication, the rows of the result which are required
+ * by the peer processes are computed first. Then the exchange of the overlap is
+ * started and the remaining rows are computed while the messages are in flight.
+ *
+ * The sparsity pattern of the compact copy and the split of the rows only depend on
+ * the overlap, so the operator is supposed to be kept alive as long as the overlapping
+ * matrix. If the values of the matrix change, updateValues() must be called.
  */
 template <class OverlappingMatrix, class DomainVector, class RangeVector>
 class OverlappingOperator
     : public Dune::AssembledLinearOperator<OverlappingMatrix, DomainVector, RangeVector>
 {
     typedef typename OverlappingMatrix::Overlap Overlap;
+    typedef typename OverlappingMatrix::block_type MatrixBlock;
+    typedef BlockCsrMatrix<typename MatrixBlock::field_type, MatrixBlock::rows> CompactMatrix;
 
 public:
     //! export types
@@ -48,7 +66,17 @@ public:
     typedef typename domain_type::field_type field_type;
 
     OverlappingOperator(const OverlappingMatrix& A) : A_(A)
-    {}
+    {
+        compactA_.setPattern(A_);
+        splitRows_();
+    }
+
+    /*!
+     * \brief Copy the current values of the overlapping matrix to the compact
+     *        storage used by the matrix-vector products.
+     */
+    void updateValues()
+    { compactA_.assign(A_); }
 
 #if DUNE_VERSION_NEWER(DUNE_ISTL, 2,6)
     //! the kind of computations supported by the operator. Either overlapping or non-overlapping
@@ -62,16 +90,32 @@ public:
     //! apply operator to x:  \f$ y = A(x) \f$
     virtual void apply(const DomainVector& x, RangeVector& y) const override
     {
-        A_.mv(x, y);
-        y.sync();
+        if (sendRows_.empty()) {
+            compactA_.mv(x, y);
+            y.sync();
+            return;
+        }
+
+        compactA_.mv(x, y, sendRows_);
+        y.startSync();
+        compactA_.mv(x, y, remainingRows_);
+        y.finishSync();
     }
 
     //! apply operator to x, scale and add:  \f$ y = y + \alpha A(x) \f$
     virtual void applyscaleadd(field_type alpha, const DomainVector& x,
                                RangeVector& y) const override
     {
-        A_.usmv(alpha, x, y);
-        y.sync();
+        if (sendRows_.empty()) {
+            compactA_.usmv(alpha, x, y);
+            y.sync();
+            return;
+        }
+
+        compactA_.usmv(alpha, x, y, sendRows_);
+        y.startSync();
+        compactA_.usmv(alpha, x, y, remainingRows_);
+        y.finishSync();
     }
 
     //! returns the matrix
@@ -82,7 +126,32 @@ public:
     { return A_.overlap(); }
 
 private:
+    // split the rows of the matrix into the ones which are sent to any of the peer
+    // processes and the remaining ones. since this only depends on the overlap, it is
+    // done once when the operator is created.
+    void splitRows_()
+    {
+        const Overlap& overlap = A_.overlap();
+        std::vector<bool> isSendRow(A_.N(), false);
+        for (const auto& peerRank : overlap.peerSet()) {
+            size_t n = overlap.foreignOverlapSize(peerRank);
+            for (unsigned i = 0; i < n; ++i)
+                isSendRow[static_cast<size_t>(overlap.foreignOverlapOffsetToDomesticIdx(peerRank, i))] = true;
+        }
+
+        for (unsigned rowIdx = 0; rowIdx < A_.N(); ++rowIdx) {
+            if (isSendRow[rowIdx])
+                sendRows_.push_back(rowIdx);
+            else
+                remainingRows_.push_back(rowIdx);
+        }
+    }
+
     const OverlappingMatrix& A_;
+    CompactMatrix compactA_;
+
+    std::vector<unsigned> sendRows_;
+    std::vector<unsigned> remainingRows_;
 };
 
 } // namespace Linear
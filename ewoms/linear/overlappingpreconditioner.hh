@@ -77,7 +77,7 @@ public:
                           1,               // number of objects in buffers
                           MPI_SHORT,       // data type
                           MPI_MIN,         // operation
-                          MPI_COMM_WORLD); // communicator
+                          overlap_->communicator()); // communicator
         }
         catch (...)
         {
@@ -87,7 +87,7 @@ public:
                           1,               // number of objects in buffers
                           MPI_SHORT,       // data type
                           MPI_MIN,         // operation
-                          MPI_COMM_WORLD); // communicator
+                          overlap_->communicator()); // communicator
         }
 
         if (success) {
@@ -112,34 +112,33 @@ public:
             // make sure that all processes react the same if the
             // sequential preconditioner on one process throws an
             // exception
-            short success;
+            short localSuccess = 1;
             try
             {
                 // execute the sequential preconditioner
                 seqPreCond_.apply(x, d);
-                short localSuccess = 1;
-                MPI_Allreduce(&localSuccess,   // source buffer
-                              &success,        // destination buffer
-                              1,               // number of objects in buffers
-                              MPI_SHORT,       // data type
-                              MPI_MIN,         // operation
-                              MPI_COMM_WORLD); // communicator
             }
             catch (...)
             {
-                short localSuccess = 0;
-                MPI_Allreduce(&localSuccess,   // source buffer
-                              &success,        // destination buffer
-                              1,               // number of objects in buffers
-                              MPI_SHORT,       // data type
-                              MPI_MIN,         // operation
-                              MPI_COMM_WORLD); // communicator
+                localSuccess = 0;
             }
 
-            if (success) {
-                x.sync();
-            }
-            else
+            // the triangular solves of the sequential preconditioners cannot be split
+            // into rows which only depend on local data and the remaining ones, but
+            // the exchange of the overlap can be done while the processes agree on
+            // whether the preconditioner was successful. (if it was not, the exchanged
+            // values are simply thrown away.)
+            x.startSync();
+            short success;
+            MPI_Allreduce(&localSuccess,   // source buffer
+                          &success,        // destination buffer
+                          1,               // number of objects in buffers
+                          MPI_SHORT,       // data type
+                          MPI_MIN,         // operation
+                          overlap_->communicator()); // communicator
+            x.finishSync();
+
+            if (!success)
                 OPM_THROW(Opm::NumericalProblem,
                           "Preconditioner threw an exception on some process.");
         }
@@ -161,7 +160,7 @@ public:
                           1,               // number of objects in buffers
                           MPI_SHORT,       // data type
                           MPI_MIN,         // operation
-                          MPI_COMM_WORLD); // communicator
+                          overlap_->communicator()); // communicator
         }
         catch (...)
         {
@@ -171,7 +170,7 @@ public:
                           1,               // number of objects in buffers
                           MPI_SHORT,       // data type
                           MPI_MIN,         // operation
-                          MPI_COMM_WORLD); // communicator
+                          overlap_->communicator()); // communicator
         }
 
         if (success) {
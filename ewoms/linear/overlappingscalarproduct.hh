@@ -31,6 +31,14 @@
 #include <dune/common/parallel/mpihelper.hh>
 #include <dune/istl/scalarproducts.hh>
 
+#if HAVE_MPI
+#include <dune/common/parallel/mpitraits.hh>
+#include <mpi.h>
+#endif
+
+#include <utility>
+#include <vector>
+
 namespace Ewoms {
 namespace Linear {
 
@@ -61,18 +69,13 @@ public:
 #endif
 
     OverlappingScalarProduct(const Overlap& overlap)
-        : overlap_(overlap), comm_( Dune::MPIHelper::getCollectiveCommunication() )
+        : overlap_(overlap), comm_(overlap.communicator())
     {}
 
     field_type dot(const OverlappingBlockVector& x,
                    const OverlappingBlockVector& y) override
     {
-        field_type sum = 0;
-        size_t numLocal = overlap_.numLocal();
-        for (unsigned localIdx = 0; localIdx < numLocal; ++localIdx) {
-            if (overlap_.iAmMasterOf(static_cast<int>(localIdx)))
-                sum += x[localIdx] * y[localIdx];
-        }
+        field_type sum = localDot_(x, y);
 
         // return the global sum
         return comm_.sum( sum );
@@ -81,9 +84,70 @@ public:
     real_type norm(const OverlappingBlockVector& x) override
     { return std::sqrt(dot(x, x)); }
 
+    /*!
+     * \brief Start the computation of several scalar products at once.
+     *
+     * The local contributions are computed immediately and then summed up using a
+     * single non-blocking global reduction, i.e., the vectors may be modified before
+     * the results are retrieved by finishDots(). Only one such reduction can be
+     * pending at a time.
+     */
+    void startDots(const std::vector<std::pair<const OverlappingBlockVector*,
+                                               const OverlappingBlockVector*> >& pairs)
+    {
+        localDots_.resize(pairs.size());
+        globalDots_.resize(pairs.size());
+        for (unsigned i = 0; i < pairs.size(); ++i)
+            localDots_[i] = localDot_(*pairs[i].first, *pairs[i].second);
+
+#if HAVE_MPI
+        MPI_Iallreduce(localDots_.data(),
+                       globalDots_.data(),
+                       static_cast<int>(localDots_.size()),
+                       Dune::MPITraits<field_type>::getType(),
+                       MPI_SUM,
+                       overlap_.communicator(),
+                       &dotsRequest_);
+#else
+        globalDots_ = localDots_;
+#endif
+    }
+
+    /*!
+     * \brief Wait for the scalar products started by startDots() and return them.
+     *
+     * The results are in the same order as the pairs of vectors passed to startDots().
+     */
+    const std::vector<field_type>& finishDots()
+    {
+#if HAVE_MPI
+        MPI_Wait(&dotsRequest_, MPI_STATUS_IGNORE);
+#endif
+        return globalDots_;
+    }
+
 private:
+    field_type localDot_(const OverlappingBlockVector& x,
+                         const OverlappingBlockVector& y) const
+    {
+        field_type sum = 0;
+        size_t numLocal = overlap_.numLocal();
+        for (unsigned localIdx = 0; localIdx < numLocal; ++localIdx) {
+            if (overlap_.iAmMasterOf(static_cast<int>(localIdx)))
+                sum += x[localIdx] * y[localIdx];
+        }
+
+        return sum;
+    }
+
     const Overlap& overlap_;
     const CollectiveCommunication comm_;
+
+    std::vector<field_type> localDots_;
+    std::vector<field_type> globalDots_;
+#if HAVE_MPI
+    MPI_Request dotsRequest_;
+#endif
 };
 
 } // namespace Linear
@@ -29,11 +29,16 @@
 #ifndef EWOMS_OVERLAP_TYPES_HH
 #define EWOMS_OVERLAP_TYPES_HH
 
+#include <opm/common/Unused.hpp>
+
+#include <dune/common/parallel/mpihelper.hh>
+
 #include <set>
 #include <list>
 #include <vector>
 #include <map>
 #include <cstddef>
+#include <type_traits>
 
 namespace Ewoms {
 namespace Linear {
@@ -53,6 +58,38 @@ typedef unsigned ProcessRank;
  */
 typedef unsigned BorderDistance;
 
+/*!
+ * \brief The type of the communicator used by the parallel linear algebra.
+ *
+ * If MPI is available, this is MPI_Comm, else it is a dummy type.
+ */
+typedef Dune::MPIHelper::MPICommunicator Communicator;
+
+/*!
+ * \brief Returns the communicator which corresponds to the collective
+ *        communication object of a grid.
+ *
+ * Grids which do not support MPI are considered to be local to the
+ * process.
+ */
+template <class CollectiveCommunication>
+typename std::enable_if<std::is_convertible<CollectiveCommunication, Communicator>::value,
+                        Communicator>::type
+gridCommunicator(const CollectiveCommunication& gridComm)
+{ return gridComm; }
+
+template <class CollectiveCommunication>
+typename std::enable_if<!std::is_convertible<CollectiveCommunication, Communicator>::value,
+                        Communicator>::type
+gridCommunicator(const CollectiveCommunication& gridComm OPM_UNUSED)
+{
+#if HAVE_MPI
+    return MPI_COMM_SELF;
+#else
+    return Communicator();
+#endif
+}
+
 /*!
  * \brief This structure stores an index and a process rank
  */
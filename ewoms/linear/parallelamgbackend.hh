@@ -29,12 +29,22 @@
 
 #include "parallelbasebackend.hh"
 #include "bicgstabsolver.hh"
+#include "gcrotsolver.hh"
 #include "combinedcriterion.hh"
+#include "mixedprecisionpreconditioner.hh"
 
 #include <dune/istl/paamg/amg.hh>
 #include <dune/istl/paamg/pinfo.hh>
 #include <dune/istl/owneroverlapcopy.hh>
 
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <string>
+#include <type_traits>
 #include <iostream>
 
 namespace Ewoms {
@@ -48,6 +58,10 @@ NEW_TYPE_TAG(ParallelAmgLinearSolver, INHERITS_FROM(ParallelBaseLinearSolver));
 
 NEW_PROP_TAG(AmgCoarsenTarget);
 NEW_PROP_TAG(LinearSolverMaxError);
+NEW_PROP_TAG(LinearSolverKrylovMethod);
+NEW_PROP_TAG(AmgReuseHierarchy);
+NEW_PROP_TAG(AmgRebuildInterval);
+NEW_PROP_TAG(AmgStagnationFactor);
 
 //! The target number of DOFs per processor for the parallel algebraic
 //! multi-grid solver
@@ -55,6 +69,21 @@ SET_INT_PROP(ParallelAmgLinearSolver, AmgCoarsenTarget, 5000);
 
 SET_SCALAR_PROP(ParallelAmgLinearSolver, LinearSolverMaxError, 1e7);
 
+//! use the classical BiCGStab method as the outer Krylov solver by default
+SET_STRING_PROP(ParallelAmgLinearSolver, LinearSolverKrylovMethod, "bicgstab");
+
+//! Rebuild the complete AMG hierarchy for each linear solve by default. (Reusing it
+//! leaves the coarse level solver of the AMG untouched, see ParallelAmgBackend.)
+SET_BOOL_PROP(ParallelAmgLinearSolver, AmgReuseHierarchy, false);
+
+//! The number of linear solves after which the AMG hierarchy is completely rebuilt
+//! even if it could be reused. (0 means that it is only rebuilt on demand.)
+SET_INT_PROP(ParallelAmgLinearSolver, AmgRebuildInterval, 10);
+
+//! Rebuild the AMG hierarchy if a linear solve requires more than this factor times
+//! the iterations of the first solve after the last rebuild
+SET_SCALAR_PROP(ParallelAmgLinearSolver, AmgStagnationFactor, 2.0);
+
 SET_TYPE_PROP(ParallelAmgLinearSolver, LinearSolverBackend,
               Ewoms::Linear::ParallelAmgBackend<TypeTag>);
 } // namespace Properties
@@ -65,6 +94,28 @@ namespace Linear {
  *
  * \brief Provides a linear solver backend using the parallel
  *        algebraic multi-grid (AMG) linear solver from DUNE-ISTL.
+ *
+ * The parallel index sets and the fine level operator are kept as long as the
+ * overlapping matrix exists, i.e., until cleanup_() is called by
+ * ParallelBaseBackend::prepare_() because the grid, the overlap size or the sparsity
+ * pattern of the matrix has changed. (eraseMatrix() only causes the pattern to be
+ * compared.) cleanup_() is also the only place where the AMG hierarchy is discarded.
+ *
+ * If the \c AmgReuseHierarchy parameter is enabled, the aggregates of the AMG are
+ * additionally kept between linear solves and only the Galerkin products of the coarse
+ * levels are recomputed. The smoothers operate on these matrices directly, but the
+ * coarse level solver of DUNE's AMG is not updated. (This matters if it uses a direct
+ * solver.) The reused hierarchy is thus only a preconditioner for an approximation of
+ * the current matrix: if a solve using it does not converge, the solve is retried
+ * using a completely rebuilt hierarchy. Besides this, the hierarchy is rebuilt after a
+ * fixed number of solves and if the number of iterations of the linear solver
+ * indicates that the aggregates do not fit the current matrix anymore.
+ *
+ * The outer Krylov method is chosen using the \c LinearSolverKrylovMethod parameter:
+ * Besides \c bicgstab, \c gcrot selects the GcrotSolver, which recycles search
+ * directions between the linear solves. This helps with the low-frequency error
+ * modes which are not effectively reduced by the smoother, e.g., for strongly
+ * heterogeneous permeability fields.
  */
 template <class TypeTag>
 class ParallelAmgBackend : public ParallelBaseBackend<TypeTag>
@@ -73,9 +124,10 @@ class ParallelAmgBackend : public ParallelBaseBackend<TypeTag>
 
     typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
     typedef typename GET_PROP_TYPE(TypeTag, LinearSolverScalar) LinearSolverScalar;
+    typedef typename GET_PROP_TYPE(TypeTag, PreconditionerScalar) PreconditionerScalar;
     typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
     typedef typename GET_PROP_TYPE(TypeTag, GridView) GridView;
-    typedef typename GET_PROP_TYPE(TypeTag, Overlap) Overlap;
+    typedef typename GET_PROP_TYPE(TypeTag, GlobalEqVector) GlobalEqVector;
 
     typedef typename ParentType::ParallelOperator ParallelOperator;
     typedef typename ParentType::OverlappingVector OverlappingVector;
@@ -83,8 +135,15 @@ class ParallelAmgBackend : public ParallelBaseBackend<TypeTag>
     typedef typename ParentType::ParallelScalarProduct ParallelScalarProduct;
 
     static constexpr int numEq = GET_PROP_VALUE(TypeTag, NumEq);
-    typedef Dune::FieldVector<LinearSolverScalar, numEq> VectorBlock;
-    typedef Dune::FieldMatrix<LinearSolverScalar, numEq, numEq> MatrixBlock;
+
+    // the AMG hierarchy is stored using the floating point type of the
+    // preconditioner. if this differs from the one of the linear solver, the AMG
+    // operates on a copy of the matrix and the vectors are converted when the
+    // preconditioner is applied.
+    static constexpr bool mixedPrecision =
+        !std::is_same<PreconditionerScalar, LinearSolverScalar>::value;
+    typedef Dune::FieldVector<PreconditionerScalar, numEq> VectorBlock;
+    typedef Dune::FieldMatrix<PreconditionerScalar, numEq, numEq> MatrixBlock;
 
     typedef Dune::BCRSMatrix<MatrixBlock> Matrix;
     typedef Dune::BlockVector<VectorBlock> Vector;
@@ -121,14 +180,48 @@ class ParallelAmgBackend : public ParallelBaseBackend<TypeTag>
     typedef Dune::Amg::AMG<FineOperator, Vector, ParallelSmoother> AMG;
 #endif
 
+    typedef typename std::conditional<mixedPrecision,
+                                      MixedPrecisionPreconditioner<AMG, OverlappingVector>,
+                                      AMG>::type Preconditioner;
+
     typedef BiCGStabSolver<ParallelOperator,
                            OverlappingVector,
-                           AMG> RawLinearSolver;
+                           Preconditioner> BiCGStab;
+    typedef GcrotSolver<ParallelOperator,
+                        OverlappingVector,
+                        Preconditioner,
+                        ParallelScalarProduct> Gcrot;
+
+    // holds the Krylov solver which was selected at run time
+    struct RawLinearSolver
+    {
+        std::shared_ptr<BiCGStab> bicgstab;
+        std::shared_ptr<Gcrot> gcrot;
+
+        bool apply(OverlappingVector& x)
+        {
+            if (bicgstab)
+                return bicgstab->apply(x);
+            return gcrot->apply(x);
+        }
+
+        unsigned iterations() const
+        {
+            if (bicgstab)
+                return bicgstab->report().iterations();
+            return gcrot->report().iterations();
+        }
+    };
 
 public:
     ParallelAmgBackend(const Simulator& simulator)
         : ParentType(simulator)
-    { }
+    {
+        rebuildAmg_ = true;
+        reusedHierarchy_ = false;
+        numSolvesSinceRebuild_ = 0;
+        iterationsAfterRebuild_ = 0;
+    }
 
     static void registerParameters()
     {
@@ -137,42 +230,124 @@ public:
         EWOMS_REGISTER_PARAM(TypeTag, Scalar, LinearSolverMaxError,
                              "The maximum residual error which the linear solver tolerates"
                              " without giving up");
+        EWOMS_REGISTER_PARAM(TypeTag, std::string, LinearSolverKrylovMethod,
+                             "The Krylov method used by the linear solver. Possible values: "
+                             "'bicgstab' and 'gcrot'");
         EWOMS_REGISTER_PARAM(TypeTag, int, AmgCoarsenTarget,
                              "The coarsening target for the agglomerations of "
                              "the AMG preconditioner");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, AmgReuseHierarchy,
+                             "Only recompute the coarse level operators of the AMG "
+                             "if the sparsity pattern of the matrix is unchanged. "
+                             "If this does not converge, the linear system is solved "
+                             "again using a rebuilt AMG");
+        EWOMS_REGISTER_PARAM(TypeTag, int, AmgRebuildInterval,
+                             "The number of linear solves after which the AMG hierarchy "
+                             "is completely rebuilt (0 means never)");
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, AmgStagnationFactor,
+                             "Rebuild the AMG hierarchy if the number of linear "
+                             "iterations grows by more than this factor");
+    }
+
+    /*!
+     * \brief Actually solve the linear system of equations.
+     *
+     * If the solve used a reused AMG hierarchy and did not converge, it is repeated
+     * using a rebuilt hierarchy.
+     *
+     * \return true if the residual reduction could be achieved, else false.
+     */
+    bool solve(GlobalEqVector& x)
+    {
+        if (ParentType::solve(x))
+            return true;
+
+        if (!reusedHierarchy_)
+            return false;
+
+        // runSolver_() has requested a rebuild of the hierarchy
+        assert(rebuildAmg_);
+        return ParentType::solve(x);
     }
 
 protected:
     friend ParentType;
 
-    std::shared_ptr<AMG> preparePreconditioner_()
+    std::shared_ptr<Preconditioner> preparePreconditioner_()
     {
+        const Matrix& fineMatrix = updateFineMatrix_(std::integral_constant<bool, mixedPrecision>());
+
+        if (!fineOperator_) {
+            // the index sets and the fine operator only depend on the overlapping
+            // matrix, i.e., they stay valid until the next call to cleanup_()
 #if HAVE_MPI
-        // create and initialize DUNE's OwnerOverlapCopyCommunication
-        // using the domestic overlap
-        istlComm_ = std::make_shared<OwnerOverlapCopyCommunication>(MPI_COMM_WORLD);
-        setupAmgIndexSet_(this->overlappingMatrix_->overlap(), istlComm_->indexSet());
-        istlComm_->remoteIndices().template rebuild<false>();
+            // create and initialize DUNE's OwnerOverlapCopyCommunication
+            // using the domestic overlap
+            const auto& overlap = this->overlappingMatrix_->overlap();
+            istlComm_ = std::make_shared<OwnerOverlapCopyCommunication>(overlap.communicator());
+            ParentType::setupAmgIndexSet_(overlap, istlComm_->indexSet());
+            istlComm_->remoteIndices().template rebuild<false>();
 #endif
 
-        // create the parallel scalar product and the parallel operator
+            // create the parallel scalar product and the parallel operator
 #if HAVE_MPI
-        fineOperator_ = std::make_shared<FineOperator>(*this->overlappingMatrix_, *istlComm_);
+            fineOperator_ = std::make_shared<FineOperator>(fineMatrix, *istlComm_);
 #else
-        fineOperator_ = std::make_shared<FineOperator>(*this->overlappingMatrix_);
+            fineOperator_ = std::make_shared<FineOperator>(fineMatrix);
 #endif
+        }
+
+        int rebuildInterval = EWOMS_GET_PARAM(TypeTag, int, AmgRebuildInterval);
+        if (amg_
+            && !rebuildAmg_
+            && EWOMS_GET_PARAM(TypeTag, bool, AmgReuseHierarchy)
+            && (rebuildInterval <= 0 || numSolvesSinceRebuild_ + 1 < static_cast<unsigned>(rebuildInterval)))
+        {
+            // the sparsity pattern of the fine matrix is unchanged, so we keep the
+            // aggregates and only recompute the Galerkin products of the coarse
+            // levels. the coarse level solver stays the same.
+            amg_->recalculateHierarchy();
+            reusedHierarchy_ = true;
+            ++numSolvesSinceRebuild_;
+            return wrapAmg_(std::integral_constant<bool, mixedPrecision>());
+        }
 
         setupAmg_();
 
-        return amg_;
+        rebuildAmg_ = false;
+        reusedHierarchy_ = false;
+        numSolvesSinceRebuild_ = 0;
+        iterationsAfterRebuild_ = 0;
+
+        return wrapAmg_(std::integral_constant<bool, mixedPrecision>());
+    }
+
+    // the AMG directly operates on the overlapping matrix
+    const Matrix& updateFineMatrix_(std::false_type)
+    { return *this->overlappingMatrix_; }
+
+    // the AMG operates on a copy of the overlapping matrix which uses the floating
+    // point type of the preconditioner
+    const Matrix& updateFineMatrix_(std::true_type)
+    {
+        if (!lowPrecMatrix_)
+            lowPrecMatrix_.reset(new Matrix);
+        copyMatrixPrecision(*lowPrecMatrix_, *this->overlappingMatrix_);
+        return *lowPrecMatrix_;
     }
 
+    std::shared_ptr<Preconditioner> wrapAmg_(std::false_type)
+    { return amg_; }
+
+    std::shared_ptr<Preconditioner> wrapAmg_(std::true_type)
+    { return std::make_shared<Preconditioner>(*amg_); }
+
     void cleanupPreconditioner_()
     { /* nothing to do */ }
 
     std::shared_ptr<RawLinearSolver> prepareSolver_(ParallelOperator& parOperator,
                                                     ParallelScalarProduct& parScalarProduct,
-                                                    AMG& parPreCond)
+                                                    Preconditioner& parPreCond)
     {
         const auto& gridView = this->simulator_.gridView();
         typedef CombinedCriterion<OverlappingVector, decltype(gridView.comm())> CCC;
@@ -185,54 +360,76 @@ protected:
                                 /*absoluteResidualTolerance=*/linearSolverAbsTolerance,
                                 EWOMS_GET_PARAM(TypeTag, Scalar, LinearSolverMaxError)));
 
-        auto bicgstabSolver =
-            std::make_shared<RawLinearSolver>(parPreCond, *convCrit_, parScalarProduct);
+        auto rawSolver = std::make_shared<RawLinearSolver>();
+        const std::string& method = EWOMS_GET_PARAM(TypeTag, std::string, LinearSolverKrylovMethod);
+        if (method == "bicgstab") {
+            rawSolver->bicgstab =
+                std::make_shared<BiCGStab>(parPreCond, *convCrit_, parScalarProduct);
+            setupSolver_(*rawSolver->bicgstab, parOperator);
+        }
+        else if (method == "gcrot") {
+            rawSolver->gcrot =
+                std::make_shared<Gcrot>(parPreCond, *convCrit_, parScalarProduct);
+            rawSolver->gcrot->setRestart(static_cast<unsigned>(EWOMS_GET_PARAM(TypeTag, int, LinearSolverRestart)));
+            this->recycleSpace_.setMaxSize(this->recycleDimension_());
+            rawSolver->gcrot->setRecycleSpace(&this->recycleSpace_);
+            setupSolver_(*rawSolver->gcrot, parOperator);
+        }
+        else
+            OPM_THROW(std::invalid_argument,
+                      "Unknown Krylov method '" << method << "' specified");
+
+        return rawSolver;
+    }
 
+    template <class Solver>
+    void setupSolver_(Solver& solver, ParallelOperator& parOperator)
+    {
         int verbosity = 0;
         if (parOperator.overlap().myRank() == 0)
             verbosity = EWOMS_GET_PARAM(TypeTag, int, LinearSolverVerbosity);
-        bicgstabSolver->setVerbosity(verbosity);
-        bicgstabSolver->setMaxIterations(EWOMS_GET_PARAM(TypeTag, int, LinearSolverMaxIterations));
-        bicgstabSolver->setLinearOperator(&parOperator);
-        bicgstabSolver->setRhs(this->overlappingb_);
-
-        return bicgstabSolver;
+        solver.setVerbosity(verbosity);
+        solver.setMaxIterations(EWOMS_GET_PARAM(TypeTag, int, LinearSolverMaxIterations));
+        solver.setLinearOperator(&parOperator);
+        solver.setRhs(this->overlappingb_);
     }
 
     bool runSolver_(std::shared_ptr<RawLinearSolver> solver)
-    { return solver->apply(*this->overlappingx_); }
+    {
+        bool converged = solver->apply(*this->overlappingx_);
+        this->iterations_ = solver->iterations();
+
+        // decide whether the AMG hierarchy needs to be rebuilt for the next solve
+        Scalar stagnationFactor = EWOMS_GET_PARAM(TypeTag, Scalar, AmgStagnationFactor);
+        if (!converged)
+            rebuildAmg_ = true;
+        else if (numSolvesSinceRebuild_ == 0)
+            iterationsAfterRebuild_ = this->iterations_;
+        else if (this->iterations_ > stagnationFactor*std::max(iterationsAfterRebuild_, 1u))
+            rebuildAmg_ = true;
+
+        return converged;
+    }
 
     void cleanupSolver_()
     { /* nothing to do */ }
 
-#if HAVE_MPI
-    template <class ParallelIndexSet>
-    void setupAmgIndexSet_(const Overlap& overlap, ParallelIndexSet& istlIndices)
+    // this is called by ParallelBaseBackend::prepare_() whenever the overlapping
+    // matrix is recreated
+    void cleanup_()
     {
-        typedef Dune::OwnerOverlapCopyAttributeSet GridAttributes;
-        typedef Dune::OwnerOverlapCopyAttributeSet::AttributeSet GridAttributeSet;
-
-        // create DUNE's ParallelIndexSet from a domestic overlap
-        istlIndices.beginResize();
-        for (Index curIdx = 0; static_cast<size_t>(curIdx) < overlap.numDomestic(); ++curIdx) {
-            GridAttributeSet gridFlag =
-                overlap.iAmMasterOf(curIdx)
-                ? GridAttributes::owner
-                : GridAttributes::copy;
-
-            // an index is used by other processes if it is in the
-            // domestic or in the foreign overlap.
-            bool isShared = overlap.isInOverlap(curIdx);
-
-            assert(curIdx == overlap.globalToDomestic(overlap.domesticToGlobal(curIdx)));
-            istlIndices.add(/*globalIdx=*/overlap.domesticToGlobal(curIdx),
-                            Dune::ParallelLocalIndex<GridAttributeSet>(static_cast<size_t>(curIdx),
-                                                                       gridFlag,
-                                                                       isShared));
-        }
-        istlIndices.endResize();
-    }
+        // the AMG hierarchy references the overlapping matrix, so it must be thrown
+        // away before the matrix is deleted
+        amg_.reset();
+        fineOperator_.reset();
+        lowPrecMatrix_.reset();
+#if HAVE_MPI
+        istlComm_.reset();
 #endif
+        rebuildAmg_ = true;
+
+        ParentType::cleanup_();
+    }
 
     void setupAmg_()
     {
@@ -282,9 +479,15 @@ protected:
 
     std::unique_ptr<ConvergenceCriterion<OverlappingVector> > convCrit_;
 
+    std::unique_ptr<Matrix> lowPrecMatrix_;
     std::shared_ptr<FineOperator> fineOperator_;
     std::shared_ptr<AMG> amg_;
 
+    bool rebuildAmg_;
+    bool reusedHierarchy_;
+    unsigned numSolvesSinceRebuild_;
+    unsigned iterationsAfterRebuild_;
+
 #if HAVE_MPI
     std::shared_ptr<OwnerOverlapCopyCommunication> istlComm_;
 #endif
@@ -34,18 +34,34 @@
 #include <ewoms/linear/overlappingoperator.hh>
 #include <ewoms/linear/parallelbasebackend.hh>
 #include <ewoms/linear/istlpreconditionerwrappers.hh>
+#include <ewoms/linear/dofreordering.hh>
+#include <ewoms/linear/blockcsrmatrix.hh>
+#include <ewoms/linear/gcrotsolver.hh>
 
 #include <ewoms/common/genericguard.hh>
 #include <ewoms/common/propertysystem.hh>
 #include <ewoms/common/parametersystem.hh>
+#include <ewoms/common/timer.hh>
 
 #include <dune/grid/io/file/vtk/vtkwriter.hh>
 
 #include <dune/common/fvector.hh>
-
+#include <dune/istl/owneroverlapcopy.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/solvers.hh>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
 #include <sstream>
 #include <memory>
 #include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 namespace Ewoms {
 namespace Properties {
@@ -53,6 +69,7 @@ NEW_TYPE_TAG(ParallelBaseLinearSolver);
 
 // forward declaration of the required property tags
 NEW_PROP_TAG(Simulator);
+NEW_PROP_TAG(ElementContext);
 NEW_PROP_TAG(Scalar);
 NEW_PROP_TAG(NumEq);
 NEW_PROP_TAG(JacobianMatrix);
@@ -77,6 +94,15 @@ NEW_PROP_TAG(PreconditionerWrapper);
 //! The floating point type used internally by the linear solver
 NEW_PROP_TAG(LinearSolverScalar);
 
+/*!
+ * \brief The floating point type used to store the data of the preconditioner.
+ *
+ * If this is a lower precision type than LinearSolverScalar, the preconditioner is
+ * applied in the lower precision while the linear solver itself and the linear
+ * operator use LinearSolverScalar.
+ */
+NEW_PROP_TAG(PreconditionerScalar);
+
 /*!
  * \brief The size of the algebraic overlap of the linear solver.
  *
@@ -108,6 +134,38 @@ NEW_PROP_TAG(PreconditionerOrder);
 
 //! The relaxation factor of the preconditioner
 NEW_PROP_TAG(PreconditionerRelaxation);
+
+/*!
+ * \brief The ordering of the degrees of freedom used by the linear solver.
+ *
+ * Possible values are "native" (use the numbering of the DOF mapper), "rcm" (reverse
+ * Cuthill-McKee ordering of the Jacobian's sparsity pattern) and "morton" (order the
+ * degrees of freedom along a Morton space filling curve). The ordering only affects
+ * the linear system of equations seen by the preconditioner and the Krylov solver.
+ * If the verbosity of the linear solver is larger than 0, its effect on the bandwidth,
+ * on the convergence of ILU(0) and on the speed of the matrix-vector products is
+ * printed whenever the linear system is set up.
+ */
+NEW_PROP_TAG(LinearSolverDofOrdering);
+
+//! The number of iterations after which the GMRES-like Krylov methods are restarted
+NEW_PROP_TAG(LinearSolverRestart);
+
+/*!
+ * \brief The maximum number of search directions which are recycled between linear
+ *        solves by the GCROT Krylov method.
+ */
+NEW_PROP_TAG(LinearSolverRecycleDimension);
+
+/*!
+ * \brief The memory in megabytes per process which may be used to store the recycled
+ *        search directions.
+ *
+ * If this is smaller than what is required for LinearSolverRecycleDimension
+ * directions (including their images under the linear operator), the number of
+ * directions is reduced accordingly. 0 means that the memory is not limited.
+ */
+NEW_PROP_TAG(LinearSolverRecycleMemoryBudget);
 }} // namespace Properties, Ewoms
 
 namespace Ewoms {
@@ -137,6 +195,9 @@ namespace Linear {
  *            that it is computationally cheaper because it does not
  *            need to consider things which are only required for
  *            higher orders
+ * - \c ThreadedILU0: The same as ILU0, but the factorization and the
+ *            triangular solves are distributed over all threads of the
+ *            process
  */
 template <class TypeTag>
 class ParallelBaseBackend
@@ -145,6 +206,7 @@ protected:
     typedef typename GET_PROP_TYPE(TypeTag, LinearSolverBackend) Implementation;
 
     typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
+    typedef typename GET_PROP_TYPE(TypeTag, ElementContext) ElementContext;
     typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
     typedef typename GET_PROP_TYPE(TypeTag, JacobianMatrix) Matrix;
     typedef typename GET_PROP_TYPE(TypeTag, GlobalEqVector) Vector;
@@ -168,12 +230,19 @@ protected:
 
     enum { dimWorld = GridView::dimensionworld };
 
+    typedef Dune::FieldVector<Scalar, dimWorld> GlobalPosition;
+
 public:
     ParallelBaseBackend(const Simulator& simulator)
         : simulator_(simulator)
         , gridSequenceNumber_( -1 )
+        , overlapSize_(0)
+        , patternMayHaveChanged_(false)
+        , dofOrderingReportPending_(false)
     {
+        iterations_ = 0;
         overlappingMatrix_ = nullptr;
+        overlappingOperator_ = nullptr;
         overlappingb_ = nullptr;
         overlappingx_ = nullptr;
     }
@@ -194,6 +263,18 @@ public:
                              "The maximum number of iterations of the linear solver");
         EWOMS_REGISTER_PARAM(TypeTag, int, LinearSolverVerbosity,
                              "The verbosity level of the linear solver");
+        EWOMS_REGISTER_PARAM(TypeTag, std::string, LinearSolverDofOrdering,
+                             "The ordering of the degrees of freedom used by the linear "
+                             "solver. Possible values: 'native', 'rcm' and 'morton'");
+        EWOMS_REGISTER_PARAM(TypeTag, int, LinearSolverRestart,
+                             "The number of iterations after which the GMRES-like Krylov "
+                             "methods are restarted");
+        EWOMS_REGISTER_PARAM(TypeTag, int, LinearSolverRecycleDimension,
+                             "The maximum number of search directions which are recycled "
+                             "between linear solves by the GCROT Krylov method");
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, LinearSolverRecycleMemoryBudget,
+                             "The memory in megabytes per process which may be used for the "
+                             "recycled search directions (0 means unlimited)");
 
         PreconditionerWrapper::registerParameters();
     }
@@ -201,9 +282,21 @@ public:
     /*!
      * \brief Causes the solve() method to discared the structure of the linear system of
      *        equations the next time it is called.
+     *
+     * Since setting up the algebraic overlap is expensive, the structure is only
+     * discarded if the sparsity pattern of the matrix has actually changed on any
+     * process. This method must thus be called by all processes at the same time,
+     * e.g., after the grid was adapted or redistributed.
      */
     void eraseMatrix()
-    { cleanup_(); }
+    { patternMayHaveChanged_ = true; }
+
+    /*!
+     * \brief Returns the number of iterations used by the linear solver for the most
+     *        recent call to solve().
+     */
+    unsigned iterations() const
+    { return iterations_; }
 
     void prepareMatrix(const Matrix& M)
     {
@@ -213,14 +306,19 @@ public:
 
         // copy the interior values of the non-overlapping linear system of
         // equations to the overlapping one. On ther border, we add up
-        // the values of all processes (using the assignAdd() methods)
-        overlappingMatrix_->assignFromNative(M);
+        // the values of all processes (using the assignAdd() methods). The
+        // equations are scaled by their weights while they are copied
+        const auto& model = simulator_.model();
+        overlappingMatrix_->assignFromNative(M,
+                                             [&model](unsigned nativeRowIdx, unsigned eqIdx)
+                                             { return model.eqWeight(nativeRowIdx, eqIdx); });
 
         asImp_().rescale_();
 
         // synchronize all entries from their master processes and add entries on the
         // process border
         overlappingMatrix_->syncAdd();
+        overlappingOperator_->updateValues();
         // the entries on the border have already been added in prepareRhs()
         overlappingb_->sync();
     }
@@ -249,6 +347,14 @@ public:
     {
         (*overlappingx_) = 0.0;
 
+        // the effect of the DOF ordering can only be determined once the values of the
+        // linear system are known. (the solvers may modify the right hand side.)
+        if (dofOrderingReportPending_) {
+            dofOrderingReportPending_ = false;
+            if (overlappingMatrix_->overlap().myRank() == 0)
+                reportDofOrdering_();
+        }
+
         auto parPreCond = asImp_().preparePreconditioner_();
 
         auto cleanupPrecondFn =
@@ -257,12 +363,12 @@ public:
 
         GenericGuard<decltype(cleanupPrecondFn)> precondGuard(cleanupPrecondFn);
 
-        // create the parallel scalar product and the parallel operator
+        // create the parallel scalar product. the parallel operator lives as long as
+        // the overlapping matrix
         ParallelScalarProduct parScalarProduct(overlappingMatrix_->overlap());
-        ParallelOperator parOperator(*overlappingMatrix_);
 
         // retrieve the linear solver
-        auto solver = asImp_().prepareSolver_(parOperator,
+        auto solver = asImp_().prepareSolver_(*overlappingOperator_,
                                               parScalarProduct,
                                               *parPreCond);
 
@@ -292,23 +398,56 @@ protected:
     {
         // if grid has changed the sequence number has changed too
         int curSeqNum = simulator_.gridManager().gridSequenceNumber();
-        if( gridSequenceNumber_ == curSeqNum && overlappingMatrix_)
-            // the grid has not changed since the overlappingMatrix_has been created, so
-            // there's noting to do
+        unsigned overlapSize = EWOMS_GET_PARAM(TypeTag, unsigned, LinearSolverOverlapSize);
+        bool upToDate =
+            gridSequenceNumber_ == curSeqNum
+            && overlapSize_ == overlapSize
+            && overlappingMatrix_;
+
+        // the grid has not changed since the overlapping matrix has been created, so
+        // there is nothing to do
+        if (upToDate && !patternMayHaveChanged_)
             return;
 
+        if (patternMayHaveChanged_) {
+            // eraseMatrix() has been called on all processes, but the grid of some of
+            // them might not have changed. since the overlap is constructed
+            // collectively, the processes must agree on whether it is recreated, so the
+            // overlapping matrix is only kept if it is up to date and the sparsity
+            // pattern of the matrix is unchanged on all processes.
+            int keepMatrix = (upToDate && matchesNativePattern_(M))?1:0;
+            keepMatrix = simulator_.gridView().comm().min(keepMatrix);
+            patternMayHaveChanged_ = false;
+            if (keepMatrix)
+                return;
+        }
+
         asImp_().cleanup_();
         gridSequenceNumber_ = curSeqNum;
+        overlapSize_ = overlapSize;
+        patternMayHaveChanged_ = false;
+        storeNativePattern_(M);
 
         BorderListCreator borderListCreator(simulator_.gridView(),
                                             simulator_.model().dofMapper());
 
         // create the overlapping Jacobian matrix
-        unsigned overlapSize = EWOMS_GET_PARAM(TypeTag, unsigned, LinearSolverOverlapSize);
+        const std::string& dofOrdering = EWOMS_GET_PARAM(TypeTag, std::string, LinearSolverDofOrdering);
         overlappingMatrix_ = new OverlappingMatrix(M,
                                                    borderListCreator.borderList(),
                                                    borderListCreator.blackList(),
-                                                   overlapSize);
+                                                   overlapSize,
+                                                   nativeOrdering_(M, dofOrdering),
+                                                   gridCommunicator(simulator_.gridView().comm()));
+
+        dofOrderingReportPending_ =
+            EWOMS_GET_PARAM(TypeTag, int, LinearSolverVerbosity) > 0
+            && dofOrdering != "native";
+
+        // create the linear operator. the row split of the operator and the pattern of
+        // its compact matrix only depend on the overlap, so they are set up here and
+        // only the values are updated for each linear solve
+        overlappingOperator_ = new ParallelOperator(*overlappingMatrix_);
 
         // create the overlapping vectors for the residual and the
         // solution
@@ -318,21 +457,177 @@ protected:
         // writeOverlapToVTK_();
     }
 
+    // remember the sparsity pattern of the native matrix for which the overlapping
+    // matrix was created
+    void storeNativePattern_(const Matrix& M)
+    {
+        nativeRowStart_.resize(M.N() + 1);
+        nativeColIndices_.resize(M.nonzeroes());
+
+        size_t entryIdx = 0;
+        for (size_t rowIdx = 0; rowIdx < M.N(); ++rowIdx) {
+            nativeRowStart_[rowIdx] = entryIdx;
+            const auto& row = M[rowIdx];
+            for (auto colIt = row.begin(); colIt != row.end(); ++colIt, ++entryIdx)
+                nativeColIndices_[entryIdx] = static_cast<unsigned>(colIt.index());
+        }
+        nativeRowStart_[M.N()] = entryIdx;
+    }
+
+    // returns true iff a native matrix exhibits the sparsity pattern which was used
+    // to create the overlapping matrix
+    bool matchesNativePattern_(const Matrix& M) const
+    {
+        if (M.N() + 1 != nativeRowStart_.size() || M.nonzeroes() != nativeColIndices_.size())
+            return false;
+
+        size_t entryIdx = 0;
+        for (size_t rowIdx = 0; rowIdx < M.N(); ++rowIdx) {
+            const auto& row = M[rowIdx];
+            if (nativeRowStart_[rowIdx + 1] - nativeRowStart_[rowIdx] != row.size())
+                return false;
+
+            for (auto colIt = row.begin(); colIt != row.end(); ++colIt, ++entryIdx)
+                if (nativeColIndices_[entryIdx] != colIt.index())
+                    return false;
+        }
+
+        return true;
+    }
+
+    // returns the ordering of the native indices used for the overlapping linear
+    // system. an empty vector means that the native ordering is kept.
+    std::vector<Index> nativeOrdering_(const Matrix& M, const std::string& dofOrdering) const
+    {
+        if (dofOrdering == "native")
+            return std::vector<Index>();
+        else if (dofOrdering == "rcm")
+            return reverseCuthillMcKeeOrdering(M);
+        else if (dofOrdering == "morton") {
+            // order the grid DOFs along the curve and put the auxiliary DOFs (e.g.,
+            // the ones of wells) at the end
+            std::vector<Index> ordering = mortonOrdering(gridDofPositions_());
+            for (size_t dofIdx = ordering.size(); dofIdx < M.N(); ++dofIdx)
+                ordering.push_back(static_cast<Index>(dofIdx));
+            return ordering;
+        }
+
+        OPM_THROW(std::invalid_argument,
+                  "Unknown DOF ordering '" << dofOrdering << "' specified");
+    }
+
+    // compares the local part of the overlapping linear system in the DOF ordering used
+    // by the linear solver with the same system in the native ordering. this prints the
+    // bandwidth of the matrix, the number of iterations of a sequential ILU(0)
+    // preconditioned BiCGStab solver and the time of a sparse matrix-vector product.
+    void reportDofOrdering_() const
+    {
+        typedef typename OverlappingMatrix::ParentType SequentialMatrix;
+        typedef Dune::BlockVector<typename OverlappingVector::block_type> SequentialVector;
+
+        const auto& overlap = overlappingMatrix_->overlap();
+        const SequentialMatrix& orderedMatrix = overlappingMatrix_->asParent();
+
+        // sort the local rows by their native index. the rows of the overlap stay at
+        // the end.
+        std::vector<Index> nativeOrdering(overlap.numLocal());
+        std::iota(nativeOrdering.begin(), nativeOrdering.end(), 0);
+        std::sort(nativeOrdering.begin(), nativeOrdering.end(),
+                  [&overlap](Index a, Index b)
+                  { return overlap.domesticToNative(a) < overlap.domesticToNative(b); });
+        for (size_t domesticIdx = overlap.numLocal(); domesticIdx < overlap.numDomestic(); ++domesticIdx)
+            nativeOrdering.push_back(static_cast<Index>(domesticIdx));
+
+        SequentialMatrix nativeMatrix;
+        permuteMatrix(orderedMatrix, nativeOrdering, nativeMatrix);
+
+        SequentialVector orderedRhs(overlappingb_->size());
+        SequentialVector nativeRhs(overlappingb_->size());
+        for (size_t rowIdx = 0; rowIdx < orderedRhs.size(); ++rowIdx) {
+            orderedRhs[rowIdx] = (*overlappingb_)[rowIdx];
+            nativeRhs[rowIdx] = (*overlappingb_)[static_cast<size_t>(nativeOrdering[rowIdx])];
+        }
+
+        const std::string& dofOrdering = EWOMS_GET_PARAM(TypeTag, std::string, LinearSolverDofOrdering);
+        std::cout << "Linear solver uses the '" << dofOrdering << "' DOF ordering. "
+                  << "Effect on the local linear system of rank 0 (native -> reordered):\n"
+                  << "  bandwidth: "
+                  << matrixBandwidth(nativeMatrix) << " -> "
+                  << matrixBandwidth(orderedMatrix) << "\n"
+                  << "  iterations of ILU(0)-BiCGStab: "
+                  << sequentialIluIterations_(nativeMatrix, nativeRhs) << " -> "
+                  << sequentialIluIterations_(orderedMatrix, orderedRhs) << "\n"
+                  << "  time per SpMV: "
+                  << spmvTime_(nativeMatrix, nativeRhs) << " s -> "
+                  << spmvTime_(orderedMatrix, orderedRhs) << " s\n"
+                  << std::flush;
+    }
+
+    // returns the number of iterations which a sequential ILU(0) preconditioned BiCGStab
+    // solver needs to reach the tolerance of the linear solver
+    template <class SequentialMatrix, class SequentialVector>
+    int sequentialIluIterations_(const SequentialMatrix& A, SequentialVector b) const
+    {
+        Scalar tolerance = EWOMS_GET_PARAM(TypeTag, Scalar, LinearSolverTolerance);
+        int maxIterations = EWOMS_GET_PARAM(TypeTag, int, LinearSolverMaxIterations);
+
+        Dune::MatrixAdapter<SequentialMatrix, SequentialVector, SequentialVector> op(A);
+        Dune::SeqILU0<SequentialMatrix, SequentialVector, SequentialVector> ilu(A, /*relaxation=*/1.0);
+        Dune::BiCGSTABSolver<SequentialVector> solver(op, ilu, tolerance, maxIterations, /*verbose=*/0);
+
+        SequentialVector x(b.size());
+        x = 0.0;
+        Dune::InverseOperatorResult result;
+        solver.apply(x, b, result);
+        return result.iterations;
+    }
+
+    // returns the average time of a sparse matrix-vector product using the compact
+    // matrix storage of the linear operator
+    template <class SequentialMatrix, class SequentialVector>
+    static double spmvTime_(const SequentialMatrix& A, const SequentialVector& x)
+    {
+        typedef typename SequentialMatrix::block_type MatrixBlock;
+        static const int numProducts = 20;
+
+        BlockCsrMatrix<typename MatrixBlock::field_type, MatrixBlock::rows> compactA;
+        compactA.setPattern(A);
+        compactA.assign(A);
+
+        SequentialVector y(x.size());
+        Ewoms::Timer timer;
+        timer.start();
+        for (int i = 0; i < numProducts; ++i)
+            compactA.mv(x, y);
+        return timer.stop()/numProducts;
+    }
+
+    // returns the positions of all degrees of freedom of the grid
+    std::vector<GlobalPosition> gridDofPositions_() const
+    {
+        std::vector<GlobalPosition> dofPositions(simulator_.model().numGridDof());
+
+        ElementContext elemCtx(simulator_);
+        auto elemIt = simulator_.gridView().template begin</*codim=*/0>();
+        const auto& elemEndIt = simulator_.gridView().template end</*codim=*/0>();
+        for (; elemIt != elemEndIt; ++elemIt) {
+            elemCtx.updateStencil(*elemIt);
+            for (unsigned dofIdx = 0; dofIdx < elemCtx.numPrimaryDof(/*timeIdx=*/0); ++dofIdx) {
+                unsigned globalIdx = elemCtx.globalSpaceIndex(dofIdx, /*timeIdx=*/0);
+                dofPositions[globalIdx] = elemCtx.pos(dofIdx, /*timeIdx=*/0);
+            }
+        }
+
+        return dofPositions;
+    }
+
+    // scales the right hand side by the equation weights. (the matrix has already
+    // been scaled while it was copied.)
     void rescale_()
     {
         const auto& overlap = overlappingMatrix_->overlap();
         for (unsigned domesticRowIdx = 0; domesticRowIdx < overlap.numLocal(); ++domesticRowIdx) {
             Index nativeRowIdx = overlap.domesticToNative(static_cast<Index>(domesticRowIdx));
-            auto& row = (*overlappingMatrix_)[domesticRowIdx];
-
-            auto colIt = row.begin();
-            const auto& colEndIt = row.end();
-            for (; colIt != colEndIt; ++ colIt) {
-                auto& entry = *colIt;
-                for (unsigned i = 0; i < entry.rows; ++i)
-                    entry[i] *= simulator_.model().eqWeight(nativeRowIdx, i);
-            }
-
             auto& rhsEntry = (*overlappingb_)[domesticRowIdx];
             for (unsigned i = 0; i < rhsEntry.size(); ++i)
                 rhsEntry[i] *= simulator_.model().eqWeight(nativeRowIdx, i);
@@ -342,13 +637,66 @@ protected:
     void cleanup_()
     {
         // create the overlapping Jacobian matrix and vectors
+        delete overlappingOperator_;
         delete overlappingMatrix_;
         delete overlappingb_;
         delete overlappingx_;
 
+        overlappingOperator_ = 0;
         overlappingMatrix_ = 0;
         overlappingb_ = 0;
         overlappingx_ = 0;
+
+        // the recycled search directions use the layout of the overlapping vectors
+        recycleSpace_.clear();
+    }
+
+#if HAVE_MPI
+    // create DUNE's ParallelIndexSet for the domestic overlap. this is required by
+    // the derived backends which use the parallel AMG of DUNE-ISTL. since the index
+    // set only depends on the overlap, it stays valid until cleanup_() is called.
+    template <class ParallelIndexSet>
+    static void setupAmgIndexSet_(const Overlap& overlap, ParallelIndexSet& istlIndices)
+    {
+        typedef Dune::OwnerOverlapCopyAttributeSet GridAttributes;
+        typedef Dune::OwnerOverlapCopyAttributeSet::AttributeSet GridAttributeSet;
+
+        istlIndices.beginResize();
+        for (Index curIdx = 0; static_cast<size_t>(curIdx) < overlap.numDomestic(); ++curIdx) {
+            GridAttributeSet gridFlag =
+                overlap.iAmMasterOf(curIdx)
+                ? GridAttributes::owner
+                : GridAttributes::copy;
+
+            // an index is used by other processes if it is in the
+            // domestic or in the foreign overlap.
+            bool isShared = overlap.isInOverlap(curIdx);
+
+            assert(curIdx == overlap.globalToDomestic(overlap.domesticToGlobal(curIdx)));
+            istlIndices.add(/*globalIdx=*/overlap.domesticToGlobal(curIdx),
+                            Dune::ParallelLocalIndex<GridAttributeSet>(static_cast<size_t>(curIdx),
+                                                                       gridFlag,
+                                                                       isShared));
+        }
+        istlIndices.endResize();
+    }
+#endif
+
+    // returns the number of search directions which can be recycled by the GCROT
+    // method given the recycle dimension and the memory budget
+    unsigned recycleDimension_() const
+    {
+        int dim = std::max(EWOMS_GET_PARAM(TypeTag, int, LinearSolverRecycleDimension), 0);
+        Scalar budget = EWOMS_GET_PARAM(TypeTag, Scalar, LinearSolverRecycleMemoryBudget);
+        if (budget <= 0 || !overlappingb_)
+            return static_cast<unsigned>(dim);
+
+        // each recycled direction requires two vectors: the direction itself and its
+        // image under the linear operator
+        typedef typename OverlappingVector::block_type VectorBlock;
+        double bytesPerDirection = 2.0*sizeof(VectorBlock)*overlappingb_->size();
+        double maxDirections = std::floor(budget*1024*1024/std::max(bytesPerDirection, 1.0));
+        return static_cast<unsigned>(std::min<double>(dim, maxDirections));
     }
 
     std::shared_ptr<ParallelPreconditioner> preparePreconditioner_()
@@ -419,12 +767,25 @@ protected:
 
     const Simulator& simulator_;
     int gridSequenceNumber_;
+    unsigned overlapSize_;
+    bool patternMayHaveChanged_;
+    bool dofOrderingReportPending_;
+    unsigned iterations_;
+
+    // the sparsity pattern of the native matrix for which the overlapping matrix
+    // was created
+    std::vector<size_t> nativeRowStart_;
+    std::vector<unsigned> nativeColIndices_;
 
     OverlappingMatrix *overlappingMatrix_;
+    ParallelOperator *overlappingOperator_;
     OverlappingVector *overlappingb_;
     OverlappingVector *overlappingx_;
 
     PreconditionerWrapper precWrapper_;
+
+    // the search directions which are recycled between the linear solves
+    GcrotRecycleSpace<OverlappingVector> recycleSpace_;
 };
 }} // namespace Linear, Ewoms
 
@@ -445,6 +806,12 @@ SET_TYPE_PROP(ParallelBaseLinearSolver,
               LinearSolverScalar,
               typename GET_PROP_TYPE(TypeTag, Scalar));
 
+//! by default, the preconditioner uses the same floating point type as the linear
+//! solver
+SET_TYPE_PROP(ParallelBaseLinearSolver,
+              PreconditionerScalar,
+              typename GET_PROP_TYPE(TypeTag, LinearSolverScalar));
+
 SET_PROP(ParallelBaseLinearSolver, OverlappingMatrix)
 {
     static constexpr int numEq = GET_PROP_VALUE(TypeTag, NumEq);
@@ -489,8 +856,20 @@ SET_TYPE_PROP(ParallelBaseLinearSolver,
 //! set the default overlap size to 2
 SET_INT_PROP(ParallelBaseLinearSolver, LinearSolverOverlapSize, 2);
 
+//! use the numbering of the DOF mapper for the linear system by default
+SET_STRING_PROP(ParallelBaseLinearSolver, LinearSolverDofOrdering, "native");
+
 //! set the default number of maximum iterations for the linear solver
 SET_INT_PROP(ParallelBaseLinearSolver, LinearSolverMaxIterations, 1000);
+
+//! restart the GMRES-like Krylov methods after 30 iterations by default
+SET_INT_PROP(ParallelBaseLinearSolver, LinearSolverRestart, 30);
+
+//! recycle at most 10 search directions between linear solves by default
+SET_INT_PROP(ParallelBaseLinearSolver, LinearSolverRecycleDimension, 10);
+
+//! do not limit the memory used for the recycled search directions by default
+SET_SCALAR_PROP(ParallelBaseLinearSolver, LinearSolverRecycleMemoryBudget, 0.0);
 } // namespace Properties
 } // namespace Ewoms
 
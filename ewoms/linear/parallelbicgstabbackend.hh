@@ -29,9 +29,16 @@
 
 #include "parallelbasebackend.hh"
 #include "bicgstabsolver.hh"
+#include "pipelinedbicgstabsolver.hh"
+#include "fgmressolver.hh"
+#include "gcrotsolver.hh"
 #include "combinedcriterion.hh"
 
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
 #include <memory>
+#include <string>
 
 namespace Ewoms {
 namespace Linear {
@@ -44,12 +51,16 @@ namespace Properties {
 NEW_TYPE_TAG(ParallelBiCGStabLinearSolver, INHERITS_FROM(ParallelBaseLinearSolver));
 
 NEW_PROP_TAG(LinearSolverMaxError);
+NEW_PROP_TAG(LinearSolverKrylovMethod);
 
 SET_TYPE_PROP(ParallelBiCGStabLinearSolver,
               LinearSolverBackend,
               Ewoms::Linear::ParallelBiCGStabSolverBackend<TypeTag>);
 
 SET_SCALAR_PROP(ParallelBiCGStabLinearSolver, LinearSolverMaxError, 1e7);
+
+//! use the classical BiCGStab method by default
+SET_STRING_PROP(ParallelBiCGStabLinearSolver, LinearSolverKrylovMethod, "bicgstab");
 }} // namespace Properties, Ewoms
 
 namespace Ewoms {
@@ -79,6 +90,18 @@ namespace Linear {
  *            that it is computationally cheaper because it does not
  *            need to consider things which are only required for
  *            higher orders
+ *
+ * The Krylov method is chosen at run time using the \c LinearSolverKrylovMethod
+ * parameter:
+ * - \c bicgstab: The classical stabilized BiCG method (BiCGStabSolver)
+ * - \c pipelined-bicgstab: A pipelined variant of BiCGStab which needs only two
+ *      non-blocking global reductions per iteration (PipelinedBiCGStabSolver)
+ * - \c fgmres: Restarted flexible GMRES which needs a single global reduction per
+ *      iteration for the orthogonalization in most cases (FgmresSolver)
+ * - \c gcrot: Flexible GCROT(m,k) which recycles search directions between the linear
+ *      solves of the Newton method and of consecutive time steps (GcrotSolver). The
+ *      number of recycled directions is limited by the \c LinearSolverRecycleDimension
+ *      and \c LinearSolverRecycleMemoryBudget parameters.
  */
 template <class TypeTag>
 class ParallelBiCGStabSolverBackend : public ParallelBaseBackend<TypeTag>
@@ -95,7 +118,50 @@ class ParallelBiCGStabSolverBackend : public ParallelBaseBackend<TypeTag>
 
     typedef BiCGStabSolver<ParallelOperator,
                            OverlappingVector,
-                           ParallelPreconditioner> RawLinearSolver;
+                           ParallelPreconditioner> BiCGStab;
+    typedef PipelinedBiCGStabSolver<ParallelOperator,
+                                    OverlappingVector,
+                                    ParallelPreconditioner,
+                                    ParallelScalarProduct> PipelinedBiCGStab;
+    typedef FgmresSolver<ParallelOperator,
+                         OverlappingVector,
+                         ParallelPreconditioner,
+                         ParallelScalarProduct> Fgmres;
+    typedef GcrotSolver<ParallelOperator,
+                        OverlappingVector,
+                        ParallelPreconditioner,
+                        ParallelScalarProduct> Gcrot;
+
+    // holds the Krylov solver which was selected at run time
+    struct RawLinearSolver
+    {
+        std::shared_ptr<BiCGStab> bicgstab;
+        std::shared_ptr<PipelinedBiCGStab> pipelinedBicgstab;
+        std::shared_ptr<Fgmres> fgmres;
+        std::shared_ptr<Gcrot> gcrot;
+
+        bool apply(OverlappingVector& x)
+        {
+            if (bicgstab)
+                return bicgstab->apply(x);
+            else if (pipelinedBicgstab)
+                return pipelinedBicgstab->apply(x);
+            else if (fgmres)
+                return fgmres->apply(x);
+            return gcrot->apply(x);
+        }
+
+        unsigned iterations() const
+        {
+            if (bicgstab)
+                return bicgstab->report().iterations();
+            else if (pipelinedBicgstab)
+                return pipelinedBicgstab->report().iterations();
+            else if (fgmres)
+                return fgmres->report().iterations();
+            return gcrot->report().iterations();
+        }
+    };
 
 public:
     ParallelBiCGStabSolverBackend(const Simulator& simulator)
@@ -109,6 +175,9 @@ public:
         EWOMS_REGISTER_PARAM(TypeTag, Scalar, LinearSolverMaxError,
                              "The maximum residual error which the linear solver tolerates"
                              " without giving up");
+        EWOMS_REGISTER_PARAM(TypeTag, std::string, LinearSolverKrylovMethod,
+                             "The Krylov method used by the linear solver. Possible values: "
+                             "'bicgstab', 'pipelined-bicgstab', 'fgmres' and 'gcrot'");
     }
 
 protected:
@@ -129,22 +198,57 @@ protected:
                                 /*absoluteResidualTolerance=*/linearSolverAbsTolerance,
                                 EWOMS_GET_PARAM(TypeTag, Scalar, LinearSolverMaxError)));
 
-        auto bicgstabSolver =
-            std::make_shared<RawLinearSolver>(parPreCond, *convCrit_, parScalarProduct);
+        auto rawSolver = std::make_shared<RawLinearSolver>();
+        const std::string& method = EWOMS_GET_PARAM(TypeTag, std::string, LinearSolverKrylovMethod);
+        if (method == "bicgstab") {
+            rawSolver->bicgstab =
+                std::make_shared<BiCGStab>(parPreCond, *convCrit_, parScalarProduct);
+            setupSolver_(*rawSolver->bicgstab, parOperator);
+        }
+        else if (method == "pipelined-bicgstab") {
+            rawSolver->pipelinedBicgstab =
+                std::make_shared<PipelinedBiCGStab>(parPreCond, *convCrit_, parScalarProduct);
+            setupSolver_(*rawSolver->pipelinedBicgstab, parOperator);
+        }
+        else if (method == "fgmres") {
+            rawSolver->fgmres =
+                std::make_shared<Fgmres>(parPreCond, *convCrit_, parScalarProduct);
+            rawSolver->fgmres->setRestart(static_cast<unsigned>(EWOMS_GET_PARAM(TypeTag, int, LinearSolverRestart)));
+            setupSolver_(*rawSolver->fgmres, parOperator);
+        }
+        else if (method == "gcrot") {
+            rawSolver->gcrot =
+                std::make_shared<Gcrot>(parPreCond, *convCrit_, parScalarProduct);
+            rawSolver->gcrot->setRestart(static_cast<unsigned>(EWOMS_GET_PARAM(TypeTag, int, LinearSolverRestart)));
+            this->recycleSpace_.setMaxSize(this->recycleDimension_());
+            rawSolver->gcrot->setRecycleSpace(&this->recycleSpace_);
+            setupSolver_(*rawSolver->gcrot, parOperator);
+        }
+        else
+            OPM_THROW(std::invalid_argument,
+                      "Unknown Krylov method '" << method << "' specified");
 
+        return rawSolver;
+    }
+
+    template <class Solver>
+    void setupSolver_(Solver& solver, ParallelOperator& parOperator)
+    {
         int verbosity = 0;
         if (parOperator.overlap().myRank() == 0)
             verbosity = EWOMS_GET_PARAM(TypeTag, int, LinearSolverVerbosity);
-        bicgstabSolver->setVerbosity(verbosity);
-        bicgstabSolver->setMaxIterations(EWOMS_GET_PARAM(TypeTag, int, LinearSolverMaxIterations));
-        bicgstabSolver->setLinearOperator(&parOperator);
-        bicgstabSolver->setRhs(this->overlappingb_);
-
-        return bicgstabSolver;
+        solver.setVerbosity(verbosity);
+        solver.setMaxIterations(EWOMS_GET_PARAM(TypeTag, int, LinearSolverMaxIterations));
+        solver.setLinearOperator(&parOperator);
+        solver.setRhs(this->overlappingb_);
     }
 
     bool runSolver_(std::shared_ptr<RawLinearSolver> solver)
-    { return solver->apply(*this->overlappingx_); }
+    {
+        bool converged = solver->apply(*this->overlappingx_);
+        this->iterations_ = solver->iterations();
+        return converged;
+    }
 
     void cleanupSolver_()
     { /* nothing to do */ }
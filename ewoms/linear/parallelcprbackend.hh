@@ -0,0 +1,505 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::Linear::ParallelCprBackend
+ */
+#ifndef EWOMS_PARALLEL_CPR_BACKEND_HH
+#define EWOMS_PARALLEL_CPR_BACKEND_HH
+
+#include "parallelbasebackend.hh"
+#include "bicgstabsolver.hh"
+#include "combinedcriterion.hh"
+#include "pressurereduction.hh"
+#include "cprpreconditioner.hh"
+#include "transportreduction.hh"
+#include "sequentialimplicitpreconditioner.hh"
+
+#include <dune/istl/paamg/amg.hh>
+#include <dune/istl/paamg/pinfo.hh>
+#include <dune/istl/owneroverlapcopy.hh>
+#include <dune/istl/preconditioners.hh>
+
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace Ewoms {
+namespace Linear {
+template <class TypeTag>
+class ParallelCprBackend;
+}
+
+namespace Properties {
+NEW_TYPE_TAG(ParallelCprLinearSolver, INHERITS_FROM(ParallelBaseLinearSolver));
+
+NEW_PROP_TAG(AmgCoarsenTarget);
+NEW_PROP_TAG(LinearSolverMaxError);
+NEW_PROP_TAG(CprPressureIndex);
+NEW_PROP_TAG(AmgReuseHierarchy);
+NEW_PROP_TAG(CprSequentialImplicit);
+NEW_PROP_TAG(CprSequentialSweeps);
+
+//! The target number of DOFs per processor for the AMG which is used for the pressure
+//! system
+SET_INT_PROP(ParallelCprLinearSolver, AmgCoarsenTarget, 5000);
+
+SET_SCALAR_PROP(ParallelCprLinearSolver, LinearSolverMaxError, 1e7);
+
+//! By default, the first primary variable is considered to be the pressure
+SET_INT_PROP(ParallelCprLinearSolver, CprPressureIndex, 0);
+
+//! Rebuild the AMG hierarchy of the pressure system for each linear solve by default
+SET_BOOL_PROP(ParallelCprLinearSolver, AmgReuseHierarchy, false);
+
+//! Use the two-stage CPR preconditioner instead of the sequential implicit one by
+//! default. If the latter is enabled, a single pressure/transport sweep is done per
+//! application
+SET_BOOL_PROP(ParallelCprLinearSolver, CprSequentialImplicit, false);
+SET_INT_PROP(ParallelCprLinearSolver, CprSequentialSweeps, 1);
+
+SET_TYPE_PROP(ParallelCprLinearSolver, LinearSolverBackend,
+              Ewoms::Linear::ParallelCprBackend<TypeTag>);
+} // namespace Properties
+
+namespace Linear {
+/*!
+ * \ingroup Linear
+ *
+ * \brief Provides a linear solver backend which uses BiCGStab with a constrained
+ *        pressure residual (CPR) preconditioner.
+ *
+ * The pressure system is extracted from the block Jacobian using quasi-IMPES
+ * weights, and it is preconditioned by a single V-cycle of the parallel algebraic
+ * multi-grid solver from DUNE-ISTL. The second stage uses the preconditioner which is
+ * specified by the \c PreconditionerWrapper property (ILU0 by default) on the full
+ * system. Which primary variable is considered to be the pressure can be specified
+ * using the \c CprPressureIndex property.
+ *
+ * The sparsity pattern of the pressure matrix, the parallel index sets and the
+ * operator of the pressure system are kept until cleanup_() is called because the
+ * overlapping matrix is recreated. If the \c AmgReuseHierarchy parameter is enabled,
+ * the aggregates of the pressure AMG are kept as well and only the Galerkin products
+ * of its coarse levels are recomputed, see Ewoms::Linear::ParallelAmgBackend. In this
+ * case, a linear solve which does not converge is repeated using a rebuilt AMG.
+ *
+ * If the \c CprSequentialImplicit parameter is enabled, the second stage is replaced
+ * by an ILU0 preconditioner for the transport system, i.e., the system which remains
+ * if the pressure is kept fixed, and the two stages are applied one after another
+ * \c CprSequentialSweeps times, see Ewoms::Linear::SequentialImplicitPreconditioner.
+ * This corresponds to a sequential implicit pressure/transport scheme which is used
+ * to precondition the fully coupled system, i.e., the tolerance and the maximum
+ * number of iterations of the linear solver apply as usual. The total number of
+ * pressure/transport sweeps of the most recent solve is returned by
+ * stageIterations().
+ */
+template <class TypeTag>
+class ParallelCprBackend : public ParallelBaseBackend<TypeTag>
+{
+    typedef ParallelBaseBackend<TypeTag> ParentType;
+
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
+    typedef typename GET_PROP_TYPE(TypeTag, GridView) GridView;
+    typedef typename GET_PROP_TYPE(TypeTag, GlobalEqVector) GlobalEqVector;
+
+    typedef typename ParentType::OverlappingMatrix OverlappingMatrix;
+    typedef typename ParentType::ParallelOperator ParallelOperator;
+    typedef typename ParentType::OverlappingVector OverlappingVector;
+    typedef typename ParentType::ParallelPreconditioner ParallelPreconditioner;
+    typedef typename ParentType::ParallelScalarProduct ParallelScalarProduct;
+
+    typedef Ewoms::Linear::PressureReduction<OverlappingMatrix,
+                                             OverlappingVector> PressureReduction;
+    typedef typename PressureReduction::PressureMatrix PressureMatrix;
+    typedef typename PressureReduction::PressureVector PressureVector;
+
+    // the smoother of the AMG for the pressure system
+    typedef Dune::SeqSOR<PressureMatrix, PressureVector, PressureVector> PressureSmoother;
+
+#if HAVE_MPI
+    typedef Dune::OwnerOverlapCopyCommunication<Ewoms::Linear::Index>
+    OwnerOverlapCopyCommunication;
+    typedef Dune::OverlappingSchwarzOperator<PressureMatrix,
+                                             PressureVector,
+                                             PressureVector,
+                                             OwnerOverlapCopyCommunication> PressureOperator;
+    typedef Dune::BlockPreconditioner<PressureVector,
+                                      PressureVector,
+                                      OwnerOverlapCopyCommunication,
+                                      PressureSmoother> ParallelPressureSmoother;
+    typedef Dune::Amg::AMG<PressureOperator,
+                           PressureVector,
+                           ParallelPressureSmoother,
+                           OwnerOverlapCopyCommunication> PressureAmg;
+#else
+    typedef Dune::MatrixAdapter<PressureMatrix, PressureVector, PressureVector> PressureOperator;
+    typedef PressureSmoother ParallelPressureSmoother;
+    typedef Dune::Amg::AMG<PressureOperator, PressureVector, ParallelPressureSmoother> PressureAmg;
+#endif
+
+    typedef Ewoms::Linear::CprPreconditioner<OverlappingMatrix,
+                                             OverlappingVector,
+                                             PressureReduction,
+                                             PressureAmg,
+                                             ParallelPreconditioner> CprPreconditioner;
+
+    typedef Ewoms::Linear::TransportReduction<OverlappingMatrix,
+                                              OverlappingVector> TransportReduction;
+    typedef typename TransportReduction::TransportMatrix TransportMatrix;
+    typedef typename TransportReduction::TransportVector TransportVector;
+
+    // the preconditioner of the transport system. it only acts on the local part of
+    // the transport matrix of each process.
+    typedef Dune::SeqILU0<TransportMatrix, TransportVector, TransportVector> TransportIlu;
+
+    typedef Ewoms::Linear::SequentialImplicitPreconditioner<OverlappingMatrix,
+                                                            OverlappingVector,
+                                                            PressureReduction,
+                                                            PressureAmg,
+                                                            TransportReduction,
+                                                            TransportIlu> SequentialImplicitPreconditioner;
+
+    // both two-stage preconditioners are used via the interface of DUNE
+    typedef Dune::Preconditioner<OverlappingVector, OverlappingVector> TwoStagePreconditioner;
+
+    typedef BiCGStabSolver<ParallelOperator,
+                           OverlappingVector,
+                           TwoStagePreconditioner> RawLinearSolver;
+
+public:
+    ParallelCprBackend(const Simulator& simulator)
+        : ParentType(simulator)
+        , pressureReduction_(static_cast<unsigned>(EWOMS_GET_PARAM(TypeTag, int, CprPressureIndex)))
+        , rebuildPressureAmg_(true)
+        , reusedHierarchy_(false)
+        , transportReduction_(static_cast<unsigned>(EWOMS_GET_PARAM(TypeTag, int, CprPressureIndex)))
+        , stageIterations_(0)
+    {
+        sequentialImplicit_ = EWOMS_GET_PARAM(TypeTag, bool, CprSequentialImplicit);
+        int numSweeps = EWOMS_GET_PARAM(TypeTag, int, CprSequentialSweeps);
+        if (numSweeps < 1)
+            OPM_THROW(std::invalid_argument,
+                      "The number of sweeps of the sequential implicit preconditioner "
+                      "must be positive, got " << numSweeps);
+        numSweeps_ = static_cast<unsigned>(numSweeps);
+    }
+
+    static void registerParameters()
+    {
+        ParentType::registerParameters();
+
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, LinearSolverMaxError,
+                             "The maximum residual error which the linear solver tolerates"
+                             " without giving up");
+        EWOMS_REGISTER_PARAM(TypeTag, int, AmgCoarsenTarget,
+                             "The coarsening target for the agglomerations of "
+                             "the AMG preconditioner of the pressure system");
+        EWOMS_REGISTER_PARAM(TypeTag, int, CprPressureIndex,
+                             "The index of the primary variable which is used as "
+                             "the pressure by the CPR preconditioner");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, AmgReuseHierarchy,
+                             "Only recompute the coarse level operators of the AMG "
+                             "for the pressure system if the sparsity pattern of the "
+                             "matrix is unchanged. If this does not converge, the "
+                             "linear system is solved again using a rebuilt AMG");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, CprSequentialImplicit,
+                             "Replace the second stage of the CPR preconditioner by "
+                             "an ILU0 preconditioner for the transport system and "
+                             "apply both stages in a sequential implicit manner");
+        EWOMS_REGISTER_PARAM(TypeTag, int, CprSequentialSweeps,
+                             "The number of pressure/transport sweeps per application "
+                             "of the sequential implicit preconditioner");
+    }
+
+    /*!
+     * \brief Returns the number of pressure/transport sweeps of the sequential
+     *        implicit preconditioner for the most recent call to solve().
+     *
+     * This is zero if the sequential implicit preconditioner is not used.
+     */
+    unsigned stageIterations() const
+    { return stageIterations_; }
+
+    /*!
+     * \brief Actually solve the linear system of equations.
+     *
+     * If the solve used a reused AMG hierarchy for the pressure system and did not
+     * converge, it is repeated using a rebuilt hierarchy.
+     *
+     * \return true if the residual reduction could be achieved, else false.
+     */
+    bool solve(GlobalEqVector& x)
+    {
+        if (ParentType::solve(x))
+            return true;
+
+        if (!reusedHierarchy_)
+            return false;
+
+        // runSolver_() has requested a rebuild of the hierarchy
+        assert(rebuildPressureAmg_);
+        return ParentType::solve(x);
+    }
+
+protected:
+    friend ParentType;
+
+    std::shared_ptr<TwoStagePreconditioner> preparePreconditioner_()
+    {
+        // the second stage of the CPR preconditioner
+        if (!sequentialImplicit_)
+            parSmoother_ = ParentType::preparePreconditioner_();
+
+        // extract the pressure system from the overlapping matrix. the pressure matrix
+        // object is the same for all calls, only its entries are updated.
+        pressureReduction_.update(*this->overlappingMatrix_);
+
+        if (!pressureOperator_) {
+            // the index sets and the pressure operator only depend on the overlapping
+            // matrix, i.e., they stay valid until the next call to cleanup_()
+#if HAVE_MPI
+            // create and initialize DUNE's OwnerOverlapCopyCommunication
+            // using the domestic overlap
+            const auto& overlap = this->overlappingMatrix_->overlap();
+            istlComm_ = std::make_shared<OwnerOverlapCopyCommunication>(overlap.communicator());
+            ParentType::setupAmgIndexSet_(overlap, istlComm_->indexSet());
+            istlComm_->remoteIndices().template rebuild<false>();
+
+            pressureOperator_ = std::make_shared<PressureOperator>(pressureReduction_.matrix(), *istlComm_);
+#else
+            pressureOperator_ = std::make_shared<PressureOperator>(pressureReduction_.matrix());
+#endif
+        }
+
+        if (pressureAmg_
+            && !rebuildPressureAmg_
+            && EWOMS_GET_PARAM(TypeTag, bool, AmgReuseHierarchy))
+        {
+            // keep the aggregates and only recompute the Galerkin products of the
+            // coarse levels. the coarse level solver stays the same.
+            pressureAmg_->recalculateHierarchy();
+            reusedHierarchy_ = true;
+        }
+        else {
+            setupPressureAmg_();
+            rebuildPressureAmg_ = false;
+            reusedHierarchy_ = false;
+        }
+
+        if (sequentialImplicit_) {
+            setupTransportIlu_();
+            seqImplicitPrecond_ =
+                std::make_shared<SequentialImplicitPreconditioner>(*this->overlappingMatrix_,
+                                                                   pressureReduction_,
+                                                                   *pressureAmg_,
+                                                                   transportReduction_,
+                                                                   *transportIlu_,
+                                                                   numSweeps_);
+            return seqImplicitPrecond_;
+        }
+
+        return std::make_shared<CprPreconditioner>(*this->overlappingMatrix_,
+                                                   pressureReduction_,
+                                                   *pressureAmg_,
+                                                   *parSmoother_);
+    }
+
+    void cleanupPreconditioner_()
+    {
+        seqImplicitPrecond_.reset();
+        transportIlu_.reset();
+
+        // the preconditioner of the base class is only used by the two-stage CPR
+        // preconditioner
+        if (parSmoother_) {
+            parSmoother_.reset();
+            ParentType::cleanupPreconditioner_();
+        }
+    }
+
+    std::shared_ptr<RawLinearSolver> prepareSolver_(ParallelOperator& parOperator,
+                                                    ParallelScalarProduct& parScalarProduct,
+                                                    TwoStagePreconditioner& parPreCond)
+    {
+        const auto& gridView = this->simulator_.gridView();
+        typedef CombinedCriterion<OverlappingVector, decltype(gridView.comm())> CCC;
+
+        Scalar linearSolverTolerance = EWOMS_GET_PARAM(TypeTag, Scalar, LinearSolverTolerance);
+        Scalar linearSolverAbsTolerance = this->simulator_.model().newtonMethod().tolerance() / 10.0;
+
+        convCrit_.reset(new CCC(gridView.comm(),
+                                /*residualReductionTolerance=*/linearSolverTolerance,
+                                /*absoluteResidualTolerance=*/linearSolverAbsTolerance,
+                                EWOMS_GET_PARAM(TypeTag, Scalar, LinearSolverMaxError)));
+
+        auto bicgstabSolver =
+            std::make_shared<RawLinearSolver>(parPreCond, *convCrit_, parScalarProduct);
+
+        int verbosity = 0;
+        if (parOperator.overlap().myRank() == 0)
+            verbosity = EWOMS_GET_PARAM(TypeTag, int, LinearSolverVerbosity);
+        bicgstabSolver->setVerbosity(verbosity);
+        bicgstabSolver->setMaxIterations(EWOMS_GET_PARAM(TypeTag, int, LinearSolverMaxIterations));
+        bicgstabSolver->setLinearOperator(&parOperator);
+        bicgstabSolver->setRhs(this->overlappingb_);
+
+        return bicgstabSolver;
+    }
+
+    bool runSolver_(std::shared_ptr<RawLinearSolver> solver)
+    {
+        bool converged = solver->apply(*this->overlappingx_);
+        this->iterations_ = solver->report().iterations();
+        stageIterations_ = seqImplicitPrecond_ ? seqImplicitPrecond_->numStageApplications() : 0;
+
+        if (seqImplicitPrecond_
+            && this->simulator_.gridView().comm().rank() == 0
+            && EWOMS_GET_PARAM(TypeTag, int, LinearSolverVerbosity) > 0)
+        {
+            std::cout << "Sequential implicit preconditioner: "
+                      << this->iterations_ << " linear iterations, "
+                      << stageIterations_ << " pressure/transport sweeps\n"
+                      << std::flush;
+        }
+
+        if (!converged)
+            rebuildPressureAmg_ = true;
+        return converged;
+    }
+
+    void cleanupSolver_()
+    { /* nothing to do */ }
+
+    // this is called by ParallelBaseBackend::prepare_() whenever the overlapping
+    // matrix is recreated
+    void cleanup_()
+    {
+        // the AMG and the pressure operator reference the pressure matrix and the
+        // index sets, which correspond to the old overlapping matrix
+        pressureAmg_.reset();
+        pressureOperator_.reset();
+#if HAVE_MPI
+        istlComm_.reset();
+#endif
+        pressureReduction_.reset();
+        transportReduction_.reset();
+        rebuildPressureAmg_ = true;
+        reusedHierarchy_ = false;
+
+        ParentType::cleanup_();
+    }
+
+    void setupPressureAmg_()
+    {
+        if (pressureAmg_)
+            pressureAmg_.reset();
+
+        int verbosity = 0;
+        if (this->simulator_.gridManager().gridView().comm().rank() == 0)
+            verbosity = EWOMS_GET_PARAM(TypeTag, int, LinearSolverVerbosity);
+
+        typedef typename Dune::Amg::SmootherTraits<ParallelPressureSmoother>::Arguments SmootherArgs;
+
+        SmootherArgs smootherArgs;
+        smootherArgs.iterations = 1;
+        smootherArgs.relaxationFactor = 1.0;
+
+        typedef Dune::Amg::
+            CoarsenCriterion<Dune::Amg::SymmetricCriterion<PressureMatrix, Dune::Amg::FirstDiagonal> >
+            CoarsenCriterion;
+        int coarsenTarget = EWOMS_GET_PARAM(TypeTag, int, AmgCoarsenTarget);
+        CoarsenCriterion coarsenCriterion(/*maxLevel=*/15, coarsenTarget);
+        coarsenCriterion.setDefaultValuesAnisotropic(GridView::dimension,
+                                                     /*aggregateSizePerDim=*/3);
+        if (verbosity > 1)
+            coarsenCriterion.setDebugLevel(1);
+        else
+            coarsenCriterion.setDebugLevel(0); // make the AMG shut up
+
+        coarsenCriterion.setMinCoarsenRate(1.05);
+        coarsenCriterion.setAccumulate(Dune::Amg::atOnceAccu);
+        coarsenCriterion.setSkipIsolated(false);
+
+#if HAVE_MPI
+        pressureAmg_ = std::make_shared<PressureAmg>(*pressureOperator_,
+                                                     coarsenCriterion,
+                                                     smootherArgs,
+                                                     *istlComm_);
+#else
+        pressureAmg_ = std::make_shared<PressureAmg>(*pressureOperator_,
+                                                     coarsenCriterion,
+                                                     smootherArgs);
+#endif
+    }
+
+    // extract the transport system from the overlapping matrix and factorize it. this
+    // requires the weights of the pressure reduction to be up to date.
+    void setupTransportIlu_()
+    {
+        transportReduction_.update(*this->overlappingMatrix_, pressureReduction_.weights());
+
+        int iluIsReady = 1;
+        try {
+            Scalar relaxationFactor = EWOMS_GET_PARAM(TypeTag, Scalar, PreconditionerRelaxation);
+            transportIlu_ = std::make_shared<TransportIlu>(transportReduction_.matrix(), relaxationFactor);
+        }
+        catch (const Dune::Exception& e) {
+            std::cout << "Preconditioner of the transport system threw exception \""
+                      << e.what() << "\" on rank "
+                      << this->overlappingMatrix_->overlap().myRank() << "\n" << std::flush;
+            iluIsReady = 0;
+        }
+
+        // the processes must agree on whether the preconditioner can be used
+        iluIsReady = this->simulator_.gridView().comm().min(iluIsReady);
+        if (!iluIsReady)
+            OPM_THROW(Opm::NumericalProblem,
+                      "Creating the preconditioner of the transport system failed");
+    }
+
+    std::unique_ptr<ConvergenceCriterion<OverlappingVector> > convCrit_;
+
+    PressureReduction pressureReduction_;
+    std::shared_ptr<PressureOperator> pressureOperator_;
+    std::shared_ptr<PressureAmg> pressureAmg_;
+    std::shared_ptr<ParallelPreconditioner> parSmoother_;
+    bool rebuildPressureAmg_;
+    bool reusedHierarchy_;
+
+    bool sequentialImplicit_;
+    unsigned numSweeps_;
+    TransportReduction transportReduction_;
+    std::shared_ptr<TransportIlu> transportIlu_;
+    std::shared_ptr<SequentialImplicitPreconditioner> seqImplicitPrecond_;
+    unsigned stageIterations_;
+
+#if HAVE_MPI
+    std::shared_ptr<OwnerOverlapCopyCommunication> istlComm_;
+#endif
+};
+
+} // namespace Linear
+} // namespace Ewoms
+
+#endif
@@ -131,6 +131,7 @@ protected:
     {
         Dune::InverseOperatorResult result;
         solver->apply(*this->overlappingx_, *this->overlappingb_, result);
+        this->iterations_ = static_cast<unsigned>(result.iterations);
         return result.converged;
     }
 
@@ -0,0 +1,363 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::Linear::PipelinedBiCGStabSolver
+ */
+#ifndef EWOMS_PIPELINED_BICG_STAB_SOLVER_HH
+#define EWOMS_PIPELINED_BICG_STAB_SOLVER_HH
+
+#include "convergencecriterion.hh"
+#include "linearsolverreport.hh"
+
+#include <ewoms/common/timer.hh>
+#include <ewoms/common/timerguard.hh>
+
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace Ewoms {
+namespace Linear {
+/*!
+ * \brief Implements a pipelined variant of the preconditioned stabilized BiCG linear
+ *        solver.
+ *
+ * Mathematically, this is the same method as BiCGStabSolver (with right
+ * preconditioning), but the recurrences are rearranged so that the scalar products
+ * of each half-iteration are computed using a single non-blocking global reduction
+ * which is overlapped with the application of the preconditioner and of the linear
+ * operator. This reduces the number of global synchronization points per iteration
+ * from four to two, at the price of additional vector updates and memory.
+ *
+ * The scalar product must provide the startDots() and finishDots() methods of
+ * OverlappingScalarProduct.
+ *
+ * See: S. Cools and W. Vanroose: "The communication-hiding pipelined BiCGstab method
+ * for the parallel solution of large unsymmetric linear systems", Parallel
+ * Computing 65, pp. 1-20, 2017
+ */
+template <class LinearOperator, class Vector, class Preconditioner, class ScalarProduct>
+class PipelinedBiCGStabSolver
+{
+    typedef Ewoms::Linear::ConvergenceCriterion<Vector> ConvergenceCriterion;
+    typedef typename LinearOperator::field_type Scalar;
+
+public:
+    PipelinedBiCGStabSolver(Preconditioner& preconditioner,
+                            ConvergenceCriterion& convergenceCriterion,
+                            ScalarProduct& scalarProduct)
+        : preconditioner_(preconditioner)
+        , convergenceCriterion_(convergenceCriterion)
+        , scalarProduct_(scalarProduct)
+    {
+        A_ = nullptr;
+        b_ = nullptr;
+
+        maxIterations_ = 1000;
+        verbosity_ = 0;
+    }
+
+    /*!
+     * \brief Set the maximum number of iterations before we give up without achieving
+     *        convergence.
+     */
+    void setMaxIterations(unsigned value)
+    { maxIterations_ = value; }
+
+    /*!
+     * \brief Return the maximum number of iterations before we give up without achieving
+     *        convergence.
+     */
+    unsigned maxIterations() const
+    { return maxIterations_; }
+
+    /*!
+     * \brief Set the verbosity level of the linear solver
+     *
+     * The levels are the same as for BiCGStabSolver.
+     */
+    void setVerbosity(unsigned value)
+    { verbosity_ = value; }
+
+    /*!
+     * \brief Return the verbosity level of the linear solver.
+     */
+    unsigned verbosity() const
+    { return verbosity_; }
+
+    /*!
+     * \brief Set the matrix "A" of the linear system.
+     */
+    void setLinearOperator(const LinearOperator* A)
+    { A_ = A; }
+
+    /*!
+     * \brief Set the right hand side "b" of the linear system.
+     */
+    void setRhs(const Vector* b)
+    { b_ = b; }
+
+    /*!
+     * \brief Run the pipelined BiCGStab solver and store the result into the "x"
+     *        vector.
+     */
+    bool apply(Vector& x)
+    {
+        // epsilon used for detecting breakdowns
+        const Scalar breakdownEps = std::numeric_limits<Scalar>::min() * Scalar(1e10);
+
+        report_.reset();
+        Ewoms::TimerGuard reportTimerGuard(report_.timer());
+        report_.timer().start();
+
+        // set the initial solution to the zero vector, i.e., r_0 = b
+        x = 0.0;
+        Vector r = *b_;
+        preconditioner_.pre(x, r);
+
+        convergenceCriterion_.setInitial(x, r);
+        if (convergenceCriterion_.converged()) {
+            report_.setConverged(true);
+            return report_.converged();
+        }
+
+        if (verbosity_ > 0) {
+            std::cout << "-------- PipelinedBiCGStabSolver --------" << std::endl;
+            convergenceCriterion_.printInitial();
+        }
+
+        // the shadow residual
+        const Vector& r0star = *b_;
+
+        // the vectors denoted by "Hat" are the preconditioned counterparts of the
+        // respective vectors, i.e., rHat = K^-1*r.
+        Vector rHat(x);
+        Vector w(x);
+        Vector wHat(x);
+        Vector t(x);
+        Vector pHat(x);
+        Vector s(x);
+        Vector sHat(x);
+        Vector z(x);
+        Vector zHat(x);
+        Vector v(x);
+        Vector y(x);
+        Vector dx(x);
+        unsigned n = x.size();
+
+        // rHat_0 = K^-1 r_0, w_0 = A rHat_0, wHat_0 = K^-1 w_0, t_0 = A wHat_0
+        preconditioner_.apply(rHat, r);
+        A_->apply(rHat, w);
+        preconditioner_.apply(wHat, w);
+        A_->apply(wHat, t);
+
+        scalarProduct_.startDots({{&r0star, &r}, {&r0star, &w}});
+        const auto& initialDots = scalarProduct_.finishDots();
+        Scalar rho = initialDots[0];
+        if (std::abs(initialDots[1]) <= breakdownEps)
+            OPM_THROW(Opm::NumericalProblem,
+                      "Breakdown of the pipelined BiCGStab solver (division by zero)");
+        Scalar alpha = rho/initialDots[1];
+        Scalar beta = 0.0;
+        Scalar omega = 0.0;
+
+        for (; report_.iterations() < maxIterations_; report_.increment()) {
+            // pHat_i = rHat_i + beta*(pHat_(i-1) - omega*sHat_(i-1))
+            // s_i = w_i + beta*(s_(i-1) - omega*z_(i-1))
+            // sHat_i = wHat_i + beta*(sHat_(i-1) - omega*zHat_(i-1))
+            // z_i = t_i + beta*(z_(i-1) - omega*v_(i-1))
+            // q_i = r_i - alpha*s_i (stored in r)
+            // qHat_i = rHat_i - alpha*sHat_i (stored in rHat)
+            // y_i = w_i - alpha*z_i
+            for (unsigned i = 0; i < n; ++i) {
+                auto tmp = sHat[i];
+                tmp *= -omega;
+                tmp += pHat[i];
+                tmp *= beta;
+                tmp += rHat[i];
+                pHat[i] = tmp;
+
+                tmp = z[i];
+                tmp *= -omega;
+                tmp += s[i];
+                tmp *= beta;
+                tmp += w[i];
+                s[i] = tmp;
+
+                tmp = zHat[i];
+                tmp *= -omega;
+                tmp += sHat[i];
+                tmp *= beta;
+                tmp += wHat[i];
+                sHat[i] = tmp;
+
+                tmp = v[i];
+                tmp *= -omega;
+                tmp += z[i];
+                tmp *= beta;
+                tmp += t[i];
+                z[i] = tmp;
+
+                tmp = s[i];
+                tmp *= alpha;
+                r[i] -= tmp;
+
+                tmp = sHat[i];
+                tmp *= alpha;
+                rHat[i] -= tmp;
+
+                tmp = z[i];
+                tmp *= -alpha;
+                tmp += w[i];
+                y[i] = tmp;
+            }
+
+            // start the reduction for omega and hide its latency behind
+            // zHat_i = K^-1 z_i and v_i = A zHat_i
+            scalarProduct_.startDots({{&r, &y}, {&y, &y}});
+            preconditioner_.apply(zHat, z);
+            A_->apply(zHat, v);
+            const auto& omegaDots = scalarProduct_.finishDots();
+
+            // omega_i = (q_i, y_i)/(y_i, y_i)
+            if (std::abs(omegaDots[1]) <= breakdownEps)
+                OPM_THROW(Opm::NumericalProblem,
+                          "Breakdown of the pipelined BiCGStab solver (division by zero)");
+            omega = omegaDots[0]/omegaDots[1];
+            if (std::abs(omega) <= breakdownEps)
+                OPM_THROW(Opm::NumericalProblem,
+                          "Breakdown of the pipelined BiCGStab solver (stagnation detected)");
+
+            // dx = alpha*pHat_i + omega*qHat_i
+            // x_(i+1) = x_i + dx
+            // r_(i+1) = q_i - omega*y_i
+            // rHat_(i+1) = qHat_i - omega*(wHat_i - alpha*zHat_i)
+            // w_(i+1) = y_i - omega*(t_i - alpha*v_i)
+            for (unsigned i = 0; i < n; ++i) {
+                auto tmp = pHat[i];
+                tmp *= alpha/omega;
+                tmp += rHat[i];
+                tmp *= omega;
+                dx[i] = tmp;
+                x[i] += tmp;
+
+                tmp = y[i];
+                tmp *= omega;
+                r[i] -= tmp;
+
+                tmp = zHat[i];
+                tmp *= -alpha;
+                tmp += wHat[i];
+                tmp *= omega;
+                rHat[i] -= tmp;
+
+                tmp = v[i];
+                tmp *= -alpha;
+                tmp += t[i];
+                tmp *= -omega;
+                tmp += y[i];
+                w[i] = tmp;
+            }
+
+            // start the reduction for the next alpha and beta. the convergence check is
+            // done while it is in flight.
+            scalarProduct_.startDots({{&r0star, &r}, {&r0star, &w}, {&r0star, &s}, {&r0star, &z}});
+
+            convergenceCriterion_.update(/*curSol=*/x, /*delta=*/dx, r);
+            if (convergenceCriterion_.converged()) {
+                scalarProduct_.finishDots();
+                if (verbosity_ > 0) {
+                    convergenceCriterion_.print(1.0 + report_.iterations());
+                    std::cout << "-------- /PipelinedBiCGStabSolver --------" << std::endl;
+                }
+
+                preconditioner_.post(x);
+                report_.setConverged(true);
+                return report_.converged();
+            }
+            else if (convergenceCriterion_.failed()) {
+                scalarProduct_.finishDots();
+                if (verbosity_ > 0) {
+                    convergenceCriterion_.print(1.0 + report_.iterations());
+                    std::cout << "-------- /PipelinedBiCGStabSolver --------" << std::endl;
+                }
+
+                report_.setConverged(false);
+                return report_.converged();
+            }
+
+            if (verbosity_ > 1)
+                convergenceCriterion_.print(1.0 + report_.iterations());
+
+            // wHat_(i+1) = K^-1 w_(i+1), t_(i+1) = A wHat_(i+1)
+            preconditioner_.apply(wHat, w);
+            A_->apply(wHat, t);
+            const auto& alphaDots = scalarProduct_.finishDots();
+
+            // beta_i = (alpha_i/omega_i)*(r0star, r_(i+1))/(r0star, r_i)
+            if (std::abs(rho) <= breakdownEps)
+                OPM_THROW(Opm::NumericalProblem,
+                          "Breakdown of the pipelined BiCGStab solver (division by zero)");
+            beta = (alpha/omega)*(alphaDots[0]/rho);
+            rho = alphaDots[0];
+
+            // alpha_(i+1) = (r0star, r_(i+1))/(r0star, s_(i+1)), where s_(i+1) is
+            // expressed by the recurrence for s
+            Scalar denom = alphaDots[1] + beta*alphaDots[2] - beta*omega*alphaDots[3];
+            if (std::abs(denom) <= breakdownEps)
+                OPM_THROW(Opm::NumericalProblem,
+                          "Breakdown of the pipelined BiCGStab solver (division by zero)");
+            alpha = rho/denom;
+            if (std::abs(alpha) <= breakdownEps)
+                OPM_THROW(Opm::NumericalProblem,
+                          "Breakdown of the pipelined BiCGStab solver (stagnation detected)");
+        }
+
+        report_.setConverged(false);
+        return report_.converged();
+    }
+
+    const Ewoms::Linear::SolverReport& report() const
+    { return report_; }
+
+private:
+    const LinearOperator* A_;
+    const Vector* b_;
+
+    Preconditioner& preconditioner_;
+    ConvergenceCriterion& convergenceCriterion_;
+    ScalarProduct& scalarProduct_;
+    Ewoms::Linear::SolverReport report_;
+
+    unsigned maxIterations_;
+    unsigned verbosity_;
+};
+
+} // namespace Linear
+} // namespace Ewoms
+
+#endif
@@ -0,0 +1,210 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::Linear::PressureReduction
+ */
+#ifndef EWOMS_PRESSURE_REDUCTION_HH
+#define EWOMS_PRESSURE_REDUCTION_HH
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+
+#include <vector>
+#include <cassert>
+#include <cmath>
+
+namespace Ewoms {
+namespace Linear {
+
+/*!
+ * \brief Reduces a block-structured linear system to a scalar system for a single
+ *        "pressure" primary variable.
+ *
+ * For each row, the equations are combined using quasi-IMPES weights: the weights
+ * \f$w_i\f$ of row \f$i\f$ are chosen such that \f$w_i^T A_{ii}\f$ exhibits a non-zero
+ * entry only for the pressure primary variable. The entries of the scalar matrix are
+ * then given by \f$(A_p)_{ij} = w_i^T A_{ij} e_p\f$, i.e., the influence of all
+ * non-pressure primary variables of the neighboring degrees of freedom is neglected.
+ *
+ * The sparsity pattern of the scalar matrix is created by the first call to update()
+ * after construction or after reset(). Subsequent calls only update its entries, i.e.,
+ * the object which owns the block matrix must call reset() whenever the sparsity
+ * pattern of the block matrix changes. The scalar matrix object itself stays the same,
+ * so references to it remain valid.
+ */
+template <class BlockMatrix, class BlockVector>
+class PressureReduction
+{
+    typedef typename BlockMatrix::block_type MatrixBlock;
+    typedef typename MatrixBlock::field_type Scalar;
+
+    enum { numEq = MatrixBlock::rows };
+
+public:
+    typedef Dune::FieldVector<Scalar, numEq> WeightVector;
+    typedef Dune::FieldMatrix<Scalar, 1, 1> PressureMatrixBlock;
+    typedef Dune::BCRSMatrix<PressureMatrixBlock> PressureMatrix;
+    typedef Dune::BlockVector<Dune::FieldVector<Scalar, 1> > PressureVector;
+
+    PressureReduction(unsigned pressureIdx)
+        : pressureIdx_(pressureIdx)
+        , patternValid_(false)
+    { }
+
+    /*!
+     * \brief Causes the sparsity pattern of the scalar matrix to be recreated by the
+     *        next call to update().
+     */
+    void reset()
+    { patternValid_ = false; }
+
+    /*!
+     * \brief Returns the index of the primary variable which is considered to be the
+     *        pressure.
+     */
+    unsigned pressureIdx() const
+    { return pressureIdx_; }
+
+    /*!
+     * \brief Calculate the weights and the scalar pressure matrix for a given block
+     *        matrix.
+     */
+    void update(const BlockMatrix& M)
+    {
+        if (!patternValid_) {
+            createPressureMatrix_(M);
+            patternValid_ = true;
+        }
+        assert(pressureMatrix_.N() == M.N() && pressureMatrix_.nonzeroes() == M.nonzeroes());
+
+        weights_.resize(M.N());
+        for (unsigned rowIdx = 0; rowIdx < M.N(); ++rowIdx)
+            computeWeights_(M[rowIdx][rowIdx], weights_[rowIdx]);
+
+        auto rowIt = M.begin();
+        const auto& rowEndIt = M.end();
+        auto pRowIt = pressureMatrix_.begin();
+        for (; rowIt != rowEndIt; ++rowIt, ++pRowIt) {
+            const auto& w = weights_[rowIt.index()];
+
+            auto colIt = rowIt->begin();
+            const auto& colEndIt = rowIt->end();
+            auto pColIt = pRowIt->begin();
+            for (; colIt != colEndIt; ++colIt, ++pColIt) {
+                Scalar value = 0.0;
+                for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+                    value += w[eqIdx]*(*colIt)[eqIdx][pressureIdx_];
+                (*pColIt) = value;
+            }
+        }
+    }
+
+    /*!
+     * \brief Returns the weights which were used to combine the equations of each row.
+     */
+    const std::vector<WeightVector>& weights() const
+    { return weights_; }
+
+    /*!
+     * \brief Returns the scalar pressure matrix.
+     */
+    const PressureMatrix& matrix() const
+    { return pressureMatrix_; }
+
+    /*!
+     * \brief Combine a block vector to a scalar one using the weights of each row.
+     */
+    void restrict(const BlockVector& b, PressureVector& bp) const
+    {
+        bp.resize(b.size());
+        for (unsigned rowIdx = 0; rowIdx < b.size(); ++rowIdx)
+            bp[rowIdx] = weights_[rowIdx]*b[rowIdx];
+    }
+
+    /*!
+     * \brief Add a scalar pressure vector to the pressure entries of a block vector.
+     */
+    void prolongate(const PressureVector& dp, BlockVector& x) const
+    {
+        for (unsigned rowIdx = 0; rowIdx < x.size(); ++rowIdx)
+            x[rowIdx][pressureIdx_] += dp[rowIdx];
+    }
+
+private:
+    void createPressureMatrix_(const BlockMatrix& M)
+    {
+        pressureMatrix_ = PressureMatrix(M.N(), M.M(), M.nonzeroes(), PressureMatrix::row_wise);
+
+        auto rowIt = M.begin();
+        for (auto pRowIt = pressureMatrix_.createbegin();
+             pRowIt != pressureMatrix_.createend();
+             ++pRowIt, ++rowIt)
+        {
+            const auto& colEndIt = rowIt->end();
+            for (auto colIt = rowIt->begin(); colIt != colEndIt; ++colIt)
+                pRowIt.insert(colIt.index());
+        }
+    }
+
+    // calculate the quasi-IMPES weights, i.e., solve A_ii^T w = e_p.
+    void computeWeights_(const MatrixBlock& diagBlock, WeightVector& w) const
+    {
+        MatrixBlock diagBlockT;
+        for (unsigned i = 0; i < numEq; ++i)
+            for (unsigned j = 0; j < numEq; ++j)
+                diagBlockT[i][j] = diagBlock[j][i];
+
+        WeightVector rhs(0.0);
+        rhs[pressureIdx_] = 1.0;
+
+        try {
+            diagBlockT.solve(w, rhs);
+        }
+        catch (const Dune::FMatrixError&) {
+            // the diagonal block is singular. fall back to simply adding up the
+            // equations
+            w = 1.0;
+            return;
+        }
+
+        for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx) {
+            if (!std::isfinite(w[eqIdx])) {
+                w = 1.0;
+                return;
+            }
+        }
+    }
+
+    unsigned pressureIdx_;
+    bool patternValid_;
+    std::vector<WeightVector> weights_;
+    PressureMatrix pressureMatrix_;
+};
+
+} // namespace Linear
+} // namespace Ewoms
+
+#endif
@@ -0,0 +1,191 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::Linear::SequentialImplicitPreconditioner
+ */
+#ifndef EWOMS_SEQUENTIAL_IMPLICIT_PRECONDITIONER_HH
+#define EWOMS_SEQUENTIAL_IMPLICIT_PRECONDITIONER_HH
+
+#include <opm/common/Unused.hpp>
+
+#include <dune/istl/preconditioner.hh>
+#include <dune/common/version.hh>
+
+#include <memory>
+
+namespace Ewoms {
+namespace Linear {
+
+/*!
+ * \brief A preconditioner for block matrices on overlapping domains which mimics a
+ *        sequential implicit pressure/transport scheme.
+ *
+ * Each sweep first reduces the current residual to a scalar pressure system using a
+ * PressureReduction object and approximately solves it using a preconditioner for the
+ * pressure matrix (typically a single AMG V-cycle). Then the pressure correction is
+ * kept fixed and the transport system (see TransportReduction) is approximately
+ * solved for the residual which remains, typically using ILU0. In contrast to the
+ * second stage of the CprPreconditioner, the transport stage only considers the
+ * non-pressure unknowns and thus works on a smaller system. Doing more than one sweep
+ * moves the result of the preconditioner towards the solution of the fully coupled
+ * system.
+ *
+ * The transport preconditioner is applied to the local part of the transport matrix
+ * of each process, i.e., the processes only exchange the overlap after each stage.
+ * Both reductions need to be up to date before the preconditioner is applied and all
+ * vectors which are passed to it are assumed to be consistent on the overlap.
+ */
+template <class OverlappingMatrix,
+          class OverlappingVector,
+          class PressureReduction,
+          class PressurePreconditioner,
+          class TransportReduction,
+          class TransportPreconditioner>
+class SequentialImplicitPreconditioner
+    : public Dune::Preconditioner<OverlappingVector, OverlappingVector>
+{
+    typedef typename PressureReduction::PressureVector PressureVector;
+    typedef typename TransportReduction::TransportVector TransportVector;
+
+public:
+    typedef OverlappingVector domain_type;
+    typedef OverlappingVector range_type;
+    typedef typename OverlappingVector::field_type field_type;
+
+#if DUNE_VERSION_NEWER(DUNE_ISTL, 2,6)
+    //! the kind of computations supported by the operator. Either overlapping or non-overlapping
+    Dune::SolverCategory::Category category() const override
+    { return Dune::SolverCategory::overlapping; }
+#else
+    // redefine the category
+    enum { category = Dune::SolverCategory::overlapping };
+#endif
+
+    SequentialImplicitPreconditioner(const OverlappingMatrix& A,
+                                     const PressureReduction& pressureReduction,
+                                     PressurePreconditioner& pressurePrecond,
+                                     const TransportReduction& transportReduction,
+                                     TransportPreconditioner& transportPrecond,
+                                     unsigned numSweeps)
+        : A_(A)
+        , pressureReduction_(pressureReduction)
+        , pressurePrecond_(pressurePrecond)
+        , transportReduction_(transportReduction)
+        , transportPrecond_(transportPrecond)
+        , numSweeps_(numSweeps)
+        , numStageApplications_(0)
+    { }
+
+    /*!
+     * \brief Returns the number of times each stage has been applied since the
+     *        preconditioner was created.
+     */
+    unsigned numStageApplications() const
+    { return numStageApplications_; }
+
+    void pre(domain_type& x, range_type& y) override
+    {
+        // allocate the temporary vectors only once per linear solve
+        residual_.reset(new OverlappingVector(y));
+
+        pressureResidual_.resize(A_.N());
+        pressureUpdate_.resize(A_.N());
+        pressureResidual_ = 0.0;
+        pressureUpdate_ = 0.0;
+        pressurePrecond_.pre(pressureUpdate_, pressureResidual_);
+
+        transportResidual_.resize(A_.N());
+        transportUpdate_.resize(A_.N());
+        transportResidual_ = 0.0;
+        transportUpdate_ = 0.0;
+        transportPrecond_.pre(transportUpdate_, transportResidual_);
+
+        x.sync();
+        y.sync();
+    }
+
+    void apply(domain_type& x, const range_type& d) override
+    {
+        auto& r = *residual_;
+
+        x = 0.0;
+        for (unsigned sweepIdx = 0; sweepIdx < numSweeps_; ++sweepIdx) {
+            // pressure stage: the correction of the previous sweeps is moved to the
+            // right hand side. for the first sweep, this is zero.
+            r = d;
+            if (sweepIdx > 0) {
+                A_.mmv(x, r);
+                r.sync();
+            }
+
+            pressureReduction_.restrict(r, pressureResidual_);
+            pressureUpdate_ = 0.0;
+            pressurePrecond_.apply(pressureUpdate_, pressureResidual_);
+            pressureReduction_.prolongate(pressureUpdate_, x);
+            x.sync();
+
+            // transport stage: keep the pressure correction fixed and solve for the
+            // remaining unknowns
+            r = d;
+            A_.mmv(x, r);
+            r.sync();
+
+            transportReduction_.restrict(r, transportResidual_);
+            transportUpdate_ = 0.0;
+            transportPrecond_.apply(transportUpdate_, transportResidual_);
+            transportReduction_.prolongate(transportUpdate_, x);
+            x.sync();
+
+            ++numStageApplications_;
+        }
+    }
+
+    void post(domain_type& x OPM_UNUSED) override
+    {
+        pressurePrecond_.post(pressureUpdate_);
+        transportPrecond_.post(transportUpdate_);
+
+        residual_.reset();
+    }
+
+private:
+    const OverlappingMatrix& A_;
+    const PressureReduction& pressureReduction_;
+    PressurePreconditioner& pressurePrecond_;
+    const TransportReduction& transportReduction_;
+    TransportPreconditioner& transportPrecond_;
+    unsigned numSweeps_;
+    unsigned numStageApplications_;
+
+    std::unique_ptr<OverlappingVector> residual_;
+    PressureVector pressureResidual_;
+    PressureVector pressureUpdate_;
+    TransportVector transportResidual_;
+    TransportVector transportUpdate_;
+};
+
+} // namespace Linear
+} // namespace Ewoms
+
+#endif
@@ -100,6 +100,15 @@ public:
     bool solve(Vector& x)
     { return SuperLUSolve_<Scalar, TypeTag, Matrix, Vector>::solve_(*M_, x, *b_); }
 
+    /*!
+     * \brief Returns the number of iterations used by the linear solver for the most
+     *        recent call to solve().
+     *
+     * SuperLU is a direct solver, so this is always one.
+     */
+    unsigned iterations() const
+    { return 1; }
+
 private:
     const Matrix* M_;
     Vector* b_;
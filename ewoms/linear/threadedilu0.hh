@@ -0,0 +1,278 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::Linear::ThreadedILU0
+ */
+#ifndef EWOMS_THREADED_ILU0_HH
+#define EWOMS_THREADED_ILU0_HH
+
+#include "blockcsrmatrix.hh"
+
+#include <opm/common/Unused.hpp>
+
+#include <dune/istl/preconditioner.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/istlexception.hh>
+#include <dune/common/fmatrix.hh>
+#include <dune/common/version.hh>
+
+#include <algorithm>
+#include <vector>
+
+namespace Ewoms {
+namespace Linear {
+
+/*!
+ * \brief An ILU(0) preconditioner which uses OpenMP threads for the factorization as
+ *        well as for the triangular solves.
+ *
+ * The rows of the matrix are grouped into levels using the sparsity pattern: A row
+ * only depends on rows of lower levels, so all rows of a given level can be processed
+ * concurrently. Levels are determined separately for the lower triangular part (used
+ * by the factorization and the forward substitution) and for the upper triangular
+ * part (used by the backward substitution). Since the operations for each row are
+ * the ones of the sequential algorithm, the result matches the one of Dune::SeqILU0
+ * up to round-off.
+ *
+ * Once the matrix is factorized, the factors are stored as a BlockCsrMatrix, so the
+ * block operations of the triangular solves can be vectorized by the compiler.
+ */
+template <class Matrix, class DomainVector, class RangeVector>
+class ThreadedILU0 : public Dune::Preconditioner<DomainVector, RangeVector>
+{
+    typedef typename Matrix::block_type MatrixBlock;
+    typedef typename MatrixBlock::field_type Scalar;
+    typedef Dune::BCRSMatrix<MatrixBlock> IluMatrix;
+    typedef BlockCsrMatrix<Scalar, MatrixBlock::rows> CompactMatrix;
+
+public:
+    typedef Matrix matrix_type;
+    typedef DomainVector domain_type;
+    typedef RangeVector range_type;
+    typedef typename DomainVector::field_type field_type;
+
+#if DUNE_VERSION_NEWER(DUNE_ISTL, 2,6)
+    //! the kind of computations supported by the operator. Either overlapping or non-overlapping
+    Dune::SolverCategory::Category category() const override
+    { return Dune::SolverCategory::sequential; }
+#else
+    // define the category
+    enum { category = Dune::SolverCategory::sequential };
+#endif
+
+    /*!
+     * \brief Factorize a matrix.
+     *
+     * \param A The matrix to be factorized
+     * \param relaxationFactor The factor by which the result of the triangular solves
+     *                         is multiplied
+     */
+    ThreadedILU0(const Matrix& A, field_type relaxationFactor)
+        : relaxationFactor_(relaxationFactor)
+    {
+        IluMatrix ilu(A);
+        computeLevels_(ilu);
+        factorize_(ilu);
+
+        ilu_.setPattern(ilu);
+        ilu_.assign(ilu);
+    }
+
+    void pre(domain_type& x OPM_UNUSED, range_type& b OPM_UNUSED) override
+    {}
+
+    void apply(domain_type& v, const range_type& d) override
+    {
+        const unsigned numLowerLevels = static_cast<unsigned>(lowerLevelStart_.size()) - 1;
+        const unsigned numUpperLevels = static_cast<unsigned>(upperLevelStart_.size()) - 1;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+            // forward substitution with the unit lower triangular factor
+            for (unsigned levelIdx = 0; levelIdx < numLowerLevels; ++levelIdx) {
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+                for (unsigned i = lowerLevelStart_[levelIdx]; i < lowerLevelStart_[levelIdx + 1]; ++i)
+                    ilu_.iluForwardRow(lowerLevelRows_[i], d, v);
+            }
+
+            // backward substitution with the upper triangular factor. the diagonal
+            // blocks have already been inverted by the factorization.
+            for (unsigned levelIdx = 0; levelIdx < numUpperLevels; ++levelIdx) {
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+                for (unsigned i = upperLevelStart_[levelIdx]; i < upperLevelStart_[levelIdx + 1]; ++i)
+                    ilu_.iluBackwardRow(upperLevelRows_[i], v);
+            }
+
+            // the relaxation factor must only be applied once the backward solve is
+            // complete: the rows of the later levels use the unscaled values of the
+            // earlier ones.
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+            for (unsigned rowIdx = 0; rowIdx < static_cast<unsigned>(v.size()); ++rowIdx)
+                v[rowIdx] *= relaxationFactor_;
+        }
+    }
+
+    void post(domain_type& x OPM_UNUSED) override
+    {}
+
+private:
+    // group the rows into levels which can be processed independently
+    void computeLevels_(const IluMatrix& ilu)
+    {
+        unsigned numRows = static_cast<unsigned>(ilu.N());
+
+        std::vector<unsigned> level(numRows, 0);
+        for (unsigned rowIdx = 0; rowIdx < numRows; ++rowIdx) {
+            const auto& row = ilu[rowIdx];
+            if (row.find(rowIdx) == row.end())
+                DUNE_THROW(Dune::ISTLError, "Diagonal entry missing in row " << rowIdx);
+
+            unsigned rowLevel = 0;
+            for (auto colIt = row.begin(); colIt.index() < rowIdx; ++colIt)
+                rowLevel = std::max(rowLevel, level[colIt.index()] + 1);
+            level[rowIdx] = rowLevel;
+        }
+        sortByLevel_(level, lowerLevelStart_, lowerLevelRows_);
+
+        for (unsigned rowIdx = numRows; rowIdx > 0; --rowIdx) {
+            const auto& row = ilu[rowIdx - 1];
+            unsigned rowLevel = 0;
+            auto colIt = row.find(rowIdx - 1);
+            const auto& colEndIt = row.end();
+            for (++colIt; colIt != colEndIt; ++colIt)
+                rowLevel = std::max(rowLevel, level[colIt.index()] + 1);
+            level[rowIdx - 1] = rowLevel;
+        }
+        sortByLevel_(level, upperLevelStart_, upperLevelRows_);
+    }
+
+    static void sortByLevel_(const std::vector<unsigned>& level,
+                             std::vector<unsigned>& levelStart,
+                             std::vector<unsigned>& levelRows)
+    {
+        unsigned numLevels = 0;
+        for (unsigned rowLevel : level)
+            numLevels = std::max(numLevels, rowLevel + 1);
+
+        // counting sort of the rows. within a level, the rows retain their order.
+        levelStart.assign(numLevels + 1, 0);
+        for (unsigned rowLevel : level)
+            ++levelStart[rowLevel + 1];
+        for (unsigned levelIdx = 0; levelIdx < numLevels; ++levelIdx)
+            levelStart[levelIdx + 1] += levelStart[levelIdx];
+
+        std::vector<unsigned> pos(levelStart.begin(), levelStart.end() - 1);
+        levelRows.resize(level.size());
+        for (unsigned rowIdx = 0; rowIdx < level.size(); ++rowIdx)
+            levelRows[pos[level[rowIdx]]++] = rowIdx;
+    }
+
+    void factorize_(IluMatrix& ilu)
+    {
+        const unsigned numLevels = static_cast<unsigned>(lowerLevelStart_.size()) - 1;
+        bool singular = false;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        for (unsigned levelIdx = 0; levelIdx < numLevels; ++levelIdx) {
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+            for (unsigned i = lowerLevelStart_[levelIdx]; i < lowerLevelStart_[levelIdx + 1]; ++i) {
+                try {
+                    factorizeRow_(ilu, lowerLevelRows_[i]);
+                }
+                catch (const Dune::FMatrixError&) {
+                    // exceptions must not leave an OpenMP parallel region
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+                    singular = true;
+                }
+            }
+        }
+
+        if (singular)
+            DUNE_THROW(Dune::ISTLError, "ILU(0) factorization encountered a singular diagonal block");
+    }
+
+    // the same algorithm as Dune::bilu0_decomposition(), but for a single row. all rows
+    // which the current one depends on must already be factorized.
+    static void factorizeRow_(IluMatrix& ilu, unsigned rowIdx)
+    {
+        auto& row = ilu[rowIdx];
+        const auto& rowEndIt = row.end();
+
+        auto ijIt = row.begin();
+        for (; ijIt.index() < rowIdx; ++ijIt) {
+            const auto& rowJ = ilu[ijIt.index()];
+            auto jjIt = rowJ.find(ijIt.index());
+
+            // L_ij = A_ij * A_jj^-1
+            ijIt->rightmultiply(*jjIt);
+
+            // A_ik -= L_ij * U_jk for all k > j present in both rows
+            auto ikIt = ijIt;
+            auto jkIt = jjIt;
+            const auto& rowJEndIt = rowJ.end();
+            for (++ikIt, ++jkIt; ikIt != rowEndIt && jkIt != rowJEndIt;) {
+                if (ikIt.index() == jkIt.index()) {
+                    MatrixBlock tmp(*jkIt);
+                    tmp.leftmultiply(*ijIt);
+                    *ikIt -= tmp;
+                    ++ikIt;
+                    ++jkIt;
+                }
+                else if (ikIt.index() < jkIt.index())
+                    ++ikIt;
+                else
+                    ++jkIt;
+            }
+        }
+
+        ijIt->invert();
+    }
+
+    CompactMatrix ilu_;
+    field_type relaxationFactor_;
+
+    std::vector<unsigned> lowerLevelStart_;
+    std::vector<unsigned> lowerLevelRows_;
+    std::vector<unsigned> upperLevelStart_;
+    std::vector<unsigned> upperLevelRows_;
+};
+
+} // namespace Linear
+} // namespace Ewoms
+
+#endif
@@ -0,0 +1,196 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::Linear::TransportReduction
+ */
+#ifndef EWOMS_TRANSPORT_REDUCTION_HH
+#define EWOMS_TRANSPORT_REDUCTION_HH
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+
+#include <array>
+#include <vector>
+#include <cassert>
+#include <cmath>
+
+namespace Ewoms {
+namespace Linear {
+
+/*!
+ * \brief Extracts the "transport" part of a block-structured linear system, i.e., the
+ *        system which remains if the pressure primary variable is kept fixed.
+ *
+ * The reduced system does not contain the pressure unknowns and one equation per
+ * row: The conservation equation which has the largest absolute quasi-IMPES weight
+ * is dropped because it is represented by the pressure system. The weights are taken
+ * from a PressureReduction object, so this must be updated before the transport
+ * system.
+ *
+ * Like for the PressureReduction, the sparsity pattern of the reduced matrix is
+ * created by the first call to update() after construction or after reset().
+ */
+template <class BlockMatrix, class BlockVector>
+class TransportReduction
+{
+    typedef typename BlockMatrix::block_type MatrixBlock;
+    typedef typename MatrixBlock::field_type Scalar;
+
+    enum { numEq = MatrixBlock::rows };
+
+public:
+    typedef Dune::FieldVector<Scalar, numEq> WeightVector;
+    typedef Dune::FieldMatrix<Scalar, numEq - 1, numEq - 1> TransportMatrixBlock;
+    typedef Dune::BCRSMatrix<TransportMatrixBlock> TransportMatrix;
+    typedef Dune::BlockVector<Dune::FieldVector<Scalar, numEq - 1> > TransportVector;
+
+    TransportReduction(unsigned pressureIdx)
+        : pressureIdx_(pressureIdx)
+        , patternValid_(false)
+    {
+        unsigned i = 0;
+        for (unsigned pvIdx = 0; pvIdx < numEq; ++pvIdx)
+            if (pvIdx != pressureIdx_)
+                pvIndices_[i++] = pvIdx;
+    }
+
+    /*!
+     * \brief Causes the sparsity pattern of the reduced matrix to be recreated by the
+     *        next call to update().
+     */
+    void reset()
+    { patternValid_ = false; }
+
+    /*!
+     * \brief Calculate the reduced transport matrix for a given block matrix.
+     *
+     * \param M The block matrix
+     * \param weights The quasi-IMPES weights of each row of the block matrix
+     */
+    void update(const BlockMatrix& M, const std::vector<WeightVector>& weights)
+    {
+        if (!patternValid_) {
+            createTransportMatrix_(M);
+            patternValid_ = true;
+        }
+        assert(transportMatrix_.N() == M.N() && transportMatrix_.nonzeroes() == M.nonzeroes());
+        assert(weights.size() == M.N());
+
+        eqIndices_.resize(M.N());
+        for (unsigned rowIdx = 0; rowIdx < M.N(); ++rowIdx)
+            computeEquations_(weights[rowIdx], eqIndices_[rowIdx]);
+
+        auto rowIt = M.begin();
+        const auto& rowEndIt = M.end();
+        auto tRowIt = transportMatrix_.begin();
+        for (; rowIt != rowEndIt; ++rowIt, ++tRowIt) {
+            const auto& eqIndices = eqIndices_[rowIt.index()];
+
+            auto colIt = rowIt->begin();
+            const auto& colEndIt = rowIt->end();
+            auto tColIt = tRowIt->begin();
+            for (; colIt != colEndIt; ++colIt, ++tColIt) {
+                const auto& block = *colIt;
+                auto& tBlock = *tColIt;
+                for (unsigned i = 0; i < numEq - 1; ++i)
+                    for (unsigned j = 0; j < numEq - 1; ++j)
+                        tBlock[i][j] = block[eqIndices[i]][pvIndices_[j]];
+            }
+        }
+    }
+
+    /*!
+     * \brief Returns the reduced transport matrix.
+     */
+    const TransportMatrix& matrix() const
+    { return transportMatrix_; }
+
+    /*!
+     * \brief Extract the entries of the transport equations from a block vector.
+     */
+    void restrict(const BlockVector& b, TransportVector& bt) const
+    {
+        bt.resize(b.size());
+        for (unsigned rowIdx = 0; rowIdx < b.size(); ++rowIdx) {
+            const auto& eqIndices = eqIndices_[rowIdx];
+            for (unsigned i = 0; i < numEq - 1; ++i)
+                bt[rowIdx][i] = b[rowIdx][eqIndices[i]];
+        }
+    }
+
+    /*!
+     * \brief Add a transport vector to the non-pressure entries of a block vector.
+     */
+    void prolongate(const TransportVector& dt, BlockVector& x) const
+    {
+        for (unsigned rowIdx = 0; rowIdx < x.size(); ++rowIdx)
+            for (unsigned j = 0; j < numEq - 1; ++j)
+                x[rowIdx][pvIndices_[j]] += dt[rowIdx][j];
+    }
+
+private:
+    void createTransportMatrix_(const BlockMatrix& M)
+    {
+        transportMatrix_ = TransportMatrix(M.N(), M.M(), M.nonzeroes(), TransportMatrix::row_wise);
+
+        auto rowIt = M.begin();
+        for (auto tRowIt = transportMatrix_.createbegin();
+             tRowIt != transportMatrix_.createend();
+             ++tRowIt, ++rowIt)
+        {
+            const auto& colEndIt = rowIt->end();
+            for (auto colIt = rowIt->begin(); colIt != colEndIt; ++colIt)
+                tRowIt.insert(colIt.index());
+        }
+    }
+
+    // the indices of the equations of a row which are kept in the transport system.
+    // the conservation equation which contributes most to the pressure equation is
+    // dropped.
+    static void computeEquations_(const WeightVector& w, std::array<unsigned, numEq - 1>& eqIndices)
+    {
+        unsigned droppedEqIdx = 0;
+        for (unsigned eqIdx = 1; eqIdx < numEq; ++eqIdx)
+            if (std::abs(w[eqIdx]) > std::abs(w[droppedEqIdx]))
+                droppedEqIdx = eqIdx;
+
+        unsigned i = 0;
+        for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+            if (eqIdx != droppedEqIdx)
+                eqIndices[i++] = eqIdx;
+    }
+
+    unsigned pressureIdx_;
+    bool patternValid_;
+    std::array<unsigned, numEq - 1> pvIndices_;
+    std::vector<std::array<unsigned, numEq - 1> > eqIndices_;
+    TransportMatrix transportMatrix_;
+};
+
+} // namespace Linear
+} // namespace Ewoms
+
+#endif
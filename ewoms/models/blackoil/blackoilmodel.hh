@@ -54,6 +54,7 @@
 #include <opm/common/ErrorMacros.hpp>
 #include <opm/common/Exceptions.hpp>
 
+#include <algorithm>
 #include <sstream>
 #include <string>
 
@@ -126,6 +127,10 @@ SET_BOOL_PROP(BlackOilModel, EnableSolvent, false);
 SET_BOOL_PROP(BlackOilModel, EnablePolymer, false);
 // by default, ebos formulates the conservation equations in terms of mass not surface volumes
 SET_BOOL_PROP(BlackOilModel, BlackoilConserveSurfaceVolume, false);
+
+// the CPR preconditioner uses the oil pressure for the pressure system
+SET_INT_PROP(BlackOilModel, CprPressureIndex,
+             GET_PROP_TYPE(TypeTag, Indices)::pressureSwitchIdx);
 } // namespace Properties
 
 /*!
@@ -251,6 +256,54 @@ public:
     static std::string name()
     { return "blackoil"; }
 
+    /*!
+     * \copydoc FvBaseDiscretization::extrapolatePrimaryVariables
+     *
+     * For the black-oil model, the primary variables are not extrapolated if the
+     * interpretation of the switching primary variables has changed during the last
+     * time step. Also, the extrapolated saturations are kept within [0, 1], the
+     * pressure stays positive and the dissolution factors and concentrations are kept
+     * non-negative.
+     */
+    void extrapolatePrimaryVariables(unsigned globalDofIdx,
+                                     PrimaryVariables& result,
+                                     const PrimaryVariables& curValue,
+                                     const PrimaryVariables& prevValue,
+                                     Scalar alpha) const
+    {
+        result = curValue;
+        if (curValue.primaryVarsMeaning() != prevValue.primaryVarsMeaning())
+            return;
+
+        for (unsigned pvIdx = 0; pvIdx < numEq; ++pvIdx) {
+            Scalar value = curValue[pvIdx] + alpha*(curValue[pvIdx] - prevValue[pvIdx]);
+
+            if (static_cast<int>(pvIdx) == Indices::pressureSwitchIdx) {
+                if (value <= 0.0)
+                    value = curValue[pvIdx];
+            }
+            else {
+                value = std::max<Scalar>(value, 0.0);
+                if (isSaturationIdx_(pvIdx, curValue))
+                    value = std::min<Scalar>(value, 1.0);
+            }
+
+            result[pvIdx] = value;
+        }
+
+        // the extrapolated water and gas saturations must not exceed 100%
+        if (Indices::waterSaturationIdx >= 0
+            && Indices::compositionSwitchIdx >= 0
+            && curValue.primaryVarsMeaning() == PrimaryVariables::Sw_po_Sg
+            && result[Indices::waterSaturationIdx] + result[Indices::compositionSwitchIdx] > 1.0)
+        {
+            result[Indices::waterSaturationIdx] = curValue[Indices::waterSaturationIdx];
+            result[Indices::compositionSwitchIdx] = curValue[Indices::compositionSwitchIdx];
+        }
+
+        result.adaptPrimaryVariables(this->simulator_.problem(), globalDofIdx);
+    }
+
     /*!
      * \copydoc FvBaseDiscretization::primaryVarName
      */
@@ -376,11 +429,11 @@ public:
         // write the primary variables
         const auto& priVars = this->solution(/*timeIdx=*/0)[dofIdx];
         for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
-            outstream << priVars[eqIdx] << " ";
+            Restart::writeValue(outstream, priVars[eqIdx]);
 
         // write the pseudo primary variables
-        outstream << priVars.primaryVarsMeaning() << " ";
-        outstream << priVars.pvtRegionIndex() << " ";
+        Restart::writeValue(outstream, static_cast<unsigned>(priVars.primaryVarsMeaning()));
+        Restart::writeValue(outstream, static_cast<unsigned>(priVars.pvtRegionIndex()));
 
         SolventModule::serializeEntity(*this, outstream, dof);
         PolymerModule::serializeEntity(*this, outstream, dof);
@@ -407,15 +460,15 @@ public:
             if (!instream.good())
                 OPM_THROW(std::runtime_error,
                           "Could not deserialize degree of freedom " << dofIdx);
-            instream >> priVars[eqIdx];
+            Restart::readValue(instream, priVars[eqIdx]);
         }
 
         // read the pseudo primary variables
         unsigned primaryVarsMeaning;
-        instream >> primaryVarsMeaning;
+        Restart::readValue(instream, primaryVarsMeaning);
 
         unsigned pvtRegionIdx;
-        instream >> pvtRegionIdx;
+        Restart::readValue(instream, pvtRegionIdx);
 
         if (!instream.good())
             OPM_THROW(std::runtime_error,
@@ -493,6 +546,19 @@ private:
     const Implementation& asImp_() const
     { return *static_cast<const Implementation*>(this); }
 
+    // returns true if a primary variable represents a saturation
+    static bool isSaturationIdx_(unsigned pvIdx, const PrimaryVariables& priVars)
+    {
+        int idx = static_cast<int>(pvIdx);
+        if (idx == Indices::waterSaturationIdx)
+            return true;
+        if (idx == Indices::compositionSwitchIdx)
+            return priVars.primaryVarsMeaning() == PrimaryVariables::Sw_po_Sg;
+        if (GET_PROP_VALUE(TypeTag, EnableSolvent))
+            return idx == Indices::solventSaturationIdx;
+        return false;
+    }
+
     template <class Context>
     void updatePvtRegionIndex_(PrimaryVariables& priVars,
                                const Context& context,
@@ -33,6 +33,7 @@
 #include <ewoms/common/signum.hh>
 
 #include <opm/common/Unused.hpp>
+#include <opm/common/ErrorMacros.hpp>
 
 namespace Ewoms {
 
@@ -94,18 +95,8 @@ protected:
     void endIteration_(SolutionVector& uCurrentIter,
                        const SolutionVector& uLastIter)
     {
-#if HAVE_MPI
-        // in the MPI enabled case we need to add up the number of DOF
-        // for which the interpretation changed over all processes.
-        int localSwitched = numPriVarsSwitched_;
-        MPI_Allreduce(&localSwitched,
-                      &numPriVarsSwitched_,
-                      /*num=*/1,
-                      MPI_INT,
-                      MPI_SUM,
-                      MPI_COMM_WORLD);
-#endif // HAVE_MPI
-
+        // the number of DOFs for which the interpretation changed has already been
+        // added up over all processes by update_()
         this->simulator_.model().newtonMethod().endIterMsg()
             << ", num switched=" << numPriVarsSwitched_;
 
@@ -132,13 +123,16 @@ protected:
                       << comm.rank() << "\n";
             succeeded = 0;
         }
-        succeeded = comm.min(succeeded);
+
+        // check whether all processes succeeded and add up the number of DOFs for
+        // which the interpretation changed using a single reduction
+        this->reductions_.min(succeeded);
+        this->reductions_.sum(numPriVarsSwitched_);
+        this->reductions_.communicate();
 
         if (!succeeded)
             OPM_THROW(Opm::NumericalProblem,
                       "A process did not succeed in adapting the primary variables");
-
-        numPriVarsSwitched_ = comm.sum(numPriVarsSwitched_);
     }
 
     /*!
@@ -30,6 +30,7 @@
 
 #include "blackoilproperties.hh"
 #include <ewoms/io/vtkblackoilpolymermodule.hh>
+#include <ewoms/io/restart.hh>
 #include <ewoms/models/common/quantitycallbacks.hh>
 
 #include <opm/material/common/Tabulated1DFunction.hpp>
@@ -560,7 +561,7 @@ public:
 
         unsigned dofIdx = model.dofMapper().index(dof);
         const PrimaryVariables& priVars = model.solution(/*timeIdx=*/0)[dofIdx];
-        outstream << priVars[polymerConcentrationIdx];
+        Restart::writeValue(outstream, priVars[polymerConcentrationIdx]);
     }
 
     template <class DofEntity>
@@ -573,7 +574,7 @@ public:
         PrimaryVariables& priVars0 = model.solution(/*timeIdx=*/0)[dofIdx];
         PrimaryVariables& priVars1 = model.solution(/*timeIdx=*/1)[dofIdx];
 
-        instream >> priVars0[polymerConcentrationIdx];
+        Restart::readValue(instream, priVars0[polymerConcentrationIdx]);
 
         // set the primary variables for the beginning of the current time step.
         priVars1 = priVars0[polymerConcentrationIdx];
@@ -50,6 +50,10 @@ NEW_PROP_TAG(EnableSolvent);
 NEW_PROP_TAG(EnablePolymer);
 //! Enable surface volume scaling
 NEW_PROP_TAG(BlackoilConserveSurfaceVolume);
+
+//! The index of the primary variable which is used as the pressure by the CPR
+//! preconditioner
+NEW_PROP_TAG(CprPressureIndex);
 }} // namespace Properties, Ewoms
 
 #endif
@@ -30,6 +30,7 @@
 
 #include "blackoilproperties.hh"
 #include <ewoms/io/vtkblackoilsolventmodule.hh>
+#include <ewoms/io/restart.hh>
 #include <ewoms/models/common/quantitycallbacks.hh>
 
 #include <opm/material/fluidsystems/blackoilpvt/SolventPvt.hpp>
@@ -665,7 +666,7 @@ public:
         unsigned dofIdx = model.dofMapper().index(dof);
 
         const PrimaryVariables& priVars = model.solution(/*timeIdx=*/0)[dofIdx];
-        outstream << priVars[solventSaturationIdx];
+        Restart::writeValue(outstream, priVars[solventSaturationIdx]);
     }
 
     template <class DofEntity>
@@ -679,7 +680,7 @@ public:
         PrimaryVariables& priVars0 = model.solution(/*timeIdx=*/0)[dofIdx];
         PrimaryVariables& priVars1 = model.solution(/*timeIdx=*/1)[dofIdx];
 
-        instream >> priVars0[solventSaturationIdx];
+        Restart::readValue(instream, priVars0[solventSaturationIdx]);
 
         // set the primary variables for the beginning of the current time step.
         priVars1 = priVars0[solventSaturationIdx];
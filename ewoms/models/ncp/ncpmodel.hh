@@ -53,6 +53,7 @@
 
 #include <dune/common/fvector.hh>
 
+#include <algorithm>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -205,6 +206,7 @@ class NcpModel
     typedef typename GET_PROP_TYPE(TypeTag, ElementContext) ElementContext;
     typedef typename GET_PROP_TYPE(TypeTag, FluidSystem) FluidSystem;
     typedef typename GET_PROP_TYPE(TypeTag, Indices) Indices;
+    typedef typename GET_PROP_TYPE(TypeTag, PrimaryVariables) PrimaryVariables;
 
     enum { numPhases = FluidSystem::numPhases };
     enum { numComponents = FluidSystem::numComponents };
@@ -326,6 +328,32 @@ public:
         }
     }
 
+    /*!
+     * \copydoc FvBaseDiscretization::extrapolatePrimaryVariables
+     *
+     * For the NCP model, the extrapolated fugacities are kept non-negative, the
+     * saturations within [0, 1] and the pressure positive.
+     */
+    void extrapolatePrimaryVariables(unsigned globalDofIdx,
+                                     PrimaryVariables& result,
+                                     const PrimaryVariables& curValue,
+                                     const PrimaryVariables& prevValue,
+                                     Scalar alpha) const
+    {
+        ParentType::extrapolatePrimaryVariables(globalDofIdx, result, curValue, prevValue, alpha);
+
+        for (unsigned compIdx = 0; compIdx < numComponents; ++compIdx)
+            result[fugacity0Idx + compIdx] = std::max<Scalar>(0.0, result[fugacity0Idx + compIdx]);
+
+        for (unsigned phaseIdx = 0; phaseIdx < numPhases - 1; ++phaseIdx) {
+            Scalar& S = result[saturation0Idx + phaseIdx];
+            S = std::max<Scalar>(0.0, std::min<Scalar>(1.0, S));
+        }
+
+        if (result[pressure0Idx] <= 0.0)
+            result[pressure0Idx] = curValue[pressure0Idx];
+    }
+
     /*!
      * \copydoc FvBaseDiscretization::updatePVWeights
      */
@@ -108,7 +108,8 @@ protected:
         }
 
         // take the other processes into account
-        this->error_ = this->comm_.max(this->error_);
+        this->reductions_.max(this->error_);
+        this->communicateReductions_();
 
         // make sure that the error never grows beyond the maximum
         // allowed one
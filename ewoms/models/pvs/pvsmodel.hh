@@ -52,6 +52,7 @@
 #include <opm/common/ErrorMacros.hpp>
 #include <opm/common/Exceptions.hpp>
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -400,6 +401,36 @@ public:
         return FluidSystem::molarMass(compIdx);
     }
 
+    /*!
+     * \copydoc FvBaseDiscretization::extrapolatePrimaryVariables
+     *
+     * The primary variables of the PVS model are only extrapolated if the set of
+     * present phases did not change during the last time step. The extrapolated
+     * saturations and mole fractions are kept within [0, 1].
+     */
+    void extrapolatePrimaryVariables(unsigned globalDofIdx,
+                                     PrimaryVariables& result,
+                                     const PrimaryVariables& curValue,
+                                     const PrimaryVariables& prevValue,
+                                     Scalar alpha) const
+    {
+        result = curValue;
+        if (curValue.phasePresence() != prevValue.phasePresence())
+            return;
+
+        ParentType::extrapolatePrimaryVariables(globalDofIdx, result, curValue, prevValue, alpha);
+
+        if (result[Indices::pressure0Idx] <= 0.0)
+            result[Indices::pressure0Idx] = curValue[Indices::pressure0Idx];
+
+        for (unsigned pvIdx = Indices::switch0Idx;
+             pvIdx < Indices::switch0Idx + numComponents - 1;
+             ++pvIdx)
+        {
+            result[pvIdx] = std::max<Scalar>(0.0, std::min<Scalar>(1.0, result[pvIdx]));
+        }
+    }
+
     /*!
      * \copydoc FvBaseDiscretization::advanceTimeLevel
      */
@@ -429,7 +460,7 @@ public:
         if (!outstream.good())
             OPM_THROW(std::runtime_error, "Could not serialize DOF " << dofIdx);
 
-        outstream << this->solution(/*timeIdx=*/0)[dofIdx].phasePresence() << " ";
+        Restart::writeValue(outstream, this->solution(/*timeIdx=*/0)[dofIdx].phasePresence());
     }
 
     /*!
@@ -448,7 +479,7 @@ public:
                        "Could not deserialize DOF " << dofIdx);
 
         short tmp;
-        instream >> tmp;
+        Restart::readValue(instream, tmp);
         this->solution(/*timeIdx=*/0)[dofIdx].setPhasePresence(tmp);
         this->solution(/*timeIdx=*/1)[dofIdx].setPhasePresence(tmp);
     }
@@ -518,18 +549,20 @@ public:
                       << "\n"  << std::flush;
             succeeded = 0;
         }
-        succeeded = this->simulator_.gridView().comm().min(succeeded);
+
+        // make sure that if there was a variable switch in an other partition we will
+        // also set the switch flag for our partition. this only requires a single
+        // reduction together with the check whether all processes succeeded.
+        auto& reductions = this->simulator_.model().newtonMethod().reductions();
+        reductions.min(succeeded);
+        reductions.sum(numSwitched_);
+        reductions.communicate();
 
         if (!succeeded) {
             OPM_THROW(Opm::NumericalProblem,
                        "A process did not succeed in adapting the primary variables");
         }
 
-        // make sure that if there was a variable switch in an
-        // other partition we will also set the switch flag
-        // for our partition.
-        numSwitched_ = this->gridView_.comm().sum(numSwitched_);
-
         if (verbosity_ > 0)
             this->simulator_.model().newtonMethod().endIterMsg()
                 << ", num switched=" << numSwitched_;
@@ -0,0 +1,274 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::NewtonConvergenceTrace
+ */
+#ifndef EWOMS_NEWTON_CONVERGENCE_TRACE_HH
+#define EWOMS_NEWTON_CONVERGENCE_TRACE_HH
+
+#include <ewoms/io/asyncbinarywriter.hh>
+#include <ewoms/common/propertysystem.hh>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+namespace Ewoms {
+namespace Properties {
+// forward declaration of the required property tags
+NEW_PROP_TAG(Scalar);
+NEW_PROP_TAG(NumEq);
+NEW_PROP_TAG(GlobalEqVector);
+} // namespace Properties
+
+/*!
+ * \ingroup Newton
+ *
+ * \brief Writes a compact binary trace of the convergence behavior of the Newton
+ *        method.
+ *
+ * In contrast to the VTK based convergence writers, only a few numbers are written per
+ * iteration, so this is cheap enough to be always enabled. Each process writes its own
+ * file. All values are written using the native byte order of the machine; floating
+ * point values are always written as double.
+ *
+ * The file starts with a header consisting of the 8 character magic string
+ * "EWNCTRC\0" followed by the format version, the number of equations and the number
+ * of reported worst degrees of freedom (all uint32_t) and the rank of the process
+ * (int32_t). After this, an arbitrary number of records follows. Each record starts
+ * with its type as uint32_t:
+ *
+ * - 1, begin of a time step: time step index (int32_t), time and time step size
+ * - 2, Newton iteration: iteration index (int32_t, starting at 0), error, the maximum
+ *   and the sum of the weighted absolute residuals for each equation, the maximum
+ *   absolute update of each primary variable (zero if the linear solver failed or if
+ *   no linear system was solved), the indices (uint32_t) and weighted residuals of the
+ *   degrees of freedom exhibiting the largest residual (unused entries use the index
+ *   0xffffffff), the number of linear solver iterations (uint32_t) and the time spent
+ *   on linearization, solution and update for the iteration
+ * - 3, end of a time step: convergence flag (uint32_t) and number of iterations
+ *   (int32_t)
+ */
+template <class TypeTag>
+class NewtonConvergenceTrace
+{
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, GlobalEqVector) GlobalEqVector;
+
+    enum { numEq = GET_PROP_VALUE(TypeTag, NumEq) };
+
+public:
+    //! The number of degrees of freedom with the largest residual which get reported
+    static const unsigned numWorstDof = 5;
+
+    enum RecordType {
+        beginTimeStepRecord = 1,
+        iterationRecord = 2,
+        endTimeStepRecord = 3
+    };
+
+    NewtonConvergenceTrace(const std::string& fileName, int rank)
+        : writer_(fileName)
+    {
+        const char magic[8] = { 'E', 'W', 'N', 'C', 'T', 'R', 'C', 0 };
+        writer_.write(magic, sizeof(magic));
+        writer_.write(static_cast<uint32_t>(1));
+        writer_.write(static_cast<uint32_t>(numEq));
+        writer_.write(static_cast<uint32_t>(numWorstDof));
+        writer_.write(static_cast<int32_t>(rank));
+    }
+
+    /*!
+     * \brief Called by the Newton method when it starts to solve a time step.
+     */
+    void beginTimeStep(int timeStepIdx, Scalar time, Scalar timeStepSize)
+    {
+        writer_.write(static_cast<uint32_t>(beginTimeStepRecord));
+        writer_.write(static_cast<int32_t>(timeStepIdx));
+        writer_.write(static_cast<double>(time));
+        writer_.write(static_cast<double>(timeStepSize));
+
+        lastLinearizeTime_ = 0.0;
+        lastSolveTime_ = 0.0;
+        lastUpdateTime_ = 0.0;
+        resetIteration_();
+    }
+
+    /*!
+     * \brief Record the norms of the residual of the current iteration.
+     *
+     * Only the degrees of freedom of the interior elements of the process are
+     * considered, i.e., the ones in the overlap are left to their peer processes.
+     */
+    template <class Model>
+    void recordResidual(const Model& model, const GlobalEqVector& residual)
+    {
+        std::fill(residualMax_.begin(), residualMax_.end(), 0.0);
+        std::fill(residualSum_.begin(), residualSum_.end(), 0.0);
+        std::fill(worstDofIdx_.begin(), worstDofIdx_.end(), invalidDofIdx_());
+        std::fill(worstDofResidual_.begin(), worstDofResidual_.end(), 0.0);
+
+        size_t numGridDof = model.numGridDof();
+        for (unsigned dofIdx = 0; dofIdx < numGridDof; ++dofIdx) {
+            if (!model.isLocalDof(dofIdx))
+                continue;
+
+            double dofResid = 0.0;
+            for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx) {
+                double r = std::abs(residual[dofIdx][eqIdx]*model.eqWeight(dofIdx, eqIdx));
+                residualMax_[eqIdx] = std::max(residualMax_[eqIdx], r);
+                residualSum_[eqIdx] += r;
+                dofResid = std::max(dofResid, r);
+            }
+
+            // insert the degree of freedom into the sorted list of the worst ones
+            if (dofResid <= worstDofResidual_[numWorstDof - 1])
+                continue;
+            unsigned i = numWorstDof - 1;
+            for (; i > 0 && worstDofResidual_[i - 1] < dofResid; --i) {
+                worstDofResidual_[i] = worstDofResidual_[i - 1];
+                worstDofIdx_[i] = worstDofIdx_[i - 1];
+            }
+            worstDofResidual_[i] = dofResid;
+            worstDofIdx_[i] = dofIdx;
+        }
+    }
+
+    /*!
+     * \brief Record the number of iterations required by the linear solver.
+     */
+    void recordLinearSolve(unsigned numIterations)
+    { linearIterations_ = numIterations; }
+
+    /*!
+     * \brief Record the norms of the update of the current iteration.
+     *
+     * Like for the residual, only the degrees of freedom of the interior elements of
+     * the process are considered.
+     */
+    template <class Model>
+    void recordUpdate(const Model& model, const GlobalEqVector& update)
+    {
+        size_t numGridDof = model.numGridDof();
+        for (unsigned dofIdx = 0; dofIdx < numGridDof; ++dofIdx) {
+            if (!model.isLocalDof(dofIdx))
+                continue;
+
+            for (unsigned pvIdx = 0; pvIdx < numEq; ++pvIdx)
+                updateMax_[pvIdx] = std::max<double>(updateMax_[pvIdx],
+                                                     std::abs(update[dofIdx][pvIdx]));
+        }
+    }
+
+    /*!
+     * \brief Write the record for a Newton iteration.
+     *
+     * The timers are expected to accumulate over the whole time step.
+     */
+    template <class Timer>
+    void endIteration(int iterationIdx,
+                      Scalar error,
+                      const Timer& linearizeTimer,
+                      const Timer& solveTimer,
+                      const Timer& updateTimer)
+    {
+        writer_.write(static_cast<uint32_t>(iterationRecord));
+        writer_.write(static_cast<int32_t>(iterationIdx));
+        writer_.write(static_cast<double>(error));
+        writer_.write(residualMax_);
+        writer_.write(residualSum_);
+        writer_.write(updateMax_);
+        for (unsigned i = 0; i < numWorstDof; ++i) {
+            writer_.write(worstDofIdx_[i]);
+            writer_.write(worstDofResidual_[i]);
+        }
+        writer_.write(static_cast<uint32_t>(linearIterations_));
+
+        double linearizeTime = linearizeTimer.realTimeElapsed();
+        double solveTime = solveTimer.realTimeElapsed();
+        double updateTime = updateTimer.realTimeElapsed();
+        writer_.write(linearizeTime - lastLinearizeTime_);
+        writer_.write(solveTime - lastSolveTime_);
+        writer_.write(updateTime - lastUpdateTime_);
+        lastLinearizeTime_ = linearizeTime;
+        lastSolveTime_ = solveTime;
+        lastUpdateTime_ = updateTime;
+
+        resetIteration_();
+    }
+
+    /*!
+     * \brief Called by the Newton method if it is finished with a time step.
+     *
+     * This hands the data of the time step to the background writer and throws if
+     * writing the data of a previous time step failed.
+     */
+    void endTimeStep(bool converged, int numIterations)
+    {
+        writer_.write(static_cast<uint32_t>(endTimeStepRecord));
+        writer_.write(static_cast<uint32_t>(converged ? 1 : 0));
+        writer_.write(static_cast<int32_t>(numIterations));
+        writer_.flush();
+    }
+
+    /*!
+     * \brief Write all remaining records to disk and close the file.
+     */
+    void close()
+    { writer_.close(); }
+
+private:
+    static uint32_t invalidDofIdx_()
+    { return std::numeric_limits<uint32_t>::max(); }
+
+    void resetIteration_()
+    {
+        std::fill(residualMax_.begin(), residualMax_.end(), 0.0);
+        std::fill(residualSum_.begin(), residualSum_.end(), 0.0);
+        std::fill(updateMax_.begin(), updateMax_.end(), 0.0);
+        std::fill(worstDofIdx_.begin(), worstDofIdx_.end(), invalidDofIdx_());
+        std::fill(worstDofResidual_.begin(), worstDofResidual_.end(), 0.0);
+        linearIterations_ = 0;
+    }
+
+    AsyncBinaryWriter writer_;
+
+    std::array<double, numEq> residualMax_;
+    std::array<double, numEq> residualSum_;
+    std::array<double, numEq> updateMax_;
+    std::array<uint32_t, numWorstDof> worstDofIdx_;
+    std::array<double, numWorstDof> worstDofResidual_;
+    unsigned linearIterations_;
+
+    double lastLinearizeTime_;
+    double lastSolveTime_;
+    double lastUpdateTime_;
+};
+
+} // namespace Ewoms
+
+#endif
@@ -0,0 +1,194 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::NewtonDivergenceDetector
+ */
+#ifndef EWOMS_NEWTON_DIVERGENCE_DETECTOR_HH
+#define EWOMS_NEWTON_DIVERGENCE_DETECTOR_HH
+
+#include <algorithm>
+#include <cmath>
+
+namespace Ewoms {
+/*!
+ * \ingroup Newton
+ *
+ * \brief Decides whether a Newton method is unlikely to converge within the allowed
+ *        number of iterations given the errors of the iterations so far.
+ *
+ * A time step is considered to be hopeless if any of the following conditions holds:
+ *
+ * - The error grew in two consecutive iterations and is larger than the initial one.
+ * - The ratio of the errors of two consecutive iterations was above the stagnation
+ *   rate for three iterations in a row.
+ * - Extrapolating the observed convergence behavior predicts that the tolerance will
+ *   not be reached within the remaining iterations, and this was also the case for
+ *   the previous iteration. The extrapolation uses the order of convergence which
+ *   is estimated from the last three errors, so quadratically converging iterations
+ *   are not aborted just because their rate of convergence is still poor.
+ */
+template <class Scalar>
+class NewtonDivergenceDetector
+{
+public:
+    /*!
+     * \param stagnationRate The ratio of the errors of two consecutive iterations above
+     *                       which the method is considered to stagnate.
+     */
+    explicit NewtonDivergenceDetector(Scalar stagnationRate)
+        : stagnationRate_(stagnationRate)
+    { reset(); }
+
+    /*!
+     * \brief Forget the history of the errors, i.e., start a new time step.
+     */
+    void reset()
+    {
+        initialError_ = 0.0;
+        lastError_ = 0.0;
+        lastRate_ = 0.0;
+        numGrowing_ = 0;
+        numStagnating_ = 0;
+        numHopeless_ = 0;
+        diverged_ = false;
+        timeStepReduction_ = 0.5;
+    }
+
+    /*!
+     * \brief Consider the error of a Newton iteration.
+     *
+     * \param iterationIdx The index of the iteration of the current time step
+     * \param error The error of the iteration
+     * \param tolerance The error below which the Newton method is converged
+     * \param maxIterations The maximum number of iterations of the Newton method
+     *
+     * \return true if the time step should be aborted.
+     */
+    bool update(int iterationIdx, Scalar error, Scalar tolerance, int maxIterations)
+    {
+        if (iterationIdx == 0) {
+            initialError_ = error;
+            lastError_ = error;
+            lastRate_ = 0.0;
+            return diverged_;
+        }
+
+        if (diverged_ || error <= tolerance || lastError_ <= 0.0) {
+            lastError_ = error;
+            lastRate_ = 0.0;
+            return diverged_;
+        }
+
+        Scalar rate = error/lastError_;
+        numGrowing_ = (rate > 1.0) ? numGrowing_ + 1 : 0;
+        numStagnating_ = (rate > stagnationRate_) ? numStagnating_ + 1 : 0;
+
+        if (numGrowing_ >= 2 && error > initialError_) {
+            // the error explodes: be aggressive with the time step size
+            diverged_ = true;
+            timeStepReduction_ = 0.25;
+        }
+        else if (numStagnating_ >= 3) {
+            diverged_ = true;
+            timeStepReduction_ = 0.5;
+        }
+        else if (0.0 < rate && rate < 1.0 && 0.0 < lastRate_ && lastRate_ < 1.0) {
+            // for e_{k+1} = C*e_k^p, the ratio of two consecutive errors is the one of
+            // the previous iteration to the power of p. Newton's method does not
+            // converge faster than quadratically and an order below one means that the
+            // convergence slows down, which is taken care of by the stagnation check.
+            Scalar order = std::log(rate)/std::log(lastRate_);
+            order = std::max<Scalar>(1.0, std::min<Scalar>(2.0, order));
+
+            int remainingBudget = std::max(maxIterations - iterationIdx, 0);
+            int maxPredicted = 10*(remainingBudget + 1);
+            int predicted = predictIterations_(error, rate, order, tolerance, maxPredicted);
+            numHopeless_ = (predicted > remainingBudget) ? numHopeless_ + 1 : 0;
+            if (numHopeless_ >= 2) {
+                diverged_ = true;
+                timeStepReduction_ =
+                    std::max<Scalar>(0.1, std::min<Scalar>(0.5, Scalar(remainingBudget)/predicted));
+            }
+        }
+        else
+            numHopeless_ = 0;
+
+        lastError_ = error;
+        lastRate_ = rate;
+        return diverged_;
+    }
+
+    /*!
+     * \brief Returns true if the time step should be aborted.
+     */
+    bool diverged() const
+    { return diverged_; }
+
+    /*!
+     * \brief Returns the factor by which the time step size should be reduced.
+     *
+     * This is 0.5 if divergence was not detected.
+     */
+    Scalar timeStepReduction() const
+    { return timeStepReduction_; }
+
+    /*!
+     * \brief Returns the ratio of the two most recent errors.
+     */
+    Scalar lastRate() const
+    { return lastRate_; }
+
+private:
+    // returns the number of iterations required to get from the error to the tolerance
+    // if the rate of convergence evolves with the given order. the result is at most
+    // maxIterations.
+    static int predictIterations_(Scalar error,
+                                  Scalar rate,
+                                  Scalar order,
+                                  Scalar tolerance,
+                                  int maxIterations)
+    {
+        int n = 0;
+        for (; n < maxIterations && error > tolerance; ++n) {
+            rate = std::pow(rate, order);
+            error *= rate;
+        }
+        return n;
+    }
+
+    Scalar stagnationRate_;
+
+    Scalar initialError_;
+    Scalar lastError_;
+    Scalar lastRate_;
+    int numGrowing_;
+    int numStagnating_;
+    int numHopeless_;
+    bool diverged_;
+    Scalar timeStepReduction_;
+};
+
+} // namespace Ewoms
+
+#endif
@@ -28,11 +28,15 @@
 #define EWOMS_NEWTON_METHOD_HH
 
 #include "nullconvergencewriter.hh"
+#include "newtonconvergencetrace.hh"
+#include "newtondivergencedetector.hh"
 
 #include <ewoms/common/propertysystem.hh>
 #include <ewoms/common/parametersystem.hh>
 #include <ewoms/common/timer.hh>
 #include <ewoms/common/timerguard.hh>
+#include <ewoms/linear/overlaptypes.hh>
+#include <ewoms/parallel/reductionbatch.hh>
 
 #include <opm/material/densead/Math.hpp>
 
@@ -45,7 +49,10 @@
 #include <dune/common/version.hh>
 #include <dune/common/parallel/mpihelper.hh>
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <memory>
 #include <sstream>
 
 #include <unistd.h>
@@ -144,10 +151,37 @@ NEW_PROP_TAG(NewtonTargetIterations);
 //! Number of maximum iterations for the Newton method.
 NEW_PROP_TAG(NewtonMaxIterations);
 
+/*!
+ * \brief Specifies whether a compact binary trace of the convergence behavior of the
+ *        Newton method should be written.
+ *
+ * See Ewoms::NewtonConvergenceTrace for the format.
+ */
+NEW_PROP_TAG(NewtonWriteConvergenceTrace);
+
+/*!
+ * \brief Specifies whether the Newton method should abort a time step as soon as it
+ *        detects that it is unlikely to converge.
+ *
+ * A time step is considered to be hopeless if the error grows for two consecutive
+ * iterations beyond the initial error, if the error stagnates for three consecutive
+ * iterations (see NewtonStagnationRate) or if extrapolating the observed rate and
+ * order of convergence predicts that more than NewtonMaxIterations iterations are
+ * needed in two consecutive iterations. See Ewoms::NewtonDivergenceDetector.
+ */
+NEW_PROP_TAG(NewtonEnableDivergenceDetection);
+
+/*!
+ * \brief The ratio of the errors of two consecutive iterations above which the Newton
+ *        method is considered to stagnate.
+ */
+NEW_PROP_TAG(NewtonStagnationRate);
+
 // set default values for the properties
 SET_TYPE_PROP(NewtonMethod, NewtonMethod, Ewoms::NewtonMethod<TypeTag>);
 SET_TYPE_PROP(NewtonMethod, NewtonConvergenceWriter, Ewoms::NullConvergenceWriter<TypeTag>);
 SET_BOOL_PROP(NewtonMethod, NewtonWriteConvergence, false);
+SET_BOOL_PROP(NewtonMethod, NewtonWriteConvergenceTrace, false);
 SET_BOOL_PROP(NewtonMethod, NewtonVerbose, true);
 SET_SCALAR_PROP(NewtonMethod, NewtonRawTolerance, 1e-8);
 // set the abortion tolerace to some very large value. if not
@@ -155,6 +189,8 @@ SET_SCALAR_PROP(NewtonMethod, NewtonRawTolerance, 1e-8);
 SET_SCALAR_PROP(NewtonMethod, NewtonMaxError, 1e100);
 SET_INT_PROP(NewtonMethod, NewtonTargetIterations, 10);
 SET_INT_PROP(NewtonMethod, NewtonMaxIterations, 18);
+SET_BOOL_PROP(NewtonMethod, NewtonEnableDivergenceDetection, false);
+SET_SCALAR_PROP(NewtonMethod, NewtonStagnationRate, 0.9);
 } // namespace Properties
 } // namespace Ewoms
 
@@ -184,6 +220,7 @@ class NewtonMethod
     typedef typename GET_PROP_TYPE(TypeTag, JacobianMatrix) JacobianMatrix;
     typedef typename GET_PROP_TYPE(TypeTag, LinearSolverBackend) LinearSolverBackend;
     typedef typename GET_PROP_TYPE(TypeTag, NewtonConvergenceWriter) ConvergenceWriter;
+    typedef Ewoms::NewtonConvergenceTrace<TypeTag> ConvergenceTrace;
 
     typedef typename Dune::MPIHelper::MPICommunicator Communicator;
     typedef Dune::CollectiveCommunication<Communicator> CollectiveCommunication;
@@ -192,8 +229,10 @@ public:
     NewtonMethod(Simulator& simulator)
         : simulator_(simulator)
         , endIterMsgStream_(std::ostringstream::out)
+        , divergenceDetector_(EWOMS_GET_PARAM(TypeTag, Scalar, NewtonStagnationRate))
         , linearSolver_(simulator)
-        , comm_(Dune::MPIHelper::getCommunicator())
+        , comm_(Ewoms::Linear::gridCommunicator(simulator.gridView().comm()))
+        , reductions_(Ewoms::Linear::gridCommunicator(simulator.gridView().comm()))
         , convergenceWriter_(asImp_())
     {
         lastError_ = 1e100;
@@ -201,6 +240,8 @@ public:
         tolerance_ = EWOMS_GET_PARAM(TypeTag, Scalar, NewtonRawTolerance);
 
         numIterations_ = 0;
+
+        linearizationPending_ = false;
     }
 
     /*!
@@ -216,6 +257,9 @@ public:
         EWOMS_REGISTER_PARAM(TypeTag, bool, NewtonWriteConvergence,
                              "Write the convergence behaviour of the Newton "
                              "method to a VTK file");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, NewtonWriteConvergenceTrace,
+                             "Write a compact binary trace of the convergence "
+                             "behaviour of the Newton method");
         EWOMS_REGISTER_PARAM(TypeTag, int, NewtonTargetIterations,
                              "The 'optimum' number of Newton iterations per "
                              "time step");
@@ -229,6 +273,13 @@ public:
         EWOMS_REGISTER_PARAM(TypeTag, Scalar, NewtonMaxError,
                              "The maximum error tolerated by the Newton "
                              "method to which does not cause an abort");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, NewtonEnableDivergenceDetection,
+                             "Abort the Newton method as soon as it is unlikely "
+                             "to converge");
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, NewtonStagnationRate,
+                             "The ratio of the errors of two consecutive Newton "
+                             "iterations above which the method is considered "
+                             "to stagnate");
     }
 
     /*!
@@ -262,6 +313,17 @@ public:
     const Model& model() const
     { return simulator_.model(); }
 
+    /*!
+     * \brief Returns the batch of reductions over all processes which is communicated
+     *        once per iteration.
+     *
+     * Code which is called while the system is linearized can add values to it instead
+     * of doing its own collective operation. The results are available after the error
+     * of the iteration has been determined.
+     */
+    ReductionBatch& reductions()
+    { return reductions_; }
+
     /*!
      * \brief Returns the number of iterations done since the Newton method
      *        was invoked.
@@ -368,6 +430,14 @@ public:
                 auto& b = linearizer.residual();
                 linearSolver_.prepareRhs(M, b);
                 asImp_().preSolve_(currentSolution,  b);
+
+                // preSolve_() usually communicates the reductions of this iteration
+                // together with the error. if it did not, this is done here.
+                communicateReductions_();
+
+                detectDivergence_();
+                if (convergenceTrace_)
+                    convergenceTrace_->recordResidual(model(), b);
                 updateTimer_.stop();
 
                 if (!asImp_().proceed_()) {
@@ -377,6 +447,7 @@ public:
 
                     // tell the implementation that we're done with this iteration
                     prePostProcessTimer_.start();
+                    traceIteration_();
                     asImp_().endIteration_(nextSolution, currentSolution);
                     prePostProcessTimer_.stop();
 
@@ -396,12 +467,18 @@ public:
                 bool converged = linearSolver_.solve(solutionUpdate);
                 solveTimer_.stop();
 
+                if (convergenceTrace_)
+                    convergenceTrace_->recordLinearSolve(linearSolver_.iterations());
+
                 if (!converged) {
                     solveTimer_.stop();
                     if (asImp_().verbose_())
                         std::cout << "Newton: Linear solver did not converge\n" << std::flush;
 
+                    // the update of a failed linear solve is meaningless, so the trace
+                    // only contains the residual of the iteration
                     prePostProcessTimer_.start();
+                    traceIteration_();
                     asImp_().failed_();
                     prePostProcessTimer_.stop();
 
@@ -415,6 +492,9 @@ public:
                               << std::flush;
                 }
 
+                if (convergenceTrace_)
+                    convergenceTrace_->recordUpdate(model(), solutionUpdate);
+
                 // update the current solution (i.e. uOld) with the delta
                 // (i.e. u). The result is stored in u
                 updateTimer_.start();
@@ -432,6 +512,7 @@ public:
 
                 // tell the implementation that we're done with this iteration
                 prePostProcessTimer_.start();
+                traceIteration_();
                 asImp_().endIteration_(nextSolution, currentSolution);
                 prePostProcessTimer_.stop();
             }
@@ -529,6 +610,23 @@ public:
         return oldTimeStep * (1.0 + percent / 1.2);
     }
 
+    /*!
+     * \brief Returns the factor by which the time step size should be reduced after
+     *        the Newton method failed.
+     *
+     * If the Newton method detected divergence, this factor depends on how it
+     * diverged, else the time step size is halved.
+     */
+    Scalar timeStepReduction() const
+    { return divergenceDetector_.timeStepReduction(); }
+
+    /*!
+     * \brief Returns true if the Newton method aborted the most recent time step
+     *        because it was unlikely to converge.
+     */
+    bool diverged() const
+    { return divergenceDetector_.diverged(); }
+
     /*!
      * \brief Message that should be printed for the user after the
      *        end of an iteration.
@@ -585,9 +683,22 @@ protected:
     void begin_(const SolutionVector& u  OPM_UNUSED)
     {
         numIterations_ = 0;
+        divergenceDetector_.reset();
 
         if (EWOMS_GET_PARAM(TypeTag, bool, NewtonWriteConvergence))
             convergenceWriter_.beginTimeStep();
+
+        if (EWOMS_GET_PARAM(TypeTag, bool, NewtonWriteConvergenceTrace)) {
+            if (!convergenceTrace_) {
+                std::ostringstream oss;
+                oss << problem().name() << "_rank=" << comm_.rank() << ".nct";
+                convergenceTrace_.reset(new ConvergenceTrace(oss.str(), comm_.rank()));
+            }
+
+            convergenceTrace_->beginTimeStep(simulator_.timeStepIndex(),
+                                             simulator_.time(),
+                                             simulator_.timeStepSize());
+        }
     }
 
     /*!
@@ -603,7 +714,29 @@ protected:
      * \brief Linearize the global non-linear system of equations.
      */
     void linearize_()
-    { model().linearizer().linearize(); }
+    {
+        // whether all processes succeeded is checked after the error of the iteration
+        // has been determined, so that both only require a single reduction
+        model().linearizer().linearize(reductions_);
+        linearizationPending_ = true;
+    }
+
+    /*!
+     * \brief Communicate the batch of reductions of the current iteration.
+     *
+     * After a linearization, the batch contains whether it succeeded on all processes.
+     * If it did not, Opm::NumericalProblem is thrown before any of the reduced values
+     * can be used, because the ones of the failed processes are meaningless.
+     */
+    void communicateReductions_()
+    {
+        reductions_.communicate();
+
+        if (linearizationPending_) {
+            linearizationPending_ = false;
+            model().linearizer().finishLinearization();
+        }
+    }
 
     void preSolve_(const SolutionVector& currentSolution  OPM_UNUSED,
                    const GlobalEqVector& currentResidual)
@@ -631,7 +764,8 @@ protected:
         }
 
         // take the other processes into account
-        error_ = comm_.max(error_);
+        reductions_.max(error_);
+        communicateReductions_();
 
         // make sure that the error never grows beyond the maximum
         // allowed one
@@ -785,7 +919,9 @@ protected:
      */
     bool proceed_() const
     {
-        if (asImp_().numIterations() < 1)
+        if (divergenceDetector_.diverged())
+            return false; // the current time step is a lost cause
+        else if (asImp_().numIterations() < 1)
             return true; // we always do at least one full iteration
         else if (asImp_().converged()) {
             // we are below the specified tolerance, so we don't have to
@@ -819,7 +955,12 @@ protected:
      * This method is called _after_ end_()
      */
     void failed_()
-    { numIterations_ = targetIterations_() * 2; }
+    {
+        if (convergenceTrace_)
+            convergenceTrace_->endTimeStep(/*converged=*/false, numIterations_);
+
+        numIterations_ = targetIterations_() * 2;
+    }
 
     /*!
      * \brief Called if the Newton method was successful.
@@ -827,7 +968,40 @@ protected:
      * This method is called _after_ end_()
      */
     void succeeded_()
-    {}
+    {
+        if (convergenceTrace_)
+            convergenceTrace_->endTimeStep(/*converged=*/true, numIterations_);
+    }
+
+    // check whether the current time step is unlikely to converge. this is called
+    // directly after the error of the current iteration has been determined
+    void detectDivergence_()
+    {
+        if (!EWOMS_GET_PARAM(TypeTag, bool, NewtonEnableDivergenceDetection))
+            return;
+
+        bool diverged = divergenceDetector_.update(numIterations_,
+                                                   error_,
+                                                   tolerance(),
+                                                   maxIterations_());
+        if (diverged && asImp_().verbose_())
+            std::cout << "Newton: Aborting time step after " << numIterations_
+                      << " iterations (error: " << error_
+                      << ", rate of convergence: " << divergenceDetector_.lastRate() << ")\n"
+                      << std::flush;
+    }
+
+    // write the convergence trace record of the iteration which was just finished. this
+    // must be called before endIteration_() increments the iteration index.
+    void traceIteration_()
+    {
+        if (convergenceTrace_)
+            convergenceTrace_->endIteration(numIterations_,
+                                            error_,
+                                            linearizeTimer_,
+                                            solveTimer_,
+                                            updateTimer_);
+    }
 
     // optimal number of iterations we want to achieve
     int targetIterations_() const
@@ -855,6 +1029,13 @@ protected:
     // actual number of iterations done so far
     int numIterations_;
 
+    // decides whether the current time step is unlikely to converge
+    NewtonDivergenceDetector<Scalar> divergenceDetector_;
+
+    // true if the linearizer has added its success flag to the reductions, but the
+    // result has not been checked yet
+    bool linearizationPending_;
+
     // the linear solver
     LinearSolverBackend linearSolver_;
 
@@ -862,10 +1043,18 @@ protected:
     // or MPI)
     CollectiveCommunication comm_;
 
+    // the reductions over all processes which are fused into a single collective
+    // operation per iteration
+    ReductionBatch reductions_;
+
     // the object which writes the convergence behaviour of the Newton
     // method to disk
     ConvergenceWriter convergenceWriter_;
 
+    // the compact binary trace of the convergence behaviour. this is only
+    // allocated if it is enabled
+    std::unique_ptr<ConvergenceTrace> convergenceTrace_;
+
 private:
     Implementation& asImp_()
     { return *static_cast<Implementation *>(this); }
@@ -31,6 +31,8 @@
 #include <mpi.h>
 #endif
 
+#include <dune/common/parallel/mpihelper.hh>
+
 #include <stddef.h>
 
 #include <type_traits>
@@ -81,8 +83,11 @@ public:
 
     /*!
      * \brief Send the buffer asyncronously to a peer process.
+     *
+     * The rank of the peer refers to the specified communicator.
      */
-    void send(unsigned peerRank)
+    void send(unsigned peerRank,
+              Dune::MPIHelper::MPICommunicator comm = Dune::MPIHelper::getCommunicator())
     {
 #if HAVE_MPI
         MPI_Isend(data_,
@@ -90,7 +95,7 @@ public:
                   mpiDataType_,
                   static_cast<int>(peerRank),
                   0, // tag
-                  MPI_COMM_WORLD,
+                  comm,
                   &mpiRequest_);
 #endif
     }
@@ -107,8 +112,11 @@ public:
 
     /*!
      * \brief Receive the buffer syncronously from a peer rank
+     *
+     * The rank of the peer refers to the specified communicator.
      */
-    void receive(unsigned peerRank)
+    void receive(unsigned peerRank,
+                 Dune::MPIHelper::MPICommunicator comm = Dune::MPIHelper::getCommunicator())
     {
 #if HAVE_MPI
         MPI_Recv(data_,
@@ -116,7 +124,7 @@ public:
                  mpiDataType_,
                  static_cast<int>(peerRank),
                  0, // tag
-                 MPI_COMM_WORLD,
+                 comm,
                  &mpiStatus_);
         assert(!mpiStatus_.MPI_ERROR);
 #endif // HAVE_MPI
@@ -0,0 +1,221 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::ReductionBatch
+ */
+#ifndef EWOMS_REDUCTION_BATCH_HH
+#define EWOMS_REDUCTION_BATCH_HH
+
+#if HAVE_MPI
+#include <mpi.h>
+#endif
+
+#include <dune/common/parallel/mpihelper.hh>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+namespace Ewoms {
+
+/*!
+ * \brief Fuses the reductions of several scalar values over all processes into a single
+ *        collective operation.
+ *
+ * Values are registered using the sum(), min() and max() methods. Their global result
+ * is written back to the registered variables by communicate(), so they must stay alive
+ * until then.
+ *
+ * Since the latency of an all-reduce operation hardly depends on the number of values,
+ * this avoids paying it for each of the many small reductions which are done in every
+ * iteration of the non-linear solver.
+ */
+class ReductionBatch
+{
+public:
+    typedef Dune::MPIHelper::MPICommunicator Communicator;
+
+    explicit ReductionBatch(Communicator comm = Dune::MPIHelper::getCommunicator())
+        : comm_(comm)
+#if HAVE_MPI
+        , type_(MPI_DATATYPE_NULL)
+        , typeSize_(0)
+        , op_(MPI_OP_NULL)
+#endif
+    {}
+
+    ReductionBatch(const ReductionBatch&) = delete;
+    ReductionBatch& operator=(const ReductionBatch&) = delete;
+
+    ~ReductionBatch()
+    {
+#if HAVE_MPI
+        int finalized;
+        MPI_Finalized(&finalized);
+        if (finalized)
+            return;
+
+        if (type_ != MPI_DATATYPE_NULL)
+            MPI_Type_free(&type_);
+        if (op_ != MPI_OP_NULL)
+            MPI_Op_free(&op_);
+#endif
+    }
+
+    /*!
+     * \brief Add a value which ought to be summed up over all processes.
+     */
+    template <class T>
+    void sum(T& value)
+    { add_(value, /*isSum=*/true, /*sign=*/1.0); }
+
+    /*!
+     * \brief Add a value for which the maximum over all processes ought to be determined.
+     */
+    template <class T>
+    void max(T& value)
+    { add_(value, /*isSum=*/false, /*sign=*/1.0); }
+
+    /*!
+     * \brief Add a value for which the minimum over all processes ought to be determined.
+     */
+    template <class T>
+    void min(T& value)
+    { add_(value, /*isSum=*/false, /*sign=*/-1.0); }
+
+    /*!
+     * \brief Returns true if no values have been registered since the last
+     *        communication.
+     */
+    bool empty() const
+    { return entries_.empty(); }
+
+    /*!
+     * \brief Reduce all registered values and write the results back.
+     */
+    void communicate()
+    {
+        if (entries_.empty())
+            return;
+
+        // the first entry tells the reduction operator how many values must be summed
+        // up. it is identical on all processes, so taking the maximum does not change it
+        buffer_.resize(entries_.size() + 1);
+        buffer_[0] = 0.0;
+        for (const auto& entry : entries_)
+            if (entry.isSum)
+                buffer_[0] += 1.0;
+
+        unsigned sumIdx = 1;
+        unsigned maxIdx = 1 + static_cast<unsigned>(buffer_[0]);
+        for (auto& entry : entries_) {
+            entry.bufferIdx = entry.isSum ? sumIdx++ : maxIdx++;
+            buffer_[entry.bufferIdx] = entry.sign*entry.value;
+        }
+
+#if HAVE_MPI
+        int commSize;
+        MPI_Comm_size(comm_, &commSize);
+        if (commSize > 1) {
+            updateMpiTypes_();
+            MPI_Allreduce(MPI_IN_PLACE, buffer_.data(), /*count=*/1, type_, op_, comm_);
+        }
+#endif
+
+        for (const auto& entry : entries_)
+            entry.assign(entry.sign*buffer_[entry.bufferIdx]);
+        entries_.clear();
+    }
+
+private:
+    struct Entry_
+    {
+        std::function<void(double)> assign;
+        double value;
+        double sign;
+        bool isSum;
+        unsigned bufferIdx;
+    };
+
+    template <class T>
+    void add_(T& value, bool isSum, double sign)
+    {
+        Entry_ entry;
+        entry.assign = [&value](double result) { value = static_cast<T>(result); };
+        entry.value = static_cast<double>(value);
+        entry.sign = sign;
+        entry.isSum = isSum;
+        entry.bufferIdx = 0;
+        entries_.push_back(entry);
+    }
+
+    Communicator comm_;
+
+#if HAVE_MPI
+    void updateMpiTypes_()
+    {
+        // the whole buffer is a single element of the MPI data type, so the reduction
+        // operator always sees all values
+        int size = static_cast<int>(buffer_.size());
+        if (size != typeSize_) {
+            if (type_ != MPI_DATATYPE_NULL)
+                MPI_Type_free(&type_);
+            MPI_Type_contiguous(size, MPI_DOUBLE, &type_);
+            MPI_Type_commit(&type_);
+            typeSize_ = size;
+        }
+
+        if (op_ == MPI_OP_NULL)
+            MPI_Op_create(&ReductionBatch::reduce_, /*commute=*/1, &op_);
+    }
+
+    static void reduce_(void* in, void* inOut, int* len, MPI_Datatype* type)
+    {
+        int typeBytes;
+        MPI_Type_size(*type, &typeBytes);
+        int n = typeBytes/static_cast<int>(sizeof(double));
+
+        const double* a = static_cast<const double*>(in);
+        double* b = static_cast<double*>(inOut);
+        for (int elemIdx = 0; elemIdx < *len; ++elemIdx, a += n, b += n) {
+            int numSums = static_cast<int>(a[0]);
+            for (int i = 1; i <= numSums; ++i)
+                b[i] += a[i];
+            for (int i = numSums + 1; i < n; ++i)
+                b[i] = std::max(a[i], b[i]);
+        }
+    }
+
+    MPI_Datatype type_;
+    int typeSize_;
+    MPI_Op op_;
+#endif
+
+    std::vector<Entry_> entries_;
+    std::vector<double> buffer_;
+};
+
+} // namespace Ewoms
+
+#endif
@@ -0,0 +1,866 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \brief Replays linear systems of equations which were written by a simulation through
+ *        the linear solver backends of eWoms.
+ *
+ * The linear systems are produced by running a simulation with the
+ * --linear-system-dump-file-name parameter. Besides the linear system, the simulation
+ * writes the values of its run-time parameters to a file with the extension ".param"
+ * and these are used to set up the solver backends in the same way as during the
+ * simulation. For each combination of linear solver and preconditioner, the time
+ * required to set up the linear system, the time required for the solve (including
+ * the setup of the preconditioner), the number of iterations and the relative
+ * residual of the result are printed. Only the part of the system of a single process
+ * is considered, i.e., the linear systems are always solved sequentially. Combinations
+ * which throw an exception are reported as failed and cause a non-zero exit code.
+ */
+#include "config.h"
+
+#include <ewoms/common/propertysystem.hh>
+#include <ewoms/common/parametersystem.hh>
+#include <ewoms/linear/linearsystemio.hh>
+#include <ewoms/linear/overlaptypes.hh>
+#include <ewoms/linear/blacklist.hh>
+#include <ewoms/linear/istlpreconditionerwrappers.hh>
+#include <ewoms/linear/istlsolverwrappers.hh>
+#include <ewoms/linear/parallelistlbackend.hh>
+#include <ewoms/linear/parallelbicgstabbackend.hh>
+#include <ewoms/linear/parallelamgbackend.hh>
+#include <ewoms/linear/parallelcprbackend.hh>
+#include <ewoms/linear/blocklubackend.hh>
+
+#include <dune/common/exceptions.hh>
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/common/parametertree.hh>
+#include <dune/common/parametertreeparser.hh>
+#include <dune/common/timer.hh>
+#include <dune/common/parallel/collectivecommunication.hh>
+#include <dune/common/parallel/mpihelper.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/preconditioner.hh>
+#include <dune/istl/solver.hh>
+
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Ewoms {
+class ReplayGridView;
+
+template <class TypeTag>
+class ReplaySimulator;
+
+template <class TypeTag>
+class ReplayElementContext;
+
+class ReplayBorderListCreator;
+
+template <class TypeTag>
+class ReplayPreconditionerWrapper;
+
+template <class TypeTag>
+class ReplaySolverWrapper;
+
+namespace Properties {
+NEW_PROP_TAG(Scalar);
+NEW_PROP_TAG(NumEq);
+NEW_PROP_TAG(Simulator);
+NEW_PROP_TAG(GridView);
+NEW_PROP_TAG(ElementContext);
+NEW_PROP_TAG(BorderListCreator);
+NEW_PROP_TAG(JacobianMatrix);
+NEW_PROP_TAG(GlobalEqVector);
+NEW_PROP_TAG(LinearSolverSplice);
+NEW_PROP_TAG(NewtonRawTolerance);
+
+//! The preconditioner used by the replayed linear solver
+NEW_PROP_TAG(ReplayPreconditioner);
+
+//! The linear solver of dune-istl used by the ParallelIstlSolverBackend
+NEW_PROP_TAG(ReplayIstlSolver);
+
+NEW_TYPE_TAG(ReplayLinearSystem, INHERITS_FROM(ParameterSystem));
+
+SET_SPLICES(ReplayLinearSystem, LinearSolverSplice);
+SET_TAG_PROP(ReplayLinearSystem, LinearSolverSplice, ParallelBiCGStabLinearSolver);
+
+SET_TYPE_PROP(ReplayLinearSystem, Scalar, double);
+
+SET_PROP(ReplayLinearSystem, JacobianMatrix)
+{
+    static constexpr int numEq = GET_PROP_VALUE(TypeTag, NumEq);
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef Dune::FieldMatrix<Scalar, numEq, numEq> MatrixBlock;
+    typedef Dune::BCRSMatrix<MatrixBlock> type;
+};
+
+SET_PROP(ReplayLinearSystem, GlobalEqVector)
+{
+    static constexpr int numEq = GET_PROP_VALUE(TypeTag, NumEq);
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef Dune::FieldVector<Scalar, numEq> VectorBlock;
+    typedef Dune::BlockVector<VectorBlock> type;
+};
+
+SET_TYPE_PROP(ReplayLinearSystem, Simulator, Ewoms::ReplaySimulator<TypeTag>);
+SET_TYPE_PROP(ReplayLinearSystem, GridView, Ewoms::ReplayGridView);
+SET_TYPE_PROP(ReplayLinearSystem, ElementContext, Ewoms::ReplayElementContext<TypeTag>);
+SET_TYPE_PROP(ReplayLinearSystem, BorderListCreator, Ewoms::ReplayBorderListCreator);
+
+SET_TYPE_PROP(ReplayLinearSystem,
+              PreconditionerWrapper,
+              Ewoms::ReplayPreconditionerWrapper<TypeTag>);
+SET_TYPE_PROP(ReplayLinearSystem,
+              LinearSolverWrapper,
+              Ewoms::ReplaySolverWrapper<TypeTag>);
+
+SET_STRING_PROP(ReplayLinearSystem, ReplayPreconditioner, "ilu0");
+SET_STRING_PROP(ReplayLinearSystem, ReplayIstlSolver, "bicgstab");
+
+//! the raw tolerance of the Newton method determines the absolute tolerance of the
+//! linear solvers. this is the default of the Newton method.
+SET_SCALAR_PROP(ReplayLinearSystem, NewtonRawTolerance, 1e-8);
+
+// the type tags which are actually used to replay a linear system: one for each
+// combination of block size and solver backend
+#define EWOMS_REPLAY_TYPE_TAG_(TAG_NAME, NUM_EQ, SPLICE)                    \
+    NEW_TYPE_TAG(TAG_NAME, INHERITS_FROM(ReplayLinearSystem));              \
+    SET_INT_PROP(TAG_NAME, NumEq, NUM_EQ);                                  \
+    SET_TAG_PROP(TAG_NAME, LinearSolverSplice, SPLICE)
+
+#define EWOMS_REPLAY_TYPE_TAGS_(NUM_EQ)                                                 \
+    EWOMS_REPLAY_TYPE_TAG_(ReplayIstl##NUM_EQ, NUM_EQ, ParallelIstlLinearSolver);       \
+    EWOMS_REPLAY_TYPE_TAG_(ReplayBiCGStab##NUM_EQ, NUM_EQ, ParallelBiCGStabLinearSolver); \
+    EWOMS_REPLAY_TYPE_TAG_(ReplayAmg##NUM_EQ, NUM_EQ, ParallelAmgLinearSolver);         \
+    EWOMS_REPLAY_TYPE_TAG_(ReplayCpr##NUM_EQ, NUM_EQ, ParallelCprLinearSolver);         \
+    EWOMS_REPLAY_TYPE_TAG_(ReplayBlockLU##NUM_EQ, NUM_EQ, BlockLULinearSolver)
+
+EWOMS_REPLAY_TYPE_TAGS_(1);
+EWOMS_REPLAY_TYPE_TAGS_(2);
+EWOMS_REPLAY_TYPE_TAGS_(3);
+EWOMS_REPLAY_TYPE_TAGS_(4);
+EWOMS_REPLAY_TYPE_TAGS_(5);
+EWOMS_REPLAY_TYPE_TAGS_(6);
+} // namespace Properties
+
+/*!
+ * \brief Maps the block size of a linear system to the type tags of the solver
+ *        backends.
+ */
+template <int numEq>
+struct ReplayTypeTags;
+
+#define EWOMS_REPLAY_TYPE_TAGS_TRAITS_(NUM_EQ)                          \
+    template <>                                                         \
+    struct ReplayTypeTags<NUM_EQ>                                       \
+    {                                                                   \
+        typedef TTAG(ReplayIstl##NUM_EQ) Istl;                          \
+        typedef TTAG(ReplayBiCGStab##NUM_EQ) BiCGStab;                  \
+        typedef TTAG(ReplayAmg##NUM_EQ) Amg;                            \
+        typedef TTAG(ReplayCpr##NUM_EQ) Cpr;                            \
+        typedef TTAG(ReplayBlockLU##NUM_EQ) BlockLU;                    \
+    };
+
+EWOMS_REPLAY_TYPE_TAGS_TRAITS_(1)
+EWOMS_REPLAY_TYPE_TAGS_TRAITS_(2)
+EWOMS_REPLAY_TYPE_TAGS_TRAITS_(3)
+EWOMS_REPLAY_TYPE_TAGS_TRAITS_(4)
+EWOMS_REPLAY_TYPE_TAGS_TRAITS_(5)
+EWOMS_REPLAY_TYPE_TAGS_TRAITS_(6)
+
+#undef EWOMS_REPLAY_TYPE_TAGS_TRAITS_
+#undef EWOMS_REPLAY_TYPE_TAGS_
+#undef EWOMS_REPLAY_TYPE_TAG_
+
+/*!
+ * \brief The grid view seen by the solver backends.
+ *
+ * It does not contain any elements and its communicator only contains the current
+ * process, i.e., the linear system is not distributed.
+ */
+class ReplayGridView
+{
+public:
+    typedef Dune::CollectiveCommunication<Dune::MPIHelper::MPICommunicator> CollectiveCommunication;
+
+    enum { dimensionworld = 3 };
+
+    ReplayGridView()
+        : comm_(Dune::MPIHelper::getLocalCommunicator())
+    {}
+
+    const CollectiveCommunication& comm() const
+    { return comm_; }
+
+    template <int codim>
+    const int* begin() const
+    { return nullptr; }
+
+    template <int codim>
+    const int* end() const
+    { return nullptr; }
+
+private:
+    CollectiveCommunication comm_;
+};
+
+/*!
+ * \brief The element context seen by the solver backends.
+ *
+ * Since the grid view does not contain any elements, this is never used.
+ */
+template <class TypeTag>
+class ReplayElementContext
+{
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
+    typedef typename GET_PROP_TYPE(TypeTag, GridView) GridView;
+
+    enum { dimWorld = GridView::dimensionworld };
+
+public:
+    explicit ReplayElementContext(const Simulator&)
+    {}
+
+    template <class Element>
+    void updateStencil(const Element&)
+    {}
+
+    unsigned numPrimaryDof(unsigned) const
+    { return 0; }
+
+    unsigned globalSpaceIndex(unsigned, unsigned) const
+    { return 0; }
+
+    Dune::FieldVector<Scalar, dimWorld> pos(unsigned, unsigned) const
+    { return Dune::FieldVector<Scalar, dimWorld>(0.0); }
+};
+
+/*!
+ * \brief Creates the border list of a linear system which is not distributed, i.e.,
+ *        an empty one.
+ */
+class ReplayBorderListCreator
+{
+public:
+    template <class GridView, class DofMapper>
+    ReplayBorderListCreator(const GridView&, const DofMapper&)
+    {}
+
+    const Ewoms::Linear::BorderList& borderList() const
+    { return borderList_; }
+
+    const Ewoms::Linear::BlackList& blackList() const
+    { return blackList_; }
+
+private:
+    Ewoms::Linear::BorderList borderList_;
+    Ewoms::Linear::BlackList blackList_;
+};
+
+/*!
+ * \brief Provides the parts of the simulator, its grid manager, its model and its
+ *        Newton method which are used by the solver backends.
+ *
+ * The weights of the equations are not stored with the linear system, so all
+ * equations are weighted equally. Since no positions of the degrees of freedom are
+ * known, the "morton" ordering keeps the native one.
+ */
+template <class TypeTag>
+class ReplaySimulator
+{
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, GridView) GridView;
+
+    struct DofMapper
+    {};
+
+public:
+
+    // the simulator
+    const ReplaySimulator& gridManager() const
+    { return *this; }
+
+    const ReplaySimulator& model() const
+    { return *this; }
+
+    const GridView& gridView() const
+    { return gridView_; }
+
+    // the grid manager
+    int gridSequenceNumber() const
+    { return 0; }
+
+    // the model
+    Scalar eqWeight(unsigned, unsigned) const
+    { return 1.0; }
+
+    const DofMapper& dofMapper() const
+    { return dofMapper_; }
+
+    size_t numGridDof() const
+    { return 0; }
+
+    const ReplaySimulator& newtonMethod() const
+    { return *this; }
+
+    // the Newton method
+    Scalar tolerance() const
+    { return EWOMS_GET_PARAM(TypeTag, Scalar, NewtonRawTolerance); }
+
+private:
+    GridView gridView_;
+    DofMapper dofMapper_;
+};
+
+/*!
+ * \brief Selects the preconditioner wrapper at run time using the
+ *        ReplayPreconditioner parameter.
+ */
+template <class TypeTag>
+class ReplayPreconditionerWrapper
+{
+    typedef typename GET_PROP_TYPE(TypeTag, OverlappingMatrix) OverlappingMatrix;
+    typedef typename GET_PROP_TYPE(TypeTag, OverlappingVector) OverlappingVector;
+
+public:
+    typedef Dune::Preconditioner<OverlappingVector, OverlappingVector> SequentialPreconditioner;
+
+    ReplayPreconditionerWrapper()
+        : seqPreCond_(nullptr)
+    {}
+
+    static void registerParameters()
+    {
+        EWOMS_REGISTER_PARAM(TypeTag, std::string, ReplayPreconditioner,
+                             "The preconditioner of the linear solver. Possible values: "
+                             "'jacobi', 'gauss-seidel', 'sor', 'ssor', 'ilu0', 'ilun' and "
+                             "'threaded-ilu0'");
+
+        // registers the order and the relaxation factor of the preconditioners
+        Ewoms::Linear::PreconditionerWrapperJacobi<TypeTag>::registerParameters();
+    }
+
+    void prepare(OverlappingMatrix& matrix)
+    {
+        const std::string& name = EWOMS_GET_PARAM(TypeTag, std::string, ReplayPreconditioner);
+        if (name == "jacobi")
+            prepare_<Ewoms::Linear::PreconditionerWrapperJacobi<TypeTag> >(matrix);
+        else if (name == "gauss-seidel")
+            prepare_<Ewoms::Linear::PreconditionerWrapperGaussSeidel<TypeTag> >(matrix);
+        else if (name == "sor")
+            prepare_<Ewoms::Linear::PreconditionerWrapperSOR<TypeTag> >(matrix);
+        else if (name == "ssor")
+            prepare_<Ewoms::Linear::PreconditionerWrapperSSOR<TypeTag> >(matrix);
+        else if (name == "ilu0")
+            prepare_<Ewoms::Linear::PreconditionerWrapperILU0<TypeTag> >(matrix);
+        else if (name == "ilun")
+            prepare_<Ewoms::Linear::PreconditionerWrapperILUn<TypeTag> >(matrix);
+        else if (name == "threaded-ilu0")
+            prepare_<Ewoms::Linear::PreconditionerWrapperThreadedILU0<TypeTag> >(matrix);
+        else
+            OPM_THROW(std::invalid_argument, "Unknown preconditioner '" << name << "'");
+    }
+
+    SequentialPreconditioner& get()
+    { return *seqPreCond_; }
+
+    void cleanup()
+    {
+        if (cleanup_)
+            cleanup_();
+        cleanup_ = nullptr;
+        seqPreCond_ = nullptr;
+    }
+
+private:
+    template <class Wrapper>
+    void prepare_(OverlappingMatrix& matrix)
+    {
+        std::shared_ptr<Wrapper> wrapper = std::make_shared<Wrapper>();
+        wrapper->prepare(matrix);
+        seqPreCond_ = &wrapper->get();
+
+        // the wrapper is kept alive until the preconditioner is cleaned up
+        cleanup_ = [wrapper]() { wrapper->cleanup(); };
+    }
+
+    SequentialPreconditioner* seqPreCond_;
+    std::function<void()> cleanup_;
+};
+
+/*!
+ * \brief Selects the linear solver of dune-istl at run time using the
+ *        ReplayIstlSolver parameter.
+ */
+template <class TypeTag>
+class ReplaySolverWrapper
+{
+    typedef typename GET_PROP_TYPE(TypeTag, OverlappingVector) OverlappingVector;
+
+public:
+    typedef Dune::InverseOperator<OverlappingVector, OverlappingVector> RawSolver;
+
+    static void registerParameters()
+    {
+        EWOMS_REGISTER_PARAM(TypeTag, std::string, ReplayIstlSolver,
+                             "The linear solver of dune-istl. Possible values: "
+                             "'richardson', 'steepest-descent', 'cg', 'bicgstab', "
+                             "'minres' and 'restarted-gmres'");
+
+        Ewoms::Linear::SolverWrapperRestartedGMRes<TypeTag>::registerParameters();
+    }
+
+    template <class LinearOperator, class ScalarProduct, class Preconditioner>
+    std::shared_ptr<RawSolver> get(LinearOperator& parOperator,
+                                   ScalarProduct& parScalarProduct,
+                                   Preconditioner& parPreCond)
+    {
+        const std::string& name = EWOMS_GET_PARAM(TypeTag, std::string, ReplayIstlSolver);
+        if (name == "richardson")
+            return get_<Ewoms::Linear::SolverWrapperRichardson<TypeTag> >(parOperator, parScalarProduct, parPreCond);
+        else if (name == "steepest-descent")
+            return get_<Ewoms::Linear::SolverWrapperSteepestDescent<TypeTag> >(parOperator, parScalarProduct, parPreCond);
+        else if (name == "cg")
+            return get_<Ewoms::Linear::SolverWrapperConjugatedGradients<TypeTag> >(parOperator, parScalarProduct, parPreCond);
+        else if (name == "bicgstab")
+            return get_<Ewoms::Linear::SolverWrapperBiCGStab<TypeTag> >(parOperator, parScalarProduct, parPreCond);
+        else if (name == "minres")
+            return get_<Ewoms::Linear::SolverWrapperMinRes<TypeTag> >(parOperator, parScalarProduct, parPreCond);
+        else if (name == "restarted-gmres")
+            return get_<Ewoms::Linear::SolverWrapperRestartedGMRes<TypeTag> >(parOperator, parScalarProduct, parPreCond);
+
+        OPM_THROW(std::invalid_argument, "Unknown linear solver '" << name << "'");
+    }
+
+    void cleanup()
+    { wrapper_.reset(); }
+
+private:
+    template <class Wrapper, class LinearOperator, class ScalarProduct, class Preconditioner>
+    std::shared_ptr<RawSolver> get_(LinearOperator& parOperator,
+                                    ScalarProduct& parScalarProduct,
+                                    Preconditioner& parPreCond)
+    {
+        std::shared_ptr<Wrapper> wrapper = std::make_shared<Wrapper>();
+        wrapper_ = wrapper;
+        return wrapper->get(parOperator, parScalarProduct, parPreCond);
+    }
+
+    std::shared_ptr<void> wrapper_;
+};
+
+/*!
+ * \brief A linear solver which can be replayed.
+ *
+ * Each of them corresponds to a solver backend and to the values of the parameters
+ * which select the Krylov method of the backend.
+ */
+struct ReplaySolver
+{
+    std::string name;
+    std::string backend;
+    std::vector<std::pair<std::string, std::string> > params;
+    bool usesPreconditioner;
+};
+
+const std::vector<ReplaySolver>& replaySolvers()
+{
+    static const std::vector<ReplaySolver> solvers = {
+        { "bicgstab", "bicgstab", { { "LinearSolverKrylovMethod", "bicgstab" } }, true },
+        { "pipelined-bicgstab", "bicgstab", { { "LinearSolverKrylovMethod", "pipelined-bicgstab" } }, true },
+        { "fgmres", "bicgstab", { { "LinearSolverKrylovMethod", "fgmres" } }, true },
+        { "gcrot", "bicgstab", { { "LinearSolverKrylovMethod", "gcrot" } }, true },
+        { "istl-bicgstab", "istl", { { "ReplayIstlSolver", "bicgstab" } }, true },
+        { "istl-gmres", "istl", { { "ReplayIstlSolver", "restarted-gmres" } }, true },
+        { "amg-bicgstab", "amg", { { "LinearSolverKrylovMethod", "bicgstab" } }, false },
+        { "amg-gcrot", "amg", { { "LinearSolverKrylovMethod", "gcrot" } }, false },
+        { "cpr", "cpr", { { "CprSequentialImplicit", "false" } }, true },
+        { "cpr-sequential-implicit", "cpr", { { "CprSequentialImplicit", "true" } }, false },
+        { "block-lu", "block-lu", {}, false }
+    };
+
+    return solvers;
+}
+
+struct ReplayOptions
+{
+    std::vector<std::string> solvers;
+    std::vector<std::string> preconditioners;
+    std::vector<std::string> fileNames;
+
+    // the run-time parameters which were specified on the command line
+    Dune::ParameterTree parameters;
+};
+
+struct ReplayResult
+{
+    bool converged;
+    unsigned iterations;
+    double prepareTime;
+    double solveTime;
+};
+
+template <int blockSize>
+class LinearSystemReplayer
+{
+    typedef Dune::FieldMatrix<double, blockSize, blockSize> MatrixBlock;
+    typedef Dune::FieldVector<double, blockSize> VectorBlock;
+    typedef Dune::BCRSMatrix<MatrixBlock> Matrix;
+    typedef Dune::BlockVector<VectorBlock> Vector;
+
+    typedef ReplayTypeTags<blockSize> TypeTags;
+
+public:
+    LinearSystemReplayer(const ReplayOptions& options)
+        : options_(options)
+    {}
+
+    /*!
+     * \brief Replay a linear system through all combinations of solvers and
+     *        preconditioners.
+     *
+     * \return The number of combinations which failed with an exception.
+     */
+    unsigned replay(const std::string& fileName)
+    {
+        Matrix A;
+        Vector b;
+        Ewoms::Linear::LinearSystemLayout layout;
+        Ewoms::Linear::readLinearSystem(fileName, A, b, layout);
+
+        // the parameters of the simulation which wrote the linear system
+        std::string paramFileName = fileName;
+        const std::string extension = ".ewls";
+        if (paramFileName.size() > extension.size()
+            && paramFileName.compare(paramFileName.size() - extension.size(),
+                                     extension.size(), extension) == 0)
+            paramFileName.erase(paramFileName.size() - extension.size());
+        paramFileName += ".param";
+        if (!std::ifstream(paramFileName).good())
+            paramFileName = "";
+
+        std::cout << "Linear system '" << fileName << "': " << A.N() << " rows, "
+                  << A.nonzeroes() << " non-zero blocks of size " << blockSize
+                  << ", written by rank " << layout.rank << " of " << layout.commSize
+                  << "\n";
+        if (paramFileName.empty())
+            std::cout << "No parameters of the simulation found, using the defaults\n";
+        else
+            std::cout << "Using the parameters of the simulation from '"
+                      << paramFileName << "'\n";
+        std::cout << std::setw(28) << std::left << "solver"
+                  << std::setw(16) << "preconditioner"
+                  << std::setw(11) << "converged"
+                  << std::setw(11) << "iterations"
+                  << std::setw(13) << "prepare [s]"
+                  << std::setw(13) << "solve [s]"
+                  << "rel. residual\n";
+
+        unsigned numFailed = 0;
+        for (const auto& solverName : options_.solvers) {
+            const ReplaySolver* solver = findSolver_(solverName);
+            if (!solver || !solver->usesPreconditioner) {
+                if (!tryCombination_(solverName, solver, "-", paramFileName, A, b))
+                    ++numFailed;
+                continue;
+            }
+
+            for (const auto& precName : options_.preconditioners)
+                if (!tryCombination_(solverName, solver, precName, paramFileName, A, b))
+                    ++numFailed;
+        }
+        std::cout << "\n" << std::flush;
+
+        return numFailed;
+    }
+
+private:
+    static const ReplaySolver* findSolver_(const std::string& solverName)
+    {
+        for (const auto& solver : replaySolvers())
+            if (solver.name == solverName)
+                return &solver;
+        return nullptr;
+    }
+
+    // run a single combination of solver and preconditioner. an exception (e.g., a
+    // singular matrix block) only causes the combination to be reported as failed.
+    bool tryCombination_(const std::string& solverName,
+                         const ReplaySolver* solver,
+                         const std::string& precName,
+                         const std::string& paramFileName,
+                         const Matrix& A,
+                         const Vector& b)
+    {
+        std::string errorMessage;
+        try {
+            if (!solver)
+                OPM_THROW(std::invalid_argument, "Unknown linear solver '" << solverName << "'");
+
+            Vector x(b.size());
+            x = 0.0;
+            ReplayResult result;
+            if (solver->backend == "istl")
+                result = run_<typename TypeTags::Istl>(*solver, precName, paramFileName, A, b, x);
+            else if (solver->backend == "bicgstab")
+                result = run_<typename TypeTags::BiCGStab>(*solver, precName, paramFileName, A, b, x);
+            else if (solver->backend == "amg")
+                result = run_<typename TypeTags::Amg>(*solver, precName, paramFileName, A, b, x);
+            else if (solver->backend == "cpr")
+                result = runCpr_(std::integral_constant<bool, (blockSize > 1)>(),
+                                 *solver, precName, paramFileName, A, b, x);
+            else
+                result = run_<typename TypeTags::BlockLU>(*solver, precName, paramFileName, A, b, x);
+
+            printResult_(solverName, precName, result, A, b, x);
+            return true;
+        }
+        catch (const std::exception& e) {
+            errorMessage = e.what();
+        }
+        catch (const Dune::Exception& e) {
+            errorMessage = e.what();
+        }
+
+        std::cout << std::setw(28) << std::left << solverName
+                  << std::setw(16) << precName
+                  << "failed: " << errorMessage << "\n" << std::flush;
+        return false;
+    }
+
+    // the CPR preconditioner decouples the pressure from the remaining equations, so
+    // it is only available for systems of equations
+    template <class ...Args>
+    ReplayResult runCpr_(std::true_type, Args&&... args)
+    { return run_<typename TypeTags::Cpr>(std::forward<Args>(args)...); }
+
+    template <class ...Args>
+    ReplayResult runCpr_(std::false_type, Args&&...)
+    {
+        OPM_THROW(std::invalid_argument,
+                  "The CPR preconditioner requires at least two equations per block");
+    }
+
+    // solve the linear system using the solver backend of a type tag in the same way
+    // as the Newton method does it
+    template <class TypeTag>
+    ReplayResult run_(const ReplaySolver& solver,
+                      const std::string& precName,
+                      const std::string& paramFileName,
+                      const Matrix& A,
+                      const Vector& b,
+                      Vector& x)
+    {
+        typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
+        typedef typename GET_PROP_TYPE(TypeTag, LinearSolverBackend) LinearSolverBackend;
+
+        setupParameters_<TypeTag, LinearSolverBackend>(solver, precName, paramFileName);
+
+        Simulator simulator;
+        LinearSolverBackend linearSolver(simulator);
+
+        ReplayResult result;
+        Dune::Timer timer;
+        Vector bTmp(b);
+        linearSolver.prepareRhs(A, bTmp);
+        linearSolver.prepareMatrix(A);
+        result.prepareTime = timer.elapsed();
+
+        timer.reset();
+        result.converged = linearSolver.solve(x);
+        result.solveTime = timer.elapsed();
+        result.iterations = linearSolver.iterations();
+
+        return result;
+    }
+
+    // set the run-time parameters of a type tag. the solver and the preconditioner
+    // take precedence over the parameters specified on the command line which take
+    // precedence over the ones of the simulation.
+    template <class TypeTag, class LinearSolverBackend>
+    void setupParameters_(const ReplaySolver& solver,
+                          const std::string& precName,
+                          const std::string& paramFileName)
+    {
+        typedef typename GET_PROP(TypeTag, ParameterMetaData) ParamsMeta;
+        typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+
+        if (ParamsMeta::registrationOpen()) {
+            LinearSolverBackend::registerParameters();
+            EWOMS_REGISTER_PARAM(TypeTag, Scalar, NewtonRawTolerance,
+                                 "The maximum raw error tolerated by the Newton"
+                                 "method for considering a solution to be "
+                                 "converged");
+            EWOMS_END_PARAM_REGISTRATION(TypeTag);
+        }
+
+        Dune::ParameterTree& tree = ParamsMeta::tree();
+        tree = options_.parameters;
+        for (const auto& param : solver.params)
+            tree[param.first] = param.second;
+        if (solver.usesPreconditioner)
+            tree["ReplayPreconditioner"] = precName;
+        if (!paramFileName.empty())
+            Dune::ParameterTreeParser::readINITree(paramFileName, tree, /*overwrite=*/false);
+    }
+
+    void printResult_(const std::string& solverName,
+                      const std::string& precName,
+                      const ReplayResult& result,
+                      const Matrix& A,
+                      const Vector& b,
+                      const Vector& x) const
+    {
+        // compute the relative residual of the result
+        Vector r(b);
+        A.mmv(x, r);
+        double bNorm = b.two_norm();
+        double relResidual = (bNorm > 0.0) ? r.two_norm()/bNorm : r.two_norm();
+
+        std::cout << std::setw(28) << std::left << solverName
+                  << std::setw(16) << precName
+                  << std::setw(11) << (result.converged ? "yes" : "no")
+                  << std::setw(11) << result.iterations
+                  << std::setw(13) << result.prepareTime
+                  << std::setw(13) << result.solveTime
+                  << relResidual << "\n" << std::flush;
+    }
+
+    const ReplayOptions& options_;
+};
+
+unsigned replayFile(const std::string& fileName, const ReplayOptions& options)
+{
+    unsigned blockSize = Ewoms::Linear::readLinearSystemBlockSize(fileName);
+    switch (blockSize) {
+    case 1: return LinearSystemReplayer<1>(options).replay(fileName);
+    case 2: return LinearSystemReplayer<2>(options).replay(fileName);
+    case 3: return LinearSystemReplayer<3>(options).replay(fileName);
+    case 4: return LinearSystemReplayer<4>(options).replay(fileName);
+    case 5: return LinearSystemReplayer<5>(options).replay(fileName);
+    case 6: return LinearSystemReplayer<6>(options).replay(fileName);
+    default:
+        OPM_THROW(std::invalid_argument,
+                  "Linear systems with a block size of " << blockSize << " are not supported");
+    }
+}
+
+std::vector<std::string> splitList(const std::string& list)
+{
+    std::vector<std::string> result;
+    std::istringstream iss(list);
+    std::string item;
+    while (std::getline(iss, item, ','))
+        if (!item.empty())
+            result.push_back(item);
+    return result;
+}
+} // namespace Ewoms
+
+int main(int argc, char** argv)
+{
+    Dune::MPIHelper::instance(argc, argv);
+
+    Ewoms::ReplayOptions options;
+    for (const auto& solver : Ewoms::replaySolvers())
+        options.solvers.push_back(solver.name);
+    options.preconditioners = { "jacobi", "gauss-seidel", "sor", "ssor", "ilu0", "ilun",
+                                "threaded-ilu0" };
+
+    // all other options are run-time parameters of the solver backends
+    std::vector<const char*> paramArgs = { argv[0] };
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        auto hasPrefix = [&arg](const std::string& prefix)
+        { return arg.compare(0, prefix.size(), prefix) == 0; };
+        auto value = [&arg]()
+        { return arg.substr(arg.find('=') + 1); };
+
+        if (hasPrefix("--solvers="))
+            options.solvers = Ewoms::splitList(value());
+        else if (hasPrefix("--preconditioners="))
+            options.preconditioners = Ewoms::splitList(value());
+        else if (hasPrefix("-"))
+            paramArgs.push_back(argv[i]);
+        else
+            options.fileNames.push_back(arg);
+    }
+
+    typedef TTAG(ReplayLinearSystem) TypeTag;
+    std::string errorMsg =
+        Ewoms::Parameters::parseCommandLineOptions<TypeTag>(static_cast<int>(paramArgs.size()),
+                                                            paramArgs.data(),
+                                                            /*handleHelp=*/false);
+    if (!errorMsg.empty()) {
+        std::cerr << errorMsg << "\n";
+        return 1;
+    }
+    options.parameters = GET_PROP(TypeTag, ParameterMetaData)::tree();
+
+    if (options.fileNames.empty()) {
+        std::cout << "Replays linear systems written by a simulation using the "
+                  << "--linear-system-dump-file-name parameter\n"
+                  << "\n"
+                  << "Usage: " << argv[0] << " [OPTIONS] LINEAR_SYSTEM_FILE...\n"
+                  << "\n"
+                  << "Options:\n"
+                  << "  --solvers=LIST           Comma separated list of the linear solvers to use\n"
+                  << "  --preconditioners=LIST   Comma separated list of the preconditioners to use\n"
+                  << "  --PARAM=VALUE            Run-time parameter of the solver backends, e.g.,\n"
+                  << "                           --linear-solver-tolerance=1e-5. These take\n"
+                  << "                           precedence over the parameters of the simulation\n"
+                  << "\n"
+                  << "Linear solvers:\n";
+        for (const auto& solver : Ewoms::replaySolvers())
+            std::cout << "  " << solver.name << "\n";
+        std::cout << "\n"
+                  << "Preconditioners (not used by the AMG, block-lu and "
+                  << "cpr-sequential-implicit solvers):\n"
+                  << "  jacobi, gauss-seidel, sor, ssor, ilu0, ilun, threaded-ilu0\n";
+        return 1;
+    }
+
+    unsigned numFailed = 0;
+    for (const auto& fileName : options.fileNames)
+        numFailed += Ewoms::replayFile(fileName, options);
+
+    if (numFailed > 0) {
+        std::cout << numFailed << " combinations of solvers and preconditioners failed\n";
+        return 1;
+    }
+
+    return 0;
+}
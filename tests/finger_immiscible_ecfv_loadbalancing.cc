@@ -0,0 +1,169 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \brief Problem featuring a saturation overshoot which is split into episodes of fixed
+ *        length so that the grid can be redistributed at the end of each of them.
+ *
+ * The source term of the elements in the left part of the domain is made artificially
+ * expensive. The work measured for the processes which own these elements is thus
+ * larger than for the others even though all processes own the same number of
+ * elements, so the grid must be redistributed using the measured work. The test fails
+ * if this never changes the number of elements owned by any process.
+ */
+#include "config.h"
+
+#include <ewoms/common/start.hh>
+#include <ewoms/models/immiscible/immisciblemodel.hh>
+#include <ewoms/disc/ecfv/ecfvdiscretization.hh>
+#include "problems/fingerproblem.hh"
+
+#include <dune/grid/common/gridenums.hh>
+
+#include <cmath>
+#include <stdexcept>
+
+namespace Ewoms {
+template <class TypeTag>
+class FingerEpisodesProblem;
+
+namespace Properties {
+NEW_TYPE_TAG(FingerProblemEcfvEpisodes, INHERITS_FROM(ImmiscibleTwoPhaseModel, FingerBaseProblem));
+SET_TAG_PROP(FingerProblemEcfvEpisodes, SpatialDiscretizationSplice, EcfvDiscretization);
+SET_TYPE_PROP(FingerProblemEcfvEpisodes, Problem, Ewoms::FingerEpisodesProblem<TypeTag>);
+} // namespace Properties
+
+/*!
+ * \brief The finger problem with episodes of 5000 seconds and a source term which is
+ *        expensive to evaluate in the left part of the domain.
+ */
+template <class TypeTag>
+class FingerEpisodesProblem : public FingerProblem<TypeTag>
+{
+    typedef FingerProblem<TypeTag> ParentType;
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, RateVector) RateVector;
+
+    static constexpr double episodeLength = 5e3;
+
+public:
+    FingerEpisodesProblem(typename GET_PROP_TYPE(TypeTag, Simulator)& simulator)
+        : ParentType(simulator)
+        , numInteriorElements_(-1)
+        , ownershipChanged_(false)
+    {}
+
+    /*!
+     * \copydoc FvBaseProblem::finishInit()
+     */
+    void finishInit()
+    {
+        ParentType::finishInit();
+
+        // this is also called after the grid was redistributed. in this case, the
+        // current episode is kept.
+        if (this->simulator().episodeIndex() == 0)
+            this->simulator().startNextEpisode(episodeLength);
+
+        if (numInteriorElements_ < 0)
+            numInteriorElements_ = countInteriorElements_();
+    }
+
+    /*!
+     * \copydoc FvBaseProblem::gridChanged()
+     */
+    void gridChanged()
+    {
+        ParentType::gridChanged();
+
+        int n = countInteriorElements_();
+        if (n != numInteriorElements_)
+            ownershipChanged_ = true;
+        numInteriorElements_ = n;
+    }
+
+    /*!
+     * \copydoc FvBaseProblem::endEpisode
+     */
+    void endEpisode()
+    { this->simulator().startNextEpisode(episodeLength); }
+
+    /*!
+     * \copydoc FvBaseProblem::finalize()
+     */
+    void finalize()
+    {
+        ParentType::finalize();
+
+        int changed = ownershipChanged_?1:0;
+        changed = this->gridView().comm().max(changed);
+        if (!changed)
+            throw std::runtime_error("The grid was not redistributed although the work of "
+                                     "the processes is unbalanced");
+    }
+
+    /*!
+     * \copydoc FvBaseMultiPhaseProblem::source
+     */
+    template <class Context>
+    void source(RateVector& rate, const Context& context,
+                unsigned spaceIdx, unsigned timeIdx) const
+    {
+        rate = Scalar(0.0);
+
+        const auto& pos = context.pos(spaceIdx, timeIdx);
+        Scalar width = this->boundingBoxMax()[0] - this->boundingBoxMin()[0];
+        if (pos[0] > this->boundingBoxMin()[0] + width/3)
+            return;
+
+        // waste some time. the result is used to keep the compiler from optimizing the
+        // loop away, but it is always zero.
+        Scalar dummy = 0.0;
+        for (int i = 0; i < 20000; ++i)
+            dummy += std::sqrt(static_cast<Scalar>(i));
+        rate *= (dummy < 0.0)?2.0:1.0;
+    }
+
+private:
+    int countInteriorElements_() const
+    {
+        int n = 0;
+        auto elemIt = this->gridView().template begin</*codim=*/0>();
+        const auto& elemEndIt = this->gridView().template end</*codim=*/0>();
+        for (; elemIt != elemEndIt; ++elemIt)
+            if (elemIt->partitionType() == Dune::InteriorEntity)
+                ++n;
+        return n;
+    }
+
+    int numInteriorElements_;
+    bool ownershipChanged_;
+};
+} // namespace Ewoms
+
+int main(int argc, char **argv)
+{
+    typedef TTAG(FingerProblemEcfvEpisodes) ProblemTypeTag;
+    return Ewoms::start<ProblemTypeTag>(argc, argv);
+}
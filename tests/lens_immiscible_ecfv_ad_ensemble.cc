@@ -0,0 +1,81 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \brief Runs two independent simulations of the lens problem within a single MPI job.
+ *
+ * The processes are split into two groups, each of which simulates one member of an
+ * ensemble on its own communicator. The program fails if the simulation of any member
+ * fails. If the simulations accidentally communicate via the world communicator, they
+ * usually dead-lock.
+ */
+#include "config.h"
+
+#include "lens_immiscible_ecfv_ad.hh"
+
+#include <ewoms/common/start.hh>
+
+#include <dune/common/parallel/mpihelper.hh>
+
+#if HAVE_DUNE_FEM
+#include <dune/fem/misc/mpimanager.hh>
+#endif
+
+#include <algorithm>
+
+#if HAVE_MPI
+#include <mpi.h>
+#endif
+
+int main(int argc, char **argv)
+{
+    typedef TTAG(LensProblemEcfvAd) ProblemTypeTag;
+
+    // initialize MPI, finalize is done automatically on exit
+#if HAVE_DUNE_FEM
+    Dune::Fem::MPIManager::initialize(argc, argv);
+#endif
+    const auto& mpiHelper = Dune::MPIHelper::instance(argc, argv);
+
+#if HAVE_MPI
+    // the first half of the processes simulates the first member of the ensemble, the
+    // remaining ones the second member
+    int numMembers = std::min(2, mpiHelper.size());
+    int memberIdx = mpiHelper.rank()*numMembers/mpiHelper.size();
+
+    MPI_Comm memberComm;
+    MPI_Comm_split(MPI_COMM_WORLD, memberIdx, mpiHelper.rank(), &memberComm);
+
+    int status = Ewoms::start<ProblemTypeTag>(argc, argv, memberComm);
+
+    MPI_Comm_free(&memberComm);
+
+    // the ensemble run fails if the simulation of any member fails
+    int globalStatus = status;
+    MPI_Allreduce(&status, &globalStatus, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    return globalStatus;
+#else
+    return Ewoms::start<ProblemTypeTag>(argc, argv, mpiHelper.getCommunicator());
+#endif
+}
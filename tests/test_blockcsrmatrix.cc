@@ -0,0 +1,201 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \brief Checks that the kernels of the compact block-CSR matrix produce the same
+ *        results as the corresponding operations of Dune::BCRSMatrix.
+ */
+#include "config.h"
+
+#include <ewoms/linear/blockcsrmatrix.hh>
+
+#include <dune/common/parallel/mpihelper.hh>
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/ilu.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// a block size which is not a multiple of the SIMD width, i.e., the blocks of the
+// compact matrix are padded
+static const int blockSize = 3;
+typedef double Scalar;
+typedef Dune::FieldMatrix<Scalar, blockSize, blockSize> MatrixBlock;
+typedef Dune::BCRSMatrix<MatrixBlock> Matrix;
+typedef Dune::FieldVector<Scalar, blockSize> VectorBlock;
+typedef Dune::BlockVector<VectorBlock> Vector;
+typedef Ewoms::Linear::BlockCsrMatrix<Scalar, blockSize> CompactMatrix;
+
+// assemble an unsymmetric operator on a structured nx times ny grid using a five
+// point stencil with diagonally dominant blocks
+void assembleMatrix(Matrix& A, unsigned nx, unsigned ny)
+{
+    unsigned n = nx*ny;
+    A.setSize(n, n, 5*n);
+    A.setBuildMode(Matrix::row_wise);
+    for (auto rowIt = A.createbegin(); rowIt != A.createend(); ++rowIt) {
+        unsigned rowIdx = static_cast<unsigned>(rowIt.index());
+        unsigned i = rowIdx % nx;
+        unsigned j = rowIdx / nx;
+        if (j > 0)
+            rowIt.insert(rowIdx - nx);
+        if (i > 0)
+            rowIt.insert(rowIdx - 1);
+        rowIt.insert(rowIdx);
+        if (i + 1 < nx)
+            rowIt.insert(rowIdx + 1);
+        if (j + 1 < ny)
+            rowIt.insert(rowIdx + nx);
+    }
+
+    for (unsigned rowIdx = 0; rowIdx < n; ++rowIdx) {
+        auto& row = A[rowIdx];
+        for (auto colIt = row.begin(); colIt != row.end(); ++colIt) {
+            unsigned colIdx = static_cast<unsigned>(colIt.index());
+            MatrixBlock& block = *colIt;
+            for (int k = 0; k < blockSize; ++k) {
+                for (int l = 0; l < blockSize; ++l) {
+                    Scalar val = 0.1*std::cos(1.0 + rowIdx + 3.0*colIdx + 5.0*k + 7.0*l);
+                    if (colIdx == rowIdx && k == l)
+                        val += 8.0;
+                    block[k][l] = val;
+                }
+            }
+        }
+    }
+}
+
+void fillVector(Vector& x, Scalar offset)
+{
+    for (unsigned i = 0; i < x.size(); ++i)
+        for (unsigned k = 0; k < blockSize; ++k)
+            x[i][k] = std::sin(offset + i*blockSize + k);
+}
+
+bool compare(const std::string& name, const Vector& result, const Vector& reference)
+{
+    Scalar maxDiff = 0.0;
+    Scalar maxVal = 0.0;
+    for (unsigned i = 0; i < reference.size(); ++i) {
+        for (unsigned k = 0; k < blockSize; ++k) {
+            maxDiff = std::max(maxDiff, std::abs(result[i][k] - reference[i][k]));
+            maxVal = std::max(maxVal, std::abs(reference[i][k]));
+        }
+    }
+
+    std::cout << name << ": maximum difference to Dune::BCRSMatrix: " << maxDiff << "\n";
+
+    return maxDiff <= 1e-12*std::max(maxVal, 1.0);
+}
+
+int main(int argc, char **argv)
+{
+    // initialize MPI, finalize is done automatically on exit
+    Dune::MPIHelper::instance(argc, argv);
+
+    Matrix A;
+    assembleMatrix(A, /*nx=*/11, /*ny=*/6);
+
+    CompactMatrix compactA;
+    compactA.setPattern(A);
+    compactA.assign(A);
+
+    Vector x(A.N());
+    fillVector(x, 1.0);
+
+    bool success = true;
+
+    // y = A x
+    Vector y(A.N());
+    Vector yRef(A.N());
+    compactA.mv(x, y);
+    A.mv(x, yRef);
+    success = compare("mv", y, yRef) && success;
+
+    // y = y + alpha A x
+    fillVector(y, 2.0);
+    fillVector(yRef, 2.0);
+    compactA.usmv(-0.5, x, y);
+    A.usmv(-0.5, x, yRef);
+    success = compare("usmv", y, yRef) && success;
+
+    // the same for two disjoint subsets of the rows
+    std::vector<unsigned> evenRows;
+    std::vector<unsigned> oddRows;
+    for (unsigned rowIdx = 0; rowIdx < A.N(); ++rowIdx)
+        (rowIdx % 2 == 0 ? evenRows : oddRows).push_back(rowIdx);
+
+    y = 0.0;
+    compactA.mv(x, y, evenRows);
+    compactA.mv(x, y, oddRows);
+    A.mv(x, yRef);
+    success = compare("mv for a subset of rows", y, yRef) && success;
+
+    fillVector(y, 2.0);
+    fillVector(yRef, 2.0);
+    compactA.usmv(1.5, x, y, oddRows);
+    compactA.usmv(1.5, x, y, evenRows);
+    A.usmv(1.5, x, yRef);
+    success = compare("usmv for a subset of rows", y, yRef) && success;
+
+    // triangular solves using an ILU(0) factorization
+    Matrix ilu(A);
+    Dune::bilu0_decomposition(ilu);
+
+    CompactMatrix compactIlu;
+    compactIlu.setPattern(ilu);
+    compactIlu.assign(ilu);
+
+    Vector d(A.N());
+    fillVector(d, 3.0);
+
+    Vector v(A.N());
+    for (unsigned rowIdx = 0; rowIdx < A.N(); ++rowIdx)
+        compactIlu.iluForwardRow(rowIdx, d, v);
+    for (unsigned rowIdx = static_cast<unsigned>(A.N()); rowIdx > 0; --rowIdx)
+        compactIlu.iluBackwardRow(rowIdx - 1, v);
+
+    Vector vRef(A.N());
+    Dune::bilu_backsolve(ilu, vRef, d);
+    success = compare("ILU(0) apply", v, vRef) && success;
+
+    // changing the values must not require a new pattern
+    A *= 2.0;
+    compactA.assign(A);
+    compactA.mv(x, y);
+    A.mv(x, yRef);
+    success = compare("mv after assigning new values", y, yRef) && success;
+
+    if (!success) {
+        std::cerr << "The kernels of the compact block-CSR matrix are incorrect\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,228 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \brief Writes a convergence trace of the Newton method, reads it back and checks
+ *        the records.
+ */
+#include "config.h"
+
+#include <ewoms/nonlinear/newtonconvergencetrace.hh>
+#include <ewoms/common/propertysystem.hh>
+
+#include <dune/common/fvector.hh>
+#include <dune/istl/bvector.hh>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace Ewoms {
+namespace Properties {
+NEW_TYPE_TAG(ConvergenceTraceTest);
+
+SET_TYPE_PROP(ConvergenceTraceTest, Scalar, double);
+SET_INT_PROP(ConvergenceTraceTest, NumEq, 2);
+SET_TYPE_PROP(ConvergenceTraceTest,
+              GlobalEqVector,
+              Dune::BlockVector<Dune::FieldVector<double, 2> >);
+}} // namespace Properties, Ewoms
+
+typedef TTAG(ConvergenceTraceTest) TypeTag;
+typedef GET_PROP_TYPE(TypeTag, GlobalEqVector) GlobalEqVector;
+typedef Ewoms::NewtonConvergenceTrace<TypeTag> ConvergenceTrace;
+
+static const unsigned numEq = 2;
+
+// a model consisting of four degrees of freedom, the last of which is in the overlap
+// of the process
+class Model
+{
+public:
+    size_t numGridDof() const
+    { return 4; }
+
+    bool isLocalDof(unsigned dofIdx) const
+    { return dofIdx < 3; }
+
+    double eqWeight(unsigned dofIdx OPM_UNUSED, unsigned eqIdx) const
+    { return (eqIdx == 0) ? 1.0 : 2.0; }
+};
+
+class Timer
+{
+public:
+    explicit Timer(double elapsed)
+        : elapsed_(elapsed)
+    {}
+
+    double realTimeElapsed() const
+    { return elapsed_; }
+
+private:
+    double elapsed_;
+};
+
+// reads the binary representation of objects from a file
+class TraceReader
+{
+public:
+    explicit TraceReader(const std::string& fileName)
+        : stream_(fileName.c_str(), std::ios::binary)
+    {}
+
+    template <class T>
+    T read()
+    {
+        T value;
+        stream_.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return value;
+    }
+
+    bool good() const
+    { return stream_.good(); }
+
+    bool atEnd()
+    { return stream_.peek() == std::char_traits<char>::eof(); }
+
+private:
+    std::ifstream stream_;
+};
+
+bool checkValue(const std::string& name, double value, double expected)
+{
+    if (std::abs(value - expected) <= 1e-12*std::max(1.0, std::abs(expected)))
+        return true;
+
+    std::cout << name << " is " << value << " instead of " << expected << "\n";
+    return false;
+}
+
+int main()
+{
+    const std::string fileName = "test_convergencetrace.nct";
+    const int rank = 3;
+
+    Model model;
+    GlobalEqVector residual(model.numGridDof());
+    GlobalEqVector update(model.numGridDof());
+    residual[0][0] = 1.0;  residual[0][1] = -0.5;
+    residual[1][0] = -3.0; residual[1][1] = 0.25;
+    residual[2][0] = 0.0;  residual[2][1] = 2.0;
+    // the overlap DOF must be ignored
+    residual[3][0] = 1e3;  residual[3][1] = -1e3;
+    update[0][0] = 0.1;    update[0][1] = -0.2;
+    update[1][0] = -0.3;   update[1][1] = 0.05;
+    update[2][0] = 0.0;    update[2][1] = 0.0;
+    update[3][0] = 1e3;    update[3][1] = 1e3;
+
+    {
+        ConvergenceTrace trace(fileName, rank);
+        trace.beginTimeStep(/*timeStepIdx=*/7, /*time=*/10.0, /*timeStepSize=*/2.0);
+        trace.recordResidual(model, residual);
+        trace.recordLinearSolve(12);
+        trace.recordUpdate(model, update);
+        trace.endIteration(/*iterationIdx=*/0, /*error=*/0.5,
+                           Timer(1.5), Timer(2.5), Timer(3.5));
+        trace.endTimeStep(/*converged=*/true, /*numIterations=*/1);
+        trace.close();
+    }
+
+    bool success = true;
+    TraceReader reader(fileName);
+
+    // header
+    char magic[8];
+    for (unsigned i = 0; i < 8; ++i)
+        magic[i] = reader.read<char>();
+    const char expectedMagic[8] = { 'E', 'W', 'N', 'C', 'T', 'R', 'C', 0 };
+    if (std::memcmp(magic, expectedMagic, sizeof(magic)) != 0) {
+        std::cout << "Invalid magic string\n";
+        success = false;
+    }
+    success = checkValue("format version", reader.read<uint32_t>(), 1) && success;
+    success = checkValue("number of equations", reader.read<uint32_t>(), numEq) && success;
+    success = checkValue("number of worst DOFs", reader.read<uint32_t>(),
+                         ConvergenceTrace::numWorstDof) && success;
+    success = checkValue("rank", reader.read<int32_t>(), rank) && success;
+
+    // begin of the time step
+    success = checkValue("record type", reader.read<uint32_t>(),
+                         ConvergenceTrace::beginTimeStepRecord) && success;
+    success = checkValue("time step index", reader.read<int32_t>(), 7) && success;
+    success = checkValue("time", reader.read<double>(), 10.0) && success;
+    success = checkValue("time step size", reader.read<double>(), 2.0) && success;
+
+    // the Newton iteration. the weighted residuals of the local DOFs are (1, 1),
+    // (3, 0.5) and (0, 4)
+    success = checkValue("record type", reader.read<uint32_t>(),
+                         ConvergenceTrace::iterationRecord) && success;
+    success = checkValue("iteration index", reader.read<int32_t>(), 0) && success;
+    success = checkValue("error", reader.read<double>(), 0.5) && success;
+    const double residualMax[numEq] = { 3.0, 4.0 };
+    const double residualSum[numEq] = { 4.0, 5.5 };
+    const double updateMax[numEq] = { 0.3, 0.2 };
+    for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+        success = checkValue("maximum residual", reader.read<double>(), residualMax[eqIdx]) && success;
+    for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+        success = checkValue("residual sum", reader.read<double>(), residualSum[eqIdx]) && success;
+    for (unsigned pvIdx = 0; pvIdx < numEq; ++pvIdx)
+        success = checkValue("maximum update", reader.read<double>(), updateMax[pvIdx]) && success;
+
+    const uint32_t invalidIdx = 0xffffffff;
+    const uint32_t worstDofIdx[ConvergenceTrace::numWorstDof] = { 2, 1, 0, invalidIdx, invalidIdx };
+    const double worstDofResidual[ConvergenceTrace::numWorstDof] = { 4.0, 3.0, 1.0, 0.0, 0.0 };
+    for (unsigned i = 0; i < ConvergenceTrace::numWorstDof; ++i) {
+        success = checkValue("worst DOF index", reader.read<uint32_t>(), worstDofIdx[i]) && success;
+        success = checkValue("worst DOF residual", reader.read<double>(), worstDofResidual[i]) && success;
+    }
+    success = checkValue("linear iterations", reader.read<uint32_t>(), 12) && success;
+    success = checkValue("linearization time", reader.read<double>(), 1.5) && success;
+    success = checkValue("solve time", reader.read<double>(), 2.5) && success;
+    success = checkValue("update time", reader.read<double>(), 3.5) && success;
+
+    // end of the time step
+    success = checkValue("record type", reader.read<uint32_t>(),
+                         ConvergenceTrace::endTimeStepRecord) && success;
+    success = checkValue("convergence flag", reader.read<uint32_t>(), 1) && success;
+    success = checkValue("number of iterations", reader.read<int32_t>(), 1) && success;
+
+    if (!reader.good() || !reader.atEnd()) {
+        std::cout << "The trace file does not have the expected size\n";
+        success = false;
+    }
+
+    std::remove(fileName.c_str());
+
+    if (!success) {
+        std::cerr << "The convergence trace of the Newton method is invalid\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \brief Checks that the cell weights for distributing ebos grids are read correctly
+ *        and that the grid manager for Dune::CpGrid refuses to ignore them.
+ */
+#include "config.h"
+
+#include <ebos/eclproblem.hh>
+#include <ewoms/common/start.hh>
+
+#include <dune/common/parallel/mpihelper.hh>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Ewoms {
+namespace Properties {
+NEW_TYPE_TAG(TestEclLoadBalancingTypeTag, INHERITS_FROM(BlackOilModel, EclBaseProblem));
+}}
+
+typedef TTAG(TestEclLoadBalancingTypeTag) TypeTag;
+typedef GET_PROP_TYPE(TypeTag, Simulator) Simulator;
+
+void setupParameters(const std::vector<std::string>& args)
+{
+    std::vector<const char*> argv = { "test_eclloadbalancing", "--ecl-deck-file-name=data/equil_base.DATA" };
+    for (const auto& arg : args)
+        argv.push_back(arg.c_str());
+
+    Ewoms::setupParameters_<TypeTag>(static_cast<int>(argv.size()), argv.data(), /*registerParams=*/false);
+}
+
+bool checkWeight(const std::unordered_map<int, double>& weights, int cartIdx, double expected)
+{
+    auto it = weights.find(cartIdx);
+    if (it != weights.end() && it->second == expected)
+        return true;
+
+    std::cout << "The load balancing weight of cell " << cartIdx << " is ";
+    if (it == weights.end())
+        std::cout << "not specified";
+    else
+        std::cout << it->second;
+    std::cout << " instead of " << expected << "\n";
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    // initialize MPI, finalize is done automatically on exit
+    Dune::MPIHelper::instance(argc, argv);
+
+    Ewoms::registerAllParameters_<TypeTag>();
+
+    bool success = true;
+
+    // without any weights, the grid can be distributed
+    setupParameters({});
+    std::unique_ptr<Simulator> simulator(new Simulator);
+    if (!simulator->gridManager().cartesianLoadWeights().empty()) {
+        std::cout << "Load balancing weights were produced without being requested\n";
+        success = false;
+    }
+
+    // read the weights from a file
+    const std::string weightsFileName = "test_eclloadbalancing.weights";
+    {
+        std::ofstream weightsFile(weightsFileName);
+        weightsFile << "0 2.5\n"
+                    << "7 4\n";
+    }
+    setupParameters({ "--ecl-load-balance-weights-file=" + weightsFileName });
+
+    const auto& weights = simulator->gridManager().cartesianLoadWeights();
+    if (weights.size() != 2) {
+        std::cout << "Expected 2 load balancing weights, got " << weights.size() << "\n";
+        success = false;
+    }
+    success = checkWeight(weights, 0, 2.5) && success;
+    success = checkWeight(weights, 7, 4.0) && success;
+
+    // Dune::CpGrid cannot take the weights into account, so they must be rejected
+    try {
+        Simulator weightedSimulator;
+        std::cout << "The grid was distributed although the cell weights cannot be used\n";
+        success = false;
+    }
+    catch (const std::invalid_argument& e) {
+        std::cout << "Rejected the cell weights: " << e.what() << "\n";
+    }
+
+    // non-positive weights are invalid
+    {
+        std::ofstream weightsFile(weightsFileName);
+        weightsFile << "3 -1\n";
+    }
+    try {
+        simulator->gridManager().cartesianLoadWeights();
+        std::cout << "A negative load balancing weight was accepted\n";
+        success = false;
+    }
+    catch (const std::runtime_error& e) {
+        std::cout << "Rejected the negative weight: " << e.what() << "\n";
+    }
+
+    std::remove(weightsFileName.c_str());
+
+    if (!success) {
+        std::cerr << "The load balancing weights of the ECL grid managers misbehaved\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \brief Checks that the divergence detection of the Newton method aborts hopeless
+ *        time steps but keeps the ones which converge.
+ */
+#include "config.h"
+
+#include <ewoms/nonlinear/newtondivergencedetector.hh>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+typedef double Scalar;
+
+static const Scalar stagnationRate = 0.9;
+static const Scalar tolerance = 1e-8;
+static const int maxIterations = 10;
+
+// feed the errors of the iterations of a time step to the detector and return the
+// index of the iteration at which the time step was aborted or -1 if it was not
+int abortIteration(const std::vector<Scalar>& errors)
+{
+    Ewoms::NewtonDivergenceDetector<Scalar> detector(stagnationRate);
+    for (unsigned iterIdx = 0; iterIdx < errors.size(); ++iterIdx)
+        if (detector.update(static_cast<int>(iterIdx), errors[iterIdx], tolerance, maxIterations))
+            return static_cast<int>(iterIdx);
+    return -1;
+}
+
+bool check(const std::string& name, const std::vector<Scalar>& errors, bool expectAbort)
+{
+    int abortIdx = abortIteration(errors);
+    bool success = (abortIdx >= 0) == expectAbort;
+
+    std::cout << name << ": ";
+    if (abortIdx >= 0)
+        std::cout << "aborted in iteration " << abortIdx;
+    else
+        std::cout << "not aborted";
+    std::cout << (success?"":" (unexpected)") << "\n";
+
+    return success;
+}
+
+int main()
+{
+    bool success = true;
+
+    // quadratic convergence which starts slowly. assuming a linear rate of
+    // convergence, the tolerance would not be reached within the allowed iterations
+    // after the third one.
+    success = check("quadratic convergence",
+                    { 1.0, 0.5, 0.25, 0.0625, 3.9e-3, 1.5e-5, 2.3e-10 },
+                    /*expectAbort=*/false) && success;
+
+    // linear convergence which is fast enough
+    success = check("fast linear convergence",
+                    { 1.0, 0.1, 1e-2, 1e-3, 1e-4, 1e-5, 1e-6, 1e-7, 1e-8, 1e-9 },
+                    /*expectAbort=*/false) && success;
+
+    // a single increase of the error is tolerated
+    success = check("temporary growth",
+                    { 1.0, 2.0, 0.5, 1e-2, 1e-4, 1e-8, 1e-16 },
+                    /*expectAbort=*/false) && success;
+
+    // linear convergence which is too slow to reach the tolerance
+    success = check("slow linear convergence",
+                    { 1.0, 0.5, 0.25, 0.125, 0.0625, 0.03125, 0.015625 },
+                    /*expectAbort=*/true) && success;
+
+    // stagnating error
+    success = check("stagnation",
+                    { 1.0, 0.95, 0.93, 0.92, 0.91, 0.9 },
+                    /*expectAbort=*/true) && success;
+
+    // exploding error
+    success = check("growth",
+                    { 1.0, 2.0, 4.0, 8.0 },
+                    /*expectAbort=*/true) && success;
+
+    if (!success) {
+        std::cerr << "The divergence detection of the Newton method misbehaved\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,148 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \brief Checks that the threaded ILU(0) preconditioner produces the same result as
+ *        Dune::SeqILU0 for several relaxation factors.
+ */
+#include "config.h"
+
+#include <ewoms/linear/threadedilu0.hh>
+
+#include <dune/common/parallel/mpihelper.hh>
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/preconditioners.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+static const int blockSize = 2;
+typedef double Scalar;
+typedef Dune::FieldMatrix<Scalar, blockSize, blockSize> MatrixBlock;
+typedef Dune::BCRSMatrix<MatrixBlock> Matrix;
+typedef Dune::FieldVector<Scalar, blockSize> VectorBlock;
+typedef Dune::BlockVector<VectorBlock> Vector;
+
+// assemble an unsymmetric operator on a structured nx times ny grid using a five
+// point stencil. the off-diagonal blocks are chosen such that the rows of the
+// backward substitution depend on each other via several levels.
+void assembleMatrix(Matrix& A, unsigned nx, unsigned ny)
+{
+    unsigned n = nx*ny;
+    A.setSize(n, n, 5*n);
+    A.setBuildMode(Matrix::row_wise);
+    for (auto rowIt = A.createbegin(); rowIt != A.createend(); ++rowIt) {
+        unsigned rowIdx = static_cast<unsigned>(rowIt.index());
+        unsigned i = rowIdx % nx;
+        unsigned j = rowIdx / nx;
+        if (j > 0)
+            rowIt.insert(rowIdx - nx);
+        if (i > 0)
+            rowIt.insert(rowIdx - 1);
+        rowIt.insert(rowIdx);
+        if (i + 1 < nx)
+            rowIt.insert(rowIdx + 1);
+        if (j + 1 < ny)
+            rowIt.insert(rowIdx + nx);
+    }
+
+    for (unsigned rowIdx = 0; rowIdx < n; ++rowIdx) {
+        auto& row = A[rowIdx];
+        for (auto colIt = row.begin(); colIt != row.end(); ++colIt) {
+            unsigned colIdx = static_cast<unsigned>(colIt.index());
+            MatrixBlock& block = *colIt;
+            if (colIdx == rowIdx) {
+                block[0][0] = 4.5;
+                block[0][1] = 0.3;
+                block[1][0] = -0.2;
+                block[1][1] = 5.0;
+            }
+            else {
+                Scalar s = (colIdx < rowIdx) ? -1.0 : -0.7;
+                block[0][0] = s;
+                block[0][1] = 0.1*s;
+                block[1][0] = 0.05;
+                block[1][1] = 1.1*s;
+            }
+        }
+    }
+}
+
+bool compare(const Matrix& A, Scalar relaxationFactor)
+{
+    Vector d(A.N());
+    for (unsigned i = 0; i < d.size(); ++i)
+        for (unsigned k = 0; k < blockSize; ++k)
+            d[i][k] = std::sin(1.0 + i*blockSize + k);
+
+    Vector vSeq(A.N());
+    Vector vThreaded(A.N());
+    vSeq = 0.0;
+    vThreaded = 0.0;
+
+    Dune::SeqILU0<Matrix, Vector, Vector> seqIlu(A, relaxationFactor);
+    Ewoms::Linear::ThreadedILU0<Matrix, Vector, Vector> threadedIlu(A, relaxationFactor);
+
+    Vector dTmp(d);
+    seqIlu.apply(vSeq, dTmp);
+    threadedIlu.apply(vThreaded, d);
+
+    Scalar maxDiff = 0.0;
+    Scalar maxVal = 0.0;
+    for (unsigned i = 0; i < vSeq.size(); ++i) {
+        for (unsigned k = 0; k < blockSize; ++k) {
+            maxDiff = std::max(maxDiff, std::abs(vSeq[i][k] - vThreaded[i][k]));
+            maxVal = std::max(maxVal, std::abs(vSeq[i][k]));
+        }
+    }
+
+    std::cout << "relaxation factor " << relaxationFactor
+              << ": maximum difference to SeqILU0: " << maxDiff << "\n";
+
+    return maxDiff <= 1e-12*std::max(maxVal, 1.0);
+}
+
+int main(int argc, char **argv)
+{
+    // initialize MPI, finalize is done automatically on exit
+    Dune::MPIHelper::instance(argc, argv);
+
+    Matrix A;
+    assembleMatrix(A, /*nx=*/13, /*ny=*/7);
+
+    bool success = true;
+    success = compare(A, 1.0) && success;
+    success = compare(A, 0.7) && success;
+    success = compare(A, 1.3) && success;
+
+    if (!success) {
+        std::cerr << "The threaded ILU(0) preconditioner differs from Dune::SeqILU0\n";
+        return 1;
+    }
+
+    return 0;
+}